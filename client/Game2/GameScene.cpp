@@ -26,6 +26,7 @@
 #include "../../engine/Player/Player.h"
 #include "../../engine/Util/Duration.h"
 #include "../../engine/Util/Loader.h"
+#include "../../engine/Util/WorkerPool.h"
 #include "../../engine/VideoServices/SoundServer.h"
 #include "../../engine/VideoServices/VideoBuffer.h"
 
@@ -103,16 +104,25 @@ void GameScene::ScheduleLoad(std::shared_ptr<Loader> loader)
 {
 	auto rulebook = rules->GetRulebook();
 
-	loader->AddLoader("Track and players", [=]{
-		// Load the selected track
-		std::shared_ptr<Model::Track> track;
-
+	// The track is read and parsed in the background, since that's the
+	// slowest part of loading and doesn't touch the display.
+	auto trackHolder = std::make_shared<std::shared_ptr<Model::Track>>();
+	auto gameOpts = rules->GetGameOpts();
+	loader->AddBackgroundLoader("Track", [=]{
 		auto entry = this->rules->GetTrackEntry();
 		if (!entry) throw Parcel::ObjStreamExn("Track does not exist.");
-		track = Config::GetInstance()->GetTrackBundle()->OpenTrack(entry);
+		auto track = Config::GetInstance()->GetTrackBundle()->OpenTrack(entry);
 		if (!track) throw Parcel::ObjStreamExn(
 			"Track does not exist: " + entry->name);
-		if (!session->LoadNew(entry->name.c_str(), scripting,
+		track->Load(true, gameOpts);
+		*trackHolder = track;
+	});
+
+	loader->AddLoader("Track and players", [=]{
+		auto track = *trackHolder;
+		const auto &entry = track->GetHeader();
+
+		if (!session->LoadNew(entry.name.c_str(), scripting,
 			track, &display.GetLegacyDisplay()))
 		{
 			throw Parcel::ObjStreamExn("Track load failed.");
@@ -244,11 +254,43 @@ void GameScene::Render()
 		VideoServices::VideoBuffer *videoBuf = &display.GetLegacyDisplay();
 		VideoServices::VideoBuffer::Lock lock(*videoBuf);
 
-		int i = 0;
-		for (auto &viewport : viewports) {
-			viewport.observer->RenderNormalDisplay(videoBuf, session,
-				session->GetPlayer(i++)->GetMainCharacter(),
+		// Each viewport renders the world into its own region of the
+		// buffer, so split-screen viewports can be rendered in parallel.
+		// A single viewport may use the pool itself to render in bands.
+		// The elements are drawn afterwards, one viewport at a time, since
+		// they may update their own state while being drawn.
+		const int numViewports = static_cast<int>(viewports.size());
+		if (!renderPool) {
+			unsigned int hwThreads =
+				std::max(1u, std::thread::hardware_concurrency());
+			if (numViewports > 1) {
+				renderPool.reset(new WorkerPool(std::min(
+					static_cast<unsigned int>(numViewports), hwThreads)));
+			}
+			else if (hwThreads > 1 && cfg->video.bandedRendering) {
+				renderPool.reset(new WorkerPool(hwThreads));
+				viewports.front().observer->SetRenderPool(renderPool.get());
+			}
+		}
+
+		auto renderWorld = [&](int i) {
+			viewports[i].observer->RenderNormalDisplayWorld(videoBuf, session,
+				session->GetPlayer(i)->GetMainCharacter(),
 				simTime, session->GetBackImage());
+		};
+
+		if (renderPool && numViewports > 1) {
+			renderPool->ParallelFor(numViewports, renderWorld);
+		}
+		else {
+			for (int i = 0; i < numViewports; i++) {
+				renderWorld(i);
+			}
+		}
+
+		for (int i = 0; i < numViewports; i++) {
+			viewports[i].observer->RenderNormalDisplayElements(session,
+				session->GetPlayer(i)->GetMainCharacter(), simTime);
 		}
 	}
 
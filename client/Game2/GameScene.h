@@ -57,6 +57,7 @@ namespace HoverRace {
 	}
 	namespace Util {
 		class Loader;
+		class WorkerPool;
 	}
 }
 
@@ -139,6 +140,7 @@ protected:
 	ClientSession *session;
 
 private:
+	std::unique_ptr<Util::WorkerPool> renderPool;  ///< For split-screen or banded rendering.
 	boost::signals2::scoped_connection finishedLoadingConn;
 
 	std::shared_ptr<HoverScript::MetaSession> metaSession;
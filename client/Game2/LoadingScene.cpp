@@ -19,6 +19,8 @@
 // See the License for the specific language governing permissions
 // and limitations under the License.
 
+#include "../../engine/Display/Container.h"
+#include "../../engine/Display/FillBox.h"
 #include "../../engine/Display/ScreenFade.h"
 #include "../../engine/Util/Loader.h"
 #include "../../engine/Util/Log.h"
@@ -30,6 +32,11 @@ using namespace HoverRace::Util;
 namespace HoverRace {
 namespace Client {
 
+namespace {
+	const double PROGRESS_WIDTH = 1280;
+	const double PROGRESS_HEIGHT = 4;
+}
+
 LoadingScene::LoadingScene(Display::Display &display, GameDirector &director,
                            const std::string &name) :
 	SUPER(display, name),
@@ -44,6 +51,10 @@ LoadingScene::LoadingScene(Display::Display &display, GameDirector &director,
 
 	fader.reset(new ScreenFade(s.dialogBg, 0.0));
 	fader->AttachView(display);
+
+	// Grows along the bottom of the screen as the loaders finish.
+	progressBar = GetRoot()->NewChild<FillBox>(0, PROGRESS_HEIGHT, s.formFg);
+	progressBar->SetPos(0, 720 - PROGRESS_HEIGHT);
 }
 
 LoadingScene::~LoadingScene()
@@ -81,6 +92,9 @@ void LoadingScene::PrepareRender()
 
 			loader->FireFinishedLoadingSignal();
 		}
+
+		progressBar->SetSize(PROGRESS_WIDTH * loader->GetProgress(),
+			PROGRESS_HEIGHT);
 	}
 
 	if (fader) {
@@ -27,6 +27,7 @@
 
 namespace HoverRace {
 	namespace Display {
+		class FillBox;
 		class ScreenFade;
 	}
 	namespace Util {
@@ -76,6 +77,7 @@ class LoadingScene : public FormScene
 		bool loading;
 		std::shared_ptr<Util::Loader> loader;
 		std::unique_ptr<Display::ScreenFade> fader;
+		std::shared_ptr<Display::FillBox> progressBar;
 };
 
 }  // namespace Client
@@ -25,6 +25,7 @@
 #include "../../engine/Model/Level.h"
 #include "../../engine/Model/MazeElement.h"
 #include "../../engine/Util/Config.h"
+#include "../../engine/Util/WorkerPool.h"
 
 #include <math.h>
 
@@ -37,6 +38,7 @@ using HoverRace::VideoServices::Ascii2Simple;
 
 #define NB_PLAYER_PAGE 10
 #define MR_CHAT_EXPIRATION     20
+#define MIN_BAND_WIDTH 32						  // Narrowest band worth a separate job
 
 namespace HoverRace {
 namespace Client {
@@ -96,6 +98,7 @@ namespace {
 
 Observer::Observer() :
 	hudVisible(true), demoMode(false),
+	renderPool(nullptr), bandSetupSerial(-1),
 	splitMode(Display::HudCell::FILL)
 {
 	globalFmts.Init();
@@ -146,6 +149,19 @@ void Observer::SetCockpitView(BOOL pOn)
 	mCockpitView = pOn;
 }
 
+/**
+ * Set the pool used to render the 3D view.
+ * When set, the view is split into vertical bands which are rendered
+ * concurrently.  The output is the same as rendering it in one piece.
+ * @param pool The pool (may be @c nullptr to render on the calling thread).
+ *             The pool must not be running another job while this observer
+ *             is rendering.
+ */
+void Observer::SetRenderPool(Util::WorkerPool *pool)
+{
+	renderPool = pool;
+}
+
 const std::string &Observer::GetCraftName(int id)
 {
 	static const std::string names[4] = {
@@ -429,10 +445,21 @@ void Observer::DrawWFSection(const Model::Level * pLevel, const Model::SectionId
 
 void Observer::Render3DView(const ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime, const MR_UInt8 * pBackImage)
 {
-	using HoverRace::VideoServices::Sprite;
-
-	const bool drawHud = hudVisible && Config::GetInstance()->runtime.enableHud;
+	Render3DWorld(pSession, pViewingCharacter, pTime, pBackImage);
+	Render3DElements(pSession, pViewingCharacter, pTime);
+}
 
+/**
+ * Set up the camera and draw the static part of the world.
+ * This only draws into this observer's viewport, so several observers can
+ * do this at once.
+ * @param pSession The session.
+ * @param pViewingCharacter The character the camera follows.
+ * @param pTime The current simulation time.
+ * @param pBackImage The background bitmap (may be @c NULL).
+ */
+void Observer::Render3DWorld(const ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime, const MR_UInt8 * pBackImage)
+{
 	const Model::Level *lLevel = pSession->GetCurrentLevel();
 
 	MR_3DCoordinate lCameraPos;
@@ -483,54 +510,66 @@ void Observer::Render3DView(const ClientSession *pSession, const MainCharacter::
 	if(pBackImage == NULL) {
 		m3DView.Clear(0);						  // Will have to be replace by a bitmapped background
 	}
-	else {
-		m3DView.RenderBackground(pBackImage);
-	}
-
-	m3DView.ClearZ();
 
-	int lCounter;
-
-	// Floor and ceiling drawing
-
-	int lTotalSections = lLevel->GetNbVisibleSurface(lRoom);
-	const Model::SectionId *lFloorList = lLevel->GetVisibleFloorList(lRoom);
-	const Model::SectionId *lCeilingList = lLevel->GetVisibleCeilingList(lRoom);
-
-	for(lCounter = 0; lCounter < lTotalSections; lCounter++) {
-		// Draw the floor
-		RenderFloorOrCeiling(lLevel, lFloorList[lCounter], TRUE, pTime);
-
-		// Render the ceiling
-		RenderFloorOrCeiling(lLevel, lCeilingList[lCounter], FALSE, pTime);
+	// The static part of the world is drawn in column bands.
+	// Each band is drawn by its own copy of the viewport, clipped to the band,
+	// with the same draw order as the full view.
+	int lNbBand = 1;
 
+	if(renderPool != NULL) {
+		lNbBand = std::min(static_cast<int>(renderPool->GetThreadCount()) * 2, m3DView.GetXRes() / MIN_BAND_WIDTH);
 	}
 
-	// Draw the walls and features of the visibles rooms
-
-	int lRoomCount;
-	const int *lRoomList = lLevel->GetVisibleZones(lRoom, lRoomCount);
-
-	for(lCounter = -1; lCounter < lRoomCount; lCounter++) {
-		int lRoomId;
-
-		if(lCounter == -1) {
-			lRoomId = lRoom;
+	if(lNbBand > 1) {
+		int lXRes = m3DView.GetXRes();
+
+		// The band copies (with their line and background tables) only
+		// need to be redone when the viewport is set up differently;
+		// otherwise just the camera moves.
+		if(static_cast<int>(bandViews.size()) != lNbBand || bandSetupSerial != m3DView.GetSetupSerial()) {
+			bandViews.resize(lNbBand);
+			for(int lBand = 0; lBand < lNbBand; lBand++) {
+				bandViews[lBand] = m3DView;
+				bandViews[lBand].SetColumnClip(lXRes * lBand / lNbBand, lXRes * (lBand + 1) / lNbBand);
+			}
+			bandSetupSerial = m3DView.GetSetupSerial();
 		}
 		else {
-			lRoomId = lRoomList[lCounter];
+			for(int lBand = 0; lBand < lNbBand; lBand++) {
+				bandViews[lBand].CopyCamera(m3DView);
+			}
 		}
 
-		// Draw all the features
+		renderPool->ParallelFor(lNbBand, [&](int lBand) {
+			RenderWorld(&bandViews[lBand], lLevel, lRoom, pTime, pBackImage);
+		});
+	}
+	else {
+		RenderWorld(&m3DView, lLevel, lRoom, pTime, pBackImage);
+	}
+}
 
-		int lNbFeature = lLevel->GetFeatureCount(lRoomId);
+/**
+ * Draw the free elements and the cockpit over the world.
+ * Elements may update their own animation state while being drawn, so this
+ * must only be called from one thread at a time, even for different
+ * observers.
+ * @param pSession The session.
+ * @param pViewingCharacter The character the camera follows.
+ * @param pTime The current simulation time.
+ */
+void Observer::Render3DElements(const ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime)
+{
+	using HoverRace::VideoServices::Sprite;
 
-		for(int lCounter2 = 0; lCounter2 < lNbFeature; lCounter2++) {
-			RenderFeatureWalls(lLevel, lLevel->GetFeature(lRoomId, lCounter2), pTime);
-		}
+	const bool drawHud = hudVisible && Config::GetInstance()->runtime.enableHud;
 
-		RenderRoomWalls(lLevel, lRoomId, pTime);
-	}
+	const Model::Level *lLevel = pSession->GetCurrentLevel();
+	int lRoom = pViewingCharacter->mRoom;
+
+	int lCounter;
+	int lRoomCount;
+	const int *lRoomList = lLevel->GetVisibleZones(lRoom, lRoomCount);
 
 	// Draw all the elements of the visibles room
 	for(lCounter = -1; lCounter < lRoomCount; lCounter++) {
@@ -676,6 +715,7 @@ void Observer::Render3DView(const ClientSession *pSession, const MainCharacter::
 			// Display list
 			for(int lCounter = lFirstPlayer; lCounter < lLastPlayer; lCounter++) {
 				char lBuffer[80];
+				char lSimpleBuffer[80];
 
 				const char *lPlayerName;
 				int lHoverId;
@@ -712,7 +752,7 @@ void Observer::Render3DView(const ClientSession *pSession, const MainCharacter::
 
 				}
 
-				mBaseFont->GetSprite()->StrBlt(lXRes / 2, lCurrentLine, Ascii2Simple(lBuffer), &m3DView, Sprite::eCenter, Sprite::eTop, lFontScaling);
+				mBaseFont->GetSprite()->StrBlt(lXRes / 2, lCurrentLine, Ascii2Simple(lBuffer, lSimpleBuffer, sizeof(lSimpleBuffer)), &m3DView, Sprite::eCenter, Sprite::eTop, lFontScaling);
 				lCurrentLine += lLineSpacing;
 			}
 		}
@@ -789,7 +829,70 @@ void Observer::Render3DView(const ClientSession *pSession, const MainCharacter::
 
 }
 
-void Observer::RenderRoomWalls(const Model::Level * pLevel, int lRoomId, MR_SimulationTime pTime)
+/**
+ * Draw the static part of the world: background, floors, ceilings and walls.
+ * This has no side effects besides drawing, so it can be run on several
+ * viewports (column bands) at once.
+ * @param pDest The viewport, with the camera already set up.
+ * @param pLevel The level.
+ * @param pRoom The room the camera is in.
+ * @param pTime The current simulation time.
+ * @param pBackImage The background bitmap (may be @c NULL).
+ */
+void Observer::RenderWorld(VideoServices::Viewport3D * pDest, const Model::Level * pLevel, int pRoom, MR_SimulationTime pTime, const MR_UInt8 * pBackImage)
+{
+	// The background was cleared already if there is no bitmap
+	if(pBackImage != NULL) {
+		pDest->RenderBackground(pBackImage);
+	}
+
+	pDest->ClearZ();
+
+	int lCounter;
+
+	// Floor and ceiling drawing
+
+	int lTotalSections = pLevel->GetNbVisibleSurface(pRoom);
+	const Model::SectionId *lFloorList = pLevel->GetVisibleFloorList(pRoom);
+	const Model::SectionId *lCeilingList = pLevel->GetVisibleCeilingList(pRoom);
+
+	for(lCounter = 0; lCounter < lTotalSections; lCounter++) {
+		// Draw the floor
+		RenderFloorOrCeiling(pDest, pLevel, lFloorList[lCounter], TRUE, pTime);
+
+		// Render the ceiling
+		RenderFloorOrCeiling(pDest, pLevel, lCeilingList[lCounter], FALSE, pTime);
+
+	}
+
+	// Draw the walls and features of the visibles rooms
+
+	int lRoomCount;
+	const int *lRoomList = pLevel->GetVisibleZones(pRoom, lRoomCount);
+
+	for(lCounter = -1; lCounter < lRoomCount; lCounter++) {
+		int lRoomId;
+
+		if(lCounter == -1) {
+			lRoomId = pRoom;
+		}
+		else {
+			lRoomId = lRoomList[lCounter];
+		}
+
+		// Draw all the features
+
+		int lNbFeature = pLevel->GetFeatureCount(lRoomId);
+
+		for(int lCounter2 = 0; lCounter2 < lNbFeature; lCounter2++) {
+			RenderFeatureWalls(pDest, pLevel, pLevel->GetFeature(lRoomId, lCounter2), pTime);
+		}
+
+		RenderRoomWalls(pDest, pLevel, lRoomId, pTime);
+	}
+}
+
+void Observer::RenderRoomWalls(VideoServices::Viewport3D * pDest, const Model::Level * pLevel, int lRoomId, MR_SimulationTime pTime)
 {
 	Model::PolygonShape *lSectionShape = pLevel->GetRoomShape(lRoomId);
 
@@ -824,7 +927,7 @@ void Observer::RenderRoomWalls(const Model::Level * pLevel, int lRoomId, MR_Simu
 				lP0.mZ = lCeilingLevel;
 				lP1.mZ = lFloorLevel;
 
-				lElement->RenderWallSurface(&m3DView, lP0, lP1, pLevel->GetRoomWallLen(lRoomId, lVertex), pTime);
+				lElement->RenderWallSurface(pDest, lP0, lP1, pLevel->GetRoomWallLen(lRoomId, lVertex), pTime);
 			}
 			else {
 				MR_Int32 lNeighborFloor = pLevel->GetRoomBottomLevel(lNeighbor);
@@ -834,14 +937,14 @@ void Observer::RenderRoomWalls(const Model::Level * pLevel, int lRoomId, MR_Simu
 					lP0.mZ = lNeighborFloor;
 					lP1.mZ = lFloorLevel;
 
-					lElement->RenderWallSurface(&m3DView, lP0, lP1, pLevel->GetRoomWallLen(lRoomId, lVertex), pTime);
+					lElement->RenderWallSurface(pDest, lP0, lP1, pLevel->GetRoomWallLen(lRoomId, lVertex), pTime);
 				}
 
 				if(lCeilingLevel > lNeighborCeiling) {
 					lP0.mZ = lCeilingLevel;
 					lP1.mZ = lNeighborCeiling;
 
-					lElement->RenderWallSurface(&m3DView, lP0, lP1, pLevel->GetRoomWallLen(lRoomId, lVertex), pTime);
+					lElement->RenderWallSurface(pDest, lP0, lP1, pLevel->GetRoomWallLen(lRoomId, lVertex), pTime);
 				}
 			}
 		}
@@ -854,7 +957,7 @@ void Observer::RenderRoomWalls(const Model::Level * pLevel, int lRoomId, MR_Simu
 	delete lSectionShape;
 }
 
-void Observer::RenderFeatureWalls(const Model::Level * pLevel, int lFeatureId, MR_SimulationTime pTime)
+void Observer::RenderFeatureWalls(VideoServices::Viewport3D * pDest, const Model::Level * pLevel, int lFeatureId, MR_SimulationTime pTime)
 {
 	Model::PolygonShape *lSectionShape = pLevel->GetFeatureShape(lFeatureId);
 
@@ -883,7 +986,7 @@ void Observer::RenderFeatureWalls(const Model::Level * pLevel, int lFeatureId, M
 		Model::SurfaceElement *lElement = pLevel->GetFeatureWallElement(lFeatureId, lVertex);
 
 		if(lElement != NULL) {
-			lElement->RenderWallSurface(&m3DView, lP0, lP1, pLevel->GetFeatureWallLen(lFeatureId, lVertex), pTime);
+			lElement->RenderWallSurface(pDest, lP0, lP1, pLevel->GetFeatureWallLen(lFeatureId, lVertex), pTime);
 		}
 
 		lP1.mX = lP0.mX;
@@ -893,7 +996,7 @@ void Observer::RenderFeatureWalls(const Model::Level * pLevel, int lFeatureId, M
 	delete lSectionShape;
 }
 
-void Observer::RenderFloorOrCeiling(const Model::Level * pLevel, const Model::SectionId & pSectionId, BOOL pFloor, MR_SimulationTime pTime)
+void Observer::RenderFloorOrCeiling(VideoServices::Viewport3D * pDest, const Model::Level * pLevel, const Model::SectionId & pSectionId, BOOL pFloor, MR_SimulationTime pTime)
 {
 	int lCounter;
 
@@ -937,7 +1040,7 @@ void Observer::RenderFloorOrCeiling(const Model::Level * pLevel, const Model::Se
 			lVertexList[lCounter].mY = lShape->Y(lCounter);
 		}
 
-		lElement->RenderHorizontalSurface(&m3DView, lNbVertex, lVertexList, lLevel, !pFloor, pTime);
+		lElement->RenderHorizontalSurface(pDest, lNbVertex, lVertexList, lLevel, !pFloor, pTime);
 	}
 
 	delete lShape;
@@ -999,6 +1102,24 @@ void Observer::RenderDebugDisplay(VideoServices::VideoBuffer * pDest, const Clie
 }
 
 void Observer::RenderNormalDisplay(VideoServices::VideoBuffer * pDest, const ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime, const MR_UInt8 * pBackImage)
+{
+	RenderNormalDisplayWorld(pDest, pSession, pViewingCharacter, pTime, pBackImage);
+	RenderNormalDisplayElements(pSession, pViewingCharacter, pTime);
+}
+
+/**
+ * Set up the viewport for the split mode and draw the static part of the
+ * world.
+ * Observers with different split modes draw into separate regions of the
+ * buffer, so this can be run for several of them at once; the elements are
+ * drawn afterwards with RenderNormalDisplayElements().
+ * @param pDest The destination buffer.
+ * @param pSession The session.
+ * @param pViewingCharacter The character the camera follows.
+ * @param pTime The current simulation time.
+ * @param pBackImage The background bitmap (may be @c NULL).
+ */
+void Observer::RenderNormalDisplayWorld(VideoServices::VideoBuffer * pDest, const ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime, const MR_UInt8 * pBackImage)
 {
 	using Cell = Display::HudCell;
 
@@ -1106,7 +1227,7 @@ void Observer::RenderNormalDisplay(VideoServices::VideoBuffer * pDest, const Cli
 
 		default:
 			throw UnimplementedExn(
-				"Observer::RenderNormalDisplay: Cell type: " +
+				"Observer::RenderNormalDisplayWorld: Cell type: " +
 					boost::lexical_cast<std::string>(splitMode));
 	}
 
@@ -1125,7 +1246,21 @@ void Observer::RenderNormalDisplay(VideoServices::VideoBuffer * pDest, const Cli
 	}
 
 	if(pViewingCharacter->mRoom != -1) {
-		Render3DView(pSession, pViewingCharacter, pTime, pBackImage);
+		Render3DWorld(pSession, pViewingCharacter, pTime, pBackImage);
+	}
+}
+
+/**
+ * Draw the elements and cockpit after RenderNormalDisplayWorld().
+ * Unlike the world, this must be done for one observer at a time.
+ * @param pSession The session.
+ * @param pViewingCharacter The character the camera follows.
+ * @param pTime The current simulation time.
+ */
+void Observer::RenderNormalDisplayElements(const ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime)
+{
+	if(pViewingCharacter->mRoom != -1) {
+		Render3DElements(pSession, pViewingCharacter, pTime);
 	}
 }
 
@@ -1134,39 +1269,76 @@ void Observer::PlaySounds(const Model::Level * pLevel, MainCharacter::MainCharac
 	// Play the sound of all moving elemnts arround
 
 	int lCurrentRoom = pViewingCharacter->mRoom;
+
+	PlayRoomSounds(pLevel, pViewingCharacter, lCurrentRoom, 255);
+
+	// The neighbors can always be heard
 	int lNeighborCount = pLevel->GetRoomVertexCount(lCurrentRoom);
+	std::vector<int> lPlayedRooms(1, lCurrentRoom);
 
-	for(int lCounter = -1; lCounter < lNeighborCount; lCounter++) {
-		int lRoomId;
+	for(int lCounter = 0; lCounter < lNeighborCount; lCounter++) {
+		int lRoomId = pLevel->GetNeighbor(lCurrentRoom, lCounter);
 
-		if(lCounter == -1) {
-			lRoomId = lCurrentRoom;
+		if(lRoomId != -1 &&
+			std::find(lPlayedRooms.begin(), lPlayedRooms.end(), lRoomId) == lPlayedRooms.end())
+		{
+			PlayRoomSounds(pLevel, pViewingCharacter, lRoomId, 255);
+			lPlayedRooms.push_back(lRoomId);
 		}
-		else {
-			lRoomId = pLevel->GetNeighbor(lCurrentRoom, lCounter);
+	}
+
+	// Plus the rooms further away that the track compiler found to be
+	// within earshot (older tracks have none)
+	int lNbAudible = pLevel->GetAudibleZoneCount(lCurrentRoom);
+
+	for(int lCounter = 0; lCounter < lNbAudible; lCounter++) {
+		int lCoefficient;
+		int lRoomId = pLevel->GetAudibleZone(lCurrentRoom, lCounter, lCoefficient);
+
+		if(lRoomId != -1 &&
+			std::find(lPlayedRooms.begin(), lPlayedRooms.end(), lRoomId) == lPlayedRooms.end())
+		{
+			PlayRoomSounds(pLevel, pViewingCharacter, lRoomId, lCoefficient);
+			lPlayedRooms.push_back(lRoomId);
 		}
+	}
+
+	pViewingCharacter->PlayInternalSounds();
+}
 
-		if(lRoomId != -1) {
-			MR_FreeElementHandle lHandle = pLevel->GetFirstFreeElement(lRoomId);
+/**
+ * Play the sounds of the elements in a single room.
+ * @param pLevel The level.
+ * @param pViewingCharacter The listener.
+ * @param pRoomId The room.
+ * @param pCoefficient The attenuation coefficient of the path to the room,
+ *                     from 255 (no attenuation) to 0 (silent).
+ */
+void Observer::PlayRoomSounds(const Model::Level * pLevel, MainCharacter::MainCharacter * pViewingCharacter, int pRoomId, int pCoefficient)
+{
+	// The sound can't be louder than the length of the path it took
+	int lPathDB = -(MR_MAX_AUDIBLE_DIST * (255 - pCoefficient) / 255) / 15;
 
-			while(lHandle != NULL) {
-				Model::FreeElement *lElement = Model::Level::GetFreeElement(lHandle);
+	MR_FreeElementHandle lHandle = pLevel->GetFirstFreeElement(pRoomId);
 
-				if(lElement != pViewingCharacter) {
-					double lXDist = pViewingCharacter->mPosition.mX - lElement->mPosition.mX;
-					double lYDist = pViewingCharacter->mPosition.mY - lElement->mPosition.mY;
+	while(lHandle != NULL) {
+		Model::FreeElement *lElement = Model::Level::GetFreeElement(lHandle);
 
-					int lDB = (int)(-sqrt(lXDist * lXDist + lYDist * lYDist) / 15.0);
+		if(lElement != pViewingCharacter) {
+			double lXDist = pViewingCharacter->mPosition.mX - lElement->mPosition.mX;
+			double lYDist = pViewingCharacter->mPosition.mY - lElement->mPosition.mY;
 
-					lElement->PlayExternalSounds(lDB, 0);
-				}
+			int lDB = (int)(-sqrt(lXDist * lXDist + lYDist * lYDist) / 15.0);
 
-				lHandle = Model::Level::GetNextFreeElement(lHandle);
+			if(lPathDB < lDB) {
+				lDB = lPathDB;
 			}
+
+			lElement->PlayExternalSounds(lDB, 0);
 		}
-	}
 
-	pViewingCharacter->PlayInternalSounds();
+		lHandle = Model::Level::GetNextFreeElement(lHandle);
+	}
 }
 
 }  // namespace Client
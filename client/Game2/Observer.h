@@ -33,6 +33,9 @@ namespace HoverRace {
 	namespace Model {
 		class SectionId;
 	}
+	namespace Util {
+		class WorkerPool;
+	}
 }
 
 namespace HoverRace {
@@ -51,6 +54,10 @@ class Observer
 		VideoServices::Viewport3D mWireFrameView;
 		VideoServices::Viewport3D m3DView;
 
+		Util::WorkerPool *renderPool;  ///< Optional; used to render the view in column bands.
+		std::vector<VideoServices::Viewport3D> bandViews;
+		int bandSetupSerial;  ///< Setup of the 3D view that bandViews were copied from.
+
 		Display::HudCell splitMode;
 
 		int mScroll;
@@ -76,14 +83,19 @@ class Observer
 		void Render2DDebugView(VideoServices::VideoBuffer * pDest, const Model::Level * pLevel, const MainCharacter::MainCharacter * pViewingCharacter);
 		void RenderWireFrameView(const Model::Level * pLevel, const MainCharacter::MainCharacter * pViewingCharacter);
 		void Render3DView(const HoverRace::Client::ClientSession * pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime, const MR_UInt8 * pBackImage);
+		void Render3DWorld(const HoverRace::Client::ClientSession * pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime, const MR_UInt8 * pBackImage);
+		void Render3DElements(const HoverRace::Client::ClientSession * pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime);
 
 		void DrawWFSection(const Model::Level * pLevel, const Model::SectionId & pSectionId, MR_UInt8 pColor);
-		void RenderRoomWalls(const Model::Level * pLevel, int pRoomId, MR_SimulationTime pTime);
-		void RenderFeatureWalls(const Model::Level * pLevel, int pFeatureId, MR_SimulationTime pTime);
-		void RenderFloorOrCeiling(const Model::Level * pLevel, const Model::SectionId & pSectionId, BOOL pFloor, MR_SimulationTime pTime);
+		void RenderWorld(VideoServices::Viewport3D * pDest, const Model::Level * pLevel, int pRoom, MR_SimulationTime pTime, const MR_UInt8 * pBackImage);
+		void RenderRoomWalls(VideoServices::Viewport3D * pDest, const Model::Level * pLevel, int pRoomId, MR_SimulationTime pTime);
+		void RenderFeatureWalls(VideoServices::Viewport3D * pDest, const Model::Level * pLevel, int pFeatureId, MR_SimulationTime pTime);
+		void RenderFloorOrCeiling(VideoServices::Viewport3D * pDest, const Model::Level * pLevel, const Model::SectionId & pSectionId, BOOL pFloor, MR_SimulationTime pTime);
 
 		static void DrawBackground(VideoServices::VideoBuffer * pDest);
 
+		void PlayRoomSounds(const Model::Level * pLevel, MainCharacter::MainCharacter * pViewingCharacter, int pRoomId, int pCoefficient);
+
 	public:
 		static const std::string &GetCraftName(int id);
 
@@ -104,10 +116,13 @@ class Observer
 		void SetCockpitView(BOOL pOn);
 
 		void SetSplitMode(Display::HudCell pMode);
+		void SetRenderPool(Util::WorkerPool *pool);
 
 		// Rendering function
 		void RenderDebugDisplay(VideoServices::VideoBuffer * pDest, const HoverRace::Client::ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime, const MR_UInt8 * pBackImage);
 		void RenderNormalDisplay(VideoServices::VideoBuffer * pDest, const HoverRace::Client::ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime, const MR_UInt8 * pBackImage);
+		void RenderNormalDisplayWorld(VideoServices::VideoBuffer * pDest, const HoverRace::Client::ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime, const MR_UInt8 * pBackImage);
+		void RenderNormalDisplayElements(const HoverRace::Client::ClientSession *pSession, const MainCharacter::MainCharacter * pViewingCharacter, MR_SimulationTime pTime);
 
 		void PlaySounds(const Model::Level * pLevel, MainCharacter::MainCharacter * pViewingCharacter);
 
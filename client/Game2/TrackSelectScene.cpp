@@ -82,7 +82,10 @@ TrackSelectScene::TrackSelectScene(Display::Display &display,
 
 	SupportCancelAction(_("Back"));
 
-	trackList.Reload(Config::GetInstance()->GetTrackBundle());
+	{
+		auto cfg = Config::GetInstance();
+		trackList.Reload(cfg->GetTrackBundle(), cfg->GetTrackIndexPath());
+	}
 
 	const auto &s = display.styles;
 
@@ -0,0 +1,300 @@
+// main.cpp
+//
+// Copyright (c) 2014 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StdAfx.h"
+
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <new>
+#include <random>
+
+#include "../../engine/MainCharacter/MainCharacter.h"
+#include "../../engine/Model/GameSession.h"
+#include "../../engine/Model/Track.h"
+#include "../../engine/Parcel/TrackBundle.h"
+#include "../../engine/Util/Config.h"
+#include "../../engine/Util/DllObjectFactory.h"
+#include "../../engine/Util/FuzzyLogic.h"
+#include "../../engine/Util/OS.h"
+#include "../../engine/Util/WorldCoordinates.h"
+#include "../../engine/VideoServices/SoundServer.h"
+#include "../../engine/Exception.h"
+
+using namespace HoverRace;
+using namespace HoverRace::Util;
+
+// Count every allocation so we can report allocations per slice.
+// This only covers the benchmark loop; setup allocations are excluded by
+// sampling the counter before and after.
+namespace {
+	std::atomic<MR_Int64> allocCount(0);
+}
+
+void *operator new(size_t sz)
+{
+	allocCount++;
+	void *retv = malloc(sz ? sz : 1);
+	if (!retv) throw std::bad_alloc();
+	return retv;
+}
+
+void *operator new[](size_t sz)
+{
+	allocCount++;
+	void *retv = malloc(sz ? sz : 1);
+	if (!retv) throw std::bad_alloc();
+	return retv;
+}
+
+void operator delete(void *ptr) throw()
+{
+	free(ptr);
+}
+
+void operator delete[](void *ptr) throw()
+{
+	free(ptr);
+}
+
+namespace {
+
+struct Options
+{
+	Options() :
+		players(9), slices(20000), seed(0), random(false) { }
+
+	std::string trackName;
+	OS::path_t mediaPath;
+	int players;
+	int slices;
+	unsigned int seed;
+	bool random;  ///< Random controls instead of the scripted pattern.
+};
+
+void PrintUsage()
+{
+	std::cerr <<
+		"Usage: hoverrace-simbench [options] <track name>\n"
+		"\n"
+		"Options:\n"
+		"  -m PATH    Media path (default: from config)\n"
+		"  -p COUNT   Number of hovercraft (default: 9)\n"
+		"  -n COUNT   Number of simulation slices (default: 20000)\n"
+		"  -r SEED    Use random controls with the given seed\n"
+		"             (default: scripted controls)\n";
+}
+
+bool ParseArgs(int argc, char **argv, Options &opts)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg.size() == 2 && arg[0] == '-') {
+			if (++i >= argc) return false;
+			try {
+				switch (arg[1]) {
+					case 'm': opts.mediaPath = argv[i]; break;
+					case 'p': opts.players = boost::lexical_cast<int>(argv[i]); break;
+					case 'n': opts.slices = boost::lexical_cast<int>(argv[i]); break;
+					case 'r':
+						opts.seed = boost::lexical_cast<unsigned int>(argv[i]);
+						opts.random = true;
+						break;
+					default:
+						return false;
+				}
+			}
+			catch (boost::bad_lexical_cast&) {
+				return false;
+			}
+		}
+		else if (opts.trackName.empty()) {
+			opts.trackName = arg;
+		}
+		else {
+			return false;
+		}
+	}
+
+	return !opts.trackName.empty() && opts.players > 0 && opts.slices > 0;
+}
+
+/**
+ * Drives a hovercraft with a fixed, repeatable pattern of inputs.
+ * Each craft is offset in the pattern so they don't all move in lockstep.
+ */
+void ApplyScriptedControls(MainCharacter::MainCharacter *ch, int idx, int slice)
+{
+	int phase = (slice + idx * 37) % 400;
+
+	ch->SetEngineState(phase < 300);
+	ch->SetTurnLeftState(phase >= 100 && phase < 130);
+	ch->SetTurnRightState(phase >= 200 && phase < 240);
+	ch->SetBrakeState(phase >= 360);
+	if (phase == 150) ch->SetPowerup();
+	if (phase == 250) ch->SetJump();
+	if (phase == 399) ch->SetChangeItem();
+}
+
+void ApplyRandomControls(MainCharacter::MainCharacter *ch, std::mt19937 &rng)
+{
+	std::uniform_int_distribution<int> dist(0, 99);
+
+	ch->SetEngineState(dist(rng) < 80);
+	int turn = dist(rng);
+	ch->SetTurnLeftState(turn < 15);
+	ch->SetTurnRightState(turn >= 85);
+	ch->SetBrakeState(dist(rng) < 5);
+	if (dist(rng) < 2) ch->SetPowerup();
+	if (dist(rng) < 1) ch->SetJump();
+	if (dist(rng) < 1) ch->SetChangeItem();
+}
+
+double NsPerSlice(MR_Int64 ns, MR_Int64 slices)
+{
+	return slices > 0 ? static_cast<double>(ns) / slices : 0.0;
+}
+
+int RunBenchmark(const Options &opts)
+{
+	Model::TrackPtr track =
+		Config::GetInstance()->GetTrackBundle()->OpenTrack(opts.trackName);
+	if (!track) {
+		std::cerr << "Track not found: " << opts.trackName << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Model::GameSession session(false);
+	if (!session.LoadNew(opts.trackName.c_str(), track, 0x7f)) {
+		std::cerr << "Unable to load track: " << opts.trackName << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	Model::Level *level = session.GetCurrentLevel();
+	int startCount = level->GetPlayerCount();
+	if (startCount < 1) {
+		std::cerr << "Track has no starting positions." << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	// The level owns the characters once they're inserted.
+	std::vector<MainCharacter::MainCharacter*> chars;
+	chars.reserve(static_cast<size_t>(opts.players));
+	for (int i = 0; i < opts.players; i++) {
+		MainCharacter::MainCharacter *ch = MainCharacter::MainCharacter::New(i, 0x7f);
+		int start = i % startCount;
+
+		ch->mRoom = level->GetStartingRoom(start);
+		ch->mPosition = level->GetStartingPos(start);
+		ch->SetOrientation(level->GetStartingOrientation(start));
+		ch->SetHoverId(i);
+
+		level->InsertElement(ch, ch->mRoom);
+		chars.push_back(ch);
+	}
+
+	std::mt19937 rng(opts.seed);
+
+	Model::GameSession::Profile profile;
+	session.SetSimulationTime(0);
+	session.SetProfile(&profile);
+
+	MR_Int64 startAllocs = allocCount.load();
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	for (int slice = 0; slice < opts.slices; slice++) {
+		for (int i = 0; i < opts.players; i++) {
+			MainCharacter::MainCharacter *ch = chars[static_cast<size_t>(i)];
+			if (opts.random) {
+				ApplyRandomControls(ch, rng);
+			}
+			else {
+				ApplyScriptedControls(ch, i, slice);
+			}
+			ch->SetSimulationTime(session.GetSimulationTime());
+		}
+		session.Step();
+	}
+
+	auto endTime = std::chrono::high_resolution_clock::now();
+	MR_Int64 allocs = allocCount.load() - startAllocs;
+
+	session.SetProfile(nullptr);
+
+	double elapsedSec = std::chrono::duration_cast<std::chrono::duration<double>>(
+		endTime - startTime).count();
+
+	std::cout << std::fixed << std::setprecision(2) <<
+		"track:           " << opts.trackName << "\n"
+		"hovercraft:      " << opts.players << "\n"
+		"controls:        " <<
+			(opts.random ?
+				"random (seed " + boost::lexical_cast<std::string>(opts.seed) + ")" :
+				std::string("scripted")) << "\n"
+		"slices:          " << profile.slices << "\n"
+		"elapsed:         " << elapsedSec << " s\n"
+		"slices/sec:      " << (profile.slices / elapsedSec) << "\n"
+		"allocs/slice:    " <<
+			(static_cast<double>(allocs) / profile.slices) << "\n"
+		"ns/slice:\n"
+		"  simulate:      " << NsPerSlice(profile.simulate, profile.slices) << "\n"
+		"  room contact:  " << NsPerSlice(profile.roomContact, profile.slices) << "\n"
+		"  shape contact: " << NsPerSlice(profile.shapeContact, profile.slices) << "\n"
+		"  flush cache:   " << NsPerSlice(profile.flushCache, profile.slices) << "\n";
+	std::cout.flush();
+
+	return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+	Options opts;
+	if (!ParseArgs(argc, argv, opts)) {
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	Config *cfg = Config::Init(0, 0, 0, 0, true, opts.mediaPath, OS::path_t());
+	cfg->runtime.silent = true;
+
+	MR_InitTrigoTables();
+	MR_InitFuzzyModule();
+	VideoServices::SoundServer::Init();
+	DllObjectFactory::Init();
+	MainCharacter::MainCharacter::RegisterFactory();
+
+	int retv;
+	try {
+		retv = RunBenchmark(opts);
+	}
+	catch (Exception &ex) {
+		std::cerr << ex.what() << std::endl;
+		retv = EXIT_FAILURE;
+	}
+
+	DllObjectFactory::Clean(FALSE);
+	VideoServices::SoundServer::Close();
+
+	Config::Shutdown();
+
+	return retv;
+}
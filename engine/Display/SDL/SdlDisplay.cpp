@@ -44,6 +44,7 @@
 #include "SdlButtonView.h"
 #include "SdlClickRegionView.h"
 #include "SdlFillBoxView.h"
+#include "SdlGlyphAtlas.h"
 #include "SdlKeycapIconView.h"
 #include "SdlLabelView.h"
 #include "SdlPictureView.h"
@@ -371,22 +372,25 @@ bool ActivateFullscreen(SDL_Window *window, SDL_DisplayMode &mode)
  */
 SdlDisplay::SdlDisplay(const std::string &windowTitle) :
 	SUPER(), windowTitle(windowTitle), window(nullptr), renderer(nullptr),
-	legacyDisplay(nullptr)
+	legacyDisplay(nullptr), unusedTextureSize(0)
 {
 	ApplyVideoMode();
 
 	legacyDisplay = new SdlLegacyDisplay(*this);
+	paletteChangedConn = legacyDisplay->GetPaletteChangedSignal().connect(
+		std::bind(&SdlDisplay::OnPaletteChanged, this));
 	SUPER::OnDisplayConfigChanged();
 	legacyDisplay->CreatePalette();
 }
 
 SdlDisplay::~SdlDisplay()
 {
+	paletteChangedConn.disconnect();
 	delete legacyDisplay;
 
-	for (auto &entry : loadedFonts) {
-		TTF_CloseFont(entry.second);
-	}
+	FlushTextureCache();
+	glyphAtlases.clear();
+	loadedFonts.clear();
 
 	if (renderer) SDL_DestroyRenderer(renderer);
 	if (window) SDL_DestroyWindow(window);
@@ -454,11 +458,167 @@ void SdlDisplay::AttachView(Wallpaper &model)
 
 /**
  * Loads a texture resource.
+ *
+ * Textures are cached by resource ID, so views which display the same
+ * resource share a single texture.  Once the last view releases a texture,
+ * it is kept (up to the budget set in the video config) in case it is
+ * needed again soon.  Since textures are shared, callers must not modify
+ * them other than setting the color, alpha, and blend modes before use.
+ *
  * @param res The resource (may be @c nullptr).
  * @return The loaded resource.
  * @throw ResLoadExn
  */
 std::shared_ptr<SdlTexture> SdlDisplay::LoadRes(std::shared_ptr<Res<Texture>> res)
+{
+	bool paletted = false;
+
+	if (!res) {
+		return LoadTexture(res, paletted);
+	}
+
+	std::string id = res->GetId();
+
+	auto iter = textureCache.find(id);
+	if (iter != textureCache.end()) {
+		auto &entry = iter->second;
+		textureLru.splice(textureLru.begin(), textureLru, entry.lruPos);
+		return ShareTexture(id, entry);
+	}
+
+	auto texture = LoadTexture(res, paletted);
+
+	int w = 0, h = 0;
+	SDL_QueryTexture(texture->Get(), nullptr, nullptr, &w, &h);
+
+	textureLru.push_front(id);
+	CachedTexture entry;
+	entry.texture = texture;
+	entry.size = static_cast<size_t>(w) * static_cast<size_t>(h) * 4;
+	entry.paletted = paletted;
+	entry.lruPos = textureLru.begin();
+	auto &newEntry = textureCache.emplace(id, std::move(entry)).first->second;
+
+	return ShareTexture(id, newEntry);
+}
+
+/**
+ * Remove all textures from the texture cache.
+ * Textures that are still in use by views will be released when the views
+ * are done with them.
+ */
+void SdlDisplay::FlushTextureCache()
+{
+	textureCache.clear();
+	textureLru.clear();
+	unusedTextureSize = 0;
+}
+
+/**
+ * Hand out a cached texture to a view.
+ * All views share the same handle; when the last of them releases it,
+ * the texture is counted against the budget for unused textures.
+ * @param id The resource ID.
+ * @param entry The cache entry.
+ * @return The shared handle.
+ */
+std::shared_ptr<SdlTexture> SdlDisplay::ShareTexture(const std::string &id,
+	CachedTexture &entry)
+{
+	auto handle = entry.handle.lock();
+	if (!handle) {
+		if (entry.unused) {
+			entry.unused = false;
+			unusedTextureSize -= entry.size;
+		}
+
+		// The handle holds its own reference so that the texture stays
+		// alive for the views even if the entry is evicted or flushed.
+		auto texture = entry.texture;
+		handle = std::shared_ptr<SdlTexture>(texture.get(),
+			[this, id, texture](SdlTexture*) {
+				OnTextureReleased(id, texture.get());
+			});
+		entry.handle = handle;
+	}
+	return handle;
+}
+
+/**
+ * Called when the last view releases a cached texture.
+ * @param id The resource ID.
+ * @param texture The released texture.
+ */
+void SdlDisplay::OnTextureReleased(const std::string &id,
+	const SdlTexture *texture)
+{
+	auto iter = textureCache.find(id);
+	if (iter == textureCache.end()) return;
+
+	// The entry may have been replaced since the handle was made
+	// (e.g. after a palette change).
+	auto &entry = iter->second;
+	if (entry.texture.get() != texture || entry.unused) return;
+
+	entry.unused = true;
+	unusedTextureSize += entry.size;
+
+	TrimTextureCache();
+}
+
+/**
+ * Evict the least-recently-used unused textures until the unused textures
+ * fit in the budget.
+ * Textures that are still in use are never evicted, nor do they count
+ * against the budget.
+ */
+void SdlDisplay::TrimTextureCache()
+{
+	const size_t budget =
+		static_cast<size_t>(Config::GetInstance()->video.textureCacheMb) *
+		1024 * 1024;
+
+	for (auto iter = textureLru.end();
+		unusedTextureSize > budget && iter != textureLru.begin(); )
+	{
+		--iter;
+		auto entryIter = textureCache.find(*iter);
+		if (entryIter->second.unused) {
+			unusedTextureSize -= entryIter->second.size;
+			textureCache.erase(entryIter);
+			iter = textureLru.erase(iter);
+		}
+	}
+}
+
+void SdlDisplay::OnPaletteChanged()
+{
+	// Textures generated from 8-bit images have the old palette baked in.
+	for (auto iter = textureCache.begin(); iter != textureCache.end(); ) {
+		auto &entry = iter->second;
+		if (entry.paletted) {
+			if (entry.unused) {
+				unusedTextureSize -= entry.size;
+			}
+			textureLru.erase(entry.lruPos);
+			iter = textureCache.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+}
+
+/**
+ * Decode and upload a texture resource, bypassing the cache.
+ * @param res The resource (may be @c nullptr to get a placeholder texture).
+ * @param[out] paletted Set to @c true if the texture was converted using
+ *                      the legacy palette.
+ * @return The loaded texture (never @c nullptr).
+ * @throw ResLoadExn The resource could not be loaded.
+ */
+std::shared_ptr<SdlTexture> SdlDisplay::LoadTexture(
+	std::shared_ptr<Res<Texture>> res, bool &paletted)
 {
 	SDL_Surface *surface = nullptr;
 
@@ -512,8 +672,10 @@ std::shared_ptr<SdlTexture> SdlDisplay::LoadRes(std::shared_ptr<Res<Texture>> re
 			if (SDL_SetPaletteColors(surface->format->palette,
 				GetLegacyDisplay().GetPalette(), 0, 256) < 0)
 			{
+				SDL_FreeSurface(surface);
 				throw ResLoadExn(res->GetId() + ": " + SDL_GetError());
 			}
+			paletted = true;
 		}
 	}
 	else {
@@ -527,9 +689,10 @@ std::shared_ptr<SdlTexture> SdlDisplay::LoadRes(std::shared_ptr<Res<Texture>> re
 	}
 
 	SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
+	SDL_FreeSurface(surface);
 	if (!texture) {
-		SDL_FreeSurface(surface);
-		throw ResLoadExn(res->GetId() + ": " + SDL_GetError());
+		throw ResLoadExn((res ? res->GetId() : std::string("(default)")) +
+			": " + SDL_GetError());
 	}
 
 	return std::make_shared<SdlTexture>(*this, texture);
@@ -555,11 +718,13 @@ void SdlDisplay::OnDisplayConfigChanged()
 
 		// Clear the loaded font cache, since resizing will change the
 		// sizes of the UI-scaled text.
-		for (auto &entry : loadedFonts) {
-			TTF_CloseFont(entry.second);
-		}
+		// Atlases still in use keep their fonts open until released.
+		glyphAtlases.clear();
 		loadedFonts.clear();
 
+		// Unused textures are unlikely to be needed at the new resolution.
+		FlushTextureCache();
+
 		SUPER::OnDisplayConfigChanged();
 	}
 }
@@ -727,6 +892,33 @@ void SdlDisplay::ApplyVideoMode()
  * @throws HoverRace::Exception The font could not be loaded.
  */
 TTF_Font *SdlDisplay::LoadTtfFont(const UiFont &font, bool uiScale)
+{
+	return LoadFontEntry(font, uiScale)->second.get();
+}
+
+/**
+ * Load the glyph atlas for a given font name and size.
+ * The atlas is shared by every user of the same font.
+ * @param font The font specification.
+ * @param uiScale Apply the user-selected scaling.
+ *                False is useful if scaling will be applied later.
+ * @return The atlas (never @c nullptr).
+ * @throws HoverRace::Exception The font could not be loaded.
+ */
+std::shared_ptr<SdlGlyphAtlas> SdlDisplay::LoadGlyphAtlas(const UiFont &font,
+	bool uiScale)
+{
+	auto fontEntry = LoadFontEntry(font, uiScale);
+
+	auto &atlas = glyphAtlases[fontEntry->first];
+	if (!atlas) {
+		atlas = std::make_shared<SdlGlyphAtlas>(*this, fontEntry->second);
+	}
+	return atlas;
+}
+
+SdlDisplay::loadedFonts_t::iterator SdlDisplay::LoadFontEntry(
+	const UiFont &font, bool uiScale)
 {
 	static FontAliasMap aliasMap;
 
@@ -756,12 +948,11 @@ TTF_Font *SdlDisplay::LoadTtfFont(const UiFont &font, bool uiScale)
 			throw Exception(TTF_GetError());
 		}
 
-		loadedFonts.insert(loadedFonts_t::value_type(key, retv));
-
-		return retv;
+		return loadedFonts.insert(loadedFonts_t::value_type(key,
+			std::shared_ptr<TTF_Font>(retv, TTF_CloseFont))).first;
 	}
 	else {
-		return iter->second;
+		return iter;
 	}
 }
 
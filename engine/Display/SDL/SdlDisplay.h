@@ -41,6 +41,7 @@
 namespace HoverRace {
 	namespace Display {
 		namespace SDL {
+			class SdlGlyphAtlas;
 			class SdlTexture;
 		}
 		class Label;
@@ -82,6 +83,13 @@ public:
 
 public:
 	std::shared_ptr<SdlTexture> LoadRes(std::shared_ptr<Res<Texture>> res);
+	void FlushTextureCache();
+private:
+	std::shared_ptr<SdlTexture> LoadTexture(std::shared_ptr<Res<Texture>> res,
+		bool &paletted);
+	void TrimTextureCache();
+	void OnTextureReleased(const std::string &id, const SdlTexture *texture);
+	void OnPaletteChanged();
 
 public:
 	// Display
@@ -104,6 +112,8 @@ public:
 public:
 	// Text-renderer-specific utilities.
 	TTF_Font *LoadTtfFont(const UiFont &font, bool uiScale = true);
+	std::shared_ptr<SdlGlyphAtlas> LoadGlyphAtlas(const UiFont &font,
+		bool uiScale = true);
 
 public:
 	// SDL-specific utilities.
@@ -120,8 +130,33 @@ private:
 	VideoServices::VideoBuffer *legacyDisplay;
 
 	typedef std::pair<std::string, int> loadedFontKey;
-	typedef std::map<loadedFontKey, TTF_Font*> loadedFonts_t;
+	typedef std::map<loadedFontKey, std::shared_ptr<TTF_Font>> loadedFonts_t;
 	loadedFonts_t loadedFonts;
+	typedef std::map<loadedFontKey, std::shared_ptr<SdlGlyphAtlas>> glyphAtlases_t;
+	glyphAtlases_t glyphAtlases;
+
+	loadedFonts_t::iterator LoadFontEntry(const UiFont &font, bool uiScale);
+
+	/// Texture loaded from a resource, shared between all views that use it.
+	struct CachedTexture
+	{
+		CachedTexture() : size(0), paletted(false), unused(false) { }
+
+		std::shared_ptr<SdlTexture> texture;
+		std::weak_ptr<SdlTexture> handle;  ///< Shared by the views using it.
+		size_t size;  ///< Approximate texture memory, in bytes.
+		bool paletted;  ///< Converted using the legacy palette.
+		bool unused;  ///< No view holds the handle.
+		std::list<std::string>::iterator lruPos;
+	};
+	typedef std::unordered_map<std::string, CachedTexture> textureCache_t;
+	textureCache_t textureCache;
+	std::list<std::string> textureLru;  ///< Most-recently-used first.
+	size_t unusedTextureSize;  ///< Total size of unused textures, in bytes.
+
+	std::shared_ptr<SdlTexture> ShareTexture(const std::string &id,
+		CachedTexture &entry);
+	boost::signals2::scoped_connection paletteChangedConn;
 };
 
 }  // namespace SDL
@@ -0,0 +1,304 @@
+
+// SdlGlyphAtlas.cpp
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "../../Exception.h"
+#include "SdlDisplay.h"
+
+#include "SdlGlyphAtlas.h"
+
+namespace HoverRace {
+namespace Display {
+namespace SDL {
+
+namespace {
+	const int PAGE_SIZE = 512;
+	const int GLYPH_PADDING = 1;
+
+	/// Number of rows of a new page that are cleared per update.
+	const int BLANK_ROWS = 32;
+	Uint32 blankStrip[PAGE_SIZE * BLANK_ROWS];  // Zero-initialized.
+
+	/**
+	 * Decode the next character from a UTF-8 string.
+	 * SDL_ttf only renders the Basic Multilingual Plane, so anything outside
+	 * of it (and any invalid sequence) is returned as U+FFFD.
+	 * @param s The current position in the string; advanced past the character.
+	 * @param end The end of the string.
+	 * @return The character.
+	 */
+	Uint16 NextChar(const char *&s, const char *end)
+	{
+		const Uint16 REPLACEMENT = 0xfffd;
+
+		unsigned char c = static_cast<unsigned char>(*s++);
+		if (c < 0x80) return c;
+
+		int len;
+		Uint32 ch;
+		if ((c & 0xe0) == 0xc0) { len = 1; ch = c & 0x1f; }
+		else if ((c & 0xf0) == 0xe0) { len = 2; ch = c & 0x0f; }
+		else if ((c & 0xf8) == 0xf0) { len = 3; ch = c & 0x07; }
+		else return REPLACEMENT;
+
+		for (; len > 0; len--) {
+			if (s == end || (*s & 0xc0) != 0x80) return REPLACEMENT;
+			ch = (ch << 6) | (*s++ & 0x3f);
+		}
+
+		return ch > 0xffff ? REPLACEMENT : static_cast<Uint16>(ch);
+	}
+}
+
+/**
+ * Constructor.
+ * @param display The display.
+ * @param font The font (may not be @c nullptr).
+ */
+SdlGlyphAtlas::SdlGlyphAtlas(SdlDisplay &display,
+	std::shared_ptr<TTF_Font> font) :
+	display(display), font(std::move(font)),
+	penX(0), penY(0), shelfHeight(0)
+{
+	TTF_Font *ttfFont = this->font.get();
+	ascent = TTF_FontAscent(ttfFont);
+	lineHeight = TTF_FontHeight(ttfFont);
+	lineSkip = TTF_FontLineSkip(ttfFont);
+}
+
+SdlGlyphAtlas::~SdlGlyphAtlas()
+{
+	for (SDL_Texture *page : pages) {
+		SDL_DestroyTexture(page);
+	}
+}
+
+/**
+ * Lay out a block of text.
+ * Lines are only broken at newlines.
+ * @param s The text (UTF-8).
+ * @param[out] quads The placed glyphs.  Any previous contents are
+ *                   replaced; the capacity is reused.
+ * @param[out] width The width of the block, in pixels.
+ * @param[out] height The height of the block, in pixels.
+ */
+void SdlGlyphAtlas::Layout(const std::string &s, quads_t &quads,
+	int &width, int &height)
+{
+	quads.clear();
+
+	int x = 0;
+	int y = 0;
+	width = 0;
+
+	TTF_Font *ttfFont = font.get();
+	bool kerning = TTF_GetFontKerning(ttfFont) != 0;
+
+	const char *cur = s.c_str();
+	const char *end = cur + s.length();
+	Uint16 prevCh = 0;
+	while (cur != end) {
+		Uint16 ch = NextChar(cur, end);
+
+		if (ch == '\n') {
+			if (x > width) width = x;
+			x = 0;
+			y += lineSkip;
+			prevCh = 0;
+			continue;
+		}
+
+		// Match the spacing of TTF_RenderUTF8_*.
+		if (kerning && prevCh != 0) {
+			x += GetKerning(prevCh, ch);
+		}
+		prevCh = ch;
+
+		const Glyph &glyph = FindGlyph(ch);
+		if (glyph.src.w > 0) {
+			Quad quad = { glyph.page, glyph.src,
+				x + glyph.xOffset, y + glyph.yOffset };
+			quads.push_back(quad);
+		}
+		x += glyph.advance;
+	}
+	if (x > width) width = x;
+
+	height = y + lineHeight;
+}
+
+/**
+ * Draw a block of text.
+ * @param quads The glyphs, from Layout().
+ * @param pos The screen position of the top-left of the block.
+ * @param scale The scaling to apply.
+ * @param color The text color.
+ */
+void SdlGlyphAtlas::Draw(const quads_t &quads, const Vec2 &pos, double scale,
+	const Color color)
+{
+	SDL_Renderer *renderer = display.GetRenderer();
+
+	for (SDL_Texture *page : pages) {
+		SDL_SetTextureColorMod(page, color.bits.r, color.bits.g, color.bits.b);
+		SDL_SetTextureAlphaMod(page, color.bits.a);
+	}
+
+	for (const Quad &quad : quads) {
+		SDL_Rect destRect = {
+			static_cast<int>(pos.x + quad.x * scale),
+			static_cast<int>(pos.y + quad.y * scale),
+			static_cast<int>(quad.src.w * scale),
+			static_cast<int>(quad.src.h * scale) };
+		SDL_RenderCopy(renderer, pages[quad.page], &quad.src, &destRect);
+	}
+}
+
+/**
+ * Retrieve the kerning adjustment between two characters.
+ * @param prevCh The first character.
+ * @param ch The second character.
+ * @return The adjustment to the advance of the first character, in pixels.
+ */
+int SdlGlyphAtlas::GetKerning(Uint16 prevCh, Uint16 ch) const
+{
+#if SDL_TTF_MAJOR_VERSION > 2 || (SDL_TTF_MAJOR_VERSION == 2 && \
+	(SDL_TTF_MINOR_VERSION > 0 || SDL_TTF_PATCHLEVEL >= 14))
+	return TTF_GetFontKerningSizeGlyphs(font.get(), prevCh, ch);
+#else
+	// Older versions of SDL_ttf only look up kerning by glyph index.
+	TTF_Font *ttfFont = font.get();
+	int prevIdx = TTF_GlyphIsProvided(ttfFont, prevCh);
+	int idx = TTF_GlyphIsProvided(ttfFont, ch);
+	return (prevIdx && idx) ? TTF_GetFontKerningSize(ttfFont, prevIdx, idx) : 0;
+#endif
+}
+
+/**
+ * Retrieve a glyph, rendering it into the atlas if necessary.
+ * @param ch The character.
+ * @return The glyph.
+ */
+const SdlGlyphAtlas::Glyph &SdlGlyphAtlas::FindGlyph(Uint16 ch)
+{
+	auto iter = glyphs.find(ch);
+	if (iter != glyphs.end()) return iter->second;
+
+	TTF_Font *ttfFont = font.get();
+
+	Glyph glyph = { 0, { 0, 0, 0, 0 }, 0, 0, 0 };
+
+	int minX, maxX, minY, maxY;
+	if (TTF_GlyphMetrics(ttfFont, ch, &minX, &maxX, &minY, &maxY,
+		&glyph.advance) < 0)
+	{
+		// Not in the font; just leave a gap.
+		return glyphs.insert(std::make_pair(ch, glyph)).first->second;
+	}
+
+	SDL_Color white = { 0xff, 0xff, 0xff, 0xff };
+	SDL_Surface *surface = TTF_RenderGlyph_Blended(ttfFont, ch, white);
+
+	if (surface && surface->w > 0 && surface->h > 0 &&
+		surface->w + GLYPH_PADDING <= PAGE_SIZE &&
+		surface->h + GLYPH_PADDING <= PAGE_SIZE)
+	{
+		// Older versions of SDL_ttf crop the surface to the glyph's bitmap;
+		// newer versions render it in a full-height line box.
+		if (surface->h < lineHeight) {
+			glyph.xOffset = minX;
+			glyph.yOffset = ascent - maxY;
+		}
+
+		if (surface->format->format != SDL_PIXELFORMAT_ARGB8888) {
+			SDL_Surface *converted = SDL_ConvertSurfaceFormat(surface,
+				SDL_PIXELFORMAT_ARGB8888, 0);
+			SDL_FreeSurface(surface);
+			surface = converted;
+		}
+	}
+	else if (surface) {
+		SDL_FreeSurface(surface);
+		surface = nullptr;
+	}
+
+	if (surface) {
+		// Simple shelf packing: glyphs go left-to-right, and a new shelf is
+		// started below the tallest glyph when the current one is full.
+		if (penX + surface->w + GLYPH_PADDING > PAGE_SIZE) {
+			penX = 0;
+			penY += shelfHeight;
+			shelfHeight = 0;
+		}
+		if (pages.empty() || penY + surface->h + GLYPH_PADDING > PAGE_SIZE) {
+			AddPage();
+		}
+
+		glyph.page = pages.size() - 1;
+		glyph.src.x = penX;
+		glyph.src.y = penY;
+		glyph.src.w = surface->w;
+		glyph.src.h = surface->h;
+
+		SDL_UpdateTexture(pages.back(), &glyph.src,
+			surface->pixels, surface->pitch);
+		SDL_FreeSurface(surface);
+
+		penX += glyph.src.w + GLYPH_PADDING;
+		if (glyph.src.h + GLYPH_PADDING > shelfHeight) {
+			shelfHeight = glyph.src.h + GLYPH_PADDING;
+		}
+	}
+
+	return glyphs.insert(std::make_pair(ch, glyph)).first->second;
+}
+
+/**
+ * Start a new, empty texture page.
+ */
+void SdlGlyphAtlas::AddPage()
+{
+	SDL_Texture *page = SDL_CreateTexture(display.GetRenderer(),
+		SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STATIC,
+		PAGE_SIZE, PAGE_SIZE);
+	if (!page) {
+		throw Exception(SDL_GetError());
+	}
+	SDL_SetTextureBlendMode(page, SDL_BLENDMODE_BLEND);
+
+	// Static textures start out undefined; clear to fully transparent,
+	// a strip at a time so we don't need a whole blank page.
+	for (int row = 0; row < PAGE_SIZE; row += BLANK_ROWS) {
+		SDL_Rect strip = { 0, row, PAGE_SIZE, BLANK_ROWS };
+		SDL_UpdateTexture(page, &strip, blankStrip, PAGE_SIZE * sizeof(Uint32));
+	}
+
+	pages.push_back(page);
+	penX = 0;
+	penY = 0;
+	shelfHeight = 0;
+}
+
+}  // namespace SDL
+}  // namespace Display
+}  // namespace HoverRace
@@ -0,0 +1,128 @@
+
+// SdlGlyphAtlas.h
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include "../../Vec.h"
+#include "../Color.h"
+
+#if defined(_WIN32) && defined(HR_ENGINE_SHARED)
+#	ifdef MR_ENGINE
+#		define MR_DllDeclare   __declspec( dllexport )
+#	else
+#		define MR_DllDeclare   __declspec( dllimport )
+#	endif
+#else
+#	define MR_DllDeclare
+#endif
+
+namespace HoverRace {
+	namespace Display {
+		namespace SDL {
+			class SdlDisplay;
+		}
+	}
+}
+
+namespace HoverRace {
+namespace Display {
+namespace SDL {
+
+/**
+ * Cache of rendered glyphs for a single font and size.
+ *
+ * Each glyph is rendered (in white) once, the first time it is needed, into
+ * a shared texture page.  Text is then drawn as a series of quads from the
+ * pages, with the color applied at draw time, so changing the text of a
+ * label costs neither a TTF render nor a texture allocation once its glyphs
+ * are cached.
+ *
+ * Only single-line-per-paragraph layout is supported (no word wrapping);
+ * wrapped text should still be rendered with SdlSurfaceText.
+ *
+ * Atlases are shared; use SdlDisplay::LoadGlyphAtlas to retrieve one.
+ *
+ * @author Michael Imamura
+ */
+class MR_DllDeclare SdlGlyphAtlas
+{
+public:
+	SdlGlyphAtlas(SdlDisplay &display, std::shared_ptr<TTF_Font> font);
+	SdlGlyphAtlas(const SdlGlyphAtlas&) = delete;
+	~SdlGlyphAtlas();
+
+	SdlGlyphAtlas &operator=(const SdlGlyphAtlas&) = delete;
+
+public:
+	/// A glyph placed in a block of text.
+	struct Quad
+	{
+		size_t page;
+		SDL_Rect src;
+		int x;  ///< Offset from the left of the text block.
+		int y;  ///< Offset from the top of the text block.
+	};
+	using quads_t = std::vector<Quad>;
+
+public:
+	int GetLineHeight() const { return lineHeight; }
+
+	void Layout(const std::string &s, quads_t &quads, int &width, int &height);
+	void Draw(const quads_t &quads, const Vec2 &pos, double scale,
+		const Color color);
+
+private:
+	struct Glyph
+	{
+		size_t page;
+		SDL_Rect src;
+		int xOffset;
+		int yOffset;
+		int advance;
+	};
+
+	int GetKerning(Uint16 prevCh, Uint16 ch) const;
+	const Glyph &FindGlyph(Uint16 ch);
+	void AddPage();
+
+private:
+	SdlDisplay &display;
+	std::shared_ptr<TTF_Font> font;
+	int ascent;
+	int lineHeight;
+	int lineSkip;
+
+	std::vector<SDL_Texture*> pages;
+	int penX;  ///< Next free position on the current shelf.
+	int penY;  ///< Top of the current shelf.
+	int shelfHeight;  ///< Height of the tallest glyph on the current shelf.
+
+	std::unordered_map<Uint16, Glyph> glyphs;
+};
+
+}  // namespace SDL
+}  // namespace Display
+}  // namespace HoverRace
+
+#undef MR_DllDeclare
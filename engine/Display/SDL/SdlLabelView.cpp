@@ -34,10 +34,11 @@ namespace SDL {
 
 SdlLabelView::SdlLabelView(SdlDisplay &disp, Label &model) :
 	SUPER(disp, model),
-	texture(), colorChanged(true), width(0), height(0)
+	texture(), atlas(), glyphs(), needsUpdate(true), colorChanged(true),
+	width(0), height(0)
 {
 	uiScaleChangedConnection = disp.GetUiScaleChangedSignal().connect(
-		std::bind(&decltype(texture)::release, &texture));
+		std::bind(&SdlLabelView::Invalidate, this));
 }
 
 SdlLabelView::~SdlLabelView()
@@ -52,9 +53,14 @@ void SdlLabelView::OnModelUpdate(int prop)
 			break;
 
 		case Label::Props::FONT:
-		case Label::Props::TEXT:
 		case Label::Props::WRAP_WIDTH:
-			texture.release();
+		case Label::Props::FIXED_SCALE:
+			Invalidate();
+			break;
+
+		case Label::Props::TEXT:
+			// The glyph atlas (if any) is still good for the new text.
+			needsUpdate = true;
 			break;
 	}
 }
@@ -69,8 +75,8 @@ Vec3 SdlLabelView::Measure()
 
 void SdlLabelView::PrepareRender()
 {
-	if (!texture) {
-		UpdateTexture();
+	if (needsUpdate) {
+		Update();
 	} else if (colorChanged) {
 		UpdateTextureColor();
 	}
@@ -83,14 +89,54 @@ void SdlLabelView::Render()
 	auto oldFlags = display.AddUiLayoutFlags(model.GetLayoutFlags());
 
 	double scale = model.GetScale();
-	display.DrawUiTexture(texture->Get(),
-		model.GetAlignedPos(unscaledWidth, unscaledHeight),
-		Vec2(scale, scale),
-		model.GetLayoutFlags());
+	Vec2 pos = model.GetAlignedPos(unscaledWidth, unscaledHeight);
+	if (atlas) {
+		atlas->Draw(glyphs, display.LayoutUiPosition(pos), scale,
+			model.GetColor());
+	}
+	else {
+		display.DrawUiTexture(texture->Get(), pos, Vec2(scale, scale),
+			model.GetLayoutFlags());
+	}
 
 	display.SetUiLayoutFlags(oldFlags);
 }
 
+/**
+ * Check if the label can be drawn from the glyph atlas.
+ * Wrapped text is still rendered in one piece by SDL_ttf.
+ * @return @c true if the glyph atlas can be used.
+ */
+bool SdlLabelView::UseGlyphs() const
+{
+	return model.IsAutoWidth();
+}
+
+/**
+ * Discard everything that depends on the font.
+ */
+void SdlLabelView::Invalidate()
+{
+	texture.reset();
+	atlas.reset();
+	needsUpdate = true;
+}
+
+void SdlLabelView::Update()
+{
+	needsUpdate = false;
+
+	if (model.GetText().empty()) {
+		UpdateBlank();
+	}
+	else if (UseGlyphs()) {
+		UpdateGlyphs();
+	}
+	else {
+		UpdateTexture();
+	}
+}
+
 /**
  * Update the state when the text is an empty string.
  * In this case, we measure the height of the string, and set the width to be 1
@@ -116,13 +162,41 @@ void SdlLabelView::UpdateBlank()
 	UpdateTextureColor();
 }
 
-void SdlLabelView::UpdateTexture()
+/**
+ * Lay out the text from the glyph atlas.
+ * Once the glyphs have been cached, this involves no rendering and no
+ * texture allocation, so it is suitable for frequently-updated text.
+ */
+void SdlLabelView::UpdateGlyphs()
 {
-	if (model.GetText().empty()) {
-		UpdateBlank();
-		return;
+	double scale = 1.0;
+
+	UiFont font = model.GetFont();
+	if (!model.IsLayoutUnscaled()) {
+		font.size *= (scale = display.GetUiScale());
 	}
 
+	if (!atlas) {
+		atlas = display.LoadGlyphAtlas(font, !model.IsFixedScale());
+	}
+	texture.reset();
+
+	atlas->Layout(model.GetText(), glyphs, width, height);
+	realWidth = width;
+	realHeight = height;
+
+	unscaledWidth = width / scale;
+	unscaledHeight = height / scale;
+
+	// The color is applied when drawing.
+	colorChanged = false;
+}
+
+void SdlLabelView::UpdateTexture()
+{
+	atlas.reset();
+	glyphs.clear();
+
 	double scale = 1.0;
 
 	UiFont font = model.GetFont();
@@ -164,7 +238,7 @@ void SdlLabelView::UpdateTexture()
 
 void SdlLabelView::UpdateTextureColor()
 {
-	if (!model.GetText().empty()) {
+	if (!model.GetText().empty() && texture) {
 		const Color cm = model.GetColor();
 		SDL_SetTextureColorMod(texture->Get(), cm.bits.r, cm.bits.g, cm.bits.b);
 		SDL_SetTextureAlphaMod(texture->Get(), cm.bits.a);
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "SdlDisplay.h"
+#include "SdlGlyphAtlas.h"
 #include "SdlTexture.h"
 #include "SdlView.h"
 
@@ -62,12 +63,19 @@ public:
 	void Render() override;
 
 private:
+	bool UseGlyphs() const;
+	void Invalidate();
+	void Update();
 	void UpdateBlank();
+	void UpdateGlyphs();
 	void UpdateTexture();
 	void UpdateTextureColor();
 
 private:
 	std::unique_ptr<SdlTexture> texture;
+	std::shared_ptr<SdlGlyphAtlas> atlas;  ///< Set when drawing from glyphs.
+	SdlGlyphAtlas::quads_t glyphs;
+	bool needsUpdate;
 	bool colorChanged;
 	int width;
 	int height;
@@ -21,6 +21,11 @@
 
 #include <SDL2/SDL.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define HR_HAVE_SSE2
+#	include <emmintrin.h>
+#endif
+
 #include "../../Exception.h"
 
 #include "SdlLegacyDisplay.h"
@@ -29,11 +34,56 @@ namespace HoverRace {
 namespace Display {
 namespace SDL {
 
-SdlLegacyDisplay::~SdlLegacyDisplay()
+namespace {
+
+/**
+ * Expand one row of 8-bit palette indexes to 32-bit pixels.
+ * @param src The palette indexes.
+ * @param dest The destination pixels.
+ * @param width The number of pixels.
+ * @param table The palette lookup table.
+ */
+void ExpandRow(const MR_UInt8 *src, MR_UInt32 *dest, int width,
+	const MR_UInt32 *table)
 {
-	if (nativeSurface) {
-		SDL_FreeSurface(nativeSurface);
+	int x = 0;
+
+#	ifdef HR_HAVE_SSE2
+		// The texture memory is only written to here, and may well be
+		// uncached, so we bypass the cache with aligned streaming stores.
+		for (; x < width && (reinterpret_cast<uintptr_t>(dest + x) & 15) != 0; x++) {
+			dest[x] = table[src[x]];
+		}
+		for (; x + 8 <= width; x += 8) {
+			const MR_UInt8 *s = src + x;
+			__m128i lo = _mm_setr_epi32(
+				static_cast<int>(table[s[0]]), static_cast<int>(table[s[1]]),
+				static_cast<int>(table[s[2]]), static_cast<int>(table[s[3]]));
+			__m128i hi = _mm_setr_epi32(
+				static_cast<int>(table[s[4]]), static_cast<int>(table[s[5]]),
+				static_cast<int>(table[s[6]]), static_cast<int>(table[s[7]]));
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + x), lo);
+			_mm_stream_si128(reinterpret_cast<__m128i*>(dest + x + 4), hi);
+		}
+#	endif
+
+	for (; x < width; x++) {
+		dest[x] = table[src[x]];
 	}
+}
+
+}  // namespace
+
+SdlLegacyDisplay::SdlLegacyDisplay(SdlDisplay &sdlDisplay) :
+	SUPER(sdlDisplay), sdlDisplay(sdlDisplay),
+	texture(), paletteChanged(true)
+{
+	paletteChangedConnection = GetPaletteChangedSignal().connect(
+		[&]{ paletteChanged = true; });
+}
+
+SdlLegacyDisplay::~SdlLegacyDisplay()
+{
 	if (texture) {
 		SDL_DestroyTexture(texture);
 	}
@@ -43,49 +93,48 @@ void SdlLegacyDisplay::OnWindowResChange()
 {
 	SUPER::OnWindowResChange();
 
-	if (nativeSurface) {
-		SDL_FreeSurface(nativeSurface);
-	}
 	if (texture) {
 		SDL_DestroyTexture(texture);
 	}
 
-	// The pixel format is selected via SDL_CreateRGBSurface, then we make sure we
-	// use the same pixel format for SDL_CreateTexture, so the later
-	// SDL_ConvertPixels is fast (in theory).
-
-	nativeSurface = SDL_CreateRGBSurface(0, GetWidth(), GetHeight(), 32,
-		0, 0, 0, 0);
-	if (!nativeSurface) {
-		throw Exception(SDL_GetError());
-	}
-
+	// The palette is expanded straight into the texture, so we pick the
+	// 32-bit format that the palette table is built for.
 	texture = SDL_CreateTexture(sdlDisplay.GetRenderer(),
-		nativeSurface->format->format, SDL_TEXTUREACCESS_STREAMING,
+		SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING,
 		GetWidth(), GetHeight());
 	if (!texture) {
 		throw Exception(SDL_GetError());
 	}
+
+	paletteChanged = true;
+}
+
+/**
+ * Rebuild the table that maps palette indexes to texture pixels.
+ */
+void SdlLegacyDisplay::UpdatePaletteTable()
+{
+	const VideoServices::ColorPalette::paletteEntry_t *palette = GetPalette();
+	for (int i = 0; i < 256; i++) {
+		paletteTable[i] = 0xff000000 |
+			(static_cast<MR_UInt32>(palette[i].r) << 16) |
+			(static_cast<MR_UInt32>(palette[i].g) << 8) |
+			static_cast<MR_UInt32>(palette[i].b);
+	}
+
+	paletteChanged = false;
 }
 
 void SdlLegacyDisplay::Flip()
 {
-	// Convert the legacy surface to the bit depth of the screen surface,
+	// Expand the palettized buffer directly into the streaming texture,
 	// then blit.
 
-	SDL_Surface *legacySurface = GetLegacySurface();
-	if (legacySurface && texture) {
+	if (texture) {
 		SDL_Renderer *renderer = sdlDisplay.GetRenderer();
 
-		// We can't use SDL_ConvertPixels to convert from an indexed format, so
-		// we use SDL_BlitSurface to do that, using the nativeSurface as a
-		// temporary buffer.
-		SDL_BlitSurface(legacySurface, nullptr, nativeSurface, nullptr);
-
-		if (SDL_MUSTLOCK(nativeSurface)) {
-			if (SDL_LockSurface(nativeSurface) < 0) {
-				throw Exception(SDL_GetError());
-			}
+		if (paletteChanged) {
+			UpdatePaletteTable();
 		}
 
 		void *pixels;
@@ -94,25 +143,23 @@ void SdlLegacyDisplay::Flip()
 			throw Exception(SDL_GetError());
 		}
 
-		MR_UInt32 destFmt;
-		SDL_QueryTexture(texture, &destFmt, nullptr, nullptr, nullptr);
-
-		// Copy the (already converted) pixels from nativeSurface to the
-		// streaming texture.
-		// Since the nativeSurface and destination texture use the same pixel
-		// format, this is effectively a memcpy with a some sanity checks.
-		if (SDL_ConvertPixels(nativeSurface->w, nativeSurface->h,
-			nativeSurface->format->format, nativeSurface->pixels, nativeSurface->pitch,
-			destFmt, pixels, pitch) < 0)
-		{
-			throw Exception(SDL_GetError());
+		const int width = GetWidth();
+		const int height = GetHeight();
+		const int srcPitch = GetPitch();
+		const MR_UInt8 *src = GetBuffer();
+		MR_UInt8 *dest = static_cast<MR_UInt8*>(pixels);
+		for (int y = 0; y < height; y++) {
+			ExpandRow(src, reinterpret_cast<MR_UInt32*>(dest), width,
+				paletteTable);
+			src += srcPitch;
+			dest += pitch;
 		}
 
-		SDL_UnlockTexture(texture);
+#	ifdef HR_HAVE_SSE2
+			_mm_sfence();
+#	endif
 
-		if (SDL_MUSTLOCK(nativeSurface)) {
-			SDL_UnlockSurface(nativeSurface);
-		}
+		SDL_UnlockTexture(texture);
 
 		SDL_RenderCopy(renderer, texture, nullptr, nullptr);
 	}
@@ -42,19 +42,22 @@ class MR_DllDeclare SdlLegacyDisplay : public VideoServices::VideoBuffer
 {
 	typedef VideoServices::VideoBuffer SUPER;
 	public:
-		SdlLegacyDisplay(SdlDisplay &sdlDisplay) :
-			SUPER(sdlDisplay), sdlDisplay(sdlDisplay),
-			nativeSurface(), texture() { }
+		SdlLegacyDisplay(SdlDisplay &sdlDisplay);
 		virtual ~SdlLegacyDisplay();
 
 	protected:
 		virtual void OnWindowResChange();
 		virtual void Flip();
 
+	private:
+		void UpdatePaletteTable();
+
 	private:
 		SdlDisplay &sdlDisplay;
-		SDL_Surface *nativeSurface;
 		SDL_Texture *texture;
+		MR_UInt32 paletteTable[256];  ///< Palette index to texture pixel.
+		bool paletteChanged;
+		boost::signals2::scoped_connection paletteChangedConnection;
 };
 
 }  // namespace SDL
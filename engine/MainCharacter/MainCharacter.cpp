@@ -38,26 +38,75 @@ namespace MainCharacter {
 
 #define MR_NB_HOVER_MODEL 8
 
-typedef Util::BitPack<23> MainCharacterState;
+namespace {
+
+/// The net state, before packing.
+struct NetState
+{
+	MR_Int32 posX;
+	MR_Int32 posY;
+	MR_Int32 posZ;
+	MR_Int32 room;
+	MR_UInt32 orientation;
+	MR_Int32 speedX256;
+	MR_Int32 speedY256;
+	MR_Int32 speedZ256;
+	MR_UInt32 controlState;
+	MR_Int32 onFloor;
+	MR_UInt32 hoverModel;
+};
 
 // Packing description
-//                     Offset  len   Prec
-#define  MC_POSX           0,   32,     5
-#define  MC_POSY          32,   32,     5
-#define  MC_POSZ          64,   27,     0
-#define  MC_ROOM          91,   11,     0
-#define  MC_ORIENTATION  102,    9,     3
-#define  MC_SPEED_X_256  111,   17,     2
-#define  MC_SPEED_Y_256  128,   17,     2
-#define  MC_SPEED_Z_256  145,    9,     2
-#define  MC_CONTROL_ST   154,   15,     0
-#define  MC_ON_FLOOR     169,    1,     0
-#define  MC_HOVER_MODEL  170,    3,     0
-#define  MC_PADDING      173,   11,     0
-//   #define  MC_SOUNDFX      141,    5,     0
-// Total                 184  = 23 bytes
-
-static_assert(std::is_pod<MainCharacterState>::value, "MainCharacterState must be a POD type");
+//                                                                      Offset len Prec
+typedef Util::BitPackMember<NetState, MR_Int32, &NetState::posX,            0, 32, 5> NetPosX;
+typedef Util::BitPackMember<NetState, MR_Int32, &NetState::posY,           32, 32, 5> NetPosY;
+typedef Util::BitPackMember<NetState, MR_Int32, &NetState::posZ,           64, 27, 0> NetPosZ;
+typedef Util::BitPackMember<NetState, MR_Int32, &NetState::room,           91, 11, 0> NetRoom;
+typedef Util::BitPackMember<NetState, MR_UInt32, &NetState::orientation,  102,  9, 3> NetOrientation;
+typedef Util::BitPackMember<NetState, MR_Int32, &NetState::speedX256,     111, 17, 2> NetSpeedX256;
+typedef Util::BitPackMember<NetState, MR_Int32, &NetState::speedY256,     128, 17, 2> NetSpeedY256;
+typedef Util::BitPackMember<NetState, MR_Int32, &NetState::speedZ256,     145,  9, 2> NetSpeedZ256;
+typedef Util::BitPackMember<NetState, MR_UInt32, &NetState::controlState, 154, 15, 0> NetControlState;
+typedef Util::BitPackMember<NetState, MR_Int32, &NetState::onFloor,       169,  1, 0> NetOnFloor;
+typedef Util::BitPackMember<NetState, MR_UInt32, &NetState::hoverModel,   170,  3, 0> NetHoverModel;
+// Padding                                                                 173, 11
+// Total                                                                   184  = 23 bytes
+
+typedef Util::BitPackSchema<NetState, MainCharacter::NET_STATE_SIZE,
+	NetPosX, NetPosY, NetPosZ, NetRoom, NetOrientation,
+	NetSpeedX256, NetSpeedY256, NetSpeedZ256,
+	NetControlState, NetOnFloor, NetHoverModel> NetStateSchema;
+
+static_assert(NetStateSchema::NUM_FIELDS == MainCharacter::NUM_NET_STATE_FIELDS,
+	"NUM_NET_STATE_FIELDS must match the net state schema");
+
+}  // namespace
+
+const Util::BitPackField *const MainCharacter::NET_STATE_FIELDS = NetStateSchema::FIELDS;
+
+namespace {
+
+// A state restored from the net state is off by up to one unit in each
+// quantized field, and the difference carries into later slices, so allow
+// a couple of units before calling it a misprediction.
+// Discrete fields must match exactly.
+const MR_UInt32 netStateTolerance[MainCharacter::NUM_NET_STATE_FIELDS] = {
+	2,   // posX
+	2,   // posY
+	32,  // posZ
+	0,   // room
+	1,   // orientation
+	2,   // speedX256
+	2,   // speedY256
+	2,   // speedZ256
+	0,   // controlState
+	0,   // onFloor
+	0,   // hoverModel
+};
+
+}  // namespace
+
+const MR_UInt32 *const MainCharacter::NET_STATE_TOLERANCE = netStateTolerance;
 
 // Local constants
 #define TIME_SLICE                     5
@@ -188,7 +237,7 @@ namespace {
 
 MainCharacter::MainCharacter(const Util::ObjectFromFactoryId & pId) :
 	Model::FreeElement(pId),
-	playerIdx(0), started(false), finished(false)
+	playerIdx(0), started(false), finished(false), replaying(false)
 {
 	mMasterMode = TRUE;
 	mRoom = -1;
@@ -322,77 +371,71 @@ MainCharacter *MainCharacter::New(int idx, char gameopts)
 	return lReturnValue;
 }
 
-Model::ElementNetState MainCharacter::GetNetState() const
+/**
+ * Pack the state of the hovercraft for sending over the network.
+ * Unlike GetNetState(), this may be called from any thread.
+ * @param[out] dest The buffer (@c NET_STATE_SIZE bytes).
+ */
+void MainCharacter::PackNetState(MR_UInt8 *dest) const
 {
-	static MainCharacterState lsState;		  // Static is ok because the variable will be used immediatly
+	NetState lState;
 
-	Model::ElementNetState lReturnValue;
-
-	lReturnValue.mDataLen = lsState.SIZE;
-	lReturnValue.mData = (MR_UInt8 *) &lsState;
-
-	lsState.Clear();
+	lState.posX = mPosition.mX;
+	lState.posY = mPosition.mY;
+	lState.posZ = mPosition.mZ;
 
-	lsState.Set(MC_POSX, mPosition.mX);
-	lsState.Set(MC_POSY, mPosition.mY);
-	lsState.Set(MC_POSZ, mPosition.mZ);
+	lState.room = mRoom;
 
-	lsState.Set(MC_ROOM, mRoom);
+	lState.orientation = static_cast<MR_UInt32>(mOrientation);
 
-	lsState.Set(MC_ORIENTATION, mOrientation);
+	lState.speedX256 = static_cast<MR_Int32>(mXSpeedBeforeCollision * 256);
+	lState.speedY256 = static_cast<MR_Int32>(mYSpeedBeforeCollision * 256);
+	lState.speedZ256 = static_cast<MR_Int32>(mZSpeed * 256);
 
-	lsState.Set(MC_SPEED_X_256, static_cast<unsigned int>(mXSpeedBeforeCollision * 256));
-	lsState.Set(MC_SPEED_Y_256, static_cast<unsigned int>(mYSpeedBeforeCollision * 256));
-	lsState.Set(MC_SPEED_Z_256, static_cast<unsigned int>(mZSpeed * 256));
-
-	lsState.Set(MC_CONTROL_ST, mControlState);
-	lsState.Set(MC_ON_FLOOR, mOnFloor);
-	lsState.Set(MC_HOVER_MODEL, mHoverModel);
-	lsState.Set(MC_PADDING, 0);
-
-	/*
-	   lsState.mPosX          = mPosition.mX;
-	   lsState.mPosY          = mPosition.mY;
-	   lsState.mPosZ          = mPosition.mZ;
+	lState.controlState = mControlState;
+	lState.onFloor = mOnFloor;
+	lState.hoverModel = mHoverModel;
 
-	   // lsState.mRoom          = mRoom;
+	NetStateSchema::Encode(lState, dest);
+}
 
-	   lsState.mOrientation   = mOrientation;
+Model::ElementNetState MainCharacter::GetNetState() const
+{
+	// The returned state is only valid until the next call.
+	PackNetState(mNetState);
 
-	   lsState.mXSpeed_256    = mXSpeed*256;
-	   lsState.mYSpeed_256    = mYSpeed*256;
-	   lsState.mZSpeed_256    = mZSpeed*256;
+	Model::ElementNetState lReturnValue;
 
-	   lsState.mControlState  = mControlState;
+	lReturnValue.mDataLen = NET_STATE_SIZE;
+	lReturnValue.mData = mNetState;
 
-	   lsState.mOnFloor       = mOnFloor;
-	 */
 	return lReturnValue;
 }
 
 void MainCharacter::SetNetState(int /*pDataLen */ , const MR_UInt8 *pData)
 {
-	MainCharacterState lState;
-	lState.InitFrom(pData);
+	NetState lState;
+	NetStateSchema::Decode(pData, lState);
 
-	mPosition.mX = lState.Get(MC_POSX);
-	mPosition.mY = lState.Get(MC_POSY);
-	mPosition.mZ = lState.Get(MC_POSZ);
+	mPosition.mX = lState.posX;
+	mPosition.mY = lState.posY;
+	mPosition.mZ = lState.posZ;
 
-	mRoom = lState.Get(MC_ROOM);
+	mRoom = lState.room;
 
+	// Rooms past 1023 come back negative.
 	if(mRoom < -1)
-		mRoom = lState.Getu(MC_ROOM);
+		mRoom = static_cast<int>(static_cast<MR_UInt32>(lState.room) & NetRoom::field_t::MASK);
 
-	mOrientation = static_cast<MR_Angle>(lState.Getu(MC_ORIENTATION));
+	mOrientation = static_cast<MR_Angle>(lState.orientation);
 
-	mXSpeed = lState.Get(MC_SPEED_X_256) / 256.0;
-	mYSpeed = lState.Get(MC_SPEED_Y_256) / 256.0;
-	mZSpeed = lState.Get(MC_SPEED_Z_256) / 256.0;
+	mXSpeed = lState.speedX256 / 256.0;
+	mYSpeed = lState.speedY256 / 256.0;
+	mZSpeed = lState.speedZ256 / 256.0;
 
-	mControlState = lState.Getu(MC_CONTROL_ST);
-	mOnFloor = lState.Get(MC_ON_FLOOR);
-	mHoverModel = lState.Getu(MC_HOVER_MODEL);
+	mControlState = lState.controlState;
+	mOnFloor = lState.onFloor;
+	mHoverModel = lState.hoverModel;
 
 	/*
 	   mPosition.mX = lState->mPosX;
@@ -423,6 +466,118 @@ void MainCharacter::SetNetState(int /*pDataLen */ , const MR_UInt8 *pData)
 	//}
 }
 
+/**
+ * Capture the full simulation state (see RestoreSimState()).
+ * @param[out] state The state.
+ */
+void MainCharacter::SaveSimState(SimState &state) const
+{
+	state.position = mPosition;
+	state.orientation = mOrientation;
+	state.room = mRoom;
+
+	state.hoverModel = mHoverModel;
+	state.controlState = mControlState;
+	state.motorOnState = mMotorOnState;
+	state.motorDisplay = mMotorDisplay;
+
+	state.xSpeed = mXSpeed;
+	state.ySpeed = mYSpeed;
+	state.zSpeed = mZSpeed;
+	state.xSpeedBeforeCollision = mXSpeedBeforeCollision;
+	state.ySpeedBeforeCollision = mYSpeedBeforeCollision;
+
+	state.onFloor = mOnFloor;
+	state.cabinOrientation = mCabinOrientation;
+	state.outOfControlDuration = mOutOfControlDuration;
+
+	state.fireDone = mFireDone;
+	state.currentWeapon = mCurrentWeapon;
+	state.missileRefillDuration = mMissileRefillDuration;
+	state.numMines = mMineList.Used();
+	for (int i = 0; i < state.numMines; i++) {
+		state.mines[i] = mMineList[i];
+	}
+	state.numPowerUps = mPowerUpList.Used();
+	for (int i = 0; i < state.numPowerUps; i++) {
+		state.powerUps[i] = mPowerUpList[i];
+	}
+	state.powerUpLeft = mPowerUpLeft;
+
+	state.fuelLevel = mFuelLevel;
+
+	state.lastLapCompletion = mLastLapCompletion;
+	state.lastLapDuration = mLastLapDuration;
+	state.bestLapDuration = mBestLapDuration;
+	state.currentTime = mCurrentTime;
+	state.checkPoint1 = mCheckPoint1;
+	state.checkPoint2 = mCheckPoint2;
+}
+
+/**
+ * Roll back to a state captured by SaveSimState().
+ * Only the hovercraft itself is restored; if the room changed, the caller
+ * must move the element in the level.
+ * @param state The state.
+ */
+void MainCharacter::RestoreSimState(const SimState &state)
+{
+	mPosition = state.position;
+	mOrientation = state.orientation;
+	mRoom = state.room;
+
+	mHoverModel = state.hoverModel;
+	mControlState = state.controlState;
+	mMotorOnState = state.motorOnState;
+	mMotorDisplay = state.motorDisplay;
+
+	mXSpeed = state.xSpeed;
+	mYSpeed = state.ySpeed;
+	mZSpeed = state.zSpeed;
+	mXSpeedBeforeCollision = state.xSpeedBeforeCollision;
+	mYSpeedBeforeCollision = state.ySpeedBeforeCollision;
+
+	mOnFloor = state.onFloor;
+	mCabinOrientation = state.cabinOrientation;
+	mOutOfControlDuration = state.outOfControlDuration;
+
+	mFireDone = state.fireDone;
+	mCurrentWeapon = state.currentWeapon;
+	mMissileRefillDuration = state.missileRefillDuration;
+	mMineList.Clean();
+	for (int i = 0; i < state.numMines; i++) {
+		mMineList.Add(state.mines[i]);
+	}
+	mPowerUpList.Clean();
+	for (int i = 0; i < state.numPowerUps; i++) {
+		mPowerUpList.Add(state.powerUps[i]);
+	}
+	mPowerUpLeft = state.powerUpLeft;
+
+	mFuelLevel = state.fuelLevel;
+
+	mLastLapCompletion = state.lastLapCompletion;
+	mLastLapDuration = state.lastLapDuration;
+	mBestLapDuration = state.bestLapDuration;
+	mCurrentTime = state.currentTime;
+	mCheckPoint1 = state.checkPoint1;
+	mCheckPoint2 = state.checkPoint2;
+}
+
+/**
+ * Mark the slices being simulated as a replay of ones that were already
+ * simulated once.
+ * While replaying, the hovercraft keeps track of its own inventory as usual,
+ * but doesn't touch the rest of the level (launching missiles, dropping
+ * mines and cans), play sounds, or fire signals, since all of that already
+ * happened the first time around.
+ * @param replaying @c true while replaying.
+ */
+void MainCharacter::SetReplaying(bool replaying)
+{
+	this->replaying = replaying;
+}
+
 void MainCharacter::SetSimulationTime(MR_SimulationTime pTime)
 {
 	mCurrentTime = pTime;
@@ -466,11 +621,11 @@ void MainCharacter::SetJump()
 	if(!(mControlState & eJump)) {
 		if(mOnFloor) {
 			mZSpeed = 1.1 * eMaxZSpeed[mHoverModel];
-			if(mRenderer != NULL)
+			if((mRenderer != NULL) && !replaying)
 				mInternalSoundList.Add(mRenderer->GetJumpSound());
 		}
 		else {
-			if(mRenderer != NULL)
+			if((mRenderer != NULL) && !replaying)
 				mInternalSoundList.Add(mRenderer->GetMisJumpSound());
 		}
 	}
@@ -582,8 +737,9 @@ int MainCharacter::Simulate(MR_SimulationTime pDuration, Model::Level *pLevel, i
 					mMissileRefillDuration = eMissileRefillTime;
 
 					Util::ObjectFromFactoryId lObjectId = { 1, 150 };
-					// Create a new missile
-					FreeElement *lMissile = (FreeElement *) Util::DllObjectFactory::CreateObject(lObjectId);
+					// Create a new missile (unless it was already launched)
+					FreeElement *lMissile = replaying ? NULL :
+						(FreeElement *) Util::DllObjectFactory::CreateObject(lObjectId);
 
 					if(lMissile != NULL) {
 						lMissile->SetOwnerId(mHoverId);
@@ -604,7 +760,8 @@ int MainCharacter::Simulate(MR_SimulationTime pDuration, Model::Level *pLevel, i
 				if(!mMineList.IsEmpty() && (mGameOpts & OPT_ALLOW_MINES)) {
 					MR_3DCoordinate lPos = mPosition;
 					lPos.mZ += 800;
-					pLevel->SetPermElementPos(mMineList.GetHead(), mRoom, lPos);
+					if(!replaying)
+						pLevel->SetPermElementPos(mMineList.GetHead(), mRoom, lPos);
 					mMineList.Remove();
 				}
 			}
@@ -613,7 +770,8 @@ int MainCharacter::Simulate(MR_SimulationTime pDuration, Model::Level *pLevel, i
 					MR_3DCoordinate lPos = mPosition;
 					lPos.mZ += 1200;
 
-					pLevel->SetPermElementPos(mPowerUpList.GetHead(), mRoom, lPos);
+					if(!replaying)
+						pLevel->SetPermElementPos(mPowerUpList.GetHead(), mRoom, lPos);
 					mPowerUpList.Remove();
 
 					mPowerUpLeft = ePwrUpDuration;
@@ -750,7 +908,7 @@ int MainCharacter::InternalSimulate(MR_SimulationTime pDuration, Model::Level *p
 
 					if(lReport.IsInMaze()) {
 						if(!lReport.HaveContact()) {
-							if((mRenderer != NULL) && (!mOnFloor))
+							if((mRenderer != NULL) && !replaying && (!mOnFloor))
 								mInternalSoundList.Add(mRenderer->GetBumpSound());
 
 							mZSpeed = 0;
@@ -863,7 +1021,7 @@ void MainCharacter::ApplyEffect(const MR_ContactEffect *pEffect,
 			mXSpeed = lMoment.mXSpeed / 256.0;
 			mYSpeed = lMoment.mYSpeed / 256.0;
 
-			if((mRenderer != NULL) && !((lMoment.mXSpeed == 0) && (lMoment.mYSpeed == 0))) {
+			if((mRenderer != NULL) && !replaying && !((lMoment.mXSpeed == 0) && (lMoment.mYSpeed == 0))) {
 				mInternalSoundList.Add(mRenderer->GetBumpSound());
 				mExternalSoundList.Add(mRenderer->GetBumpSound());
 			}
@@ -902,12 +1060,12 @@ void MainCharacter::ApplyEffect(const MR_ContactEffect *pEffect,
 	}
 
 	if((lLostOfControl != NULL) && mMasterMode) {
-		if(mOutOfControlDuration < 1750)
+		if((mOutOfControlDuration < 1750) && !replaying)
 			mLastHits.Add(lLostOfControl->mHoverId);
 
 		mOutOfControlDuration = 2000;
 
-		if(mRenderer != NULL) {
+		if((mRenderer != NULL) && !replaying) {
 			mInternalSoundList.Add(mRenderer->GetOutOfCtrlSound());
 			mExternalSoundList.Add(mRenderer->GetOutOfCtrlSound());
 		}
@@ -926,8 +1084,10 @@ void MainCharacter::ApplyEffect(const MR_ContactEffect *pEffect,
 		if((mPowerUpLeft == 0) && (lPowerUp->mElementPermId != -1) && !mPowerUpList.Full()) {
 			mPowerUpList.Add(lPowerUp->mElementPermId);
 			pLevel->SetPermElementPos(lPowerUp->mElementPermId, -1, mPosition);
-			mInternalSoundList.Add(mRenderer->GetPickupSound());
-			mExternalSoundList.Add(mRenderer->GetPickupSound());
+			if(!replaying) {
+				mInternalSoundList.Add(mRenderer->GetPickupSound());
+				mExternalSoundList.Add(mRenderer->GetPickupSound());
+			}
 		}
 	}
 
@@ -935,7 +1095,7 @@ void MainCharacter::ApplyEffect(const MR_ContactEffect *pEffect,
 		switch (lLapCompleted->mType) {
 			case MR_CheckPoint::eCheck1:
 				if (!mCheckPoint1 && !mCheckPoint2) {
-					checkpointSignal(this, 1);
+					if (!replaying) checkpointSignal(this, 1);
 					mCheckPoint1 = TRUE;
 					mCheckPoint2 = FALSE;
 				}
@@ -943,7 +1103,7 @@ void MainCharacter::ApplyEffect(const MR_ContactEffect *pEffect,
 			case MR_CheckPoint::eCheck2:
 				if (mCheckPoint1)
 					if (!mCheckPoint2) {
-						checkpointSignal(this, 2);
+						if (!replaying) checkpointSignal(this, 2);
 						mCheckPoint2 = TRUE;
 					}
 				break;
@@ -954,8 +1114,10 @@ void MainCharacter::ApplyEffect(const MR_ContactEffect *pEffect,
 
 					// The finish line is the first checkpoint, but we fire
 					// a separate signal for convenience.
-					checkpointSignal(this, 0);
-					finishLineSignal(this);
+					if (!replaying) {
+						checkpointSignal(this, 0);
+						finishLineSignal(this);
+					}
 
 					mLastLapDuration = pTime - mLastLapCompletion;
 					mLastLapCompletion = pTime;
@@ -965,7 +1127,7 @@ void MainCharacter::ApplyEffect(const MR_ContactEffect *pEffect,
 					{
 						mBestLapDuration = mLastLapDuration;
 					}
-					if(mRenderer != NULL) {
+					if((mRenderer != NULL) && !replaying) {
 						if (finished) {
 							mInternalSoundList.Add(mRenderer->GetFinishSound());
 							mExternalSoundList.Add(mRenderer->GetFinishSound());
@@ -26,6 +26,7 @@
 #include "../Display/Color.h"
 #include "../Model/MazeElement.h"
 #include "../Model/PhysicalCollision.h"
+#include "../Util/BitPacking.h"
 #include "../Util/FastFifo.h"
 
 #if defined(_WIN32) && defined(HR_ENGINE_SHARED)
@@ -77,6 +78,63 @@ class MR_DllDeclare MainCharacter : public Model::FreeElement
 			ePowerUp,
 			eNotAWeapon
 		};
+
+		/// The layout of the net state, for delta compression.
+		static const int NET_STATE_SIZE = 23;
+		static const int NUM_NET_STATE_FIELDS = 11;
+		static const Util::BitPackField *const NET_STATE_FIELDS;
+
+		/// How far each net state field (in packed units) may be from the
+		/// server's before a prediction is considered wrong.
+		static const MR_UInt32 *const NET_STATE_TOLERANCE;
+
+		/**
+		 * Everything that the simulation of the hovercraft depends on.
+		 * Unlike the net state, this is exact, so that a prediction can be
+		 * rolled back to it (see Net::Prediction).
+		 */
+		struct SimState
+		{
+			enum { MAX_MINES = 2, MAX_POWER_UPS = 4 };
+
+			MR_3DCoordinate position;
+			MR_Angle orientation;
+			int room;
+
+			unsigned hoverModel;
+			unsigned int controlState;
+			BOOL motorOnState;
+			int motorDisplay;
+
+			double xSpeed;
+			double ySpeed;
+			double zSpeed;
+			double xSpeedBeforeCollision;
+			double ySpeedBeforeCollision;
+
+			BOOL onFloor;
+			MR_Angle cabinOrientation;
+			MR_SimulationTime outOfControlDuration;
+
+			BOOL fireDone;
+			eWeapon currentWeapon;
+			MR_SimulationTime missileRefillDuration;
+			int mines[MAX_MINES];
+			int numMines;
+			int powerUps[MAX_POWER_UPS];
+			int numPowerUps;
+			MR_SimulationTime powerUpLeft;
+
+			double fuelLevel;
+
+			MR_SimulationTime lastLapCompletion;
+			MR_SimulationTime lastLapDuration;
+			MR_SimulationTime bestLapDuration;
+			MR_SimulationTime currentTime;
+			BOOL checkPoint1;
+			BOOL checkPoint2;
+		};
+
 	private:
 		class Cylinder : public Model::CylinderShape
 		{
@@ -128,8 +186,8 @@ class MR_DllDeclare MainCharacter : public Model::FreeElement
 
 		eWeapon mCurrentWeapon;
 		MR_SimulationTime mMissileRefillDuration;  // Countdown
-		MR_FixedFastFifo<int, 2> mMineList;
-		MR_FixedFastFifo<int, 4> mPowerUpList;
+		MR_FixedFastFifo<int, SimState::MAX_MINES> mMineList;
+		MR_FixedFastFifo<int, SimState::MAX_POWER_UPS> mPowerUpList;
 		MR_SimulationTime mPowerUpLeft;
 
 		double mFuelLevel;
@@ -141,6 +199,8 @@ class MR_DllDeclare MainCharacter : public Model::FreeElement
 
 		int mHoverId;
 
+		mutable MR_UInt8 mNetState[NET_STATE_SIZE];  ///< Returned by GetNetState().
+
 		// Race stats
 		MR_SimulationTime mLastLapCompletion;
 		MR_SimulationTime mLastLapDuration;
@@ -183,10 +243,16 @@ class MR_DllDeclare MainCharacter : public Model::FreeElement
 		void AddRenderer();
 		void Render(VideoServices::Viewport3D * pDest, MR_SimulationTime pTime);
 
+		void PackNetState(MR_UInt8 *dest) const;
 		Model::ElementNetState GetNetState() const;
 		void SetNetState(int pDataLen, const MR_UInt8 * pData);
 		void SetNbLapForRace(int pNbLap);
 
+		// Rollback
+		void SaveSimState(SimState &state) const;
+		void RestoreSimState(const SimState &state);
+		void SetReplaying(bool replaying);
+
 		// Movement inputs
 		void SetSimulationTime(MR_SimulationTime pTime);
 		void SetEngineState(bool engineState); // TODO: analog
@@ -259,6 +325,7 @@ class MR_DllDeclare MainCharacter : public Model::FreeElement
 	private:
 		bool started;
 		bool finished;
+		bool replaying;  ///< Re-simulating slices that were already shown.
 		startedSignal_t startedSignal;
 		finishedSignal_t finishedSignal;
 		checkpointSignal_t checkpointSignal;
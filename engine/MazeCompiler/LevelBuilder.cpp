@@ -23,6 +23,7 @@
 
 #include <boost/filesystem/fstream.hpp>
 
+#include "../Util/WorkerPool.h"
 #include "TrackCompileExn.h"
 #include "TrackSpecParser.h"
 
@@ -49,14 +50,21 @@ struct MR_Connection
 	int mWall1;
 };
 
-// Helper variables
-static LevelBuilder *gsCurrentLevelBuilder = NULL;
+// A surface tagged with the level it is sorted by
+struct MR_SortedSurface
+{
+	int mLevel;
+	Model::SectionId mSurface;
+};
 
 // Local helper functions
 static Model::SurfaceElement *sLoadTexture(TrackSpecParser * pParser);
+static void sSortSurfaces(Model::SectionId *pList, MR_SortedSurface *pTmp, int pCount, int (*pCompare)(const void *, const void *));
+static int sOrderFloor(const void *pSurface0, const void *pSurface1);
+static int sOrderCeiling(const void *pSurface0, const void *pSurface1);
 
 LevelBuilder::LevelBuilder(const TrackCompilationLogPtr &log) :
-	SUPER(), log(log)
+	SUPER(), log(log), threads(0)
 {
 }
 
@@ -615,119 +623,101 @@ bool LevelBuilder::Parse(std::istream &in)
 	return lReturnValue;
 }
 
-bool LevelBuilder::ComputeAudibleZones()
+void LevelBuilder::OrderVisibleSurfaces()
 {
-	// Not implemented.
-	return true;
+	// For each room, compute the list of the visible surfaces.
+	// Rooms only modify their own lists, so they can be done in parallel.
+	Util::WorkerPool lPool(threads);
+	lPool.ParallelFor(mNbRoom, [&](int lRoom) {
+		OrderVisibleSurfaces(lRoom);
+	});
 }
 
-void LevelBuilder::OrderVisibleSurfaces()
+void LevelBuilder::OrderVisibleSurfaces(int pRoom)
 {
 	int lCounter;
 
-	// For each room, compute the list of the visible surfaces
-	for(int lRoomId = 0; lRoomId < mNbRoom; lRoomId++) {
-		mRoomList[lRoomId].mNbVisibleSurface = 0;
-
-		// Compute the number of visible surfaces
-
-		mRoomList[lRoomId].mNbVisibleSurface = mRoomList[lRoomId].mNbChild + 1;
+	mRoomList[pRoom].mNbVisibleSurface = 0;
 
-		for(lCounter = 0; lCounter < mRoomList[lRoomId].mNbVisibleRoom; lCounter++) {
-			mRoomList[lRoomId].mNbVisibleSurface += mRoomList[mRoomList[lRoomId].mVisibleRoomList[lCounter]].mNbChild + 1;
-		}
+	// Compute the number of visible surfaces
 
-		// Create the arrays containing the list of visible floor and ceiling
-		int lCurrentIndex = 0;
+	mRoomList[pRoom].mNbVisibleSurface = mRoomList[pRoom].mNbChild + 1;
 
-		mRoomList[lRoomId].mVisibleFloorList = new Model::SectionId[mRoomList[lRoomId].mNbVisibleSurface];
-		mRoomList[lRoomId].mVisibleCeilingList = new Model::SectionId[mRoomList[lRoomId].mNbVisibleSurface];
+	for(lCounter = 0; lCounter < mRoomList[pRoom].mNbVisibleRoom; lCounter++) {
+		mRoomList[pRoom].mNbVisibleSurface += mRoomList[mRoomList[pRoom].mVisibleRoomList[lCounter]].mNbChild + 1;
+	}
 
-		for(lCounter = -1; lCounter < mRoomList[lRoomId].mNbVisibleRoom; lCounter++) {
-			int lVisibleRoom;
+	// Create the arrays containing the list of visible floor and ceiling
+	int lCurrentIndex = 0;
 
-			if(lCounter == -1) {
-				lVisibleRoom = lRoomId;
-			}
-			else {
-				lVisibleRoom = mRoomList[lRoomId].mVisibleRoomList[lCounter];
-			}
+	mRoomList[pRoom].mVisibleFloorList = new Model::SectionId[mRoomList[pRoom].mNbVisibleSurface];
+	mRoomList[pRoom].mVisibleCeilingList = new Model::SectionId[mRoomList[pRoom].mNbVisibleSurface];
 
-			mRoomList[lRoomId].mVisibleFloorList[lCurrentIndex].mType = Model::SectionId::eRoom;
-			mRoomList[lRoomId].mVisibleFloorList[lCurrentIndex].mId = lVisibleRoom;
-			mRoomList[lRoomId].mVisibleCeilingList[lCurrentIndex].mType = Model::SectionId::eRoom;
-			mRoomList[lRoomId].mVisibleCeilingList[lCurrentIndex++].mId = lVisibleRoom;
+	for(lCounter = -1; lCounter < mRoomList[pRoom].mNbVisibleRoom; lCounter++) {
+		int lVisibleRoom;
 
-			for(int lChildIndex = 0; lChildIndex < mRoomList[lVisibleRoom].mNbChild; lChildIndex++) {
-				mRoomList[lRoomId].mVisibleFloorList[lCurrentIndex].mType = Model::SectionId::eFeature;
-				mRoomList[lRoomId].mVisibleFloorList[lCurrentIndex].mId = mRoomList[lVisibleRoom].mChildList[lChildIndex];
-				mRoomList[lRoomId].mVisibleCeilingList[lCurrentIndex].mType = Model::SectionId::eFeature;
-				mRoomList[lRoomId].mVisibleCeilingList[lCurrentIndex++].mId = mRoomList[lVisibleRoom].mChildList[lChildIndex];
-			}
-
-			ASSERT(lCurrentIndex <= mRoomList[lRoomId].mNbVisibleSurface);
+		if(lCounter == -1) {
+			lVisibleRoom = pRoom;
+		}
+		else {
+			lVisibleRoom = mRoomList[pRoom].mVisibleRoomList[lCounter];
 		}
 
-		ASSERT(lCurrentIndex == mRoomList[lRoomId].mNbVisibleSurface);
-
-		// Order the surfaces list
-		gsCurrentLevelBuilder = this;
-
-		qsort(mRoomList[lRoomId].mVisibleFloorList, mRoomList[lRoomId].mNbVisibleSurface, sizeof(Model::SectionId), OrderFloor);
+		mRoomList[pRoom].mVisibleFloorList[lCurrentIndex].mType = Model::SectionId::eRoom;
+		mRoomList[pRoom].mVisibleFloorList[lCurrentIndex].mId = lVisibleRoom;
+		mRoomList[pRoom].mVisibleCeilingList[lCurrentIndex].mType = Model::SectionId::eRoom;
+		mRoomList[pRoom].mVisibleCeilingList[lCurrentIndex++].mId = lVisibleRoom;
 
-		qsort(mRoomList[lRoomId].mVisibleCeilingList, mRoomList[lRoomId].mNbVisibleSurface, sizeof(Model::SectionId), OrderCeiling);
+		for(int lChildIndex = 0; lChildIndex < mRoomList[lVisibleRoom].mNbChild; lChildIndex++) {
+			mRoomList[pRoom].mVisibleFloorList[lCurrentIndex].mType = Model::SectionId::eFeature;
+			mRoomList[pRoom].mVisibleFloorList[lCurrentIndex].mId = mRoomList[lVisibleRoom].mChildList[lChildIndex];
+			mRoomList[pRoom].mVisibleCeilingList[lCurrentIndex].mType = Model::SectionId::eFeature;
+			mRoomList[pRoom].mVisibleCeilingList[lCurrentIndex++].mId = mRoomList[lVisibleRoom].mChildList[lChildIndex];
+		}
 
+		ASSERT(lCurrentIndex <= mRoomList[pRoom].mNbVisibleSurface);
 	}
-}
 
-int LevelBuilder::OrderFloor(const void *pSurface0, const void *pSurface1)
-{
-	int lLevel0;
-	int lLevel1;
+	ASSERT(lCurrentIndex == mRoomList[pRoom].mNbVisibleSurface);
 
-	Model::SectionId lSurface0 = *(Model::SectionId *) pSurface0;
-	Model::SectionId lSurface1 = *(Model::SectionId *) pSurface1;
+	// Order the surfaces list
+	MR_SortedSurface *lTmp = new MR_SortedSurface[mRoomList[pRoom].mNbVisibleSurface];
 
-	if(lSurface0.mType == Model::SectionId::eRoom) {
-		lLevel0 = gsCurrentLevelBuilder->mRoomList[lSurface0.mId].mFloorLevel;
-	}
-	else {
-		lLevel0 = gsCurrentLevelBuilder->mFeatureList[lSurface0.mId].mCeilingLevel;
+	for(lCounter = 0; lCounter < mRoomList[pRoom].mNbVisibleSurface; lCounter++) {
+		lTmp[lCounter].mLevel = GetFloorLevel(mRoomList[pRoom].mVisibleFloorList[lCounter]);
 	}
+	sSortSurfaces(mRoomList[pRoom].mVisibleFloorList, lTmp, mRoomList[pRoom].mNbVisibleSurface, sOrderFloor);
 
-	if(lSurface1.mType == Model::SectionId::eRoom) {
-		lLevel1 = gsCurrentLevelBuilder->mRoomList[lSurface1.mId].mFloorLevel;
-	}
-	else {
-		lLevel1 = gsCurrentLevelBuilder->mFeatureList[lSurface1.mId].mCeilingLevel;
+	for(lCounter = 0; lCounter < mRoomList[pRoom].mNbVisibleSurface; lCounter++) {
+		lTmp[lCounter].mLevel = GetCeilingLevel(mRoomList[pRoom].mVisibleCeilingList[lCounter]);
 	}
+	sSortSurfaces(mRoomList[pRoom].mVisibleCeilingList, lTmp, mRoomList[pRoom].mNbVisibleSurface, sOrderCeiling);
 
-	return (lLevel0 - lLevel1);
+	delete[] lTmp;
 }
 
-int LevelBuilder::OrderCeiling(const void *pSurface0, const void *pSurface1)
+// Level of the upward-facing side of a surface (the floor of a room or the
+// top of a feature)
+int LevelBuilder::GetFloorLevel(const Model::SectionId &pSurface) const
 {
-	int lLevel0;
-	int lLevel1;
-
-	Model::SectionId lSurface0 = *(Model::SectionId *) pSurface0;
-	Model::SectionId lSurface1 = *(Model::SectionId *) pSurface1;
-
-	if(lSurface0.mType == Model::SectionId::eFeature) {
-		lLevel0 = gsCurrentLevelBuilder->mFeatureList[lSurface0.mId].mFloorLevel;
+	if(pSurface.mType == Model::SectionId::eRoom) {
+		return mRoomList[pSurface.mId].mFloorLevel;
 	}
 	else {
-		lLevel0 = gsCurrentLevelBuilder->mRoomList[lSurface0.mId].mCeilingLevel;
+		return mFeatureList[pSurface.mId].mCeilingLevel;
 	}
+}
 
-	if(lSurface1.mType == Model::SectionId::eFeature) {
-		lLevel1 = gsCurrentLevelBuilder->mFeatureList[lSurface1.mId].mFloorLevel;
+// Level of the downward-facing side of a surface (the ceiling of a room or
+// the bottom of a feature)
+int LevelBuilder::GetCeilingLevel(const Model::SectionId &pSurface) const
+{
+	if(pSurface.mType == Model::SectionId::eFeature) {
+		return mFeatureList[pSurface.mId].mFloorLevel;
 	}
 	else {
-		lLevel1 = gsCurrentLevelBuilder->mRoomList[lSurface1.mId].mCeilingLevel;
+		return mRoomList[pSurface.mId].mCeilingLevel;
 	}
-
-	return (lLevel1 - lLevel0);
 }
 
 double LevelBuilder::ComputeShapeConst(Section * pSection)
@@ -767,6 +757,8 @@ double LevelBuilder::ComputeShapeConst(Section * pSection)
 		pSection->mWallLen[lCounter] = (MR_Int32) sqrt(pow(lXLen, 2) + pow(lYLen, 2));
 	}
 
+	pSection->UpdateFlatGeometry();
+
 	// Compute bonding box diag size
 	lReturnValue = sqrt(
 		pow((float)(pSection->mMax.mX - pSection->mMin.mX), 2.0f) +
@@ -807,5 +799,34 @@ Model::SurfaceElement *sLoadTexture(TrackSpecParser *pParser)
 	return lReturnValue;
 }
 
+// Sort a list of surfaces by their precomputed levels.
+// The comparators only look at the keys, so no global state is needed, and
+// qsort sees exactly the same comparisons as when the levels were looked up
+// on the fly (so the resulting order is unchanged).
+void sSortSurfaces(Model::SectionId *pList, MR_SortedSurface *pTmp, int pCount, int (*pCompare)(const void *, const void *))
+{
+	int lCounter;
+
+	for(lCounter = 0; lCounter < pCount; lCounter++) {
+		pTmp[lCounter].mSurface = pList[lCounter];
+	}
+
+	qsort(pTmp, pCount, sizeof(MR_SortedSurface), pCompare);
+
+	for(lCounter = 0; lCounter < pCount; lCounter++) {
+		pList[lCounter] = pTmp[lCounter].mSurface;
+	}
+}
+
+int sOrderFloor(const void *pSurface0, const void *pSurface1)
+{
+	return ((const MR_SortedSurface *) pSurface0)->mLevel - ((const MR_SortedSurface *) pSurface1)->mLevel;
+}
+
+int sOrderCeiling(const void *pSurface0, const void *pSurface1)
+{
+	return ((const MR_SortedSurface *) pSurface1)->mLevel - ((const MR_SortedSurface *) pSurface0)->mLevel;
+}
+
 }  // namespace MazeCompiler
 }  // namespace HoverRace
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "../Model/Level.h"
+#include "../Util/MR_Types.h"
 #include "../Util/OS.h"
 #include "TrackCompilationLog.h"
 
@@ -43,6 +44,9 @@ class VisibleStep;
 class MR_DllDeclare LevelBuilder : public Model::Level
 {
 	typedef Model::Level SUPER;
+	public:
+		struct Point;
+
 	public:
 		LevelBuilder(const TrackCompilationLogPtr &log);
 		virtual ~LevelBuilder() {}
@@ -60,17 +64,40 @@ class MR_DllDeclare LevelBuilder : public Model::Level
 		void OrderVisibleSurfaces();
 
 	private:
-		void TestForVisibility(VisibleStep *pPreviousStep, int *pDestArray, int &pDestIndex, int pNewLeftNodeIndex);
+		void ComputeVisibleZones(int pRoom);
+		void ComputeAudibleZones(int pRoom, const std::vector<Point> &pCenters);
+		MR_UInt64 HashRoomGeometry(int pRoom) const;
+		int LoadVisibleZonesCache(const std::vector<MR_UInt64> &pRoomHash, std::vector<char> &pCached);
+		void SaveVisibleZonesCache(const std::vector<MR_UInt64> &pRoomHash) const;
+		void TestForVisibility(VisibleStep *pPreviousStep, int *pDestArray, int &pDestIndex, int pNewLeftNodeIndex) const;
 
-		static int OrderFloor(const void *pSurface0, const void *pSurface1);
-		static int OrderCeiling(const void *pSurface0, const void *pSurface1);
+		void OrderVisibleSurfaces(int pRoom);
+		int GetFloorLevel(const Model::SectionId &pSurface) const;
+		int GetCeilingLevel(const Model::SectionId &pSurface) const;
 
 	public:
+		/**
+		 * Set where the visible zones are cached between compilations.
+		 * Rooms which are unchanged since the last compilation will not have
+		 * their visibility recomputed.
+		 * @param path The cache file (empty to disable caching).
+		 */
+		void SetVisibleZonesCache(const Util::OS::path_t &path) { visibleZonesCachePath = path; }
+
+		/**
+		 * Set the number of threads used to compute the zones and surface
+		 * order.  The output is the same regardless of the thread count.
+		 * @param threads The thread count (zero for one per hardware thread).
+		 */
+		void SetThreads(unsigned int threads) { this->threads = threads; }
+
 		bool InitFromFile(const Util::OS::path_t &filename);
 		bool InitFromStream(std::istream &in);
 
 	private:
 		TrackCompilationLogPtr log;
+		Util::OS::path_t visibleZonesCachePath;
+		unsigned int threads;
 };
 
 }  // namespace MazeCompiler
@@ -0,0 +1,205 @@
+
+// LevelBuilderAudibleZones.cpp
+// Precomputation of the rooms that can be heard from each room.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include <math.h>
+
+#include <functional>
+#include <queue>
+
+#include "../Util/WorkerPool.h"
+
+#include "LevelBuilder.h"
+
+namespace HoverRace {
+namespace MazeCompiler {
+
+struct LevelBuilder::Point
+{
+	double x;
+	double y;
+};
+
+namespace {
+	double Dist(const LevelBuilder::Point &p0, const LevelBuilder::Point &p1)
+	{
+		double dx = p1.x - p0.x;
+		double dy = p1.y - p0.y;
+		return sqrt(dx * dx + dy * dy);
+	}
+}
+
+/**
+ * Compute, for each room, which other rooms can be heard from it.
+ *
+ * Sound travels from room to room through the openings in the walls; the
+ * length of a path is measured from room center to opening midpoint to room
+ * center.  For each opening of the listening room, the shortest path to
+ * every other room is found, and rooms that are closer than
+ * @c MR_MAX_AUDIBLE_DIST through at least one opening are audible.
+ * Each opening is given a coefficient from 255 (right next to the opening)
+ * down to 0 (@c MR_MAX_AUDIBLE_DIST away).
+ *
+ * @return @c true if successful.
+ */
+bool LevelBuilder::ComputeAudibleZones()
+{
+	log->Info(_("Computing audible zones"));
+
+	std::vector<Point> lCenters(mNbRoom);
+	for (int lRoom = 0; lRoom < mNbRoom; lRoom++) {
+		const Room &lRoomData = mRoomList[lRoom];
+
+		Point &lCenter = lCenters[lRoom];
+		lCenter.x = 0;
+		lCenter.y = 0;
+		for (int lVertex = 0; lVertex < lRoomData.mNbVertex; lVertex++) {
+			lCenter.x += lRoomData.mVertexList[lVertex].mX;
+			lCenter.y += lRoomData.mVertexList[lVertex].mY;
+		}
+		if (lRoomData.mNbVertex > 0) {
+			lCenter.x /= lRoomData.mNbVertex;
+			lCenter.y /= lRoomData.mNbVertex;
+		}
+	}
+
+	// Each room only writes its own list, so the rooms can be done in
+	// parallel.
+	Util::WorkerPool lPool(threads);
+	lPool.ParallelFor(mNbRoom, [&](int lRoom) {
+		ComputeAudibleZones(lRoom, lCenters);
+	});
+
+	return true;
+}
+
+/**
+ * Compute the audible rooms for a single room.
+ * @param pRoom The listening room.
+ * @param pCenters The center of each room.
+ */
+void LevelBuilder::ComputeAudibleZones(int pRoom, const std::vector<Point> &pCenters)
+{
+	typedef std::pair<double, int> queueEntry_t;  // (path length, room)
+
+	const Room &lListener = mRoomList[pRoom];
+
+	// Coefficient for each (source room, opening of the listening room).
+	std::vector<BYTE> lCoefficients(
+		static_cast<size_t>(mNbRoom) * lListener.mNbVertex, 0);
+	std::vector<int> lNbOpenings(mNbRoom, 0);
+
+	std::vector<double> lDist(mNbRoom);
+
+	for (int lWall = 0; lWall < lListener.mNbVertex; lWall++) {
+		int lNeighbor = lListener.mNeighborList[lWall];
+		if (lNeighbor == -1) continue;
+
+		const MR_2DCoordinate &lV0 = lListener.mVertexList[lWall];
+		const MR_2DCoordinate &lV1 = lListener.mVertexList[(lWall + 1) % lListener.mNbVertex];
+		Point lOpening = { (lV0.mX + lV1.mX) / 2.0, (lV0.mY + lV1.mY) / 2.0 };
+
+		std::fill(lDist.begin(), lDist.end(), static_cast<double>(MR_MAX_AUDIBLE_DIST));
+		std::priority_queue<queueEntry_t, std::vector<queueEntry_t>, std::greater<queueEntry_t>> lQueue;
+
+		double lStart = Dist(pCenters[pRoom], lOpening) + Dist(lOpening, pCenters[lNeighbor]);
+		if (lStart < lDist[lNeighbor]) {
+			lDist[lNeighbor] = lStart;
+			lQueue.push(queueEntry_t(lStart, lNeighbor));
+		}
+
+		while (!lQueue.empty()) {
+			queueEntry_t lEntry = lQueue.top();
+			lQueue.pop();
+
+			int lRoom = lEntry.second;
+			if (lEntry.first > lDist[lRoom]) continue;  // Stale.
+
+			const Room &lRoomData = mRoomList[lRoom];
+			for (int lRoomWall = 0; lRoomWall < lRoomData.mNbVertex; lRoomWall++) {
+				int lNext = lRoomData.mNeighborList[lRoomWall];
+
+				// Sound coming back through the listening room is heard
+				// through another opening.
+				if (lNext == -1 || lNext == pRoom) continue;
+
+				const MR_2DCoordinate &lW0 = lRoomData.mVertexList[lRoomWall];
+				const MR_2DCoordinate &lW1 = lRoomData.mVertexList[(lRoomWall + 1) % lRoomData.mNbVertex];
+				Point lNextOpening = { (lW0.mX + lW1.mX) / 2.0, (lW0.mY + lW1.mY) / 2.0 };
+
+				double lNextDist = lEntry.first +
+					Dist(pCenters[lRoom], lNextOpening) +
+					Dist(lNextOpening, pCenters[lNext]);
+				if (lNextDist < lDist[lNext]) {
+					lDist[lNext] = lNextDist;
+					lQueue.push(queueEntry_t(lNextDist, lNext));
+				}
+			}
+		}
+
+		for (int lSource = 0; lSource < mNbRoom; lSource++) {
+			if (lSource == pRoom || lDist[lSource] >= MR_MAX_AUDIBLE_DIST) continue;
+
+			int lCoef = static_cast<int>(255.0 * (1.0 - lDist[lSource] / MR_MAX_AUDIBLE_DIST));
+			if (lCoef < 1) lCoef = 1;
+
+			BYTE &lDest = lCoefficients[static_cast<size_t>(lSource) * lListener.mNbVertex + lWall];
+			if (lDest == 0) {
+				lNbOpenings[lSource]++;
+			}
+			lDest = static_cast<BYTE>(lCoef);
+		}
+	}
+
+	int lNbAudible = 0;
+	for (int lSource = 0; lSource < mNbRoom; lSource++) {
+		if (lNbOpenings[lSource] > 0) lNbAudible++;
+	}
+	if (lNbAudible == 0) return;
+
+	Room &lDestRoom = mRoomList[pRoom];
+	lDestRoom.mNbAudibleRoom = lNbAudible;
+	lDestRoom.mAudibleRoomList = new Room::AudibleRoom[lNbAudible];
+
+	int lIndex = 0;
+	for (int lSource = 0; lSource < mNbRoom; lSource++) {
+		int lNbSources = lNbOpenings[lSource];
+		if (lNbSources == 0) continue;
+
+		Room::AudibleRoom &lAudible = lDestRoom.mAudibleRoomList[lIndex++];
+		lAudible.mSectionSource = lSource;
+		lAudible.mNbVertexSources = lNbSources;
+		lAudible.mVertexList = new int[lNbSources];
+		lAudible.mSoundCoefficient = new BYTE[lNbSources];
+
+		const BYTE *lSourceCoefs = &lCoefficients[static_cast<size_t>(lSource) * lListener.mNbVertex];
+		int lVertexIndex = 0;
+		for (int lWall = 0; lWall < lListener.mNbVertex; lWall++) {
+			if (lSourceCoefs[lWall] != 0) {
+				lAudible.mVertexList[lVertexIndex] = lWall;
+				lAudible.mSoundCoefficient[lVertexIndex++] = lSourceCoefs[lWall];
+			}
+		}
+	}
+}
+
+}  // namespace MazeCompiler
+}  // namespace HoverRace
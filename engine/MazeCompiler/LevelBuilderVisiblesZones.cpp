@@ -21,12 +21,20 @@
 
 #include <math.h>
 
+#include "../Parcel/ClassicObjStream.h"
+#include "../Util/Str.h"
+#include "../Util/WorkerPool.h"
 #include "TrackCompileExn.h"
 
 #include "LevelBuilder.h"
 
 #define MR_MAX_VISIBLE_ZONES   500
 
+#define MR_VISIBLE_ZONES_CACHE_MAGIC     0x53495648  // "HVIS"
+#define MR_VISIBLE_ZONES_CACHE_VERSION   1
+
+using HoverRace::Util::OS;
+
 namespace HoverRace {
 namespace MazeCompiler {
 
@@ -69,60 +77,96 @@ class VisibleStep
 // Local functions
 static void AddZonetoArray(int pZone, int *pDestArray, int &pDestIndex);
 static double GetAngle(const MR_2DFloatPos & pPoint0, const MR_2DFloatPos & pPoint1, double pRef = 0.0);
+static MR_UInt64 HashInt(MR_UInt64 pHash, MR_Int32 pValue);
+static MR_UInt64 HashVisibleZonesInputs(int pRoom, const int *pVisibleList, int pNbVisible, const std::vector<MR_UInt64> &pRoomHash);
 
 // Functions implementation
 bool LevelBuilder::ComputeVisibleZones()
 {
 	bool lReturnValue = true;
 
-	int lDestIndex;
-	int lDestArray[MR_MAX_VISIBLE_ZONES];
-
 	log->Info(_("Computing visible zones... be patient"));
 
-	VisibleStep lStep;
-
+	std::vector<MR_UInt64> lRoomHash(mNbRoom);
 	for(int lCounter = 0; lCounter < mNbRoom; lCounter++) {
-		lDestIndex = 0;							  // Index in destination array
+		lRoomHash[lCounter] = HashRoomGeometry(lCounter);
+	}
+
+	// Rooms whose visibility inputs haven't changed since the last
+	// compilation are taken from the cache.
+	std::vector<char> lCached(mNbRoom, 0);
+	if(!visibleZonesCachePath.empty()) {
+		int lNbCached = LoadVisibleZonesCache(lRoomHash, lCached);
+		if(lNbCached > 0) {
+			log->Info(boost::str(boost::format(
+				_("Reusing visible zones for %d of %d rooms")) %
+					lNbCached % mNbRoom));
+		}
+	}
 
-		lStep.mZone = lCounter;
+	// Each room is independent of the others (the room list is only read
+	// while testing), so spread the rooms across all of the cores.
+	Util::WorkerPool lPool(threads);
+	lPool.ParallelFor(mNbRoom, [&](int lRoom) {
+		if(!lCached[lRoom]) {
+			ComputeVisibleZones(lRoom);
+		}
+	});
 
-		for(int lCounter2 = 0; lCounter2 < mRoomList[lCounter].mNbVertex; lCounter2++) {
-			lStep.mLeftNode = mRoomList[lCounter].mVertexList[lCounter2];
-			lStep.mRightNode = mRoomList[lCounter].mVertexList[(lCounter2 + 1) % mRoomList[lCounter].mNbVertex];
+	if(!visibleZonesCachePath.empty()) {
+		SaveVisibleZonesCache(lRoomHash);
+	}
 
-			lStep.mLeftLimit = lStep.mLeftNode;
-			lStep.mLeftLimitLightSource = lStep.mRightNode;
+	return lReturnValue;
+}
 
-			lStep.mRightLimit = lStep.mRightNode;
-			lStep.mRightLimitLightSource = lStep.mLeftNode;
+/**
+ * Compute the list of rooms visible from a single room.
+ * This only modifies the visible room list of the room itself, so it is
+ * safe to call concurrently for different rooms.
+ * @param pRoom The room.
+ */
+void LevelBuilder::ComputeVisibleZones(int pRoom)
+{
+	int lDestIndex = 0;							  // Index in destination array
+	int lDestArray[MR_MAX_VISIBLE_ZONES];
 
-			// PrintStep( &lStep );
-			// gMargin += 3;
+	VisibleStep lStep;
 
-			TestForVisibility(&lStep, lDestArray, lDestIndex, lCounter2);
+	lStep.mZone = pRoom;
 
-			// gMargin -= 3;
-		}
-		// printf( "%d visibles zones for zone %d\n", lDestIndex, lCounter );
+	for(int lCounter2 = 0; lCounter2 < mRoomList[pRoom].mNbVertex; lCounter2++) {
+		lStep.mLeftNode = mRoomList[pRoom].mVertexList[lCounter2];
+		lStep.mRightNode = mRoomList[pRoom].mVertexList[(lCounter2 + 1) % mRoomList[pRoom].mNbVertex];
 
-		if(lDestIndex > 0) {
-			mRoomList[lCounter].mNbVisibleRoom = lDestIndex;
+		lStep.mLeftLimit = lStep.mLeftNode;
+		lStep.mLeftLimitLightSource = lStep.mRightNode;
 
-			mRoomList[lCounter].mVisibleRoomList = new int[lDestIndex];
+		lStep.mRightLimit = lStep.mRightNode;
+		lStep.mRightLimitLightSource = lStep.mLeftNode;
 
-			for(int lCounter3 = 0; lCounter3 < lDestIndex; lCounter3++) {
-				mRoomList[lCounter].mVisibleRoomList[lCounter3] = lDestArray[lCounter3];
-			}
+		// PrintStep( &lStep );
+		// gMargin += 3;
 
-		}
+		TestForVisibility(&lStep, lDestArray, lDestIndex, lCounter2);
 
+		// gMargin -= 3;
 	}
+	// printf( "%d visibles zones for zone %d\n", lDestIndex, pRoom );
 
-	return lReturnValue;
+	if(lDestIndex > 0) {
+		mRoomList[pRoom].mNbVisibleRoom = lDestIndex;
+
+		mRoomList[pRoom].mVisibleRoomList = new int[lDestIndex];
+
+		for(int lCounter3 = 0; lCounter3 < lDestIndex; lCounter3++) {
+			mRoomList[pRoom].mVisibleRoomList[lCounter3] = lDestArray[lCounter3];
+		}
+
+	}
 }
 
-void LevelBuilder::TestForVisibility(VisibleStep *pPreviousStep, int *pDestArray, int &pDestIndex, int pNewLeftNodeIndex)
+void LevelBuilder::TestForVisibility(VisibleStep *pPreviousStep, int *pDestArray, int &pDestIndex, int pNewLeftNodeIndex) const
 {
 
 	VisibleStep lCurrentStep;
@@ -258,6 +302,160 @@ void LevelBuilder::TestForVisibility(VisibleStep *pPreviousStep, int *pDestArray
 	}
 }
 
+/**
+ * Hash the parts of a room that affect visibility: its walls and the
+ * rooms on the other side of them.
+ * @param pRoom The room.
+ * @return The hash.
+ */
+MR_UInt64 LevelBuilder::HashRoomGeometry(int pRoom) const
+{
+	const Room &lRoom = mRoomList[pRoom];
+
+	MR_UInt64 lHash = 14695981039346656037ULL;  // FNV-1a offset basis.
+
+	lHash = HashInt(lHash, lRoom.mNbVertex);
+	for(int lCounter = 0; lCounter < lRoom.mNbVertex; lCounter++) {
+		lHash = HashInt(lHash, lRoom.mVertexList[lCounter].mX);
+		lHash = HashInt(lHash, lRoom.mVertexList[lCounter].mY);
+		lHash = HashInt(lHash, lRoom.mNeighborList[lCounter]);
+	}
+
+	return lHash;
+}
+
+/**
+ * Load the visible zones from the last compilation.
+ *
+ * The visible list of a room only depends on the geometry of the room itself
+ * and of the rooms in the list (the search never looks past a wall that
+ * blocks the light), so a cached list is reused if none of those rooms have
+ * changed.
+ *
+ * @param pRoomHash The geometry hash of each room.
+ * @param pCached Set for each room which was loaded from the cache.
+ * @return The number of rooms loaded from the cache.
+ */
+int LevelBuilder::LoadVisibleZonesCache(const std::vector<MR_UInt64> &pRoomHash, std::vector<char> &pCached)
+{
+	int lReturnValue = 0;
+
+	FILE *lFile = OS::FOpen(visibleZonesCachePath, "rb");
+
+	if(lFile == NULL) {
+		return 0;
+	}
+
+	try {
+		Parcel::ClassicObjStream lArchive(lFile, visibleZonesCachePath, false);
+
+		MR_UInt32 lMagic;
+		MR_UInt32 lVersion;
+		MR_Int32 lNbRoom;
+
+		lArchive >> lMagic >> lVersion >> lNbRoom;
+
+		if((lMagic == MR_VISIBLE_ZONES_CACHE_MAGIC) && (lVersion == MR_VISIBLE_ZONES_CACHE_VERSION)) {
+			std::vector<int> lList;
+
+			for(int lRoom = 0; (lRoom < lNbRoom) && (lRoom < mNbRoom); lRoom++) {
+				MR_UInt32 lHashLo;
+				MR_UInt32 lHashHi;
+				MR_Int32 lNbVisible;
+
+				lArchive >> lHashLo >> lHashHi >> lNbVisible;
+
+				if((lNbVisible < 0) || (lNbVisible > MR_MAX_VISIBLE_ZONES)) {
+					break;
+				}
+
+				lList.resize(lNbVisible);
+
+				bool lValid = true;
+				for(int lCounter = 0; lCounter < lNbVisible; lCounter++) {
+					MR_Int32 lId;
+					lArchive >> lId;
+					lList[lCounter] = lId;
+
+					if((lId < 0) || (lId >= mNbRoom)) {
+						lValid = false;
+					}
+				}
+
+				MR_UInt64 lHash = (static_cast<MR_UInt64>(lHashHi) << 32) | lHashLo;
+
+				if(lValid && (HashVisibleZonesInputs(lRoom, lList.data(), lNbVisible, pRoomHash) == lHash)) {
+					if(lNbVisible > 0) {
+						mRoomList[lRoom].mNbVisibleRoom = lNbVisible;
+						mRoomList[lRoom].mVisibleRoomList = new int[lNbVisible];
+
+						for(int lCounter = 0; lCounter < lNbVisible; lCounter++) {
+							mRoomList[lRoom].mVisibleRoomList[lCounter] = lList[lCounter];
+						}
+					}
+
+					pCached[lRoom] = 1;
+					lReturnValue++;
+				}
+			}
+		}
+	}
+	catch(Parcel::ObjStreamExn &) {
+		// A truncated cache is harmless; whatever couldn't be read will
+		// simply be recomputed.
+	}
+
+	fclose(lFile);
+
+	return lReturnValue;
+}
+
+/**
+ * Save the visible zones for the next compilation.
+ * Failure to write the cache is not an error.
+ * @param pRoomHash The geometry hash of each room.
+ */
+void LevelBuilder::SaveVisibleZonesCache(const std::vector<MR_UInt64> &pRoomHash) const
+{
+	FILE *lFile = OS::FOpen(visibleZonesCachePath, "wb");
+
+	if(lFile == NULL) {
+		log->Warn(boost::str(boost::format(
+			_("Warning: unable to write the visible zones cache: %s")) %
+				Util::Str::PU(visibleZonesCachePath)));
+		return;
+	}
+
+	try {
+		Parcel::ClassicObjStream lArchive(lFile, visibleZonesCachePath, true);
+
+		lArchive << static_cast<MR_UInt32>(MR_VISIBLE_ZONES_CACHE_MAGIC);
+		lArchive << static_cast<MR_UInt32>(MR_VISIBLE_ZONES_CACHE_VERSION);
+		lArchive << static_cast<MR_Int32>(mNbRoom);
+
+		for(int lRoom = 0; lRoom < mNbRoom; lRoom++) {
+			const Room &lRoomData = mRoomList[lRoom];
+
+			MR_UInt64 lHash = HashVisibleZonesInputs(lRoom, lRoomData.mVisibleRoomList, lRoomData.mNbVisibleRoom, pRoomHash);
+
+			lArchive << static_cast<MR_UInt32>(lHash);
+			lArchive << static_cast<MR_UInt32>(lHash >> 32);
+			lArchive << static_cast<MR_Int32>(lRoomData.mNbVisibleRoom);
+
+			for(int lCounter = 0; lCounter < lRoomData.mNbVisibleRoom; lCounter++) {
+				lArchive << static_cast<MR_Int32>(lRoomData.mVisibleRoomList[lCounter]);
+			}
+		}
+	}
+	catch(Parcel::ObjStreamExn &ex) {
+		log->Warn(boost::str(boost::format(
+			_("Warning: unable to write the visible zones cache: %s")) %
+				ex.what()));
+	}
+
+	fclose(lFile);
+}
+
 const MR_2DFloatPos &MR_2DFloatPos::operator=(const MR_2DCoordinate &pPos)
 {
 	mX = pPos.mX / 1000.0;
@@ -296,6 +494,37 @@ void AddZonetoArray(int pZone, int *pDestArray, int &pDestIndex)
 	pDestArray[pDestIndex++] = pZone;
 }
 
+MR_UInt64 HashInt(MR_UInt64 pHash, MR_Int32 pValue)
+{
+	MR_UInt32 lValue = static_cast<MR_UInt32>(pValue);
+
+	for(int lCounter = 0; lCounter < 4; lCounter++) {
+		pHash ^= (lValue & 0xff);
+		pHash *= 1099511628211ULL;			  // FNV-1a prime.
+		lValue >>= 8;
+	}
+	return pHash;
+}
+
+// Combine the hashes of everything that the visible list of a room was
+// computed from: the room itself and each of the rooms that it can see.
+MR_UInt64 HashVisibleZonesInputs(int pRoom, const int *pVisibleList, int pNbVisible, const std::vector<MR_UInt64> &pRoomHash)
+{
+	MR_UInt64 lHash = pRoomHash[pRoom];
+
+	lHash = HashInt(lHash, pRoom);
+	lHash = HashInt(lHash, pNbVisible);
+
+	for(int lCounter = 0; lCounter < pNbVisible; lCounter++) {
+		int lRoom = pVisibleList[lCounter];
+
+		lHash = HashInt(lHash, lRoom);
+		lHash = HashInt(lHash, static_cast<MR_Int32>(pRoomHash[lRoom]));
+		lHash = HashInt(lHash, static_cast<MR_Int32>(pRoomHash[lRoom] >> 32));
+	}
+	return lHash;
+}
+
 double GetAngle(const MR_2DFloatPos & pPoint0, const MR_2DFloatPos & pPoint1, double pRef)
 {
 
@@ -58,8 +58,12 @@ namespace {
 }
 
 TrackCompiler::TrackCompiler(const TrackCompilationLogPtr &log, const Util::OS::path_t &outputFilename) :
-	outputFilename(outputFilename), log(log)
+	outputFilename(outputFilename), log(log), threads(0)
 {
+	// Keep the visibility results next to the track so that recompiling
+	// after a small change only has to redo the affected rooms.
+	cacheFilename = outputFilename;
+	cacheFilename += ".vis";
 }
 
 /**
@@ -112,6 +116,8 @@ void TrackCompiler::Compile(std::istream &in) const
 
 	// The track itself.
 	LevelBuilder builder(log);
+	builder.SetVisibleZonesCache(cacheFilename);
+	builder.SetThreads(threads);
 	if (!outFile.BeginANewRecord()) {
 		throw TrackCompileExn(_("Unable to add the track to the output file"));
 	}
@@ -191,7 +197,7 @@ void TrackCompiler::CreateHeader(std::istream &in, Parcel::ObjStream &archive) c
 	}
 
 	archive << (int) MR_MAGIC_TRACK_NUMBER;
-	archive << (int) 1;  // Version.
+	archive << (int) MR_TRACK_VERSION;
 	archive << desc;
 	archive << (int) 0;  // Registration minor ID (obsolete).
 	archive << (int) 0;  // Registration major ID (obsolete).
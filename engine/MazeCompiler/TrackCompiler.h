@@ -54,6 +54,20 @@ class MR_DllDeclare TrackCompiler
 		TrackCompiler(const TrackCompilationLogPtr &log, const Util::OS::path_t &outputFilename);
 		~TrackCompiler() {}
 
+	public:
+		/**
+		 * Set where the visible zones are cached between compilations.
+		 * By default, the cache is kept next to the output file.
+		 * @param path The cache file (empty to disable caching).
+		 */
+		void SetVisibleZonesCache(const Util::OS::path_t &path) { cacheFilename = path; }
+
+		/**
+		 * Set the number of threads used to build the track.
+		 * @param threads The thread count (zero for one per hardware thread).
+		 */
+		void SetThreads(unsigned int threads) { this->threads = threads; }
+
 	public:
 		void Compile(const Util::OS::path_t &inputFilename) const;
 		void Compile(std::istream &in) const;
@@ -70,7 +84,9 @@ class MR_DllDeclare TrackCompiler
 
 	private:
 		Util::OS::path_t outputFilename;
+		Util::OS::path_t cacheFilename;
 		TrackCompilationLogPtr log;
+		unsigned int threads;
 };
 
 }  // namespace MazeCompiler
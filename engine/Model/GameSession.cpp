@@ -19,10 +19,12 @@
 // and limitations under the License.
 //
 
+#include <chrono>
+
 #include "GameSession.h"
 #include "ObstacleCollisionReport.h"
 
-#define MR_SIMULATION_SLICE             15
+#define MR_SIMULATION_SLICE             HoverRace::Model::GameSession::SIMULATION_SLICE
 #define MR_MINIMUM_SIMULATION_SLICE     10
 
 using namespace HoverRace::Parcel;
@@ -30,11 +32,39 @@ using namespace HoverRace::Parcel;
 namespace HoverRace {
 namespace Model {
 
+namespace {
+	/**
+	 * Adds the time spent in a scope to a profile counter.
+	 * Does nothing (and doesn't touch the clock) if the counter is @c nullptr.
+	 */
+	class PhaseTimer
+	{
+		typedef std::chrono::high_resolution_clock clock_t;
+		public:
+			PhaseTimer(MR_Int64 *counter) :
+				counter(counter),
+				start(counter ? clock_t::now() : clock_t::time_point()) { }
+			~PhaseTimer()
+			{
+				if (counter) {
+					*counter += std::chrono::duration_cast<std::chrono::nanoseconds>(
+						clock_t::now() - start).count();
+				}
+			}
+
+		private:
+			MR_Int64 *counter;
+			clock_t::time_point start;
+	};
+}
+
 GameSession::GameSession(bool pAllowRendering) :
 	mAllowRendering(pAllowRendering),
 	mCurrentLevelNumber(-1),
 	mSimulationTime(-3000),  // 3 sec countdown
-	mLastSimulateCallTime(Util::OS::Time())
+	mLastSimulateCallTime(Util::OS::Time()),
+	mPendingTime(0),
+	profile(nullptr)
 {
 }
 
@@ -45,7 +75,11 @@ GameSession::~GameSession()
 
 bool GameSession::LoadLevel(char gameOpts)
 {
-	track->Load(mAllowRendering, gameOpts);
+	// The track may have already been loaded ahead of time
+	// (e.g. by a background loader).
+	if (!track->GetLevel()) {
+		track->Load(mAllowRendering, gameOpts);
+	}
 	return true;
 }
 
@@ -74,6 +108,7 @@ bool GameSession::LoadNew(const char *pTitle, std::shared_ptr<Track> track, char
 void GameSession::SetSimulationTime(MR_SimulationTime pTime)
 {
 	mSimulationTime = pTime;
+	mPendingTime = 0;
 	mLastSimulateCallTime = Util::OS::Time();
 }
 
@@ -110,9 +145,8 @@ void GameSession::Simulate()
 	 */
 
 	while(lTimeToSimulate >= MR_SIMULATION_SLICE) {
-		SimulateFreeElems(mSimulationTime < 0 ? 0 : MR_SIMULATION_SLICE);
+		Step();
 		lTimeToSimulate -= MR_SIMULATION_SLICE;
-		mSimulationTime += MR_SIMULATION_SLICE;
 	}
 
 	if(lTimeToSimulate >= MR_MINIMUM_SIMULATION_SLICE) {
@@ -127,6 +161,49 @@ void GameSession::Simulate()
 	mLastSimulateCallTime = lSimulateCallTime - lTimeToSimulate;
 }
 
+/**
+ * Advance the simulation by exactly one slice (MR_SIMULATION_SLICE ms).
+ * Unlike Simulate(), this doesn't depend on the wall clock, so a sequence
+ * of steps with the same inputs always produces the same results.
+ */
+void GameSession::Step()
+{
+	ASSERT(track->GetLevel() != nullptr);
+
+	SimulateFreeElems(mSimulationTime < 0 ? 0 : MR_SIMULATION_SLICE);
+	mSimulationTime += MR_SIMULATION_SLICE;
+}
+
+/**
+ * Advance the simulation by a fixed amount of time, independent of the wall
+ * clock.
+ *
+ * The world is only ever advanced in whole slices; any remainder is carried
+ * over to the next call.  This means that splitting a duration across
+ * several calls produces exactly the same results as a single call, so
+ * servers, replays and batch runs can go as fast as the host allows and
+ * still get identical results.
+ *
+ * @param duration The simulation time to advance, in milliseconds
+ *                 (negative values are ignored).
+ * @return The number of slices that were simulated.
+ */
+int GameSession::RunFor(MR_SimulationTime duration)
+{
+	if (duration > 0) {
+		mPendingTime += duration;
+	}
+
+	int slices = 0;
+	while (mPendingTime >= MR_SIMULATION_SLICE) {
+		Step();
+		mPendingTime -= MR_SIMULATION_SLICE;
+		slices++;
+	}
+
+	return slices;
+}
+
 void GameSession::SimulateLateElement(MR_FreeElementHandle pElement, MR_SimulationTime pDuration, int pRoom)
 {
 	Level *mCurrentLevel = track->GetLevel();
@@ -142,6 +219,8 @@ void GameSession::SimulateLateElement(MR_FreeElementHandle pElement, MR_Simulati
 		// can't backtrack below 0
 		return;
 	}
+	mCurrentLevel->UpdateAllContactBounds();
+
 	// clock back
 	MR_SimulationTime lOriginalTime = mSimulationTime;
 	mSimulationTime -= lTimeToSimulate;
@@ -160,6 +239,42 @@ void GameSession::SimulateLateElement(MR_FreeElementHandle pElement, MR_Simulati
 	mSimulationTime = lOriginalTime;
 }
 
+/**
+ * Simulate a single element for one slice at an earlier point in time,
+ * without advancing the rest of the world.
+ *
+ * This is used to replay the movement of an element after its state has
+ * been corrected.  Other elements are not rewound, so the element sees
+ * them where they are now.
+ *
+ * @param pElement The element.
+ * @param pRoom The room the element is in.
+ * @param pTime The simulation time at the start of the slice (may not be
+ *              later than the current simulation time).
+ * @return The room the element is in afterwards, or a negative value if
+ *         the element is gone.
+ */
+int GameSession::ReplayElementSlice(MR_FreeElementHandle pElement, int pRoom, MR_SimulationTime pTime)
+{
+	ASSERT(track->GetLevel() != nullptr);
+
+	if(pRoom < 0 || pTime > mSimulationTime) {
+		return pRoom;
+	}
+
+	// The element may have been moved since it was last simulated.
+	Level::UpdateContactBounds(pElement);
+
+	MR_SimulationTime lOriginalTime = mSimulationTime;
+	mSimulationTime = pTime;
+
+	pRoom = SimulateOneFreeElem(pTime < 0 ? 0 : MR_SIMULATION_SLICE, pElement, pRoom);
+
+	mSimulationTime = lOriginalTime;
+
+	return pRoom;
+}
+
 void GameSession::SimulateSurfaceElems(MR_SimulationTime /*pTimeToSimulate */ )
 {
 	// Give the control to each surface so they can update there state
@@ -176,7 +291,11 @@ int GameSession::SimulateOneFreeElem(MR_SimulationTime pTimeToSimulate, MR_FreeE
 	FreeElement *lElement = mCurrentLevel->GetFreeElement(pElementHandle);
 
 	// Ask the element to simulate its movement
-	int lNewRoom = lElement->Simulate(pTimeToSimulate, mCurrentLevel, pRoom);
+	int lNewRoom;
+	{
+		PhaseTimer timer(profile ? &profile->simulate : nullptr);
+		lNewRoom = lElement->Simulate(pTimeToSimulate, mCurrentLevel, pRoom);
+	}
 	int lReturnValue = lNewRoom;
 
 	if(lNewRoom == Level::eMustBeDeleted) {
@@ -187,6 +306,10 @@ int GameSession::SimulateOneFreeElem(MR_SimulationTime pTimeToSimulate, MR_FreeE
 	if(pRoom != lNewRoom)
 		mCurrentLevel->MoveElement(pElementHandle, lNewRoom);
 
+	// The element may have moved, so refresh the broad-phase bounds
+	// before anyone tests against it.
+	Level::UpdateContactBounds(pElementHandle);
+
 	// Compute interaction of the element with the environment
 	const ShapeInterface *lContactShape = lElement->GetGivingContactEffectShape();
 
@@ -196,8 +319,12 @@ int GameSession::SimulateOneFreeElem(MR_SimulationTime pTimeToSimulate, MR_FreeE
 		RoomContactSpec lSpec;
 
 		// Do the contact treatement for that room
-		mCurrentLevel->GetRoomContact(lNewRoom, lContactShape, lSpec);
+		{
+			PhaseTimer timer(profile ? &profile->roomContact : nullptr);
+			mCurrentLevel->GetRoomContact(lNewRoom, lContactShape, lSpec);
+		}
 
+		PhaseTimer timer(profile ? &profile->shapeContact : nullptr);
 		ComputeShapeContactEffects(lNewRoom, lElement, lSpec, &lVisitedRooms, 1, pTimeToSimulate);
 	}
 
@@ -214,9 +341,12 @@ void GameSession::SimulateFreeElems(MR_SimulationTime pTimeToSimulate)
 	int lRoomIndex;
 
 	// Interaction objects collection
+	mCurrentLevel->UpdateAllContactBounds();
 
-	// Simulate element by element
-	for(lRoomIndex = -1; lRoomIndex < mCurrentLevel->GetRoomCount(); lRoomIndex++) {
+	// Simulate element by element, skipping rooms without elements
+	for(lRoomIndex = Level::eNonClassified;
+		lRoomIndex < mCurrentLevel->GetRoomCount();
+		lRoomIndex = mCurrentLevel->GetNextActiveRoom(lRoomIndex)) {
 		// Simulate FreeElements
 		MR_FreeElementHandle lElementHandle = mCurrentLevel->GetFirstFreeElement(lRoomIndex);
 
@@ -226,7 +356,13 @@ void GameSession::SimulateFreeElems(MR_SimulationTime pTimeToSimulate)
 			lElementHandle = lNext;
 		}
 	}
+
+	PhaseTimer timer(profile ? &profile->flushCache : nullptr);
 	mCurrentLevel->FlushPermElementPosCache();
+
+	if (profile) {
+		profile->slices++;
+	}
 }
 
 void GameSession::ComputeShapeContactEffects(int pCurrentRoom, FreeElement * pActor, const RoomContactSpec & pLastSpec, MR_FastArrayBase < int >*pVisitedRooms, int pMaxDepth, MR_SimulationTime pDuration)
@@ -282,12 +418,17 @@ void GameSession::ComputeShapeContactEffects(int pCurrentRoom, FreeElement * pAc
 	}
 
 	// Compute interaction with room actors
+	// The cached bounds let us skip the (virtual) contact test for
+	// obstacles which can't possibly be touching the actor.
+	ContactBounds lActorBounds;
+	lActorBounds.Set(lActorShape);
+
 	MR_FreeElementHandle lObstacleHandle = mCurrentLevel->GetFirstFreeElement(pCurrentRoom);
 
 	while(lObstacleHandle != NULL) {
 		FreeElement *lObstacleElem = Level::GetFreeElement(lObstacleHandle);
 
-		if(lObstacleElem != pActor) {
+		if(lObstacleElem != pActor && Level::MayContact(lObstacleHandle, lActorBounds)) {
 
 			if(DetectActorContact(lActorShape, lObstacleElem->GetReceivingContactEffectShape(), lSpec)) {
 				// Ok Compute the directiion of the collision
@@ -41,6 +41,36 @@ namespace Model {
 
 class MR_DllDeclare GameSession
 {
+	public:
+		/**
+		 * Accumulated time spent in each phase of the simulation.
+		 * Only collected while attached to a session with SetProfile().
+		 * All times are in nanoseconds.
+		 */
+		struct Profile
+		{
+			Profile() { Clear(); }
+
+			void Clear()
+			{
+				slices = 0;
+				simulate = 0;
+				roomContact = 0;
+				shapeContact = 0;
+				flushCache = 0;
+			}
+
+			MR_Int64 slices;  ///< Number of slices simulated.
+			MR_Int64 simulate;  ///< FreeElement::Simulate().
+			MR_Int64 roomContact;  ///< Level::GetRoomContact().
+			MR_Int64 shapeContact;  ///< ComputeShapeContactEffects().
+			MR_Int64 flushCache;  ///< Level::FlushPermElementPosCache().
+		};
+
+	public:
+		/// The length of one slice of the simulation (see Step()), in ms.
+		static const MR_SimulationTime SIMULATION_SLICE = 15;
+
 	public:
 		GameSession(bool pAllowRendering = true);
 		~GameSession();
@@ -50,11 +80,21 @@ class MR_DllDeclare GameSession
 		void SetSimulationTime(MR_SimulationTime);
 		MR_SimulationTime GetSimulationTime() const;
 		void Simulate();
+		void Step();
+		int RunFor(MR_SimulationTime duration);
 		void SimulateLateElement(MR_FreeElementHandle pElement, MR_SimulationTime pDuration, int pRoom);
+		int ReplayElementSlice(MR_FreeElementHandle pElement, int pRoom, MR_SimulationTime pTime);
 
 		Level *GetCurrentLevel() const;
 		const char *GetTitle() const;
 
+		/**
+		 * Attach a profile to collect per-phase simulation timings.
+		 * @param profile The profile to update (may be @c nullptr to stop
+		 *                profiling).  The caller retains ownership.
+		 */
+		void SetProfile(Profile *profile) { this->profile = profile; }
+
 	private:
 		bool LoadLevel(char gameOpts);
 		void Clean();							  // Clean up before destruction or clean-up
@@ -75,6 +115,9 @@ class MR_DllDeclare GameSession
 
 		MR_SimulationTime mSimulationTime;  ///< Time simulated since the session start
 		Util::OS::timestamp_t mLastSimulateCallTime;  ///< Time in ms obtained by timeGetTime
+		MR_SimulationTime mPendingTime;  ///< Leftover time from RunFor() (less than a slice).
+
+		Profile *profile;
 };
 
 }  // namespace Model
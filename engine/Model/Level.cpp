@@ -20,17 +20,46 @@
 //
 
 #include "../Parcel/ObjStream.h"
+#include "../Parcel/SpanReader.h"
+#include "TrackFileCommon.h"
 
 #include "Level.h"
 
 using HoverRace::Parcel::ObjStream;
+using HoverRace::Parcel::SpanReader;
 
 namespace HoverRace {
 namespace Model {
 
+namespace {
+
+static_assert(sizeof(int) == sizeof(MR_Int32), "int must be 32 bits");
+
+/**
+ * Read an array of 32-bit integers.
+ * If the stream is backed by memory, the whole array is read in one block.
+ * @param pArchive The stream.
+ * @param pArray The destination array.
+ * @param pCount The number of elements.
+ */
+void ReadInt32Array(ObjStream &pArchive, int *pArray, int pCount)
+{
+	SpanReader *lSpan = pArchive.GetSpanReader();
+	if(lSpan != NULL) {
+		lSpan->ReadArray(pArray, pCount);
+	}
+	else {
+		for(int lCounter = 0; lCounter < pCount; lCounter++) {
+			pArchive >> pArray[lCounter];
+		}
+	}
+}
+
+}  // namespace
+
 // Level implementation
 Level::Level(BOOL pAllowRendering, char pGameOpts) :
-	gravity(1.0)
+	gravity(1.0), formatVersion(MR_TRACK_VERSION)
 {
 	// Initialisation of an empty level
 	mAllowRendering = pAllowRendering;
@@ -59,12 +88,12 @@ Level::~Level()
 
 	// Delete free elements
 	while(mFreeElementNonClassifiedList != NULL) {
-		delete mFreeElementNonClassifiedList;
+		DeleteElement((MR_FreeElementHandle) mFreeElementNonClassifiedList);
 	}
 
 	for(int lCounter = 0; lCounter < mNbRoom; lCounter++) {
 		while(mFreeElementClassifiedByRoomList[lCounter] != NULL) {
-			delete mFreeElementClassifiedByRoomList[lCounter];
+			DeleteElement((MR_FreeElementHandle) mFreeElementClassifiedByRoomList[lCounter]);
 		}
 	}
 
@@ -135,7 +164,7 @@ void Level::Serialize(ObjStream &pArchive)
 	}
 
 	for(lCounter = 0; lCounter < mNbRoom; lCounter++) {
-		mRoomList[lCounter].SerializeStructure(pArchive);
+		mRoomList[lCounter].SerializeStructure(pArchive, formatVersion);
 	}
 
 	for(lCounter = 0; lCounter < mNbFeature; lCounter++) {
@@ -144,10 +173,10 @@ void Level::Serialize(ObjStream &pArchive)
 
 	// Serialise the actors
 
-	FreeElementList::SerializeList(pArchive, &mFreeElementNonClassifiedList);
+	FreeElementList::SerializeList(pArchive, &mFreeElementNonClassifiedList, mFreeElementPool);
 
 	for(lCounter = 0; lCounter < mNbRoom; lCounter++) {
-		FreeElementList::SerializeList(pArchive, &mFreeElementClassifiedByRoomList[lCounter]);
+		FreeElementList::SerializeList(pArchive, &mFreeElementClassifiedByRoomList[lCounter], mFreeElementPool);
 
 		if(!pArchive.IsWriting()) {
 			FreeElementList *lCurrentElem = mFreeElementClassifiedByRoomList[lCounter];
@@ -190,6 +219,10 @@ void Level::Serialize(ObjStream &pArchive)
 		}
 	}
 
+	if(!pArchive.IsWriting()) {
+		ResetActiveRooms();
+	}
+
 	// the logic state of each element can now be serialized because all
 	// elements are now created (this is only a precaution in case that some
 	// elements have a link between them
@@ -303,6 +336,41 @@ const int *Level::GetVisibleZones(int pRoomId, int &pNbVisibleZones) const
 	return mRoomList[pRoomId].mVisibleRoomList;
 }
 
+/**
+ * Retrieve the number of other rooms that can be heard from a room.
+ * Tracks compiled before the audible zones were computed have none.
+ * @param pRoomId The listening room.
+ * @return The number of audible rooms.
+ */
+int Level::GetAudibleZoneCount(int pRoomId) const
+{
+	return mRoomList[pRoomId].mNbAudibleRoom;
+}
+
+/**
+ * Retrieve a room that can be heard from a room.
+ * @param pRoomId The listening room.
+ * @param pIndex The index of the audible room
+ *               (0 to GetAudibleZoneCount() - 1).
+ * @param[out] pCoefficient The attenuation coefficient of the loudest path,
+ *                          from 255 (no attenuation) to 0 (silent).
+ * @return The audible room, or -1 for tracks older than version 2
+ *         (which don't record it).
+ */
+int Level::GetAudibleZone(int pRoomId, int pIndex, int &pCoefficient) const
+{
+	const Room::AudibleRoom &lAudible = mRoomList[pRoomId].mAudibleRoomList[pIndex];
+
+	pCoefficient = 0;
+	for(int lCounter = 0; lCounter < lAudible.mNbVertexSources; lCounter++) {
+		if(lAudible.mSoundCoefficient[lCounter] > pCoefficient) {
+			pCoefficient = lAudible.mSoundCoefficient[lCounter];
+		}
+	}
+
+	return lAudible.mSectionSource;
+}
+
 int Level::GetNbVisibleSurface(int pRoomId) const
 {
 	return mRoomList[pRoomId].mNbVisibleSurface;
@@ -381,6 +449,73 @@ MR_FreeElementHandle Level::GetFirstFreeElement(int pRoom) const
 	return (MR_FreeElementHandle) lReturnValue;
 }
 
+/**
+ * Find the next room that contains free elements.
+ *
+ * This lets callers visit every room with free elements without scanning
+ * the whole track.  Rooms are returned in increasing order, and an element
+ * that moves into a later room while iterating will still be found.
+ *
+ * @param pRoom The room to start after (use @c eNonClassified to start
+ *              from the first room).
+ * @return The room index, or GetRoomCount() if there are no more rooms.
+ */
+int Level::GetNextActiveRoom(int pRoom)
+{
+	int lRoom = pRoom + 1;
+
+	while(lRoom < mNbRoom) {
+		size_t lWord = static_cast<size_t>(lRoom) / 64;
+		if(lWord >= mActiveRooms.size()) {
+			break;
+		}
+
+		MR_UInt64 lBits = mActiveRooms[lWord] >> (lRoom % 64);
+		if(lBits == 0) {
+			lRoom = static_cast<int>(lWord + 1) * 64;
+			continue;
+		}
+
+		while(!(lBits & 1)) {
+			lBits >>= 1;
+			lRoom++;
+		}
+
+		if(mFreeElementClassifiedByRoomList[lRoom] != NULL) {
+			return lRoom;
+		}
+
+		// The room has emptied since it was marked; drop it from the set.
+		mActiveRooms[lWord] &= ~(static_cast<MR_UInt64>(1) << (lRoom % 64));
+		lRoom++;
+	}
+
+	return mNbRoom;
+}
+
+void Level::MarkRoomActive(int pRoom)
+{
+	size_t lWord = static_cast<size_t>(pRoom) / 64;
+	if(lWord >= mActiveRooms.size()) {
+		mActiveRooms.resize(static_cast<size_t>(mNbRoom + 63) / 64);
+	}
+	mActiveRooms[lWord] |= static_cast<MR_UInt64>(1) << (pRoom % 64);
+}
+
+/**
+ * Rebuild the active room set from the room lists.
+ */
+void Level::ResetActiveRooms()
+{
+	mActiveRooms.assign(static_cast<size_t>(mNbRoom + 63) / 64, 0);
+
+	for(int lCounter = 0; lCounter < mNbRoom; lCounter++) {
+		if(mFreeElementClassifiedByRoomList[lCounter] != NULL) {
+			MarkRoomActive(lCounter);
+		}
+	}
+}
+
 MR_FreeElementHandle Level::GetNextFreeElement(MR_FreeElementHandle pHandle)
 {
 	return (MR_FreeElementHandle) ((FreeElementList *) pHandle)->mNext;
@@ -398,18 +533,20 @@ void Level::MoveElement(MR_FreeElementHandle pHandle, int pNewRoom)
 	}
 	else {
 		((FreeElementList *) pHandle)->LinkTo(&(mFreeElementClassifiedByRoomList[pNewRoom]));
+		MarkRoomActive(pNewRoom);
 	}
 }
 
 MR_FreeElementHandle Level::InsertElement(FreeElement * pElement, int pRoom, BOOL pBroadcast)
 {
-	FreeElementList *lReturnValue = new FreeElementList;
+	FreeElementList *lReturnValue = mFreeElementPool.Alloc();
 
 	if(mAllowRendering) {
 		pElement->AddRenderer();
 	}
 
 	lReturnValue->mElement = pElement;
+	UpdateContactBounds((MR_FreeElementHandle) lReturnValue);
 
 	MoveElement((MR_FreeElementHandle) lReturnValue, pRoom);
 
@@ -422,7 +559,14 @@ MR_FreeElementHandle Level::InsertElement(FreeElement * pElement, int pRoom, BOO
 
 void Level::DeleteElement(MR_FreeElementHandle pHandle)
 {
-	delete((FreeElementList *) pHandle);
+	FreeElementList *lNode = (FreeElementList *) pHandle;
+
+	lNode->Unlink();
+	delete lNode->mElement;
+	lNode->mElement = NULL;
+	lNode->mHasBounds = FALSE;
+
+	mFreeElementPool.Free(lNode);
 }
 
 MR_FreeElementHandle Level::GetPermanentElementHandle(int pElem) const
@@ -434,6 +578,55 @@ MR_FreeElementHandle Level::GetPermanentElementHandle(int pElem) const
 	return (MR_FreeElementHandle) mPermNetActor[pElem];
 }
 
+/**
+ * Refresh the cached contact bounds of an element.
+ * This must be called whenever the element's position changes, so that
+ * MayContact() doesn't reject a real contact.
+ * @param pHandle The element.
+ */
+void Level::UpdateContactBounds(MR_FreeElementHandle pHandle)
+{
+	FreeElementList *lNode = (FreeElementList *) pHandle;
+	const ShapeInterface *lShape = lNode->mElement->GetReceivingContactEffectShape();
+
+	if(lShape == NULL) {
+		lNode->mHasBounds = FALSE;
+	}
+	else {
+		lNode->mHasBounds = TRUE;
+		lNode->mBounds.Set(lShape);
+	}
+}
+
+/**
+ * Refresh the cached contact bounds of every element in the level.
+ * This catches any position changes made outside of the simulation
+ * (e.g. from network updates).
+ */
+void Level::UpdateAllContactBounds()
+{
+	for(int lRoom = eNonClassified; lRoom < mNbRoom; lRoom = GetNextActiveRoom(lRoom)) {
+		MR_FreeElementHandle lHandle = GetFirstFreeElement(lRoom);
+
+		while(lHandle != NULL) {
+			UpdateContactBounds(lHandle);
+			lHandle = GetNextFreeElement(lHandle);
+		}
+	}
+}
+
+/**
+ * Broad-phase contact test against an element's cached bounds.
+ * @param pHandle The element.
+ * @param pBounds The bounds of the actor.
+ * @return @c false if the actor definitely isn't touching the element.
+ */
+bool Level::MayContact(MR_FreeElementHandle pHandle, const ContactBounds &pBounds)
+{
+	FreeElementList *lNode = (FreeElementList *) pHandle;
+	return lNode->mHasBounds && lNode->mBounds.MayContact(pBounds);
+}
+
 void Level::SetPermElementPos(int pPermElement, int pRoom, const MR_3DCoordinate & pNewPos)
 {
 	if(pPermElement >= 0) {
@@ -442,6 +635,7 @@ void Level::SetPermElementPos(int pPermElement, int pRoom, const MR_3DCoordinate
 		// MoveElement( (MR_FreeElementHandle)mPermNetActor[ pPermElement ], pRoom );
 
 		mPermNetActor[pPermElement]->mElement->mPosition = pNewPos;
+		UpdateContactBounds((MR_FreeElementHandle) mPermNetActor[pPermElement]);
 		if(mPermElementStateBroadcastHook != NULL) {
 			mPermElementStateBroadcastHook(mPermNetActor[pPermElement]->mElement, pRoom, pPermElement, mBroadcastHookData);
 		}
@@ -465,14 +659,12 @@ void Level::GetRoomContact(int pRoom, const ShapeInterface * pShape, RoomContact
 {
 
 	// Verify if the current room contains the requires shape
-	SectionShape room(&(mRoomList[pRoom]));
-	DetectRoomContact(pShape, &room, pAnswer);
+	DetectRoomContact(pShape, mRoomList[pRoom].mPolygon, pAnswer);
 }
 
 BOOL Level::GetRoomWallContactOrientation(int pRoom, int pWall, const ShapeInterface * pShape, MR_Angle & pAnswer)
 {
-	SectionShape room(&(mRoomList[pRoom]));
-	return GetWallForceLongitude(pShape, &room, pWall, pAnswer);
+	return GetWallForceLongitude(pShape, mRoomList[pRoom].mPolygon, pWall, pAnswer);
 }
 
 BOOL Level::GetFeatureContact(int pFeature, const ShapeInterface * pShape, ContactSpec & pAnswer)
@@ -574,11 +766,14 @@ Level::Room::AudibleRoom::~AudibleRoom()
 	delete[]mSoundCoefficient;
 }
 
-void Level::Room::AudibleRoom::Serialize(ObjStream & pArchive)
+void Level::Room::AudibleRoom::Serialize(ObjStream & pArchive, int pVersion)
 {
 	int lCounter;
 
 	if(pArchive.IsWriting()) {
+		if(pVersion >= 2) {
+			pArchive << mSectionSource;
+		}
 		pArchive << mNbVertexSources;
 
 		for(lCounter = 0; lCounter < mNbVertexSources; lCounter++) {
@@ -590,6 +785,9 @@ void Level::Room::AudibleRoom::Serialize(ObjStream & pArchive)
 		ASSERT(mVertexList == NULL);			  // Serialisation permited only once
 
 		// Retrieve data
+		if(pVersion >= 2) {
+			pArchive >> mSectionSource;
+		}
 		pArchive >> mNbVertexSources;
 
 		mVertexList = new int[mNbVertexSources];
@@ -608,7 +806,7 @@ int Level::FindRoomForPoint(const MR_2DCoordinate & pPosition, int pStartingRoom
 	int lReturnValue = -1;
 
 	// Verify if the position is included in the current section
-	if(GetPolygonInclusion(SectionShape(&mRoomList[pStartingRoom]), pPosition)) {
+	if(GetPolygonInclusion(mRoomList[pStartingRoom].mPolygon, pPosition)) {
 		lReturnValue = pStartingRoom;
 	}
 	else {
@@ -617,7 +815,7 @@ int Level::FindRoomForPoint(const MR_2DCoordinate & pPosition, int pStartingRoom
 			int lNeighbor = mRoomList[pStartingRoom].mNeighborList[lCounter];
 
 			if(lNeighbor != -1) {
-				if(GetPolygonInclusion(SectionShape(&mRoomList[lNeighbor]), pPosition)) {
+				if(GetPolygonInclusion(mRoomList[lNeighbor].mPolygon, pPosition)) {
 					lReturnValue = lNeighbor;
 					break;
 				} else {
@@ -627,7 +825,7 @@ int Level::FindRoomForPoint(const MR_2DCoordinate & pPosition, int pStartingRoom
 						if(lNeighborsNeighbor == pStartingRoom) continue;
 
 						if(lNeighborsNeighbor != -1) {
-							if(GetPolygonInclusion(SectionShape(&mRoomList[lNeighborsNeighbor]), pPosition)) {
+							if(GetPolygonInclusion(mRoomList[lNeighborsNeighbor].mPolygon, pPosition)) {
 								lReturnValue = lNeighborsNeighbor;
 								break;
 							}
@@ -657,6 +855,7 @@ Level::Section::Section()
 	mNbVertex = 0;
 	mVertexList = NULL;
 	mWallLen = NULL;
+	mFlatGeometry = NULL;
 
 	mWallTexture = NULL;
 	mFloorTexture = NULL;
@@ -668,6 +867,7 @@ Level::Section::~Section()
 {
 	delete[]mVertexList;
 	delete[]mWallLen;
+	delete[]mFlatGeometry;
 
 	delete mFloorTexture;
 	delete mCeilingTexture;
@@ -712,10 +912,22 @@ void Level::Section::SerializeStructure(ObjStream & pArchive)
 		mVertexList = new MR_2DCoordinate[mNbVertex];
 		mWallLen = new MR_Int32[mNbVertex];
 
-		for(lCounter = 0; lCounter < mNbVertex; lCounter++) {
-			mVertexList[lCounter].Serialize(pArchive);
-			pArchive >> mWallLen[lCounter];
+		SpanReader *lSpan = pArchive.GetSpanReader();
+		if(lSpan != NULL) {
+			for(lCounter = 0; lCounter < mNbVertex; lCounter++) {
+				lSpan->Read(mVertexList[lCounter].mX);
+				lSpan->Read(mVertexList[lCounter].mY);
+				lSpan->Read(mWallLen[lCounter]);
+			}
 		}
+		else {
+			for(lCounter = 0; lCounter < mNbVertex; lCounter++) {
+				mVertexList[lCounter].Serialize(pArchive);
+				pArchive >> mWallLen[lCounter];
+			}
+		}
+
+		UpdateFlatGeometry();
 	}
 
 	// Serialize the textures
@@ -731,6 +943,45 @@ void Level::Section::SerializeStructure(ObjStream & pArchive)
 	}
 }
 
+/**
+ * Rebuild the flattened geometry from the vertex list.
+ * Must be called whenever the vertices, wall lengths, bounding box or
+ * floor/ceiling levels change.
+ */
+void Level::Section::UpdateFlatGeometry()
+{
+	delete[]mFlatGeometry;
+	mFlatGeometry = new MR_Int32[mNbVertex * 4];
+
+	MR_Int32 *lX = mFlatGeometry;
+	MR_Int32 *lY = lX + mNbVertex;
+	MR_Int32 *lDX = lY + mNbVertex;
+	MR_Int32 *lDY = lDX + mNbVertex;
+
+	for(int lCounter = 0; lCounter < mNbVertex; lCounter++) {
+		int lNext = (lCounter + 1) % mNbVertex;
+
+		lX[lCounter] = mVertexList[lCounter].mX;
+		lY[lCounter] = mVertexList[lCounter].mY;
+		lDX[lCounter] = mVertexList[lNext].mX - mVertexList[lCounter].mX;
+		lDY[lCounter] = mVertexList[lNext].mY - mVertexList[lCounter].mY;
+	}
+
+	mPolygon.mNbVertex = mNbVertex;
+	mPolygon.mX = lX;
+	mPolygon.mY = lY;
+	mPolygon.mDX = lDX;
+	mPolygon.mDY = lDY;
+	mPolygon.mSideLen = mWallLen;
+
+	mPolygon.mXMin = mMin.mX;
+	mPolygon.mXMax = mMax.mX;
+	mPolygon.mYMin = mMin.mY;
+	mPolygon.mYMax = mMax.mY;
+	mPolygon.mZMin = mFloorLevel;
+	mPolygon.mZMax = mCeilingLevel;
+}
+
 void Level::Section::SerializeSurfacesLogicState(ObjStream & pArchive)
 {
 	// Serialize the textures state
@@ -777,7 +1028,7 @@ Level::Room::~Room()
 	delete[]mVisibleCeilingList;
 }
 
-void Level::Room::SerializeStructure(ObjStream & pArchive)
+void Level::Room::SerializeStructure(ObjStream & pArchive, int pVersion)
 {
 	int lCounter;
 	Section::SerializeStructure(pArchive);
@@ -807,7 +1058,7 @@ void Level::Room::SerializeStructure(ObjStream & pArchive)
 		}
 
 		for(lCounter = 0; lCounter < mNbAudibleRoom; lCounter++) {
-			mAudibleRoomList[lCounter].Serialize(pArchive);
+			mAudibleRoomList[lCounter].Serialize(pArchive, pVersion);
 		}
 	}
 	else {
@@ -837,18 +1088,10 @@ void Level::Room::SerializeStructure(ObjStream & pArchive)
 			mAudibleRoomList = new AudibleRoom[mNbAudibleRoom];
 		}
 
-		for(lCounter = 0; lCounter < mNbVertex; lCounter++) {
-			pArchive >> mNeighborList[lCounter];
-		}
-
-		for(lCounter = 0; lCounter < mNbChild; lCounter++) {
-			pArchive >> mChildList[lCounter];
-		}
-
-		for(lCounter = 0; lCounter < mNbVisibleRoom; lCounter++) {
+		ReadInt32Array(pArchive, mNeighborList, mNbVertex);
+		ReadInt32Array(pArchive, mChildList, mNbChild);
 												  // List of the room that are visible from the current room
-			pArchive >> mVisibleRoomList[lCounter];
-		}
+		ReadInt32Array(pArchive, mVisibleRoomList, mNbVisibleRoom);
 
 		for(lCounter = 0; lCounter < mNbVisibleSurface; lCounter++) {
 			mVisibleFloorList[lCounter].Serialize(pArchive);
@@ -856,7 +1099,7 @@ void Level::Room::SerializeStructure(ObjStream & pArchive)
 		}
 
 		for(lCounter = 0; lCounter < mNbAudibleRoom; lCounter++) {
-			mAudibleRoomList[lCounter].Serialize(pArchive);
+			mAudibleRoomList[lCounter].Serialize(pArchive, pVersion);
 		}
 	}
 }
@@ -881,12 +1124,7 @@ Level::FreeElementList::FreeElementList()
 	mPrevLink = NULL;
 	mNext = NULL;
 	mElement = NULL;
-}
-
-Level::FreeElementList::~FreeElementList()
-{
-	Unlink();
-	delete mElement;
+	mHasBounds = FALSE;
 }
 
 void Level::FreeElementList::Unlink()
@@ -915,7 +1153,7 @@ void Level::FreeElementList::LinkTo(FreeElementList ** pPrevLink)
 	}
 }
 
-void Level::FreeElementList::SerializeList(ObjStream & pArchive, FreeElementList ** pListHead)
+void Level::FreeElementList::SerializeList(ObjStream & pArchive, FreeElementList ** pListHead, FreeElementPool & pPool)
 {
 	if(pArchive.IsWriting()) {
 		FreeElementList *lFreeElement = *pListHead;
@@ -943,7 +1181,7 @@ void Level::FreeElementList::SerializeList(ObjStream & pArchive, FreeElementList
 			Util::ObjectFromFactory::SerializePtr(pArchive, (Util::ObjectFromFactory * &)lCurrentElement);
 
 			if(lCurrentElement != NULL) {
-				FreeElementList *lFreeElement = new FreeElementList;
+				FreeElementList *lFreeElement = pPool.Alloc();
 
 				lCurrentElement->mPosition.Serialize(pArchive);
 				pArchive >> lCurrentElement->mOrientation;
@@ -956,6 +1194,56 @@ void Level::FreeElementList::SerializeList(ObjStream & pArchive, FreeElementList
 	}
 }
 
+// class Level::FreeElementPool
+Level::FreeElementPool::FreeElementPool() :
+	mFreeList(NULL)
+{
+}
+
+Level::FreeElementPool::~FreeElementPool()
+{
+	for (auto block : mBlocks) {
+		delete[] block;
+	}
+}
+
+/**
+ * Retrieve an unlinked node from the pool, growing the pool if necessary.
+ * @return The node (never @c NULL).
+ */
+Level::FreeElementList *Level::FreeElementPool::Alloc()
+{
+	if (mFreeList == NULL) {
+		FreeElementList *lBlock = new FreeElementList[eBlockSize];
+		mBlocks.push_back(lBlock);
+
+		// Chain in reverse so that nodes are handed out in address order.
+		for (int lCounter = eBlockSize - 1; lCounter >= 0; lCounter--) {
+			lBlock[lCounter].mNext = mFreeList;
+			mFreeList = &lBlock[lCounter];
+		}
+	}
+
+	FreeElementList *lReturnValue = mFreeList;
+	mFreeList = lReturnValue->mNext;
+	lReturnValue->mNext = NULL;
+
+	return lReturnValue;
+}
+
+/**
+ * Return a node to the pool.
+ * @param pNode The node; it must already be unlinked and have no element.
+ */
+void Level::FreeElementPool::Free(FreeElementList *pNode)
+{
+	ASSERT(pNode->mPrevLink == NULL);
+	ASSERT(pNode->mElement == NULL);
+
+	pNode->mNext = mFreeList;
+	mFreeList = pNode;
+}
+
 // class SectionId
 void SectionId::Serialize(ObjStream & pArchive)
 {
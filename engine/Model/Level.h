@@ -39,6 +39,10 @@
 #define MR_NB_MAX_PLAYER    32
 #define MR_NB_PERNET_ACTORS 512
 
+// Length of the path (through the openings between rooms) at which a sound
+// is attenuated to nothing
+#define MR_MAX_AUDIBLE_DIST 150000
+
 // for game options (also found in TrackSelect.h)
 #define OPT_ALLOW_WEAPONS	0x40
 #define OPT_ALLOW_MINES		0x20
@@ -133,6 +137,10 @@ class MR_DllDeclare Level
 				MR_2DCoordinate mMin;
 				MR_2DCoordinate mMax;
 
+				// Flattened copy of the geometry used by the contact tests
+				MR_Int32 *mFlatGeometry;
+				PolygonData mPolygon;
+
 				// Wall textures
 				SurfaceElement **mWallTexture;
 				SurfaceElement *mFloorTexture;
@@ -145,6 +153,8 @@ class MR_DllDeclare Level
 				void SerializeStructure(Parcel::ObjStream &pArchive);
 				void SerializeSurfacesLogicState(Parcel::ObjStream &pArchive);
 
+				void UpdateFlatGeometry();
+
 		};
 
 		class Feature : public Section
@@ -175,7 +185,7 @@ class MR_DllDeclare Level
 						AudibleRoom();
 						~AudibleRoom();
 
-						void Serialize(Parcel::ObjStream &pArchive);
+						void Serialize(Parcel::ObjStream &pArchive, int pVersion);
 
 				};
 
@@ -203,10 +213,12 @@ class MR_DllDeclare Level
 				Room();
 				~Room();
 
-				void SerializeStructure(Parcel::ObjStream &pArchive);
+				void SerializeStructure(Parcel::ObjStream &pArchive, int pVersion);
 
 		};
 
+		class FreeElementPool;
+
 		class FreeElementList
 		{
 			public:
@@ -214,13 +226,42 @@ class MR_DllDeclare Level
 				FreeElementList *mNext;
 				FreeElement *mElement;
 
+				// Bounds of the element's receiving contact shape as of the
+				// last call to UpdateContactBounds().
+				BOOL mHasBounds;
+				ContactBounds mBounds;
+
 				FreeElementList();
-				~FreeElementList();
 
 				void Unlink();
 				void LinkTo(FreeElementList ** pPrevLink);
 
-				static void SerializeList(Parcel::ObjStream &pArchive, FreeElementList **pListHead);
+				static void SerializeList(Parcel::ObjStream &pArchive, FreeElementList **pListHead, FreeElementPool &pPool);
+		};
+
+		/**
+		 * Slab storage for free element list nodes.
+		 *
+		 * Nodes are allocated in fixed-size blocks which are only released
+		 * when the pool is destroyed, so node addresses (and therefore
+		 * element handles) stay stable for the life of the level, and
+		 * inserting or deleting elements during a race doesn't touch the
+		 * heap once the pool has warmed up.
+		 */
+		class FreeElementPool
+		{
+			public:
+				FreeElementPool();
+				~FreeElementPool();
+
+				FreeElementList *Alloc();
+				void Free(FreeElementList *pNode);
+
+			private:
+				enum { eBlockSize = 64 };
+
+				std::vector<FreeElementList*> mBlocks;
+				FreeElementList *mFreeList;  // Chained through mNext.
 		};
 
 		// Private Data
@@ -243,9 +284,16 @@ class MR_DllDeclare Level
 		MR_Angle mStartingOrientation[MR_NB_MAX_PLAYER];
 
 		// FreeElements
+		FreeElementPool mFreeElementPool;
 		FreeElementList *mFreeElementNonClassifiedList;
 		FreeElementList **mFreeElementClassifiedByRoomList;
 
+		// One bit per room that may hold free elements.
+		// Bits are set when an element enters a room and are only cleared
+		// lazily by GetNextActiveRoom(), so this is a superset of the
+		// rooms that actually have elements.
+		std::vector<MR_UInt64> mActiveRooms;
+
 		int mNbPermNetActor;
 		FreeElementList *mPermNetActor[MR_NB_PERNET_ACTORS];
 
@@ -260,6 +308,8 @@ class MR_DllDeclare Level
 		void *mBroadcastHookData;
 
 		// Helper functions
+		void MarkRoomActive(int pRoom);
+		void ResetActiveRooms();
 		int GetRealRoomRecursive(const MR_2DCoordinate & pPosition, int pOriginalSection, int = -1) const;
 
 	public:
@@ -298,6 +348,8 @@ class MR_DllDeclare Level
 		int GetFeatureVertexCount(int pFeatureId) const;
 
 		const int *GetVisibleZones(int pRoomId, int &pNbVisibleZones) const;
+		int GetAudibleZoneCount(int pRoomId) const;
+		int GetAudibleZone(int pRoomId, int pIndex, int &pCoefficient) const;
 		int GetNbVisibleSurface(int pRoomId) const;
 		const SectionId *GetVisibleFloorList(int pRoomId) const;
 		const SectionId *GetVisibleCeilingList(int pRoomId) const;
@@ -316,15 +368,20 @@ class MR_DllDeclare Level
 
 		// Free element content interrogation and manipulation
 		MR_FreeElementHandle GetFirstFreeElement(int pRoom) const;
+		int GetNextActiveRoom(int pRoom);
 		static MR_FreeElementHandle GetNextFreeElement(MR_FreeElementHandle pHandle);
 		static FreeElement *GetFreeElement(MR_FreeElementHandle pHandle);
 		MR_FreeElementHandle GetPermanentElementHandle(int pElem) const;
 
+		static void UpdateContactBounds(MR_FreeElementHandle pHandle);
+		void UpdateAllContactBounds();
+		static bool MayContact(MR_FreeElementHandle pHandle, const ContactBounds &pBounds);
+
 												  // -1 mean non classified
 		void MoveElement(MR_FreeElementHandle pHandle, int pNewRoom);
 												  // -1 mean non classified
 		MR_FreeElementHandle InsertElement(FreeElement * pElement, int pNewRoom, BOOL Broadcast = FALSE);
-		static void DeleteElement(MR_FreeElementHandle pHandle);
+		void DeleteElement(MR_FreeElementHandle pHandle);
 
 												  // Set and broadcast the newporition
 		void SetPermElementPos(int pPermElement, int pRoom, const MR_3DCoordinate & pNewPos);
@@ -353,8 +410,16 @@ class MR_DllDeclare Level
 		 */
 		void SetGravity(double gravity) { this->gravity = gravity; }
 
+		/**
+		 * Set the track format version to read or write.
+		 * By default, the current version is used.
+		 * @param version The version (see MR_TRACK_VERSION).
+		 */
+		void SetFormatVersion(int version) { formatVersion = version; }
+
 	private:
 		double gravity;
+		int formatVersion;
 };
 
 }  // namespace Model
@@ -23,6 +23,11 @@
 
 #include "ShapeCollisions.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define MR_HAVE_SSE2
+#	include <emmintrin.h>
+#endif
+
 using std::min;
 using std::max;
 
@@ -43,12 +48,16 @@ static BOOL MR_LineCylinderContact(const LineSegmentShape * pActor0, const Cylin
 static BOOL MR_PolygonCylinderContact(const PolygonShape * pActor0, const CylinderShape * pActor1, ContactSpec & pAnswer);
 static BOOL MR_PolygonLineContact(const PolygonShape * pActor0, const LineSegmentShape * pActor1, ContactSpec & pAnswer);
 
-static void MR_CylinderRoomContact(const CylinderShape * pActor, const PolygonShape * pRoom, RoomContactSpec & pAnswer);
-static void MR_LineRoomContact(const LineSegmentShape * pActor, const PolygonShape * pRoom, RoomContactSpec & pAnswer);
-static void MR_PolygonRoomContact(const PolygonShape * pActor, const PolygonShape * pRoom, RoomContactSpec & pAnswer);
+template<class Room> static BOOL MR_PolygonInclusion(const Room &pPolygon, const MR_2DCoordinate &pPosition);
+template<class Room> static void MR_DetectRoomContact(const ShapeInterface * pActor, const Room & pRoom, RoomContactSpec & pAnswer);
+template<class Room> static void MR_CylinderRoomContact(const CylinderShape * pActor, const Room & pRoom, RoomContactSpec & pAnswer);
+template<class Room> static void MR_CylinderWallContact(const Room & pRoom, int pWall, int pNext, MR_Int32 pAxisX, MR_Int32 pAxisY, MR_Int32 pRayLen, RoomContactSpec & pAnswer);
+template<class Room> static void MR_LineRoomContact(const LineSegmentShape * pActor, const Room & pRoom, RoomContactSpec & pAnswer);
+template<class Room> static void MR_PolygonRoomContact(const PolygonShape * pActor, const Room & pRoom, RoomContactSpec & pAnswer);
 
 static BOOL MR_TestLevelShape(const ShapeInterface * pActor0, const ShapeInterface * pActor1, ContactSpec & pAnswer);
 static BOOL MR_TestBoundingBox(const ShapeInterface * pActor0, const ShapeInterface * pActor1);
+template<class Room> static BOOL MR_TestRoomBoundingBox(const ShapeInterface * pActor, const Room & pRoom);
 static BOOL MR_IsOnLeft(const MR_2DCoordinate & pPointToCheck, const MR_2DCoordinate & pVectorOrigin, const MR_2DCoordinate & pVectorDest);
 static BOOL MR_Is1Outside0(const PolygonShape * pActor0, const PolygonShape * pActor1);
 static void MR_AddContactWall(int pWallIndex, RoomContactSpec & pAnswer);
@@ -73,40 +82,62 @@ static const MR_ActorActorContactFunc MR_ActorActorContactMatrix[3][3] =
 	}
 };
 
-BOOL GetPolygonInclusion(const PolygonShape &pPolygon, const MR_2DCoordinate &pPosition)
+/**
+ * Non-virtual adapter for PolygonData, giving it the same accessors as
+ * PolygonShape so the room routines can be instantiated for either one.
+ */
+class MR_FlatPolygon
 {
-	BOOL lAnswer = TRUE;
+	public:
+		MR_FlatPolygon(const PolygonData &pData) : mData(pData) { }
+
+		int VertexCount() const { return mData.mNbVertex; }
+		MR_Int32 X(int pIndex) const { return mData.mX[pIndex]; }
+		MR_Int32 Y(int pIndex) const { return mData.mY[pIndex]; }
+		MR_Int32 SideLen(int pIndex) const { return mData.mSideLen[pIndex]; }
+
+		MR_Int32 XMin() const { return mData.mXMin; }
+		MR_Int32 XMax() const { return mData.mXMax; }
+		MR_Int32 YMin() const { return mData.mYMin; }
+		MR_Int32 YMax() const { return mData.mYMax; }
+		MR_Int32 ZMin() const { return mData.mZMin; }
+		MR_Int32 ZMax() const { return mData.mZMax; }
+
+		const PolygonData &mData;
+};
 
-	// Verify that the point is inside the bounding box of the polygon
-	if((pPosition.mX < pPolygon.XMin()) || (pPosition.mX > pPolygon.XMax()) || (pPosition.mY < pPolygon.YMin()) || (pPosition.mY > pPolygon.YMax())) {
-		lAnswer = FALSE;
-	}
-	else {
-		// Verify that the given point is on the
-		// right side of each line segment
-		//
-		// The point C is at the right side of segment
-		// AB if the scalar product of( AB rotated by 90deg x AC ) is positive
+// Wall vectors (the wall normals rotated by 90 degrees).
+// These are precomputed for flat polygons.
+static inline MR_Int32 MR_WallDX(const PolygonShape & pRoom, int pWall, int pNext)
+{
+	return pRoom.X(pNext) - pRoom.X(pWall);
+}
 
-		for(int lA = 0; lA < pPolygon.VertexCount(); lA++) {
-			int lB = (lA + 1) % pPolygon.VertexCount();
+static inline MR_Int32 MR_WallDY(const PolygonShape & pRoom, int pWall, int pNext)
+{
+	return pRoom.Y(pNext) - pRoom.Y(pWall);
+}
 
-			MR_Int32 lDXAB = pPolygon.X(lB) - pPolygon.X(lA);
-			MR_Int32 lDYAB = pPolygon.Y(lB) - pPolygon.Y(lA);
+static inline MR_Int32 MR_WallDX(const MR_FlatPolygon & pRoom, int pWall, int)
+{
+	return pRoom.mData.mDX[pWall];
+}
 
-			MR_Int32 lDXAC = pPosition.mX - pPolygon.X(lA);
-			MR_Int32 lDYAC = pPosition.mY - pPolygon.Y(lA);
+static inline MR_Int32 MR_WallDY(const MR_FlatPolygon & pRoom, int pWall, int)
+{
+	return pRoom.mData.mDY[pWall];
+}
 
-			MR_Int64 lScalarProduct = Int32x32To64(lDYAB, lDXAC) - Int32x32To64(lDXAB, lDYAC);
+static void MR_CylinderRoomContact(const CylinderShape * pActor, const MR_FlatPolygon & pRoom, RoomContactSpec & pAnswer);
 
-			if(lScalarProduct < 0) {
-				lAnswer = FALSE;
-				break;							  // There is no reason to continue
-			}
-		}
-	}
+BOOL GetPolygonInclusion(const PolygonShape &pPolygon, const MR_2DCoordinate &pPosition)
+{
+	return MR_PolygonInclusion(pPolygon, pPosition);
+}
 
-	return lAnswer;
+BOOL GetPolygonInclusion(const PolygonData &pPolygon, const MR_2DCoordinate &pPosition)
+{
+	return MR_PolygonInclusion(MR_FlatPolygon(pPolygon), pPosition);
 }
 
 BOOL DetectActorContact(const ShapeInterface * pActor, const ShapeInterface * pObstacle, ContactSpec & pAnswer)
@@ -121,35 +152,12 @@ BOOL DetectFeatureContact(const ShapeInterface * pActor, const PolygonShape * pF
 
 void DetectRoomContact(const ShapeInterface * pActor, const PolygonShape * pRoom, RoomContactSpec & pAnswer)
 {
+	MR_DetectRoomContact(pActor, *pRoom, pAnswer);
+}
 
-	// Initialize basic stuff
-	pAnswer.mTouchingRoom = FALSE;
-	pAnswer.mNbWallContact = 0;
-
-	// Compute the vertical variables
-	pAnswer.mDistanceFromFloor = pActor->ZMin() - pRoom->ZMin();
-	pAnswer.mDistanceFromCeiling = pRoom->ZMax() - pActor->ZMax();
-
-	// Verify if the bounding boxes are matching
-
-	if(MR_TestBoundingBox(pActor, pRoom)) {
-		switch (pActor->ShapeType()) {
-			case ShapeInterface::eCylinder:
-				MR_CylinderRoomContact((const CylinderShape *) pActor, pRoom, pAnswer);
-				break;
-
-			case ShapeInterface::eLineSegment:
-				MR_LineRoomContact((const LineSegmentShape *) pActor, pRoom, pAnswer);
-				break;
-
-			case ShapeInterface::ePolygon:
-				MR_PolygonRoomContact((const PolygonShape *) pActor, pRoom, pAnswer);
-				break;
-
-			default:
-				ASSERT(FALSE);					  // Shape type not supported
-		}
-	}
+void DetectRoomContact(const ShapeInterface * pActor, const PolygonData & pRoom, RoomContactSpec & pAnswer)
+{
+	MR_DetectRoomContact(pActor, MR_FlatPolygon(pRoom), pAnswer);
 }
 
 BOOL GetActorForceLongitude(const ShapeInterface * pActor, const ShapeInterface * pObstacle, MR_Angle & pLongitude)
@@ -234,6 +242,14 @@ BOOL GetWallForceLongitude(const ShapeInterface * /*pActor */ , const PolygonSha
 	return TRUE;
 }
 
+BOOL GetWallForceLongitude(const ShapeInterface * /*pActor */ , const PolygonData & pRoom, int pWallIndex, MR_Angle & pLongitude)
+{
+	// return a vector perpendicular to the selected wall
+	pLongitude = RAD_2_MR_ANGLE(atan2((double) -pRoom.mDX[pWallIndex], (double) pRoom.mDY[pWallIndex]));
+
+	return TRUE;
+}
+
 // Local functions implementation
 
 BOOL MR_CylinderCylinderContact(const CylinderShape * pActor0, const CylinderShape * pActor1, ContactSpec & pAnswer)
@@ -450,85 +466,290 @@ BOOL MR_PolygonLineContact(const PolygonShape * pActor0, const LineSegmentShape
 	return lReturnValue;
 }
 
-void MR_CylinderRoomContact(const CylinderShape * pActor, const PolygonShape * pRoom, RoomContactSpec & pAnswer)
+template<class Room>
+BOOL MR_PolygonInclusion(const Room &pPolygon, const MR_2DCoordinate &pPosition)
+{
+	BOOL lAnswer = TRUE;
+
+	// Verify that the point is inside the bounding box of the polygon
+	if((pPosition.mX < pPolygon.XMin()) || (pPosition.mX > pPolygon.XMax()) || (pPosition.mY < pPolygon.YMin()) || (pPosition.mY > pPolygon.YMax())) {
+		lAnswer = FALSE;
+	}
+	else {
+		// Verify that the given point is on the
+		// right side of each line segment
+		//
+		// The point C is at the right side of segment
+		// AB if the scalar product of( AB rotated by 90deg x AC ) is positive
+
+		int lVertexCount = pPolygon.VertexCount();
+
+		for(int lA = 0; lA < lVertexCount; lA++) {
+			int lB = (lA + 1 < lVertexCount) ? lA + 1 : 0;
+
+			MR_Int32 lDXAB = MR_WallDX(pPolygon, lA, lB);
+			MR_Int32 lDYAB = MR_WallDY(pPolygon, lA, lB);
+
+			MR_Int32 lDXAC = pPosition.mX - pPolygon.X(lA);
+			MR_Int32 lDYAC = pPosition.mY - pPolygon.Y(lA);
+
+			MR_Int64 lScalarProduct = Int32x32To64(lDYAB, lDXAC) - Int32x32To64(lDXAB, lDYAC);
+
+			if(lScalarProduct < 0) {
+				lAnswer = FALSE;
+				break;							  // There is no reason to continue
+			}
+		}
+	}
+
+	return lAnswer;
+}
+
+template<class Room>
+void MR_DetectRoomContact(const ShapeInterface * pActor, const Room & pRoom, RoomContactSpec & pAnswer)
+{
+
+	// Initialize basic stuff
+	pAnswer.mTouchingRoom = FALSE;
+	pAnswer.mNbWallContact = 0;
+
+	// Compute the vertical variables
+	pAnswer.mDistanceFromFloor = pActor->ZMin() - pRoom.ZMin();
+	pAnswer.mDistanceFromCeiling = pRoom.ZMax() - pActor->ZMax();
+
+	// Verify if the bounding boxes are matching
+
+	if(MR_TestRoomBoundingBox(pActor, pRoom)) {
+		switch (pActor->ShapeType()) {
+			case ShapeInterface::eCylinder:
+				MR_CylinderRoomContact((const CylinderShape *) pActor, pRoom, pAnswer);
+				break;
+
+			case ShapeInterface::eLineSegment:
+				MR_LineRoomContact((const LineSegmentShape *) pActor, pRoom, pAnswer);
+				break;
+
+			case ShapeInterface::ePolygon:
+				MR_PolygonRoomContact((const PolygonShape *) pActor, pRoom, pAnswer);
+				break;
+
+			default:
+				ASSERT(FALSE);					  // Shape type not supported
+		}
+	}
+}
+
+template<class Room>
+void MR_CylinderRoomContact(const CylinderShape * pActor, const Room & pRoom, RoomContactSpec & pAnswer)
 {
 	// For each side of the polygon, verify that
 	// the left perpendicular distance of the center of
 	// the cylinder is < than the cylinder ray
 
-	int lVertexCount = pRoom->VertexCount();
+	int lVertexCount = pRoom.VertexCount();
+
+	// The actor doesn't change during the test
+	MR_Int32 lAxisX = pActor->AxisX();
+	MR_Int32 lAxisY = pActor->AxisY();
+	MR_Int32 lRayLen = pActor->RayLen();
 
 	pAnswer.mTouchingRoom = TRUE;
 
 	for(int lCounter = 0; pAnswer.mTouchingRoom && (lCounter < lVertexCount); lCounter++) {
-		int lP1 = (lCounter + 1) % lVertexCount;
+		int lP1 = (lCounter + 1 < lVertexCount) ? lCounter + 1 : 0;
 
-		MR_Int32 lLeftDistance = -(pRoom->Y(lP1) - pRoom->Y(lCounter)) * (pActor->AxisX() - pRoom->X(lCounter))
-			+ (pRoom->X(lP1) - pRoom->X(lCounter)) * (pActor->AxisY() - pRoom->Y(lCounter));
+		MR_CylinderWallContact(pRoom, lCounter, lP1, lAxisX, lAxisY, lRayLen, pAnswer);
+	}
+}
 
-		lLeftDistance /= pRoom->SideLen(lCounter);
+template<class Room>
+void MR_CylinderWallContact(const Room & pRoom, int pWall, int pNext, MR_Int32 pAxisX, MR_Int32 pAxisY, MR_Int32 pRayLen, RoomContactSpec & pAnswer)
+{
+	MR_Int32 lX0 = pRoom.X(pWall);
+	MR_Int32 lY0 = pRoom.Y(pWall);
+	MR_Int32 lDX = MR_WallDX(pRoom, pWall, pNext);
+	MR_Int32 lDY = MR_WallDY(pRoom, pWall, pNext);
+	MR_Int32 lSideLen = pRoom.SideLen(pWall);
 
-		if(lLeftDistance > 0) {
-			if(lLeftDistance > pActor->RayLen()) {
-				pAnswer.mTouchingRoom = FALSE;
-			}
+	MR_Int32 lLeftDistance = -lDY * (pAxisX - lX0) + lDX * (pAxisY - lY0);
+
+	lLeftDistance /= lSideLen;
+
+	if(lLeftDistance > 0) {
+		if(lLeftDistance > pRayLen) {
+			pAnswer.mTouchingRoom = FALSE;
 		}
+	}
 
-		if(pAnswer.mTouchingRoom) {
-			if(lLeftDistance > -pActor->RayLen()) {
-				// This side is potentially crossing the selectedside
-				/*
-				   MR_Int32 lOldLenDistance =  (pRoom->X(lP1)-pRoom->X(lCounter))*(pActor->AxisX()-pRoom->X(lCounter))
-				   +(pRoom->Y(lP1)-pRoom->Y(lCounter))*(pActor->AxisY()-pRoom->Y(lCounter));
+	if(pAnswer.mTouchingRoom) {
+		if(lLeftDistance > -pRayLen) {
+			// This side is potentially crossing the selectedside
+			/*
+			   MR_Int32 lOldLenDistance =  lDX*(pAxisX-lX0)
+			   +lDY*(pAxisY-lY0);
 
-				   lOldLenDistance /= pRoom->SideLen( lCounter );
-				 */
+			   lOldLenDistance /= lSideLen;
+			 */
 
-				MR_Int32 lLenDistance = ((pRoom->X(lP1) - pRoom->X(lCounter)) / 2) * ((pActor->AxisX() - pRoom->X(lCounter)) / 2)
-					+ ((pRoom->Y(lP1) - pRoom->Y(lCounter)) / 2) * ((pActor->AxisY() - pRoom->Y(lCounter)) / 2);
+			MR_Int32 lLenDistance = (lDX / 2) * ((pAxisX - lX0) / 2)
+				+ (lDY / 2) * ((pAxisY - lY0) / 2);
 
-				lLenDistance /= pRoom->SideLen(lCounter) / 4;
+			lLenDistance /= lSideLen / 4;
 
-				/*
-				   MR_Int32 lDiff = lLenDistance - lOldLenDistance;
+			/*
+			   MR_Int32 lDiff = lLenDistance - lOldLenDistance;
 
-				   ASSERT( (lDiff<20)&&(lDiff>-20) );
-				 */
+			   ASSERT( (lDiff<20)&&(lDiff>-20) );
+			 */
 
-				if(lLenDistance < 0) {
-					if(lLenDistance >= -pActor->RayLen()) {
-						if((pRoom->X(lCounter) - pActor->AxisX()) * (pRoom->X(lCounter) - pActor->AxisX())
-						+ (pRoom->Y(lCounter) - pActor->AxisY()) * (pRoom->Y(lCounter) - pActor->AxisY()) <= pActor->RayLen() * pActor->RayLen()) {
-							MR_AddContactWall(lCounter, pAnswer);
-						}
+			if(lLenDistance < 0) {
+				if(lLenDistance >= -pRayLen) {
+					if((lX0 - pAxisX) * (lX0 - pAxisX)
+					+ (lY0 - pAxisY) * (lY0 - pAxisY) <= pRayLen * pRayLen) {
+						MR_AddContactWall(pWall, pAnswer);
 					}
 				}
-				else if(lLenDistance > pRoom->SideLen(lCounter)) {
-					if(lLenDistance <= pActor->RayLen() + pRoom->SideLen(lCounter)) {
-						if((pRoom->X(lP1) - pActor->AxisX()) * (pRoom->X(lP1) - pActor->AxisX())
-						+ (pRoom->Y(lP1) - pActor->AxisY()) * (pRoom->Y(lP1) - pActor->AxisY()) <= pActor->RayLen() * pActor->RayLen()) {
-							MR_AddContactWall(lCounter, pAnswer);
-						}
+			}
+			else if(lLenDistance > lSideLen) {
+				if(lLenDistance <= pRayLen + lSideLen) {
+					MR_Int32 lX1 = pRoom.X(pNext);
+					MR_Int32 lY1 = pRoom.Y(pNext);
+
+					if((lX1 - pAxisX) * (lX1 - pAxisX)
+					+ (lY1 - pAxisY) * (lY1 - pAxisY) <= pRayLen * pRayLen) {
+						MR_AddContactWall(pWall, pAnswer);
 					}
 				}
-				else {
-					MR_AddContactWall(lCounter, pAnswer);
-				}
+			}
+			else {
+				MR_AddContactWall(pWall, pAnswer);
+			}
+
+		}
+	}
+}
+
+#ifdef MR_HAVE_SSE2
+/**
+ * 32-bit multiply keeping the low 32 bits of each lane (SSE2 has no
+ * pmulld), so overflow wraps exactly like the scalar MR_Int32 code.
+ */
+static inline __m128i MR_MulLo32(__m128i pA, __m128i pB)
+{
+	__m128i lEven = _mm_mul_epu32(pA, pB);
+	__m128i lOdd = _mm_mul_epu32(_mm_srli_si128(pA, 4), _mm_srli_si128(pB, 4));
+
+	return _mm_unpacklo_epi32(
+		_mm_shuffle_epi32(lEven, _MM_SHUFFLE(0, 0, 2, 0)),
+		_mm_shuffle_epi32(lOdd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+/**
+ * Truncating 32-bit division of four lanes.
+ * Going through double is exact for any 32-bit numerator and divisor.
+ */
+static inline __m128i MR_Div32(__m128i pNum, __m128i pDen)
+{
+	__m128d lLo = _mm_div_pd(_mm_cvtepi32_pd(pNum), _mm_cvtepi32_pd(pDen));
+	__m128d lHi = _mm_div_pd(
+		_mm_cvtepi32_pd(_mm_shuffle_epi32(pNum, _MM_SHUFFLE(1, 0, 3, 2))),
+		_mm_cvtepi32_pd(_mm_shuffle_epi32(pDen, _MM_SHUFFLE(1, 0, 3, 2))));
+
+	return _mm_unpacklo_epi64(_mm_cvttpd_epi32(lLo), _mm_cvttpd_epi32(lHi));
+}
+#endif
+
+/**
+ * Cylinder vs. room test for flattened rooms.
+ *
+ * Most walls of a room are further than the cylinder ray from the axis
+ * (on the inside), and those walls never change the answer.  With SSE2 the
+ * left distance is computed for four walls at a time and only the walls
+ * that may matter go through the scalar test, in order, so the result is
+ * exactly the same as the generic version.
+ */
+void MR_CylinderRoomContact(const CylinderShape * pActor, const MR_FlatPolygon & pRoom, RoomContactSpec & pAnswer)
+{
+#ifdef MR_HAVE_SSE2
+	const PolygonData &lData = pRoom.mData;
+	int lVertexCount = lData.mNbVertex;
+
+	MR_Int32 lAxisX = pActor->AxisX();
+	MR_Int32 lAxisY = pActor->AxisY();
+	MR_Int32 lRayLen = pActor->RayLen();
+
+#	ifdef _DEBUG
+	RoomContactSpec lCheck = pAnswer;
+	MR_CylinderRoomContact<MR_FlatPolygon>(pActor, pRoom, lCheck);
+#	endif
 
+	pAnswer.mTouchingRoom = TRUE;
+
+	__m128i lAxisXV = _mm_set1_epi32(lAxisX);
+	__m128i lAxisYV = _mm_set1_epi32(lAxisY);
+	__m128i lNegRayV = _mm_set1_epi32(-lRayLen);
+
+	int lCounter = 0;
+
+	for(; pAnswer.mTouchingRoom && (lCounter + 4 <= lVertexCount); lCounter += 4) {
+		__m128i lX0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lData.mX + lCounter));
+		__m128i lY0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lData.mY + lCounter));
+		__m128i lDX = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lData.mDX + lCounter));
+		__m128i lDY = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lData.mDY + lCounter));
+		__m128i lSideLen = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lData.mSideLen + lCounter));
+
+		// -lDY * (lAxisX - lX0) + lDX * (lAxisY - lY0)
+		__m128i lLeftDistance = _mm_sub_epi32(
+			MR_MulLo32(lDX, _mm_sub_epi32(lAxisYV, lY0)),
+			MR_MulLo32(lDY, _mm_sub_epi32(lAxisXV, lX0)));
+
+		lLeftDistance = MR_Div32(lLeftDistance, lSideLen);
+
+		int lMask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(lLeftDistance, lNegRayV)));
+
+		for(int lLane = 0; pAnswer.mTouchingRoom && (lLane < 4); lLane++) {
+			if(lMask & (1 << lLane)) {
+				int lWall = lCounter + lLane;
+				int lP1 = (lWall + 1 < lVertexCount) ? lWall + 1 : 0;
+
+				MR_CylinderWallContact(pRoom, lWall, lP1, lAxisX, lAxisY, lRayLen, pAnswer);
 			}
 		}
 	}
+
+	for(; pAnswer.mTouchingRoom && (lCounter < lVertexCount); lCounter++) {
+		int lP1 = (lCounter + 1 < lVertexCount) ? lCounter + 1 : 0;
+
+		MR_CylinderWallContact(pRoom, lCounter, lP1, lAxisX, lAxisY, lRayLen, pAnswer);
+	}
+
+#	ifdef _DEBUG
+	ASSERT(lCheck.mTouchingRoom == pAnswer.mTouchingRoom);
+	ASSERT(lCheck.mNbWallContact == pAnswer.mNbWallContact);
+	for(int lWall = 0; lWall < pAnswer.mNbWallContact; lWall++) {
+		ASSERT(lCheck.mWallContact[lWall] == pAnswer.mWallContact[lWall]);
+	}
+#	endif
+#else
+	MR_CylinderRoomContact<MR_FlatPolygon>(pActor, pRoom, pAnswer);
+#endif
 }
 
-void MR_LineRoomContact(const LineSegmentShape * pActor, const PolygonShape * pRoom, RoomContactSpec & pAnswer)
+template<class Room>
+void MR_LineRoomContact(const LineSegmentShape * pActor, const Room & pRoom, RoomContactSpec & pAnswer)
 {
 	// Count the crossed sides
-	int lVertexCount = pRoom->VertexCount();
+	int lVertexCount = pRoom.VertexCount();
+
+	MR_Int32 lX0 = pActor->X0();
+	MR_Int32 lY0 = pActor->Y0();
+	MR_Int32 lX1 = pActor->X1();
+	MR_Int32 lY1 = pActor->Y1();
 
 	for(int lCounter = 0; pAnswer.mTouchingRoom && (lCounter < lVertexCount); lCounter++) {
-		int lP1 = (lCounter + 1) % lVertexCount;
+		int lP1 = (lCounter + 1 < lVertexCount) ? lCounter + 1 : 0;
 
-		if(MR_AreLineCrossing(pRoom->X(lCounter), pRoom->Y(lCounter), pRoom->X(lP1), pRoom->Y(lP1), pActor->X0(), pActor->Y0(), pActor->X1(), pActor->Y1())) {
+		if(MR_AreLineCrossing(pRoom.X(lCounter), pRoom.Y(lCounter), pRoom.X(lP1), pRoom.Y(lP1), lX0, lY0, lX1, lY1)) {
 			MR_AddContactWall(lCounter, pAnswer);
 		}
 	}
@@ -540,32 +761,43 @@ void MR_LineRoomContact(const LineSegmentShape * pActor, const PolygonShape * pR
 		pAnswer.mTouchingRoom = TRUE;
 	}
 	else {
-		if(GetPolygonInclusion(*pRoom, MR_2DCoordinate(pActor->X0(), pActor->X1()))) {
+		if(MR_PolygonInclusion(pRoom, MR_2DCoordinate(lX0, lX1))) {
 			pAnswer.mTouchingRoom = TRUE;
 		}
 	}
 }
 
-void MR_PolygonRoomContact(const PolygonShape * pActor, const PolygonShape * pRoom, RoomContactSpec & pAnswer)
+template<class Room>
+void MR_PolygonRoomContact(const PolygonShape * pActor, const Room & pRoom, RoomContactSpec & pAnswer)
 {
 	// For each wall of the Room, verify if it is crossed by a wall of the
 	// polygon to check
 
-	int lRoomSides = pRoom->VertexCount();
+	int lRoomSides = pRoom.VertexCount();
 	int lActorSides = pActor->VertexCount();
 
+	MR_Int32 lActorXMin = pActor->XMin();
+	MR_Int32 lActorXMax = pActor->XMax();
+	MR_Int32 lActorYMin = pActor->YMin();
+	MR_Int32 lActorYMax = pActor->YMax();
+
 	for(int lP0Room = 0; lP0Room < lRoomSides; lP0Room++) {
-		int lP1Room = (lP0Room + 1) % lRoomSides;
+		int lP1Room = (lP0Room + 1 < lRoomSides) ? lP0Room + 1 : 0;
+
+		MR_Int32 lRoomX0 = pRoom.X(lP0Room);
+		MR_Int32 lRoomY0 = pRoom.Y(lP0Room);
+		MR_Int32 lRoomX1 = pRoom.X(lP1Room);
+		MR_Int32 lRoomY1 = pRoom.Y(lP1Room);
 
 		// Verify if the bounding box of the actor cross the selected side
-		if((pActor->XMin() <= max(pRoom->X(lP0Room), pRoom->X(lP1Room)))
-		&& (pActor->XMax() >= min(pRoom->X(lP0Room), pRoom->X(lP1Room)))) {
-			if((pActor->YMin() <= max(pRoom->Y(lP0Room), pRoom->Y(lP1Room)))
-			&& (pActor->YMax() >= min(pRoom->Y(lP0Room), pRoom->Y(lP1Room)))) {
+		if((lActorXMin <= max(lRoomX0, lRoomX1))
+		&& (lActorXMax >= min(lRoomX0, lRoomX1))) {
+			if((lActorYMin <= max(lRoomY0, lRoomY1))
+			&& (lActorYMax >= min(lRoomY0, lRoomY1))) {
 				for(int lP0Actor = 0; lP0Actor < lActorSides; lP0Actor++) {
 					int lP1Actor = (lP0Actor + 1) % lActorSides;
 
-					if(MR_AreLineCrossing(pRoom->X(lP0Room), pRoom->Y(lP0Room), pRoom->X(lP1Room), pRoom->Y(lP1Room), pActor->X(lP0Actor), pActor->Y(lP0Actor), pActor->X(lP1Actor), pActor->Y(lP1Actor))) {
+					if(MR_AreLineCrossing(lRoomX0, lRoomY0, lRoomX1, lRoomY1, pActor->X(lP0Actor), pActor->Y(lP0Actor), pActor->X(lP1Actor), pActor->Y(lP1Actor))) {
 						MR_AddContactWall(lP0Room, pAnswer);
 						break;
 					}
@@ -582,7 +814,7 @@ void MR_PolygonRoomContact(const PolygonShape * pActor, const PolygonShape * pRo
 		pAnswer.mTouchingRoom = TRUE;
 	}
 	else {
-		if(GetPolygonInclusion(*pRoom, MR_2DCoordinate(pActor->X(0), pActor->Y(0)))) {
+		if(MR_PolygonInclusion(pRoom, MR_2DCoordinate(pActor->X(0), pActor->Y(0)))) {
 			pAnswer.mTouchingRoom = TRUE;
 		}
 	}
@@ -624,6 +856,17 @@ BOOL MR_TestBoundingBox(const ShapeInterface * pActor0, const ShapeInterface * p
 	return lReturnValue;
 }
 
+template<class Room>
+BOOL MR_TestRoomBoundingBox(const ShapeInterface * pActor, const Room & pRoom)
+{
+	// Same test as MR_TestBoundingBox, without going through the room's
+	// virtual accessors.
+	int lXMin = max(pActor->XMin(), pRoom.XMin());
+	int lXMax = min(pActor->XMax(), pRoom.XMax());
+
+	return lXMax >= lXMin;
+}
+
 BOOL MR_IsOnLeft(const MR_2DCoordinate & pPointToCheck, const MR_2DCoordinate & pVectorOrigin, const MR_2DCoordinate & pVectorDest)
 {
 	MR_Int32 lLeftScalarResult = -(pVectorDest.mY - pVectorOrigin.mY) * (pPointToCheck.mX - pVectorOrigin.mX)
@@ -65,6 +65,67 @@ class ContactSpec
 		MR_Int32 mZMax;
 };
 
+/**
+ * Cached bounds of a shape, used to cheaply reject actor pairs before
+ * running the full contact test.
+ *
+ * Only the X and Z extents are kept since those are the tests that every
+ * actor-actor contact function starts with.
+ */
+class ContactBounds
+{
+	public:
+		MR_Int32 mXMin;
+		MR_Int32 mXMax;
+		MR_Int32 mZMin;
+		MR_Int32 mZMax;
+
+		void Set(const ShapeInterface *pShape)
+		{
+			mXMin = pShape->XMin();
+			mXMax = pShape->XMax();
+			mZMin = pShape->ZMin();
+			mZMax = pShape->ZMax();
+		}
+
+		/**
+		 * Check if two shapes may be in contact.
+		 * @return @c false if the shapes definitely aren't in contact
+		 *         (DetectActorContact() would return @c FALSE).
+		 */
+		bool MayContact(const ContactBounds &pOther) const
+		{
+			return
+				std::max(mXMin, pOther.mXMin) <= std::min(mXMax, pOther.mXMax) &&
+				std::max(mZMin, pOther.mZMin) < std::min(mZMax, pOther.mZMax);
+		}
+};
+
+/**
+ * Flattened, non-virtual view of a convex polygon (usually a room).
+ *
+ * The vertex coordinates and wall vectors are kept in separate arrays so
+ * the room contact tests can walk them without going through the
+ * PolygonShape interface.  The arrays are owned by whoever built the view.
+ */
+struct PolygonData
+{
+	int mNbVertex;
+
+	const MR_Int32 *mX;
+	const MR_Int32 *mY;
+	const MR_Int32 *mDX;  ///< X(i + 1) - X(i)
+	const MR_Int32 *mDY;  ///< Y(i + 1) - Y(i)
+	const MR_Int32 *mSideLen;
+
+	MR_Int32 mXMin;
+	MR_Int32 mXMax;
+	MR_Int32 mYMin;
+	MR_Int32 mYMax;
+	MR_Int32 mZMin;
+	MR_Int32 mZMax;
+};
+
 class RoomContactSpec
 {
 	public:
@@ -80,15 +141,18 @@ class RoomContactSpec
 };
 
 BOOL MR_DllDeclare GetPolygonInclusion(const PolygonShape &pPolygon, const MR_2DCoordinate &pPosition);
+BOOL MR_DllDeclare GetPolygonInclusion(const PolygonData &pPolygon, const MR_2DCoordinate &pPosition);
 
 // High level oontact function
 BOOL MR_DllDeclare DetectActorContact(const ShapeInterface *pActor, const ShapeInterface *pObstacle, ContactSpec &pAnswer);
 BOOL MR_DllDeclare DetectFeatureContact(const ShapeInterface *pActor, const PolygonShape *pFeature, ContactSpec &pAnswer);
 void MR_DllDeclare DetectRoomContact(const ShapeInterface *pActor, const PolygonShape *pRoom, RoomContactSpec &pAnswer);
+void MR_DllDeclare DetectRoomContact(const ShapeInterface *pActor, const PolygonData &pRoom, RoomContactSpec &pAnswer);
 
 BOOL MR_DllDeclare GetActorForceLongitude(const ShapeInterface *pActor, const ShapeInterface *pObstacle, MR_Angle &pLongitude);
 BOOL MR_DllDeclare GetFeatureForceLongitude(const ShapeInterface *pActor, const PolygonShape *pFeature, MR_Angle &pLongitude);
 BOOL MR_DllDeclare GetWallForceLongitude(const ShapeInterface *pActor, const PolygonShape *pRoom, int pWallIndex, MR_Angle &pLongitude);
+BOOL MR_DllDeclare GetWallForceLongitude(const ShapeInterface *pActor, const PolygonData &pRoom, int pWallIndex, MR_Angle &pLongitude);
 
 }  // namespace Model
 }  // namespace HoverRace
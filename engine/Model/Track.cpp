@@ -83,6 +83,7 @@ void Track::LoadLevel(bool allowRendering, char gameOpts)
 	using namespace HoverRace::Parcel;
 
 	level = new Level(allowRendering, gameOpts);
+	level->SetFormatVersion(header.version);
 
 	recFile->SelectRecord(1);
 	ObjStreamPtr archivePtr(recFile->StreamIn());
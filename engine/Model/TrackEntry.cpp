@@ -37,7 +37,6 @@ void TrackEntry::Serialize(Parcel::ObjStream &os)
 	}
 	else {
 		MR_Int32 magicNumber;
-		MR_Int32 version;
 
 		os >> magicNumber;
 		if (magicNumber != MR_MAGIC_TRACK_NUMBER)
@@ -45,7 +44,7 @@ void TrackEntry::Serialize(Parcel::ObjStream &os)
 				"Bad magic number: 0x%08x") % magicNumber));
 
 		os >> version;
-		if (version != 1)
+		if (version < 1 || version > MR_TRACK_VERSION)
 			throw TrackFormatExn(boost::str(boost::format(
 				"Unknown track version: %d") % version));
 
@@ -64,6 +63,7 @@ void TrackEntry::Inspect(Util::InspectMapNode &node) const
 {
 	node.
 		AddField("name", name).
+		AddField("version", version).
 		AddField("description", description).
 		AddField("regMinor", regMinor).
 		AddField("regMajor", regMajor).
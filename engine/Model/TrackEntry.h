@@ -56,7 +56,7 @@ class MR_DllDeclare TrackEntry : public Util::Inspectable
 {
 	typedef Util::Inspectable SUPER;
 	public:
-		TrackEntry() : SUPER() { }
+		TrackEntry() : SUPER(), version(0) { }
 		virtual ~TrackEntry() { }
 
 		void Serialize(Parcel::ObjStream &os);
@@ -85,6 +85,7 @@ class MR_DllDeclare TrackEntry : public Util::Inspectable
 #		ifdef _DEBUG
 			Util::OS::path_t path;  // For parcel debugging.
 #		endif
+		MR_Int32 version;  ///< Track format version.
 		std::string description;
 		MR_Int32 regMinor;
 		MR_Int32 regMajor;
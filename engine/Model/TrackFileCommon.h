@@ -23,6 +23,11 @@
 #pragma once
 
 #define MR_MAGIC_TRACK_NUMBER  82617
+
+// Track format version
+// 1: Original format
+// 2: Audible rooms store their source room
+#define MR_TRACK_VERSION           2
 #define MR_REGISTRED_TRACK         0
 #define MR_FREE_TRACK              1
 
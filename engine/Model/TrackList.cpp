@@ -20,13 +20,18 @@
 // See the License for the specific language governing permissions
 // and limitations under the License.
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/lexical_cast.hpp>
 
+#include "../Parcel/ClassicObjStream.h"
+#include "../Parcel/MappedRecordFile.h"
 #include "../Parcel/ObjStream.h"
 #include "../Parcel/TrackBundle.h"
+#include "../Util/Config.h"
 #include "../Util/Str.h"
 #include "../Util/Log.h"
 #include "../Util/OS.h"
+#include "../Util/WorkerPool.h"
 
 #include "TrackList.h"
 
@@ -49,6 +54,47 @@ namespace {
 	{
 		return *ent1 < *ent2;
 	}
+
+	const MR_UInt32 INDEX_MAGIC = 0x49545248;  // "HRTI"
+	const MR_UInt32 INDEX_VERSION = 2;
+
+	/// Parsing a handful of headers isn't worth starting up the threads.
+	const size_t MIN_PARALLEL_PARSE = 16;
+
+	/// A track file found in the bundle.
+	struct FoundTrack
+	{
+		OS::path_t path;
+		std::string key;  ///< The path, as a key in the index.
+		std::string name;
+		MR_UInt64 size;
+		MR_Int64 mtime;
+		TrackEntryPtr entry;
+	};
+
+	/**
+	 * Read the header of a single track file.
+	 * @param track The track; the entry will be filled in.
+	 */
+	void ParseTrackEntry(FoundTrack &track)
+	{
+		try {
+			MappedRecordFile recFile;
+			if (!recFile.OpenForRead(track.path)) {
+				throw ObjStreamExn(track.path, "Not a valid track file");
+			}
+			recFile.SelectRecord(0);
+
+			TrackEntryPtr entry = std::make_shared<TrackEntry>();
+			entry->Serialize(*recFile.StreamIn());
+			track.entry = entry;
+		}
+		catch (Exception &ex) {
+			// Ignore this bad track and continue.
+			Log::Warn("Skipping invalid track: %s: %s",
+				track.name.c_str(), ex.what());
+		}
+	}
 }
 
 TrackList::TrackList()
@@ -59,29 +105,93 @@ TrackList::TrackList()
 /**
  * Load the list of available tracks from the track bundle.
  * Any previously-loaded list is cleared.
+ *
+ * If an index path is given, then the track headers are cached there, and
+ * only tracks which have been added or modified since the last time are
+ * actually read.
+ *
  * @param trackBundle The track bundle (may not be @c NULL).
+ * @param indexPath Optional path to the track header cache.
  */
-void TrackList::Reload(Parcel::TrackBundlePtr trackBundle)
+void TrackList::Reload(Parcel::TrackBundlePtr trackBundle,
+	const OS::path_t &indexPath)
 {
 	Clear();
 
+	index_t index;
+	if (!indexPath.empty()) {
+		LoadIndex(indexPath, index);
+	}
+
+	std::vector<FoundTrack> found;
+	std::vector<size_t> toParse;
 	for (const OS::dirEnt_t &ent : *trackBundle) {
 		std::string name((const char*)Str::PU(ent.path().filename().c_str()));
-		try {
-			TrackEntryPtr trackEnt = trackBundle->OpenTrackEntry(name);
-			if (trackEnt) {
-				tracks.emplace_back(trackEnt);
-#				ifdef _DEBUG
-					tracks.back()->path = ent.path();
-#				endif
-			}
+		if (!boost::ends_with(name, Config::TRACK_EXT)) continue;
+
+		boost::system::error_code ec;
+		MR_UInt64 size = boost::filesystem::file_size(ent.path(), ec);
+		if (ec) continue;
+		MR_Int64 mtime = boost::filesystem::last_write_time(ent.path(), ec);
+		if (ec) continue;
+
+		FoundTrack track;
+		track.path = ent.path();
+		track.key = (const char*)Str::PU(ent.path());
+		track.name.assign(name, 0, name.length() - Config::TRACK_EXT.length());
+		track.size = size;
+		track.mtime = mtime;
+
+		auto iter = index.find(track.key);
+		if (iter != index.end() &&
+			iter->second.size == size && iter->second.mtime == mtime)
+		{
+			track.entry = iter->second.entry;
 		}
-		catch (Parcel::ObjStreamExn &ex) {
-			// Ignore this bad track and continue.
-			Log::Warn("Skipping invalid track: %s: %s", name.c_str(), ex.what());
+		else {
+			toParse.push_back(found.size());
+		}
+
+		found.emplace_back(std::move(track));
+	}
+
+	if (toParse.size() >= MIN_PARALLEL_PARSE) {
+		Util::WorkerPool pool;
+		pool.ParallelFor(static_cast<int>(toParse.size()), [&](int i) {
+			ParseTrackEntry(found[toParse[static_cast<size_t>(i)]]);
+		});
+	}
+	else {
+		for (size_t i : toParse) {
+			ParseTrackEntry(found[i]);
 		}
 	}
 
+	index_t newIndex;
+	for (auto &track : found) {
+		if (!track.entry) continue;
+
+		track.entry->name = track.name;
+#		ifdef _DEBUG
+			track.entry->path = track.path;
+#		endif
+
+		// Each list gets its own copy, since the entries are mutable.
+		tracks.emplace_back(std::make_shared<TrackEntry>(*track.entry));
+
+		IndexEntry &indexEnt = newIndex[track.key];
+		indexEnt.size = track.size;
+		indexEnt.mtime = track.mtime;
+		indexEnt.entry = track.entry;
+	}
+
+	// Only rewrite the index if something was added, changed, or removed.
+	if (!indexPath.empty() &&
+		(!toParse.empty() || newIndex.size() != index.size()))
+	{
+		SaveIndex(indexPath, newIndex);
+	}
+
 	// Use a stable sort so that if there are multiple entries with the
 	// same name, then the bundle priority order will be preserved.
 	// Then, when we remove duplicates, the lower-priority entries will be
@@ -93,5 +203,111 @@ void TrackList::Reload(Parcel::TrackBundlePtr trackBundle)
 	std::sort(tracks.begin(), tracks.end(), NaturalCmpFunc);
 }
 
+/**
+ * Read the track header cache.
+ * If the cache is missing or unreadable, then the index is left empty.
+ * @param path The path to the cache.
+ * @param[out] index The cached headers, keyed by track path.
+ */
+void TrackList::LoadIndex(const OS::path_t &path, index_t &index)
+{
+	FILE *file = OS::FOpen(path, "rb");
+	if (!file) return;
+
+	try {
+		ClassicObjStream os(file, path, false);
+
+		MR_UInt32 magic, version, count;
+		os >> magic >> version >> count;
+		if (magic != INDEX_MAGIC || version != INDEX_VERSION) {
+			fclose(file);
+			return;
+		}
+
+		for (MR_UInt32 i = 0; i < count; ++i) {
+			std::string key;
+			MR_UInt32 sizeLo, sizeHi, mtimeLo, mtimeHi;
+			TrackEntryPtr entry = std::make_shared<TrackEntry>();
+
+			os >> key >> sizeLo >> sizeHi >> mtimeLo >> mtimeHi >>
+				entry->version >>
+				entry->description >> entry->regMinor >> entry->regMajor >>
+				entry->registrationMode >> entry->sortingIndex;
+
+			IndexEntry &indexEnt = index[key];
+			indexEnt.size = (static_cast<MR_UInt64>(sizeHi) << 32) | sizeLo;
+			indexEnt.mtime = static_cast<MR_Int64>(
+				(static_cast<MR_UInt64>(mtimeHi) << 32) | mtimeLo);
+			indexEnt.entry = entry;
+		}
+	}
+	catch (ObjStreamExn &ex) {
+		Log::Warn("Ignoring corrupt track index: %s", ex.what());
+		index.clear();
+	}
+
+	fclose(file);
+}
+
+/**
+ * Write the track header cache.
+ * Failure to write the cache is not fatal; the tracks will just be re-read
+ * next time.
+ * @param path The path to the cache.
+ * @param index The headers, keyed by track path.
+ */
+void TrackList::SaveIndex(const OS::path_t &path, const index_t &index)
+{
+	// Write to a temporary file first so that a partially-written index is
+	// never picked up.
+	OS::path_t tmpPath = path;
+	tmpPath += Str::UP(".tmp");
+
+	boost::system::error_code ec;
+	boost::filesystem::create_directories(path.parent_path(), ec);
+
+	FILE *file = OS::FOpen(tmpPath, "wb");
+	if (!file) {
+		Log::Warn("Unable to write track index: %s",
+			(const char*)Str::PU(tmpPath));
+		return;
+	}
+
+	try {
+		ClassicObjStream os(file, tmpPath, true);
+
+		os << INDEX_MAGIC << INDEX_VERSION <<
+			static_cast<MR_UInt32>(index.size());
+
+		for (const auto &ent : index) {
+			const IndexEntry &indexEnt = ent.second;
+			const TrackEntry &entry = *indexEnt.entry;
+			const MR_UInt64 mtime = static_cast<MR_UInt64>(indexEnt.mtime);
+
+			os << ent.first <<
+				static_cast<MR_UInt32>(indexEnt.size) <<
+				static_cast<MR_UInt32>(indexEnt.size >> 32) <<
+				static_cast<MR_UInt32>(mtime) <<
+				static_cast<MR_UInt32>(mtime >> 32) <<
+				entry.version <<
+				entry.description << entry.regMinor << entry.regMajor <<
+				entry.registrationMode << entry.sortingIndex;
+		}
+	}
+	catch (ObjStreamExn &ex) {
+		fclose(file);
+		boost::filesystem::remove(tmpPath, ec);
+		Log::Warn("Unable to write track index: %s", ex.what());
+		return;
+	}
+
+	fclose(file);
+
+	boost::filesystem::rename(tmpPath, path, ec);
+	if (ec) {
+		boost::filesystem::remove(tmpPath, ec);
+	}
+}
+
 }  // namespace Model
 }  // namespace HoverRace
@@ -53,7 +53,8 @@ class MR_DllDeclare TrackList
 		TrackList();
 
 	public:
-		void Reload(Parcel::TrackBundlePtr trackBundle);
+		void Reload(Parcel::TrackBundlePtr trackBundle,
+			const Util::OS::path_t &indexPath = Util::OS::path_t());
 
 		/** Clear the list of available tracks. */
 		void Clear() { tracks.clear(); }
@@ -73,6 +74,19 @@ class MR_DllDeclare TrackList
 		const_iterator begin() const { return tracks.begin(); }
 		const_iterator end() const { return tracks.end(); }
 
+	private:
+		/// Cached header of a single track file.
+		struct IndexEntry
+		{
+			MR_UInt64 size;
+			MR_Int64 mtime;
+			TrackEntryPtr entry;
+		};
+		typedef std::unordered_map<std::string, IndexEntry> index_t;
+
+		static void LoadIndex(const Util::OS::path_t &path, index_t &index);
+		static void SaveIndex(const Util::OS::path_t &path, const index_t &index);
+
 	private:
 		tracks_t tracks;
 };
@@ -0,0 +1,245 @@
+
+// Prediction.cpp
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include <chrono>
+
+#include "../Model/GameSession.h"
+#include "RaceProtocol.h"
+
+#include "Prediction.h"
+
+namespace HoverRace {
+namespace Net {
+
+/**
+ * Constructor.
+ * @param session The session the hovercraft is in.
+ * @param ch The local hovercraft.
+ * @param handle The hovercraft's handle in the current level.
+ * @param maxDepth The maximum number of slices to roll back.
+ */
+Prediction::Prediction(Model::GameSession &session,
+	MainCharacter::MainCharacter *ch,
+	MR_FreeElementHandle handle, int maxDepth) :
+	session(session), ch(ch), handle(handle),
+	layout(MainCharacter::MainCharacter::NET_STATE_FIELDS,
+		MainCharacter::MainCharacter::NUM_NET_STATE_FIELDS,
+		MainCharacter::MainCharacter::NET_STATE_SIZE),
+	history(static_cast<size_t>(maxDepth < 1 ? 1 : maxDepth) + 1),
+	inputSeq(0), startTime(0), controls(0)
+{
+	for (auto &slice : history) {
+		slice.state.resize(MainCharacter::MainCharacter::NET_STATE_SIZE);
+	}
+}
+
+/**
+ * Apply the local input and advance the session by one slice.
+ * This replaces GameSession::Step() on the client.
+ * The controls are for the slice that starts at the current simulation
+ * time; send them to the server tagged with that time.
+ * @param controls The control bits (see RaceProtocol::Control).
+ * @return The input sequence to send to the server with the controls.
+ */
+MR_UInt32 Prediction::Step(MR_UInt32 controls)
+{
+	MR_SimulationTime time = session.GetSimulationTime();
+
+	if (inputSeq == 0) startTime = time;
+
+	// Zero means "no input", so skip it when the sequence wraps.
+	if (++inputSeq == 0) inputSeq = 1;
+
+	Slice &slice = GetSlot(time);
+	slice.seq = inputSeq;
+	slice.controls = controls;
+	slice.prevControls = this->controls;
+	slice.time = time;
+
+	ApplyControls(ch, controls, this->controls);
+	this->controls = controls;
+
+	ch->SetSimulationTime(time);
+	session.Step();
+
+	ch->SaveSimState(slice.sim);
+	ch->PackNetState(slice.state.data());
+
+	return inputSeq;
+}
+
+/**
+ * Reconcile the prediction with a state from the server.
+ *
+ * The server applies each input to the slice it was tagged with, and runs
+ * the same simulation, so the quantized state it sends should match the
+ * prediction for the same point in time, give or take the precision lost
+ * by the last correction; anything more (a collision with another player,
+ * an input that arrived too late) triggers a rollback.
+ *
+ * @param simTime The simulation time of the state (the end of a slice).
+ * @param state The authoritative net state of the local hovercraft.
+ */
+void Prediction::OnState(MR_SimulationTime simTime, const MR_UInt8 *state)
+{
+	typedef std::chrono::high_resolution_clock clock_t;
+
+	stats.states++;
+
+	if (inputSeq == 0) {
+		// We haven't started predicting, so just take the server's word.
+		Restore(state);
+		return;
+	}
+
+	// States from before our first input tell us nothing new.
+	if (simTime <= startTime) return;
+
+	MR_SimulationTime now = session.GetSimulationTime();
+	if (simTime > now) {
+		// The server is ahead of us; there's nothing to replay.
+		stats.ahead++;
+		Restore(state);
+		return;
+	}
+
+	Slice *slice = FindSlice(simTime - Model::GameSession::SIMULATION_SLICE);
+	if (!slice) {
+		stats.tooDeep++;
+		Restore(state);
+		return;
+	}
+
+	if (layout.IsClose(slice->state.data(), state,
+		MainCharacter::MainCharacter::NET_STATE_TOLERANCE))
+	{
+		stats.confirmed++;
+		return;
+	}
+
+	clock_t::time_point start = clock_t::now();
+
+	int depth = static_cast<int>(
+		(now - simTime) / Model::GameSession::SIMULATION_SLICE);
+
+	stats.rollbacks++;
+	if (depth > stats.maxDepth) stats.maxDepth = depth;
+
+	Restore(state, &slice->sim);
+	ch->SaveSimState(slice->sim);
+	memcpy(slice->state.data(), state, slice->state.size());
+
+	ch->SetReplaying(true);
+
+	int room = ch->mRoom;
+	for (MR_SimulationTime time = simTime; time < now;
+		time += Model::GameSession::SIMULATION_SLICE)
+	{
+		Slice *next = FindSlice(time);
+		if (!next) break;
+
+		ApplyControls(ch, next->controls, next->prevControls);
+		ch->SetSimulationTime(time);
+
+		room = session.ReplayElementSlice(handle, room, time);
+		if (room < 0) break;
+
+		ch->SaveSimState(next->sim);
+		ch->PackNetState(next->state.data());
+		stats.replayed++;
+	}
+
+	ch->SetReplaying(false);
+	ch->SetSimulationTime(now);
+
+	stats.replayTime += std::chrono::duration_cast<std::chrono::nanoseconds>(
+		clock_t::now() - start).count();
+}
+
+/**
+ * Retrieve the place in the ring for a slice.
+ * @param time The simulation time at the start of the slice.
+ * @return The slot (which may hold an older slice).
+ */
+Prediction::Slice &Prediction::GetSlot(MR_SimulationTime time)
+{
+	MR_UInt32 idx = static_cast<MR_UInt32>(time) /
+		static_cast<MR_UInt32>(Model::GameSession::SIMULATION_SLICE);
+	return history[idx % history.size()];
+}
+
+/**
+ * Look up a recorded slice.
+ * @param time The simulation time at the start of the slice.
+ * @return The slice, or @c nullptr if it has already been overwritten.
+ */
+Prediction::Slice *Prediction::FindSlice(MR_SimulationTime time)
+{
+	Slice &slice = GetSlot(time);
+	return (slice.seq != 0 && slice.time == time) ? &slice : nullptr;
+}
+
+/**
+ * Apply control bits to a hovercraft.
+ * The server uses this too, so that both sides interpret the controls the
+ * same way.
+ * @param ch The hovercraft.
+ * @param controls The control bits.
+ * @param prevControls The control bits from the previous slice.
+ */
+void Prediction::ApplyControls(MainCharacter::MainCharacter *ch,
+	MR_UInt32 controls, MR_UInt32 prevControls)
+{
+	using namespace RaceProtocol;
+
+	MR_UInt32 pressed = controls & ~prevControls;
+
+	ch->SetEngineState((controls & CTL_ENGINE) != 0);
+	ch->SetTurnLeftState((controls & CTL_LEFT) != 0);
+	ch->SetTurnRightState((controls & CTL_RIGHT) != 0);
+	ch->SetBrakeState((controls & CTL_BRAKE) != 0);
+	ch->SetLookBackState((controls & CTL_LOOK_BACK) != 0);
+	if (pressed & CTL_JUMP) ch->SetJump();
+	if (pressed & CTL_FIRE) ch->SetPowerup();
+	if (pressed & CTL_CHANGE_ITEM) ch->SetChangeItem();
+}
+
+/**
+ * Overwrite the hovercraft's state, moving it to its new room if needed.
+ * @param state The net state.
+ * @param sim The full state to restore first, or @c nullptr to only apply
+ *            the net state.
+ */
+void Prediction::Restore(const MR_UInt8 *state,
+	const MainCharacter::MainCharacter::SimState *sim)
+{
+	int oldRoom = ch->mRoom;
+
+	if (sim) ch->RestoreSimState(*sim);
+	ch->SetNetState(MainCharacter::MainCharacter::NET_STATE_SIZE, state);
+
+	if (ch->mRoom != oldRoom && ch->mRoom >= 0) {
+		session.GetCurrentLevel()->MoveElement(handle, ch->mRoom);
+	}
+}
+
+}  // namespace Net
+}  // namespace HoverRace
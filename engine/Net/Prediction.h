@@ -0,0 +1,161 @@
+
+// Prediction.h
+// Client-side prediction for the local hovercraft.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include "../MainCharacter/MainCharacter.h"
+#include "../Model/Level.h"
+#include "../Util/MR_Types.h"
+#include "StateDelta.h"
+
+#if defined(_WIN32) && defined(HR_ENGINE_SHARED)
+#	ifdef MR_ENGINE
+#		define MR_DllDeclare   __declspec( dllexport )
+#	else
+#		define MR_DllDeclare   __declspec( dllimport )
+#	endif
+#else
+#	define MR_DllDeclare
+#endif
+
+namespace HoverRace {
+	namespace Model {
+		class GameSession;
+	}
+}
+
+namespace HoverRace {
+namespace Net {
+
+/**
+ * Predicts the movement of the local hovercraft ahead of the race server.
+ *
+ * The client runs its simulation a few slices ahead of the server, so that
+ * each input reaches the server before the server simulates the slice it
+ * was sampled for.  Local input is applied as soon as it is sampled, one
+ * slice at a time.  For each slice, the input (which is also sent to the
+ * server, tagged with the slice) and the resulting state of the hovercraft
+ * (both the full state and the net state) are kept in a ring, indexed by
+ * simulation time.
+ *
+ * When a STATE arrives, the authoritative state of the hovercraft is
+ * compared with the state that was predicted for the end of the same slice.
+ * If they differ by more than the quantization of the net state can explain
+ * (see MainCharacter::NET_STATE_TOLERANCE), the hovercraft is rolled back to
+ * the full state it had at that point, with the authoritative net state
+ * applied on top, and the slices since then are replayed with the same
+ * inputs, so the correction is applied without losing the player's more
+ * recent input.  Inventory, fuel and timers come from the full state, so
+ * replayed presses (fire, change item, jump) take effect exactly once; the
+ * replay itself doesn't touch the rest of the level (see
+ * MainCharacter::SetReplaying()).
+ *
+ * Corrections that are more than @c maxDepth slices old can't be replayed;
+ * the hovercraft just snaps to the authoritative state.
+ *
+ * @author Michael Imamura
+ */
+class MR_DllDeclare Prediction
+{
+	public:
+		/// Default rollback cap (about half a second).
+		static const int DEFAULT_MAX_DEPTH = 32;
+
+		/// Counters for how often (and how expensively) predictions are fixed.
+		struct Stats
+		{
+			Stats() { Clear(); }
+
+			void Clear()
+			{
+				states = 0;
+				confirmed = 0;
+				rollbacks = 0;
+				replayed = 0;
+				tooDeep = 0;
+				ahead = 0;
+				maxDepth = 0;
+				replayTime = 0;
+			}
+
+			MR_Int64 states;  ///< Authoritative states received.
+			MR_Int64 confirmed;  ///< States that matched the prediction.
+			MR_Int64 rollbacks;  ///< States that were restored and replayed.
+			MR_Int64 replayed;  ///< Total slices replayed.
+			MR_Int64 tooDeep;  ///< States too old to replay (snapped instead).
+			MR_Int64 ahead;  ///< States past the prediction (snapped instead).
+			int maxDepth;  ///< Deepest rollback so far, in slices.
+			MR_Int64 replayTime;  ///< Time spent restoring and replaying (ns).
+		};
+
+	public:
+		Prediction(Model::GameSession &session,
+			MainCharacter::MainCharacter *ch, MR_FreeElementHandle handle,
+			int maxDepth = DEFAULT_MAX_DEPTH);
+
+	public:
+		MR_UInt32 GetInputSeq() const { return inputSeq; }
+		const Stats &GetStats() const { return stats; }
+		void ClearStats() { stats.Clear(); }
+
+		MR_UInt32 Step(MR_UInt32 controls);
+		void OnState(MR_SimulationTime simTime, const MR_UInt8 *state);
+
+		static void ApplyControls(MainCharacter::MainCharacter *ch,
+			MR_UInt32 controls, MR_UInt32 prevControls);
+
+	private:
+		struct Slice
+		{
+			Slice() : seq(0), controls(0), prevControls(0), time(0) { }
+
+			MR_UInt32 seq;  ///< Input sequence (0 if unused).
+			MR_UInt32 controls;
+			MR_UInt32 prevControls;  ///< For triggering on the press.
+			MR_SimulationTime time;  ///< Simulation time at the start.
+			MainCharacter::MainCharacter::SimState sim;  ///< Full state at the end.
+			std::vector<MR_UInt8> state;  ///< Net state at the end.
+		};
+
+		Slice &GetSlot(MR_SimulationTime time);
+		Slice *FindSlice(MR_SimulationTime time);
+		void Restore(const MR_UInt8 *state,
+			const MainCharacter::MainCharacter::SimState *sim = nullptr);
+
+	private:
+		Model::GameSession &session;
+		MainCharacter::MainCharacter *ch;
+		MR_FreeElementHandle handle;
+		StateDelta layout;  ///< For comparing net states.
+
+		std::vector<Slice> history;  ///< Ring of recent slices, by start time.
+		MR_UInt32 inputSeq;  ///< Last input sequence (0 if none yet).
+		MR_SimulationTime startTime;  ///< Start of the first predicted slice.
+		MR_UInt32 controls;  ///< Last controls applied.
+
+		Stats stats;
+};
+
+}  // namespace Net
+}  // namespace HoverRace
+
+#undef MR_DllDeclare
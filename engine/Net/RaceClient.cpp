@@ -0,0 +1,420 @@
+
+// RaceClient.cpp
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include <chrono>
+
+#include <boost/asio.hpp>
+
+#include "../MainCharacter/MainCharacter.h"
+#include "../Model/GameSession.h"
+#include "../Exception.h"
+#include "NetExn.h"
+#include "Prediction.h"
+
+#include "RaceClient.h"
+
+using boost::asio::ip::udp;
+
+namespace HoverRace {
+namespace Net {
+
+namespace {
+	/// How often to repeat the JOIN until the server answers.
+	const auto JOIN_RETRY = std::chrono::milliseconds(500);
+
+	/// Number of received states to keep as baselines (the same as the
+	/// server keeps).
+	const size_t HISTORY_SIZE = 32;
+}
+
+/// The socket, kept out of the header so that users don't need Asio.
+struct RaceClient::Connection
+{
+	Connection() : socket(io) { }
+
+	boost::asio::io_service io;
+	udp::socket socket;
+	udp::endpoint server;  ///< Where JOINs go.
+	udp::endpoint racePort;  ///< Where everything else goes (after the WELCOME).
+};
+
+/**
+ * Constructor.
+ * Sends the first JOIN right away.
+ * @param host The server host name or address.
+ * @param port The server port.
+ * @param race The race to join.
+ * @param hoverModel The requested craft.
+ * @param name The player name.
+ * @throws NetExn The host could not be resolved or the socket could not
+ *                be opened.
+ */
+RaceClient::RaceClient(const std::string &host, MR_UInt16 port,
+	MR_UInt16 race, int hoverModel, const std::string &name) :
+	conn(new Connection()), race(race), hoverModel(hoverModel), name(name),
+	welcomed(false), rejected(false),
+	playerIdx(-1), welcomeSimTime(0), laps(0),
+	session(nullptr), gameOpts(0), leadTime(0),
+	stateDelta(MainCharacter::MainCharacter::NET_STATE_FIELDS,
+		MainCharacter::MainCharacter::NUM_NET_STATE_FIELDS,
+		MainCharacter::MainCharacter::NET_STATE_SIZE),
+	history(HISTORY_SIZE), lastState(0)
+{
+	boost::system::error_code err;
+
+	udp::resolver resolver(conn->io);
+	udp::resolver::query query(host, boost::lexical_cast<std::string>(port));
+	udp::resolver::iterator iter = resolver.resolve(query, err);
+	if (err || iter == udp::resolver::iterator()) {
+		throw NetExn("Unable to resolve " + host + ": " + err.message());
+	}
+	conn->server = *iter;
+
+	conn->socket.open(conn->server.protocol(), err);
+	if (!err) conn->socket.non_blocking(true, err);
+	if (err) {
+		throw NetExn("Unable to open socket: " + err.message());
+	}
+
+	SendJoin();
+}
+
+RaceClient::~RaceClient()
+{
+	Leave();
+}
+
+/**
+ * Retrieve the local hovercraft.
+ * @return The hovercraft, or @c nullptr if the race hasn't started.
+ */
+MainCharacter::MainCharacter *RaceClient::GetPlayer() const
+{
+	return (playerIdx >= 0 && static_cast<size_t>(playerIdx) < players.size()) ?
+		players[static_cast<size_t>(playerIdx)].ch : nullptr;
+}
+
+/**
+ * Start racing.
+ * Adds the local hovercraft to the session and sets the session's clock
+ * a few slices ahead of the server's.
+ * @param session The session, with the race's track already loaded.
+ * @param gameOpts The game options the track was loaded with.
+ * @param lead The number of slices to run ahead of the server; this must
+ *             cover the time it takes for an input to reach the server.
+ */
+void RaceClient::Start(Model::GameSession &session, char gameOpts, int lead)
+{
+	ASSERT(welcomed);
+	ASSERT(this->session == nullptr);
+
+	this->session = &session;
+	this->gameOpts = gameOpts;
+	leadTime = static_cast<MR_SimulationTime>(lead < 1 ? 1 : lead) *
+		Model::GameSession::SIMULATION_SLICE;
+
+	// The server has kept running since it sent the WELCOME.
+	MR_SimulationTime elapsed = static_cast<MR_SimulationTime>(
+		std::chrono::duration_cast<std::chrono::milliseconds>(
+			clock_t::now() - welcomeTime).count());
+	MR_SimulationTime serverTime = welcomeSimTime + elapsed -
+		(elapsed % Model::GameSession::SIMULATION_SLICE);
+	session.SetSimulationTime(serverTime + leadTime);
+
+	Player &player = AddPlayer(playerIdx, true);
+	prediction.reset(new Prediction(session, player.ch, player.handle));
+}
+
+/**
+ * Handle everything the server has sent since the last call.
+ * Also repeats the JOIN until the server answers.
+ */
+void RaceClient::Poll()
+{
+	if (!welcomed && !rejected && clock_t::now() - lastJoin >= JOIN_RETRY) {
+		SendJoin();
+	}
+
+	MR_UInt8 buf[RaceProtocol::MAX_DATAGRAM];
+	udp::endpoint from;
+	for (;;) {
+		boost::system::error_code err;
+		size_t len = conn->socket.receive_from(
+			boost::asio::buffer(buf), from, 0, err);
+		if (err) {
+			// Either nothing is waiting, or an earlier send bounced; either
+			// way, try again next time.
+			break;
+		}
+
+		if (from.address() != conn->server.address()) continue;
+
+		RaceProtocol::Reader msg(buf, len);
+		RaceProtocol::Msg type = msg.ReadMsg();
+
+		// The WELCOME (or REJECT) may come from a different port than the
+		// one we sent the JOIN to; everything else must come from the
+		// race port.
+		if (type == RaceProtocol::Msg::WELCOME) {
+			OnWelcome(msg);
+		}
+		else if (type == RaceProtocol::Msg::REJECT) {
+			OnReject(msg);
+		}
+		else if (type == RaceProtocol::Msg::STATE &&
+			welcomed && from == conn->racePort)
+		{
+			OnState(msg);
+		}
+	}
+}
+
+/**
+ * Apply the local input and advance the session by one slice.
+ * This replaces GameSession::Step() once the race has started.
+ * @param controls The control bits (see RaceProtocol::Control).
+ */
+void RaceClient::Step(MR_UInt32 controls)
+{
+	if (!prediction) return;
+
+	MR_SimulationTime sliceTime = session->GetSimulationTime();
+	MR_UInt32 seq = prediction->Step(controls);
+
+	RaceProtocol::Writer msg(RaceProtocol::Msg::INPUT);
+	msg.
+		Write(seq).
+		Write(static_cast<MR_UInt32>(sliceTime)).
+		Write(controls).
+		Write(lastState);
+	Send(msg);
+}
+
+/**
+ * Tell the server that we're leaving.
+ * The client can't be used afterwards.
+ */
+void RaceClient::Leave()
+{
+	if (!welcomed) return;
+
+	Send(RaceProtocol::Writer(RaceProtocol::Msg::LEAVE));
+	welcomed = false;
+	prediction.reset();
+}
+
+void RaceClient::Send(const RaceProtocol::Writer &msg)
+{
+	if (!msg.IsOk()) return;
+
+	boost::system::error_code err;
+	conn->socket.send_to(
+		boost::asio::buffer(msg.GetData(), msg.GetLength()),
+		welcomed ? conn->racePort : conn->server, 0, err);
+	// Lost datagrams are expected; the protocol recovers on its own.
+}
+
+void RaceClient::SendJoin()
+{
+	RaceProtocol::Writer msg(RaceProtocol::Msg::JOIN);
+	msg.
+		Write(RaceProtocol::VERSION).
+		Write(race).
+		Write(static_cast<MR_UInt8>(hoverModel)).
+		Write(name);
+	Send(msg);
+
+	lastJoin = clock_t::now();
+}
+
+void RaceClient::OnWelcome(RaceProtocol::Reader &msg)
+{
+	int idx = msg.ReadUInt8();
+	MR_UInt32 simTime = msg.ReadUInt32();
+	std::string track = msg.ReadString();
+	int raceLaps = msg.ReadUInt8();
+	MR_UInt16 racePort = msg.ReadUInt16();
+	if (!msg.IsOk() || welcomed || rejected) return;
+
+	welcomed = true;
+	playerIdx = idx;
+	welcomeSimTime = static_cast<MR_SimulationTime>(simTime);
+	welcomeTime = clock_t::now();
+	trackName = track;
+	laps = raceLaps;
+
+	conn->racePort = udp::endpoint(conn->server.address(), racePort);
+}
+
+void RaceClient::OnReject(RaceProtocol::Reader &msg)
+{
+	std::string reason = msg.ReadString();
+	if (!msg.IsOk() || welcomed) return;
+
+	rejected = true;
+	rejectReason = reason;
+}
+
+void RaceClient::OnState(RaceProtocol::Reader &msg)
+{
+	MR_UInt32 seq = msg.ReadUInt32();
+	MR_UInt32 baseSeq = msg.ReadUInt32();
+	MR_UInt32 simTime = msg.ReadUInt32();
+	msg.ReadUInt32();  // Last input applied; we go by the sim time instead.
+	int count = msg.ReadUInt8();
+	if (!msg.IsOk() || seq == 0 || !session) return;
+
+	// Only take newer states (sequence numbers may wrap).
+	if (lastState != 0 && static_cast<MR_Int32>(seq - lastState) <= 0) return;
+
+	const Received *base = nullptr;
+	if (baseSeq != 0) {
+		const Received &prev = history[baseSeq % HISTORY_SIZE];
+		if (prev.seq != baseSeq) return;  // Too old; wait for the next one.
+		base = &prev;
+	}
+
+	const size_t stateLen = static_cast<size_t>(stateDelta.GetStateLength());
+
+	incoming.present.assign(players.size(), false);
+	incoming.states.resize(players.size() * stateLen);
+
+	for (int i = 0; i < count; i++) {
+		MR_UInt8 tag = msg.ReadUInt8();
+		size_t idx = tag & ~RaceProtocol::STATE_FROM_BASELINE;
+
+		const MR_UInt8 *baseState = nullptr;
+		if (tag & RaceProtocol::STATE_FROM_BASELINE) {
+			if (!base || idx >= base->present.size() || !base->present[idx]) return;
+			baseState = &base->states[idx * stateLen];
+		}
+
+		if (idx >= incoming.present.size()) {
+			incoming.present.resize(idx + 1, false);
+			incoming.states.resize((idx + 1) * stateLen);
+		}
+		if (!stateDelta.Read(msg, baseState, &incoming.states[idx * stateLen])) return;
+		incoming.present[idx] = true;
+	}
+	if (!msg.IsOk()) return;
+
+	incoming.seq = seq;
+	incoming.simTime = static_cast<MR_SimulationTime>(simTime);
+
+	Received &snap = history[seq % HISTORY_SIZE];
+	std::swap(snap, incoming);
+	lastState = seq;
+
+	ApplyState(snap);
+}
+
+void RaceClient::ApplyState(const Received &snap)
+{
+	const size_t stateLen = static_cast<size_t>(stateDelta.GetStateLength());
+	const size_t num = std::max(players.size(), snap.present.size());
+
+	for (size_t i = 0; i < num; i++) {
+		int idx = static_cast<int>(i);
+		bool present = i < snap.present.size() && snap.present[i];
+		const MR_UInt8 *state = present ? &snap.states[i * stateLen] : nullptr;
+
+		if (idx == playerIdx) {
+			if (state) prediction->OnState(snap.simTime, state);
+			continue;
+		}
+
+		if (!state) {
+			RemovePlayer(idx);
+			continue;
+		}
+
+		Player &player = (i < players.size() && players[i].ch) ?
+			players[i] : AddPlayer(idx, false);
+
+		int oldRoom = player.ch->mRoom;
+		player.ch->SetNetState(static_cast<int>(stateLen), state);
+		if (player.ch->mRoom != oldRoom && player.ch->mRoom >= 0) {
+			session->GetCurrentLevel()->MoveElement(player.handle, player.ch->mRoom);
+		}
+	}
+
+	// If we're no longer far enough ahead of the server, our inputs will
+	// soon arrive too late to be used; jump ahead again.
+	if (snap.simTime + leadTime / 2 > session->GetSimulationTime()) {
+		session->SetSimulationTime(snap.simTime + leadTime);
+	}
+}
+
+/**
+ * Add a hovercraft to the session, the same way the server does.
+ * @param idx The player index.
+ * @param local @c true for the local player (simulated from our own input),
+ *              @c false for anyone else (moved by the server's states).
+ * @return The player.
+ */
+RaceClient::Player &RaceClient::AddPlayer(int idx, bool local)
+{
+	MainCharacter::MainCharacter *ch =
+		MainCharacter::MainCharacter::New(idx, gameOpts);
+	if (!ch) {
+		throw Exception("Unable to create hovercraft");
+	}
+
+	Model::Level *level = session->GetCurrentLevel();
+	int start = idx % level->GetPlayerCount();
+
+	ch->mRoom = level->GetStartingRoom(start);
+	ch->mPosition = level->GetStartingPos(start);
+	ch->SetOrientation(level->GetStartingOrientation(start));
+	ch->SetHoverId(idx);
+	ch->SetHoverModel(local ? hoverModel : 0);
+	ch->SetNbLapForRace(laps);
+	if (local) {
+		ch->SetAsMaster();
+	}
+	else {
+		ch->SetAsSlave();
+	}
+	ch->SetSimulationTime(session->GetSimulationTime());
+
+	if (static_cast<size_t>(idx) >= players.size()) {
+		players.resize(static_cast<size_t>(idx) + 1);
+	}
+	Player &player = players[static_cast<size_t>(idx)];
+	player.ch = ch;
+	player.handle = level->InsertElement(ch, ch->mRoom);
+
+	return player;
+}
+
+void RaceClient::RemovePlayer(int idx)
+{
+	if (static_cast<size_t>(idx) >= players.size()) return;
+
+	Player &player = players[static_cast<size_t>(idx)];
+	if (!player.ch) return;
+
+	session->GetCurrentLevel()->DeleteElement(player.handle);
+	player = Player();
+}
+
+}  // namespace Net
+}  // namespace HoverRace
@@ -0,0 +1,173 @@
+
+// RaceClient.h
+// Client for the dedicated race server.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include <chrono>
+
+#include "../Model/Level.h"
+#include "../Util/MR_Types.h"
+#include "RaceProtocol.h"
+#include "StateDelta.h"
+
+#if defined(_WIN32) && defined(HR_ENGINE_SHARED)
+#	ifdef MR_ENGINE
+#		define MR_DllDeclare   __declspec( dllexport )
+#	else
+#		define MR_DllDeclare   __declspec( dllimport )
+#	endif
+#else
+#	define MR_DllDeclare
+#endif
+
+namespace HoverRace {
+	namespace MainCharacter {
+		class MainCharacter;
+	}
+	namespace Model {
+		class GameSession;
+	}
+	namespace Net {
+		class Prediction;
+	}
+}
+
+namespace HoverRace {
+namespace Net {
+
+/**
+ * Connects to a race on the dedicated race server (see RaceProtocol).
+ *
+ * Once the race has started, the local hovercraft is driven through
+ * Prediction: each Step() applies the local input immediately and sends it
+ * to the server, tagged with its slice, and the STATEs that Poll() receives
+ * reconcile the prediction and move everyone else's hovercraft.
+ *
+ * To use it:
+ *  -# Construct the client and call Poll() until the server welcomes
+ *     (IsWelcomed()) or rejects (IsRejected()) it.
+ *  -# Load the race's track (GetTrackName()) into a session and Start().
+ *  -# Call Step() once per slice (GameSession::SIMULATION_SLICE ms of real
+ *     time) instead of stepping the session, and Poll() once per frame.
+ *
+ * Nothing here blocks.  The session must outlive the client.
+ *
+ * @author Michael Imamura
+ */
+class MR_DllDeclare RaceClient
+{
+	typedef std::chrono::steady_clock clock_t;
+	public:
+		/// Default number of slices to run ahead of the server.
+		static const int DEFAULT_LEAD = 8;
+
+	public:
+		RaceClient(const std::string &host, MR_UInt16 port, MR_UInt16 race,
+			int hoverModel, const std::string &name);
+		RaceClient(const RaceClient&) = delete;
+		~RaceClient();
+
+		RaceClient &operator=(const RaceClient&) = delete;
+
+	public:
+		bool IsWelcomed() const { return welcomed; }
+		bool IsRejected() const { return rejected; }
+		const std::string &GetRejectReason() const { return rejectReason; }
+
+		int GetPlayerIdx() const { return playerIdx; }
+		const std::string &GetTrackName() const { return trackName; }
+		int GetLaps() const { return laps; }
+
+		MainCharacter::MainCharacter *GetPlayer() const;
+		const Prediction *GetPrediction() const { return prediction.get(); }
+
+		void Start(Model::GameSession &session, char gameOpts,
+			int lead = DEFAULT_LEAD);
+		void Poll();
+		void Step(MR_UInt32 controls);
+		void Leave();
+
+	private:
+		/// A STATE that was received, kept as a baseline for later ones.
+		struct Received
+		{
+			Received() : seq(0), simTime(0) { }
+
+			MR_UInt32 seq;  ///< STATE sequence number (0 if unused).
+			MR_SimulationTime simTime;
+			std::vector<bool> present;  ///< Indexed by player.
+			std::vector<MR_UInt8> states;  ///< Net state of each player, back-to-back.
+		};
+
+		struct Player
+		{
+			Player() : ch(nullptr), handle(nullptr) { }
+
+			MainCharacter::MainCharacter *ch;  ///< Owned by the level; @c nullptr if absent.
+			MR_FreeElementHandle handle;
+		};
+
+		void Send(const RaceProtocol::Writer &msg);
+		void SendJoin();
+		void OnWelcome(RaceProtocol::Reader &msg);
+		void OnReject(RaceProtocol::Reader &msg);
+		void OnState(RaceProtocol::Reader &msg);
+		void ApplyState(const Received &snap);
+		Player &AddPlayer(int idx, bool local);
+		void RemovePlayer(int idx);
+
+	private:
+		struct Connection;
+		std::unique_ptr<Connection> conn;
+
+		MR_UInt16 race;
+		int hoverModel;
+		std::string name;
+
+		bool welcomed;
+		bool rejected;
+		std::string rejectReason;
+		clock_t::time_point lastJoin;
+
+		int playerIdx;
+		MR_SimulationTime welcomeSimTime;  ///< Server's simulation time in the WELCOME.
+		clock_t::time_point welcomeTime;  ///< When the WELCOME arrived.
+		std::string trackName;
+		int laps;
+
+		Model::GameSession *session;  ///< @c nullptr until Start().
+		char gameOpts;
+		MR_SimulationTime leadTime;  ///< How far to run ahead of the server.
+
+		StateDelta stateDelta;
+		std::vector<Received> history;  ///< Recently-received STATEs, by sequence number.
+		Received incoming;  ///< Scratch space for decoding a STATE.
+		MR_UInt32 lastState;  ///< Last STATE received (0 if none).
+
+		std::vector<Player> players;
+		std::unique_ptr<Prediction> prediction;
+};
+
+}  // namespace Net
+}  // namespace HoverRace
+
+#undef MR_DllDeclare
@@ -0,0 +1,261 @@
+
+// RaceProtocol.h
+// Datagram format for the dedicated race server.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include "../Util/MR_Types.h"
+
+namespace HoverRace {
+namespace Net {
+
+/**
+ * The messages exchanged between a client and the dedicated race server.
+ *
+ * Each UDP datagram holds exactly one message, starting with the message
+ * type.  All integers are little-endian; strings are a one-byte length
+ * followed by UTF-8 bytes.
+ *
+ * | Message | Direction | Body |
+ * |---------|-----------|------|
+ * | JOIN    | C &rarr; S | version u16, race u16, hover model u8, name str |
+ * | INPUT   | C &rarr; S | input sequence u32, slice time u32, controls u32, last state sequence u32 |
+ * | LEAVE   | C &rarr; S | (none) |
+ * | WELCOME | S &rarr; C | player index u8, sim time u32, track str, laps u8, race port u16 |
+ * | REJECT  | S &rarr; C | reason str |
+ * | STATE   | S &rarr; C | state sequence u32, baseline u32, sim time u32, last input sequence u32, count u8, then per player: index u8, state (see StateDelta) |
+ *
+ * Clients send their whole control state with every INPUT (and keep sending
+ * it even if nothing changes), so a lost datagram is simply superseded by
+ * the next one.  Clients run their simulation a little ahead of the server
+ * and send one INPUT per slice, tagged with the simulation time at the
+ * start of the slice.  The server applies each input when it simulates that
+ * slice (or the next one, if it arrives late), and holds the last controls
+ * if there is no input for a slice.  The server ignores inputs that are
+ * older than the last one it received.
+ *
+ * Each STATE is numbered (starting at 1), and clients acknowledge the
+ * latest one they received in every INPUT.  The server encodes each
+ * hovercraft relative to its state in that acknowledged STATE (the
+ * baseline, or 0 if there is none) when the @c STATE_FROM_BASELINE bit is
+ * set in the player index; otherwise, the state is encoded from scratch.
+ * Clients therefore need to keep the last few STATEs they received.  The
+ * sim time is the end of the last slice simulated; the last input sequence
+ * is that of the last input applied to the recipient's own hovercraft.
+ *
+ * A server may host several races behind the same port; the race in the
+ * JOIN selects which one.  The WELCOME (and everything after it) comes from
+ * the race port, which may differ from the port the JOIN was sent to;
+ * clients send every later message to the race port.
+ *
+ * @author Michael Imamura
+ */
+namespace RaceProtocol {
+
+const MR_UInt16 VERSION = 5;
+
+/// Largest datagram either side will send (fits in a typical MTU).
+const size_t MAX_DATAGRAM = 1200;
+
+enum class Msg : MR_UInt8
+{
+	JOIN = 1,
+	INPUT = 2,
+	LEAVE = 3,
+	WELCOME = 16,
+	REJECT = 17,
+	STATE = 18,
+};
+
+/// Flag on a player index in STATE.
+const MR_UInt8 STATE_FROM_BASELINE = 0x80;
+
+/**
+ * Control bits for INPUT.
+ * JUMP, FIRE and CHANGE_ITEM trigger once when the bit is first set; the
+ * rest are held for as long as the bit is set.
+ */
+enum Control : MR_UInt32
+{
+	CTL_ENGINE = 1,
+	CTL_LEFT = 2,
+	CTL_RIGHT = 4,
+	CTL_BRAKE = 8,
+	CTL_LOOK_BACK = 16,
+	CTL_JUMP = 32,
+	CTL_FIRE = 64,
+	CTL_CHANGE_ITEM = 128,
+};
+
+/**
+ * Builds a message into a fixed-size buffer.
+ * Writes that would overflow the buffer are dropped and mark the message
+ * as bad.
+ */
+class Writer
+{
+	public:
+		Writer(Msg msg) : len(0), ok(true) { Write(static_cast<MR_UInt8>(msg)); }
+
+	public:
+		bool IsOk() const { return ok; }
+		const MR_UInt8 *GetData() const { return buf; }
+		size_t GetLength() const { return len; }
+
+		Writer &Write(MR_UInt8 v)
+		{
+			if (Reserve(1)) buf[len++] = v;
+			return *this;
+		}
+
+		Writer &Write(MR_UInt16 v)
+		{
+			if (Reserve(2)) {
+				buf[len++] = static_cast<MR_UInt8>(v);
+				buf[len++] = static_cast<MR_UInt8>(v >> 8);
+			}
+			return *this;
+		}
+
+		Writer &Write(MR_UInt32 v)
+		{
+			if (Reserve(4)) {
+				for (int i = 0; i < 4; i++) {
+					buf[len++] = static_cast<MR_UInt8>(v >> (i * 8));
+				}
+			}
+			return *this;
+		}
+
+		Writer &Write(const std::string &s)
+		{
+			size_t sz = s.length() > 255 ? 255 : s.length();
+			if (Reserve(1 + sz)) {
+				buf[len++] = static_cast<MR_UInt8>(sz);
+				memcpy(buf + len, s.data(), sz);
+				len += sz;
+			}
+			return *this;
+		}
+
+		Writer &Write(const MR_UInt8 *data, size_t sz)
+		{
+			if (Reserve(sz)) {
+				memcpy(buf + len, data, sz);
+				len += sz;
+			}
+			return *this;
+		}
+
+	private:
+		bool Reserve(size_t sz)
+		{
+			if (len + sz > MAX_DATAGRAM) ok = false;
+			return ok;
+		}
+
+	private:
+		MR_UInt8 buf[MAX_DATAGRAM];
+		size_t len;
+		bool ok;
+};
+
+/**
+ * Reads a received message.
+ * Reads past the end of the message return zero and mark the message
+ * as bad, so a whole message can be read and then checked once.
+ */
+class Reader
+{
+	public:
+		Reader(const MR_UInt8 *data, size_t len) :
+			cur(data), end(data + len), ok(true) { }
+
+	public:
+		bool IsOk() const { return ok; }
+		size_t GetRemaining() const { return static_cast<size_t>(end - cur); }
+
+		Msg ReadMsg() { return static_cast<Msg>(ReadUInt8()); }
+
+		MR_UInt8 ReadUInt8()
+		{
+			return Need(1) ? *cur++ : 0;
+		}
+
+		MR_UInt16 ReadUInt16()
+		{
+			if (!Need(2)) return 0;
+			MR_UInt16 retv = static_cast<MR_UInt16>(cur[0] | (cur[1] << 8));
+			cur += 2;
+			return retv;
+		}
+
+		MR_UInt32 ReadUInt32()
+		{
+			if (!Need(4)) return 0;
+			MR_UInt32 retv = 0;
+			for (int i = 3; i >= 0; i--) {
+				retv = (retv << 8) | cur[i];
+			}
+			cur += 4;
+			return retv;
+		}
+
+		std::string ReadString()
+		{
+			size_t sz = ReadUInt8();
+			if (!Need(sz)) return std::string();
+			std::string retv(reinterpret_cast<const char*>(cur), sz);
+			cur += sz;
+			return retv;
+		}
+
+		/**
+		 * Take a block of bytes from the message.
+		 * @param sz The number of bytes.
+		 * @return The bytes (valid as long as the message buffer is),
+		 *         or @c nullptr if the message is too short.
+		 */
+		const MR_UInt8 *ReadBytes(size_t sz)
+		{
+			if (!Need(sz)) return nullptr;
+			const MR_UInt8 *retv = cur;
+			cur += sz;
+			return retv;
+		}
+
+	private:
+		bool Need(size_t sz)
+		{
+			if (ok && GetRemaining() < sz) ok = false;
+			return ok;
+		}
+
+	private:
+		const MR_UInt8 *cur;
+		const MR_UInt8 *end;
+		bool ok;
+};
+
+}  // namespace RaceProtocol
+
+}  // namespace Net
+}  // namespace HoverRace
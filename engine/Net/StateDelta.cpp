@@ -0,0 +1,216 @@
+
+// StateDelta.cpp
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StateDelta.h"
+
+namespace HoverRace {
+namespace Net {
+
+namespace {
+	/// Largest encoded delta (the length is sent as a single byte).
+	const size_t MAX_BITS_LEN = 255;
+
+	MR_UInt32 FieldMask(MR_UInt32 len)
+	{
+		return len >= 32 ? 0xffffffffu : ((1u << len) - 1);
+	}
+
+	MR_Int32 SignExtend(MR_UInt32 value, MR_UInt32 len)
+	{
+		return static_cast<MR_Int32>(value << (32 - len)) >> (32 - len);
+	}
+
+	/// Fields narrower than a byte are always sent whole.
+	MR_UInt32 ShortLen(MR_UInt32 len)
+	{
+		return len >= 8 ? len / 2 : 0;
+	}
+
+	MR_UInt32 GetBits(const MR_UInt8 *data, MR_UInt32 offset, MR_UInt32 len)
+	{
+		// Only touch the bytes that hold the field, since the buffer may
+		// end right after it.
+		MR_UInt64 value = 0;
+		for (MR_UInt32 i = (offset + len - 1) / 8 + 1; i-- > offset / 8; ) {
+			value = (value << 8) | data[i];
+		}
+		return static_cast<MR_UInt32>(value >> (offset % 8)) & FieldMask(len);
+	}
+
+	void SetBits(MR_UInt8 *data, MR_UInt32 offset, MR_UInt32 len, MR_UInt32 value)
+	{
+		for (MR_UInt32 i = 0; i < len; ) {
+			MR_UInt32 bit = offset + i;
+			MR_UInt32 shift = bit % 8;
+			MR_UInt32 n = std::min(8 - shift, len - i);
+			MR_UInt8 mask = static_cast<MR_UInt8>(((1u << n) - 1) << shift);
+
+			MR_UInt8 &dest = data[bit / 8];
+			dest = static_cast<MR_UInt8>((dest & ~mask) | (((value >> i) << shift) & mask));
+
+			i += n;
+		}
+	}
+}
+
+/**
+ * Constructor.
+ * @param fields The fields of the state (must outlive this object).
+ * @param numFields The number of fields.
+ * @param stateLen The length of the state, in bytes.
+ */
+StateDelta::StateDelta(const Util::BitPackField *fields, int numFields,
+	int stateLen) :
+	fields(fields), numFields(numFields), stateLen(stateLen)
+{
+	ASSERT(static_cast<size_t>(numFields * 2 + stateLen * 8) <= MAX_BITS_LEN * 8);
+}
+
+/**
+ * Encode a state.
+ * @param msg The message to append to.
+ * @param base The state that the receiver already has, or @c nullptr to
+ *             encode the whole state.
+ * @param cur The state to send.
+ */
+void StateDelta::Write(RaceProtocol::Writer &msg,
+	const MR_UInt8 *base, const MR_UInt8 *cur) const
+{
+	MR_UInt8 bits[MAX_BITS_LEN] = { 0 };
+	MR_UInt32 pos = static_cast<MR_UInt32>(numFields);
+
+	for (int i = 0; i < numFields; i++) {
+		const Util::BitPackField &field = fields[i];
+
+		MR_UInt32 oldValue = base ? GetBits(base, field.offset, field.len) : 0;
+		MR_UInt32 newValue = GetBits(cur, field.offset, field.len);
+		if (oldValue == newValue) continue;
+
+		SetBits(bits, static_cast<MR_UInt32>(i), 1, 1);
+
+		MR_UInt32 shortLen = ShortLen(field.len);
+		MR_Int32 diff = SignExtend((newValue - oldValue) & FieldMask(field.len), field.len);
+		if (shortLen > 0 &&
+			diff >= -(1 << (shortLen - 1)) && diff < (1 << (shortLen - 1)))
+		{
+			SetBits(bits, pos++, 1, 1);
+			SetBits(bits, pos, shortLen, static_cast<MR_UInt32>(diff));
+			pos += shortLen;
+		}
+		else {
+			SetBits(bits, pos++, 1, 0);
+			SetBits(bits, pos, field.len, newValue);
+			pos += field.len;
+		}
+	}
+
+	size_t len = (pos + 7) / 8;
+	msg.Write(static_cast<MR_UInt8>(len));
+	msg.Write(bits, len);
+}
+
+/**
+ * Decode a state.
+ * @param msg The message to read from.
+ * @param base The state that the sender encoded against, or @c nullptr if
+ *             the whole state was sent.
+ * @param[out] out The decoded state.
+ * @return @c true if successful, @c false if the encoding is invalid.
+ */
+bool StateDelta::Read(RaceProtocol::Reader &msg,
+	const MR_UInt8 *base, MR_UInt8 *out) const
+{
+	size_t len = msg.ReadUInt8();
+	const MR_UInt8 *bits = msg.ReadBytes(len);
+	if (!bits) return false;
+
+	MR_UInt32 avail = static_cast<MR_UInt32>(len * 8);
+	MR_UInt32 pos = static_cast<MR_UInt32>(numFields);
+	if (pos > avail) return false;
+
+	if (base) {
+		memcpy(out, base, stateLen);
+	}
+	else {
+		memset(out, 0, stateLen);
+	}
+
+	for (int i = 0; i < numFields; i++) {
+		if (!GetBits(bits, static_cast<MR_UInt32>(i), 1)) continue;
+
+		const Util::BitPackField &field = fields[i];
+
+		if (pos + 1 > avail) return false;
+		bool isDiff = GetBits(bits, pos++, 1) != 0;
+
+		MR_UInt32 value;
+		if (isDiff) {
+			MR_UInt32 shortLen = ShortLen(field.len);
+			if (shortLen == 0 || pos + shortLen > avail) return false;
+
+			MR_Int32 diff = SignExtend(GetBits(bits, pos, shortLen), shortLen);
+			pos += shortLen;
+
+			MR_UInt32 oldValue = base ? GetBits(base, field.offset, field.len) : 0;
+			value = (oldValue + static_cast<MR_UInt32>(diff)) & FieldMask(field.len);
+		}
+		else {
+			if (pos + field.len > avail) return false;
+			value = GetBits(bits, pos, field.len);
+			pos += field.len;
+		}
+
+		SetBits(out, field.offset, field.len, value);
+	}
+
+	return true;
+}
+
+/**
+ * Compare two states field by field.
+ * Fields are compared as packed; differences wrap around the width of the
+ * field, so angles that wrap are still close.
+ * @param a The first state.
+ * @param b The second state.
+ * @param tolerance For each field, the largest difference to accept
+ *                  (zero for an exact match).
+ * @return @c true if every field is within its tolerance.
+ */
+bool StateDelta::IsClose(const MR_UInt8 *a, const MR_UInt8 *b,
+	const MR_UInt32 *tolerance) const
+{
+	for (int i = 0; i < numFields; i++) {
+		const Util::BitPackField &field = fields[i];
+
+		MR_UInt32 aValue = GetBits(a, field.offset, field.len);
+		MR_UInt32 bValue = GetBits(b, field.offset, field.len);
+		if (aValue == bValue) continue;
+
+		MR_Int32 diff = SignExtend((aValue - bValue) & FieldMask(field.len), field.len);
+		MR_UInt32 absDiff = diff < 0 ?
+			0u - static_cast<MR_UInt32>(diff) : static_cast<MR_UInt32>(diff);
+		if (absDiff > tolerance[i]) return false;
+	}
+	return true;
+}
+
+}  // namespace Net
+}  // namespace HoverRace
@@ -0,0 +1,83 @@
+
+// StateDelta.h
+// Delta compression of element net states.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include "../Util/BitPacking.h"
+#include "RaceProtocol.h"
+
+#if defined(_WIN32) && defined(HR_ENGINE_SHARED)
+#	ifdef MR_ENGINE
+#		define MR_DllDeclare   __declspec( dllexport )
+#	else
+#		define MR_DllDeclare   __declspec( dllimport )
+#	endif
+#else
+#	define MR_DllDeclare
+#endif
+
+namespace HoverRace {
+namespace Net {
+
+/**
+ * Encodes an element's net state relative to an earlier state that the
+ * receiver already has.
+ *
+ * The net state is treated as a set of bit fields (already quantized by
+ * the element's own packing).  Only the fields that changed are sent,
+ * preceded by a mask of which ones they are; numeric fields that only
+ * moved a little are sent as a difference at half their width.
+ *
+ * The encoding is a length byte followed by a bit stream:
+ *  - one bit per field, set if the field changed;
+ *  - for each changed field, one bit which is set if the field is sent as
+ *    a difference, followed by the difference or the new value.
+ *
+ * @author Michael Imamura
+ */
+class MR_DllDeclare StateDelta
+{
+	public:
+		StateDelta(const Util::BitPackField *fields, int numFields,
+			int stateLen);
+
+	public:
+		int GetStateLength() const { return stateLen; }
+
+		void Write(RaceProtocol::Writer &msg,
+			const MR_UInt8 *base, const MR_UInt8 *cur) const;
+		bool Read(RaceProtocol::Reader &msg,
+			const MR_UInt8 *base, MR_UInt8 *out) const;
+
+		bool IsClose(const MR_UInt8 *a, const MR_UInt8 *b,
+			const MR_UInt32 *tolerance) const;
+
+	private:
+		const Util::BitPackField *fields;
+		int numFields;
+		int stateLen;
+};
+
+}  // namespace Net
+}  // namespace HoverRace
+
+#undef MR_DllDeclare
@@ -78,22 +78,25 @@ void HoverRender::Render(VideoServices::Viewport3D *pDest, const MR_3DCoordinate
 
 	if(pDest->ComputePositionMatrix(lMatrix, pPosition, pOrientation, 1000 /* TODO Object ray must be precomputed at compilation */ )) {
 		int lSeq = pMotorOn ? 1 : 0;
+		int lFrame;
 
+		// Viewports may be rendered concurrently, so keep our own copy
+		// of the frame.
 		if(pMotorOn) {
-			mFrame = (mFrame + 1) % 2;
+			lFrame = (mFrame ^= 1);
 		}
 		else {
-			mFrame = 0;
+			lFrame = mFrame = 0;
 		}
 
 		if(pModel == 1) {
-			ResActorFriend::Draw(mActor1, pDest, lMatrix, lSeq, mFrame, mCockpitBitmap2[pHoverId % 10]);
+			ResActorFriend::Draw(mActor1, pDest, lMatrix, lSeq, lFrame, mCockpitBitmap2[pHoverId % 10]);
 		} else if(pModel == 2) {
-			ResActorFriend::Draw(mActor2, pDest, lMatrix, lSeq, mFrame, mCockpitBitmap[pHoverId % 10]);
+			ResActorFriend::Draw(mActor2, pDest, lMatrix, lSeq, lFrame, mCockpitBitmap[pHoverId % 10]);
 		} else if(pModel == 3) {
-			ResActorFriend::Draw(mActor3, pDest, lMatrix, lSeq, mFrame, mEonCockpitBitmap[pHoverId % 10]);
+			ResActorFriend::Draw(mActor3, pDest, lMatrix, lSeq, lFrame, mEonCockpitBitmap[pHoverId % 10]);
 		} else {
-			ResActorFriend::Draw(mActor0, pDest, lMatrix, lSeq, mFrame, mCockpitBitmap[pHoverId % 10]);
+			ResActorFriend::Draw(mActor0, pDest, lMatrix, lSeq, lFrame, mCockpitBitmap[pHoverId % 10]);
 		}
 	}
 }
@@ -23,6 +23,8 @@
 
 #pragma once
 
+#include <atomic>
+
 #include "../ObjFacTools/FreeElementBase.h"
 #include "../MainCharacter/MainCharacterRenderer.h"
 
@@ -38,7 +40,7 @@ class HoverRender : public MainCharacter::MainCharacterRenderer
 		const ObjFacTools::ResActor *mActor2;
 		const ObjFacTools::ResActor *mActor3;
 
-		int mFrame;
+		std::atomic<int> mFrame;				  // Shared by every craft and viewport
 
 		VideoServices::ShortSound *mLineCrossingSound;
 		VideoServices::ShortSound *mStartSound;
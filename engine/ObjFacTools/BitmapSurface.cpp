@@ -29,6 +29,39 @@ static BOOL gLocalInitialized = FALSE;
 static MR_PhysicalCollision gEffect;
 static MR_ContactEffectList gEffectList;
 
+namespace {
+
+// Presents a bitmap with a different size without touching the original,
+// which may be drawn concurrently by other viewports.
+class StretchedBitmap : public VideoServices::Bitmap
+{
+	private:
+		const VideoServices::Bitmap *mBitmap;
+		int mWidth;
+		int mHeight;
+
+	public:
+		StretchedBitmap(const VideoServices::Bitmap * pBitmap, int pWidth, int pHeight) :
+			mBitmap(pBitmap), mWidth(pWidth), mHeight(pHeight) { }
+
+		int GetWidth() const { return mWidth; }
+		int GetHeight() const { return mHeight; }
+		int GetMaxXRes() const { return mBitmap->GetMaxXRes(); }
+		int GetMaxYRes() const { return mBitmap->GetMaxYRes(); }
+		MR_UInt8 GetPlainColor() const { return mBitmap->GetPlainColor(); }
+
+		int GetNbSubBitmap() const { return mBitmap->GetNbSubBitmap(); }
+		int GetXRes(int pSubBitmap) const { return mBitmap->GetXRes(pSubBitmap); }
+		int GetYRes(int pSubBitmap) const { return mBitmap->GetYRes(pSubBitmap); }
+		int GetXResShiftFactor(int pSubBitmap) const { return mBitmap->GetXResShiftFactor(pSubBitmap); }
+		int GetYResShiftFactor(int pSubBitmap) const { return mBitmap->GetYResShiftFactor(pSubBitmap); }
+		MR_UInt8 *GetBuffer(int pSubBitmap) const { return mBitmap->GetBuffer(pSubBitmap); }
+		MR_UInt8 *GetColumnBuffer(int pSubBitmap, int pColumn) const { return mBitmap->GetColumnBuffer(pSubBitmap, pColumn); }
+		MR_UInt8 **GetColumnBufferTable(int pSubBitmap) const { return mBitmap->GetColumnBufferTable(pSubBitmap); }
+};
+
+}  // namespace
+
 BitmapSurface::BitmapSurface(const Util::ObjectFromFactoryId & pId) :
 	Model::SurfaceElement(pId)
 {
@@ -98,21 +131,30 @@ BitmapSurface::~BitmapSurface()
 void BitmapSurface::RenderWallSurface(VideoServices::Viewport3D * pDest, const MR_3DCoordinate & pUpperLeft, const MR_3DCoordinate & pLowerRight, MR_Int32 pLen, MR_SimulationTime pTime)
 {
 	if(mBitmap != NULL) {
-		if(mRotationSpeed != 0) {
-			int lStartPos = (pTime + 40000) / mRotationSpeed;
+		RenderWallBitmap(pDest, pUpperLeft, pLowerRight, pLen, pTime, mBitmap);
+	}
+}
 
-			if(lStartPos < 0) {
-				lStartPos = mRotationLen - 1 - ((-lStartPos) % mRotationLen);
-			}
-			else {
-				lStartPos = (lStartPos) % mRotationLen;
-			}
-			pDest->RenderAlternateWallSurface(pUpperLeft, pLowerRight, pLen, mBitmap, mBitmap2, mRotationLen, lStartPos);
+/**
+ * Draw the wall with a replacement for the main bitmap (mBitmap).
+ * The alternate bitmap (mBitmap2), if any, is used as-is.
+ */
+void BitmapSurface::RenderWallBitmap(VideoServices::Viewport3D * pDest, const MR_3DCoordinate & pUpperLeft, const MR_3DCoordinate & pLowerRight, MR_Int32 pLen, MR_SimulationTime pTime, const VideoServices::Bitmap * pBitmap)
+{
+	if(mRotationSpeed != 0) {
+		int lStartPos = (pTime + 40000) / mRotationSpeed;
 
+		if(lStartPos < 0) {
+			lStartPos = mRotationLen - 1 - ((-lStartPos) % mRotationLen);
 		}
 		else {
-			pDest->RenderWallSurface(pUpperLeft, pLowerRight, pLen, mBitmap);
+			lStartPos = (lStartPos) % mRotationLen;
 		}
+		pDest->RenderAlternateWallSurface(pUpperLeft, pLowerRight, pLen, pBitmap, mBitmap2, mRotationLen, lStartPos);
+
+	}
+	else {
+		pDest->RenderWallSurface(pUpperLeft, pLowerRight, pLen, pBitmap);
 	}
 }
 
@@ -154,9 +196,9 @@ void VStretchBitmapSurface::RenderWallSurface(VideoServices::Viewport3D * pDest,
 				lHeight = lHeight / lDivisor;
 			}
 
-			mBitmap->SetWidthHeight(lHeight, lHeight);
+			StretchedBitmap lBitmap(mBitmap, lHeight, lHeight);
 
-			BitmapSurface::RenderWallSurface(pDest, pUpperLeft, pLowerRight, pLen, pTime);
+			RenderWallBitmap(pDest, pUpperLeft, pLowerRight, pLen, pTime, &lBitmap);
 		}
 	}
 }
@@ -53,6 +53,8 @@ class MR_DllDeclare BitmapSurface : public Model::SurfaceElement
 		int mRotationSpeed;						  // negative values mean left to right rotation
 		int mRotationLen;
 
+		void RenderWallBitmap(VideoServices::Viewport3D * pDest, const MR_3DCoordinate & pUpperLeft, const MR_3DCoordinate & pLowerRight, MR_Int32 pLen, MR_SimulationTime pTime, const VideoServices::Bitmap * pBitmap);
+
 	public:
 												  // old constructor..obsolete
 		BitmapSurface(const Util::ObjectFromFactoryId & pId);
@@ -20,6 +20,7 @@
 //
 
 #include "../Parcel/ObjStream.h"
+#include "../Parcel/SpanReader.h"
 
 #include "ResBitmap.h"
 
@@ -171,7 +172,9 @@ ResBitmap::SubBitmap::SubBitmap()
 
 ResBitmap::SubBitmap::~SubBitmap()
 {
-	delete[] mBuffer;
+	if(!mBufferOwner) {
+		delete[] mBuffer;
+	}
 	delete[] mColumnPtr;
 }
 
@@ -188,7 +191,10 @@ void ResBitmap::SubBitmap::Serialize(Parcel::ObjStream &pArchive)
 		pArchive.Write(mBuffer, mXRes * mYRes);
 	}
 	else {
-		delete[] mBuffer;
+		if(!mBufferOwner) {
+			delete[] mBuffer;
+		}
+		mBufferOwner.reset();
 		delete[] mColumnPtr;
 
 		pArchive >> mXRes;
@@ -197,7 +203,17 @@ void ResBitmap::SubBitmap::Serialize(Parcel::ObjStream &pArchive)
 		pArchive >> mYResShiftFactor;
 		pArchive >> mHaveTransparent;
 
-		mBuffer = new MR_UInt8[mXRes * mYRes];
+		Parcel::SpanReader *lSpan = pArchive.GetSpanReader();
+		if(lSpan != NULL && lSpan->GetOwner()) {
+			// Use the pixels in place (the memory is copy-on-write).
+			mBuffer = const_cast<MR_UInt8 *>(lSpan->Take(mXRes * mYRes));
+			mBufferOwner = lSpan->GetOwner();
+		}
+		else {
+			mBuffer = new MR_UInt8[mXRes * mYRes];
+			pArchive.Read(mBuffer, mXRes * mYRes);
+		}
+
 		mColumnPtr = new MR_UInt8 *[mXRes];
 
 		MR_UInt8 *lPtr = mBuffer;
@@ -206,7 +222,6 @@ void ResBitmap::SubBitmap::Serialize(Parcel::ObjStream &pArchive)
 			mColumnPtr[lCounter] = lPtr;
 			lPtr += mYRes;
 		}
-		pArchive.Read(mBuffer, mXRes * mYRes);
 	}
 }
 
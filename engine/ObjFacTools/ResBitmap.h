@@ -58,6 +58,7 @@ class ResBitmap : public VideoServices::Bitmap
 
 				MR_UInt8 *mBuffer;
 				MR_UInt8 **mColumnPtr;
+				std::shared_ptr<const void> mBufferOwner;  // If set, mBuffer points into memory owned by this
 
 				MR_DllDeclare SubBitmap();
 				MR_DllDeclare ~ SubBitmap();
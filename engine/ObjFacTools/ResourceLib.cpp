@@ -19,8 +19,9 @@
 // See the License for the specific language governing permissions
 // and limitations under the License.
 
-#include "../Parcel/ClassicRecordFile.h"
+#include "../Parcel/MappedRecordFile.h"
 #include "../Parcel/ObjStream.h"
+#include "../Parcel/SpanReader.h"
 
 #include "ResourceLib.h"
 
@@ -42,55 +43,143 @@ namespace {
 		val->Serialize(os, self);
 	}
 
-	template<class T>
-	void LoadRes(ObjStream &os, std::map<int, T*> &res, ResourceLib *self)
+	// The skip functions must match the corresponding Serialize().
+
+	size_t ReadSize(SpanReader &span)
+	{
+		MR_Int32 val;
+		span.Read(val);
+		if (val < 0) {
+			throw ObjStreamExn("Negative size in resource");
+		}
+		return static_cast<size_t>(val);
+	}
+
+	/// Skip a ResBitmap.
+	void SkipBitmap(SpanReader &span)
+	{
+		span.Skip(4 * 4);  // Width, height, X res, Y res.
+		size_t subBitmapCount = ReadSize(span);
+		span.Skip(1);  // Plain color.
+
+		for (size_t i = 0; i < subBitmapCount; ++i) {
+			size_t xRes = ReadSize(span);
+			size_t yRes = ReadSize(span);
+			span.Skip(3 * 4);  // Shift factors, transparency flag.
+			span.Skip(xRes * yRes);
+		}
+	}
+
+	/// Skip a ResActor.
+	void SkipActor(SpanReader &span)
+	{
+		size_t numSequences = ReadSize(span);
+		for (size_t seq = 0; seq < numSequences; ++seq) {
+			size_t numFrames = ReadSize(span);
+			for (size_t frame = 0; frame < numFrames; ++frame) {
+				size_t numComponents = ReadSize(span);
+				for (size_t comp = 0; comp < numComponents; ++comp) {
+					MR_Int32 type;
+					span.Read(type);
+					if (type != ResActor::ePatch) {
+						throw ObjStreamExn(boost::str(boost::format("%s: %d") %
+							_("Unhandled component type") % type));
+					}
+
+					size_t uRes = ReadSize(span);
+					size_t vRes = ReadSize(span);
+					span.Skip(4);  // Bitmap ID.
+					span.Skip(uRes * vRes * 3 * 4);  // Vertices.
+				}
+			}
+		}
+	}
+
+	/// Skip a ResSprite.
+	void SkipSprite(SpanReader &span)
+	{
+		span.Skip(2 * 4);  // Item count, item height.
+		size_t totalHeight = ReadSize(span);
+		size_t width = ReadSize(span);
+		span.Skip(width * totalHeight);
+	}
+
+	/// Skip a ResShortSound or ResContinuousSound.
+	void SkipSound(SpanReader &span)
+	{
+		span.Skip(4);  // Copy count.
+		span.Skip(ReadSize(span));
+	}
+
+	/**
+	 * Build the directory for one type of resource.
+	 * @param span The stream, positioned at the start of the section.
+	 * @param recordSize The total size of the record.
+	 * @param dir The directory to fill in.
+	 * @param skip Function to skip over a single resource.
+	 */
+	void IndexRes(SpanReader &span, size_t recordSize,
+		ResourceLib::dir_t &dir, void (*skip)(SpanReader&))
 	{
 		MR_UInt32 num;
-		os >> num;
+		span.Read(num);
 		for (MR_UInt32 i = 0; i < num; ++i) {
 			MR_Int32 key;
-			os >> key;
+			span.Read(key);
 
-			T *val = new T(key);
-			NewRes(val, os, self);
+			dir.insert(ResourceLib::dir_t::value_type(
+				key, recordSize - span.GetRemaining()));
 
-			res.insert(typename std::map<int, T*>::value_type(key, val));
+			skip(span);
 		}
 	}
 }
 
 /**
  * Constructor.
+ *
+ * Only the directory of resources is read here; each resource is decoded
+ * the first time it is requested.
+ *
  * @param filename The resource data file.
  */
 ResourceLib::ResourceLib(const Util::OS::path_t &filename)
 {
-	recordFile = new ClassicRecordFile();
+	recordFile = new MappedRecordFile();
 
 	if (!recordFile->OpenForRead(filename)) {
+		delete recordFile;
 		throw ObjStreamExn(filename, "File not found or not readable");
 	}
 
 	recordFile->SelectRecord(0);
 
 	ObjStreamPtr osPtr(recordFile->StreamIn());
-	ObjStream &os = *osPtr;
+	SpanReader &span = *osPtr->GetSpanReader();
+	const size_t recordSize = span.GetRemaining();
 
 	const MR_UInt32 expectedMagic = FILE_MAGIC;
 	MR_UInt32 magic;
-	os >> magic;
+	span.Read(magic);
 	if (magic != expectedMagic) {
+		delete recordFile;
 		throw ObjStreamExn(filename,
 			boost::str(boost::format(
 				"Invalid magic number: Expected %08x, got %08x") %
 				expectedMagic % magic));
 	}
 
-	LoadRes(os, bitmaps, this);
-	LoadRes(os, actors, this);
-	LoadRes(os, sprites, this);
-	LoadRes(os, shortSounds, this);
-	LoadRes(os, continuousSounds, this);
+	try {
+		IndexRes(span, recordSize, bitmapDir, SkipBitmap);
+		IndexRes(span, recordSize, actorDir, SkipActor);
+		IndexRes(span, recordSize, spriteDir, SkipSprite);
+		IndexRes(span, recordSize, shortSoundDir, SkipSound);
+		IndexRes(span, recordSize, continuousSoundDir, SkipSound);
+	}
+	catch (ObjStreamExn &ex) {
+		delete recordFile;
+		throw ObjStreamExn(filename, ex.what());
+	}
 }
 
 ResourceLib::~ResourceLib()
@@ -104,34 +193,64 @@ ResourceLib::~ResourceLib()
 	delete recordFile;
 }
 
+/**
+ * Retrieve a resource, decoding it if necessary.
+ * @param id The resource ID.
+ * @param res The decoded resources.
+ * @param dir The directory of resources that may be decoded.
+ * @return The resource, or @c NULL if it does not exist.
+ */
+template<class T>
+T *ResourceLib::FindRes(int id, std::map<int, T*> &res, const dir_t &dir)
+{
+	std::lock_guard<std::recursive_mutex> lock(mutex);
+
+	auto iter = res.find(id);
+	if (iter != res.end()) return iter->second;
+
+	auto dirIter = dir.find(id);
+	if (dirIter == dir.end()) return NULL;
+
+	recordFile->SelectRecord(0);
+	ObjStreamPtr osPtr(recordFile->StreamIn());
+	osPtr->GetSpanReader()->Skip(dirIter->second);
+
+	T *val = new T(id);
+	try {
+		NewRes(val, *osPtr, this);
+	}
+	catch (...) {
+		delete val;
+		throw;
+	}
+
+	res.insert(typename std::map<int, T*>::value_type(id, val));
+	return val;
+}
+
 ResBitmap *ResourceLib::GetBitmap(int id)
 {
-	bitmaps_t::const_iterator iter = bitmaps.find(id);
-	return (iter == bitmaps.end()) ? NULL : iter->second;
+	return FindRes(id, bitmaps, bitmapDir);
 }
 
 const ResActor *ResourceLib::GetActor(int id)
 {
-	actors_t::const_iterator iter = actors.find(id);
-	return (iter == actors.end()) ? NULL : iter->second;
+	return FindRes(id, actors, actorDir);
 }
 
 const ResSprite *ResourceLib::GetSprite(int id)
 {
-	sprites_t::const_iterator iter = sprites.find(id);
-	return (iter == sprites.end()) ? NULL : iter->second;
+	return FindRes(id, sprites, spriteDir);
 }
 
 const ResShortSound *ResourceLib::GetShortSound(int id)
 {
-	shortSounds_t::const_iterator iter = shortSounds.find(id);
-	return (iter == shortSounds.end()) ? NULL : iter->second;
+	return FindRes(id, shortSounds, shortSoundDir);
 }
 
 const ResContinuousSound *ResourceLib::GetContinuousSound(int id)
 {
-	continuousSounds_t::const_iterator iter = continuousSounds.find(id);
-	return (iter == continuousSounds.end()) ? NULL : iter->second;
+	return FindRes(id, continuousSounds, continuousSoundDir);
 }
 
 }  // namespace HoverRace
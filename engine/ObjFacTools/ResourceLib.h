@@ -22,6 +22,7 @@
 #pragma once
 
 #include <map>
+#include <mutex>
 
 #include "../Util/OS.h"
 #include "ResActor.h"
@@ -50,12 +51,17 @@ namespace ObjFacTools {
 
 /**
  * Loadable resource manager.
+ *
+ * Resources are decoded on demand, the first time they are requested, and
+ * then kept for the lifetime of the library.  Resources may be requested
+ * from any thread.
+ *
  * @author Michael Imamura
  */
 class MR_DllDeclare ResourceLib
 {
 	protected:
-		ResourceLib() { }
+		ResourceLib() : recordFile(NULL) { }
 	public:
 		ResourceLib(const Util::OS::path_t &filename);
 		~ResourceLib();
@@ -67,8 +73,25 @@ class MR_DllDeclare ResourceLib
 		const ResShortSound *GetShortSound(int id);
 		const ResContinuousSound *GetContinuousSound(int id);
 
+	public:
+		/// Map of resource ID to the offset in the resource record.
+		typedef std::map<int, size_t> dir_t;
+
+	private:
+		template<class T>
+		T *FindRes(int id, std::map<int, T*> &res, const dir_t &dir);
+
 	protected:
 		Parcel::RecordFile *recordFile;
+		std::recursive_mutex mutex;
+
+		dir_t bitmapDir;
+		dir_t actorDir;
+		dir_t spriteDir;
+		dir_t shortSoundDir;
+		dir_t continuousSoundDir;
+
+		// Decoded resources.
 
 		typedef std::map<int, ResBitmap*> bitmaps_t;
 		bitmaps_t bitmaps;
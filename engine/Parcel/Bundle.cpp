@@ -22,6 +22,7 @@
 
 #include "../Util/Str.h"
 #include "ClassicRecordFile.h"
+#include "MappedRecordFile.h"
 
 #include "Bundle.h"
 
@@ -56,11 +57,13 @@ RecordFilePtr Bundle::OpenParcel(const std::string &name, bool writing) const
 	OS::path_t pt = dir / Str::UP(name.c_str());
 
 	if (fs::exists(pt)) {
-		RecordFile *rec = new ClassicRecordFile();
+		RecordFile *rec;
 		if (writing) {
+			rec = new ClassicRecordFile();
 			rec->OpenForWrite(pt);
 		}
 		else {
+			rec = new MappedRecordFile();
 			rec->OpenForRead(pt);
 		}
 		return RecordFilePtr(rec);
@@ -0,0 +1,100 @@
+
+// MappedObjStream.cpp
+// Read-only parcel data stream over a block of memory.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "../Util/Log.h"
+#include "../Exception.h"
+
+#include "MappedObjStream.h"
+
+namespace HoverRace {
+namespace Parcel {
+
+namespace {
+const size_t MAX_STRING_LEN = 16 * 1024;  ///< Maximum length of a string.
+}
+
+/**
+ * Constructor.
+ * @param name The name of the stream (for error messages).
+ * @param begin The start of the data.
+ * @param end The end of the data.
+ * @param owner Keeps the memory alive (may be @c nullptr if the memory is
+ *              guaranteed to outlive the stream and everything read from it).
+ */
+MappedObjStream::MappedObjStream(const Util::OS::path_t &name,
+	const MR_UInt8 *begin, const MR_UInt8 *end,
+	std::shared_ptr<const void> owner) :
+	SUPER(name, 1, false),
+	span(GetName(), begin, end, std::move(owner))
+{
+	// Version for classic record file is currently always 1.
+}
+
+void MappedObjStream::ReadOnly()
+{
+	throw ObjStreamExn(GetName(), "Stream is read-only");
+}
+
+void MappedObjStream::ReadString(std::string &s)
+{
+	MR_UInt32 len = ReadStringLength();
+	MR_UInt32 remaining = 0;
+	if (len > MAX_STRING_LEN) {
+		HR_LOG(warning) << "String length (" << len << ") exceeds max (" <<
+			MAX_STRING_LEN << "); truncatng.";
+		remaining = len - static_cast<MR_Int32>(MAX_STRING_LEN);
+		len = MAX_STRING_LEN;
+	}
+
+	s.assign(reinterpret_cast<const char*>(span.Take(len)), len);
+
+	// Skip excess.
+	if (remaining > 0) {
+		span.Skip(remaining);
+	}
+}
+
+MR_UInt32 MappedObjStream::ReadStringLength()
+{
+	MR_UInt8 b;
+	span.Read(b);
+	if (b < 0xff) return b;
+
+	MR_UInt16 w;
+	span.Read(w);
+	if (w == 0xfffe) {
+		// Unicode (length follows).
+		ASSERT(FALSE);
+		throw UnimplementedExn("MappedObjStream::ReadStringLength for unicode strings");
+	}
+	else if (w == 0xffff) {
+		MR_UInt32 dw;
+		span.Read(dw);
+		return dw;
+	}
+	else {
+		return w;
+	}
+}
+
+}  // namespace Parcel
+}  // namespace HoverRace
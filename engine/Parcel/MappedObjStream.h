@@ -0,0 +1,101 @@
+
+// MappedObjStream.h
+// Read-only parcel data stream over a block of memory.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include "ObjStream.h"
+#include "SpanReader.h"
+
+#if defined(_WIN32) && defined(HR_ENGINE_SHARED)
+#	ifdef MR_ENGINE
+#		define MR_DllDeclare   __declspec( dllexport )
+#	else
+#		define MR_DllDeclare   __declspec( dllimport )
+#	endif
+#else
+#	define MR_DllDeclare
+#endif
+
+namespace HoverRace {
+namespace Parcel {
+
+/**
+ * Read-only parcel data stream over a block of memory.
+ *
+ * The data format is the same as ClassicObjStream, but reads are served
+ * straight from memory (usually a memory-mapped MappedRecordFile) instead
+ * of going through stdio for each field.
+ *
+ * @author Michael Imamura
+ */
+class MR_DllDeclare MappedObjStream : public ObjStream
+{
+	typedef ObjStream SUPER;
+	public:
+		MappedObjStream(const Util::OS::path_t &name,
+			const MR_UInt8 *begin, const MR_UInt8 *end,
+			std::shared_ptr<const void> owner);
+		virtual ~MappedObjStream() { }
+
+	public:
+		SpanReader *GetSpanReader() override { return &span; }
+
+	private:
+		void ReadOnly();
+
+	public:
+		void Write(const void*, size_t) override { ReadOnly(); }
+
+		void WriteUInt8(MR_UInt8) override { ReadOnly(); }
+		void WriteInt16(MR_Int16) override { ReadOnly(); }
+		void WriteUInt16(MR_UInt16) override { ReadOnly(); }
+		void WriteInt32(MR_Int32) override { ReadOnly(); }
+		void WriteUInt32(MR_UInt32) override { ReadOnly(); }
+		void WriteString(const std::string&) override { ReadOnly(); }
+#		if defined(_WIN32) && !defined(WITH_OBJSTREAM)
+			void WriteCString(const CString&) override { ReadOnly(); }
+#		endif
+
+	public:
+		void Read(void *buf, size_t ct) override { span.Read(buf, ct); }
+
+		void ReadUInt8(MR_UInt8 &i) override { span.Read(i); }
+		void ReadInt16(MR_Int16 &i) override { span.Read(i); }
+		void ReadUInt16(MR_UInt16 &i) override { span.Read(i); }
+		void ReadInt32(MR_Int32 &i) override { span.Read(i); }
+		void ReadUInt32(MR_UInt32 &i) override { span.Read(i); }
+		void ReadString(std::string &s) override;
+#		if defined(_WIN32) && !defined(WITH_OBJSTREAM)
+			void ReadCString(CString &s) override { std::string ss; ReadString(ss); s = ss.c_str(); }
+#		endif
+
+	private:
+		MR_UInt32 ReadStringLength();
+
+	private:
+		SpanReader span;
+};
+
+}  // namespace Parcel
+}  // namespace HoverRace
+
+#undef MR_DllDeclare
@@ -0,0 +1,278 @@
+
+// MappedRecordFile.cpp
+// Read-only, memory-mapped HoverRace 1.x parcel.
+//
+// Copyright (c) 2015 Michael Imamura.
+// Copyright (c) 2010, 2012 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
+
+#include "../Util/InspectMapNode.h"
+#include "../Util/Log.h"
+#include "MappedObjStream.h"
+
+#include "MappedRecordFile.h"
+
+using namespace HoverRace::Util;
+
+namespace HoverRace {
+namespace Parcel {
+
+/**
+ * A read-only, copy-on-write view of an entire file.
+ */
+class MappedRecordFile::Mapping
+{
+	public:
+		Mapping(const OS::path_t &filename);
+		~Mapping();
+
+	public:
+		bool IsValid() const { return base != nullptr; }
+		const MR_UInt8 *GetData() const { return base; }
+		size_t GetSize() const { return size; }
+
+	private:
+		MR_UInt8 *base;
+		size_t size;
+};
+
+MappedRecordFile::Mapping::Mapping(const OS::path_t &filename) :
+	base(nullptr), size(0)
+{
+#	ifdef _WIN32
+		HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ,
+			FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+			FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+			CloseHandle(file);
+			return;
+		}
+
+		HANDLE fileMapping = CreateFileMappingW(file, nullptr, PAGE_WRITECOPY,
+			0, 0, nullptr);
+		CloseHandle(file);
+		if (!fileMapping) return;
+
+		// The view keeps the mapping object alive.
+		void *view = MapViewOfFile(fileMapping, FILE_MAP_COPY, 0, 0, 0);
+		CloseHandle(fileMapping);
+		if (!view) return;
+
+		base = static_cast<MR_UInt8*>(view);
+		size = static_cast<size_t>(fileSize.QuadPart);
+#	else
+		int fd = open(filename.c_str(), O_RDONLY);
+		if (fd < 0) return;
+
+		struct stat st;
+		if (fstat(fd, &st) < 0 || st.st_size == 0) {
+			close(fd);
+			return;
+		}
+
+		void *view = mmap(nullptr, static_cast<size_t>(st.st_size),
+			PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+		close(fd);
+		if (view == MAP_FAILED) return;
+
+		base = static_cast<MR_UInt8*>(view);
+		size = static_cast<size_t>(st.st_size);
+#	endif
+}
+
+MappedRecordFile::Mapping::~Mapping()
+{
+	if (base) {
+#		ifdef _WIN32
+			UnmapViewOfFile(base);
+#		else
+			munmap(base, size);
+#		endif
+	}
+}
+
+// MappedRecordFile
+
+MappedRecordFile::MappedRecordFile() :
+	SUPER(), curRecord(-1), sumValid(false), checksum(0), recordsMax(0)
+{
+}
+
+MappedRecordFile::~MappedRecordFile()
+{
+}
+
+bool MappedRecordFile::CreateForWrite(const OS::path_t&, int, const char*)
+{
+	// Read-only.
+	return false;
+}
+
+bool MappedRecordFile::OpenForWrite(const OS::path_t&)
+{
+	// Read-only.
+	return false;
+}
+
+bool MappedRecordFile::OpenForRead(const OS::path_t &filename, bool)
+{
+	if (mapping) return false;
+
+	auto newMapping = std::make_shared<Mapping>(filename);
+	if (!newMapping->IsValid()) return false;
+
+	const MR_UInt8 *data = newMapping->GetData();
+	const size_t size = newMapping->GetSize();
+
+	// Same layout as ClassicRecordFileHeader.
+	MR_UInt32 recordsUsed;
+	try {
+		MappedObjStream os(filename, data, data + size, nullptr);
+
+		MR_UInt32 dummy;
+		BOOL sumValidLoad;
+
+		os >> title >>
+			dummy >> dummy >>
+			sumValidLoad >> checksum >> recordsUsed >> recordsMax >>
+			dummy >> dummy;
+		sumValid = sumValidLoad != FALSE;
+
+		if (title.find("HoverRace track file") == std::string::npos &&
+			title.find("Fireball object factory resource file") == std::string::npos)
+		{
+			HR_LOG(error) << "Not a parcel: " << filename;
+			return false;
+		}
+
+		if (recordsUsed > recordsMax) {
+			HR_LOG(error) << "Corrupt parcel header: " << filename;
+			return false;
+		}
+
+		recordList.resize(recordsMax);
+		os.GetSpanReader()->ReadArray(recordList.data(), recordsMax);
+		recordList.resize(recordsUsed);
+	}
+	catch (ObjStreamExn &ex) {
+		HR_LOG(error) << ex.what();
+		return false;
+	}
+
+	// Records are written one after the other, so each record ends where
+	// the next one starts (or at the end of the file).
+	recordEnd.resize(recordsUsed);
+	for (MR_UInt32 i = 0; i < recordsUsed; ++i) {
+		MR_UInt32 start = recordList[i];
+		if (start > size) {
+			HR_LOG(error) << "Corrupt parcel record table: " << filename;
+			return false;
+		}
+
+		MR_UInt32 end = static_cast<MR_UInt32>(size);
+		for (MR_UInt32 next : recordList) {
+			if (next > start && next < end) end = next;
+		}
+		recordEnd[i] = end;
+	}
+
+	this->filename = filename;
+	mapping = std::move(newMapping);
+	curRecord = 0;
+
+	return true;
+}
+
+bool MappedRecordFile::ApplyChecksum(const OS::path_t&)
+{
+	// Read-only.
+	return false;
+}
+
+DWORD MappedRecordFile::GetAlignMode()
+{
+	return mapping ? checksum : 0;
+}
+
+int MappedRecordFile::GetNbRecords() const
+{
+	return mapping ? static_cast<int>(recordList.size()) : 0;
+}
+
+void MappedRecordFile::SelectRecord(int i)
+{
+	if (mapping) {
+		if ((unsigned)i < recordList.size()) {
+			curRecord = i;
+		}
+		else {
+			ASSERT(FALSE);
+		}
+	}
+}
+
+bool MappedRecordFile::BeginANewRecord()
+{
+	// Read-only.
+	ASSERT(FALSE);
+	return false;
+}
+
+void MappedRecordFile::Inspect(Util::InspectMapNode &node) const
+{
+	node.
+		AddField("curRecord", curRecord).
+		AddField("title", title).
+		AddField("sumValid", sumValid).
+		AddField("checksum", checksum).
+		AddField("recordsUsed", recordList.size()).
+		AddField("recordsMax", recordsMax).
+		AddArray("recordList", recordList.data(), 0, recordList.size());
+}
+
+ObjStreamPtr MappedRecordFile::StreamIn()
+{
+	if (!mapping || curRecord < 0) {
+		throw ObjStreamExn(filename, "No record selected");
+	}
+
+	const MR_UInt8 *data = mapping->GetData();
+	return std::make_shared<MappedObjStream>(filename,
+		data + recordList[curRecord], data + recordEnd[curRecord],
+		mapping);
+}
+
+ObjStreamPtr MappedRecordFile::StreamOut()
+{
+	throw ObjStreamExn(filename, "Parcel is read-only");
+}
+
+}  // namespace Parcel
+}  // namespace HoverRace
@@ -0,0 +1,100 @@
+
+// MappedRecordFile.h
+// Read-only, memory-mapped HoverRace 1.x parcel.
+//
+// Copyright (c) 2015 Michael Imamura.
+// Copyright (c) 2010, 2012 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include "RecordFile.h"
+
+#if defined(_WIN32) && defined(HR_ENGINE_SHARED)
+#	ifdef MR_ENGINE
+#		define MR_DllDeclare   __declspec( dllexport )
+#	else
+#		define MR_DllDeclare   __declspec( dllimport )
+#	endif
+#else
+#	define MR_DllDeclare
+#endif
+
+namespace HoverRace {
+namespace Parcel {
+
+/**
+ * Read-only, memory-mapped HoverRace 1.x parcel.
+ *
+ * This reads the same format as ClassicRecordFile, but the whole file is
+ * mapped into memory so that streams read directly from the mapping instead
+ * of calling into stdio for each field.  Streams from this parcel support
+ * ObjStream::GetSpanReader(), so large arrays can be read (or used in place)
+ * without intermediate copies.
+ *
+ * The mapping is copy-on-write, so data that is used in place may be
+ * modified without affecting the file.  The mapping stays alive as long as
+ * anything (including the owner from the span reader) references it.
+ *
+ * Since each stream has its own cursor, multiple input streams may be open
+ * at once, even from different threads.
+ *
+ * @author Michael Imamura
+ */
+class MR_DllDeclare MappedRecordFile : public RecordFile
+{
+	typedef RecordFile SUPER;
+	public:
+		MappedRecordFile();
+		virtual ~MappedRecordFile();
+
+		bool CreateForWrite(const Util::OS::path_t &filename, int numRecords, const char *title=NULL) override;
+		bool OpenForWrite(const Util::OS::path_t &filename) override;
+		bool OpenForRead(const Util::OS::path_t &filename, bool validateChecksum=false) override;
+
+		bool ApplyChecksum(const Util::OS::path_t &filename) override;
+
+		DWORD GetAlignMode() override;
+
+		int GetNbRecords() const override;
+		void SelectRecord(int i) override;
+		bool BeginANewRecord() override;
+
+		void Inspect(Util::InspectMapNode &node) const override;
+
+		ObjStreamPtr StreamIn() override;
+		ObjStreamPtr StreamOut() override;
+
+	private:
+		class Mapping;
+		std::shared_ptr<Mapping> mapping;
+		Util::OS::path_t filename;
+		int curRecord;
+
+		std::string title;
+		bool sumValid;
+		MR_UInt32 checksum;
+		MR_UInt32 recordsMax;
+		std::vector<MR_UInt32> recordList;  ///< Start offset of each record.
+		std::vector<MR_UInt32> recordEnd;  ///< End offset of each record.
+};
+
+}  // namespace Parcel
+}  // namespace HoverRace
+
+#undef MR_DllDeclare
@@ -41,6 +41,8 @@
 namespace HoverRace {
 namespace Parcel {
 
+class SpanReader;
+
 class MR_DllDeclare ObjStreamExn : public Exception
 {
 	typedef Exception SUPER;
@@ -70,6 +72,15 @@ class MR_DllDeclare ObjStream
 		int GetVersion() const { return version; }
 		bool IsWriting() const { return writing; }
 
+		/**
+		 * Retrieve direct access to the remaining data in the stream.
+		 * Only streams that are backed by memory (e.g. memory-mapped
+		 * files) support this.  Reading from the span reader advances the
+		 * stream.
+		 * @return The span reader, or @c nullptr if not supported.
+		 */
+		virtual SpanReader *GetSpanReader() { return nullptr; }
+
 	public:
 		virtual void Write(const void *buf, size_t ct) = 0;
 
@@ -0,0 +1,156 @@
+
+// SpanReader.h
+// Bounds-checked reader for parcel data in memory.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include <string.h>
+
+#include "../Util/MR_Types.h"
+#include "../Util/OS.h"
+
+#include "ObjStream.h"
+
+namespace HoverRace {
+namespace Parcel {
+
+/**
+ * Bounds-checked cursor over a block of parcel data in memory.
+ *
+ * Unlike the ObjStream read functions, none of these are virtual, so
+ * deserializers can use this directly (see ObjStream::GetSpanReader()) for
+ * large arrays, or to take pointers into the data without copying it.
+ *
+ * The data is in the same (little-endian) format as ClassicObjStream.
+ *
+ * @author Michael Imamura
+ */
+class SpanReader
+{
+	public:
+		/**
+		 * Constructor.
+		 * @param name The name of the stream (for error messages).
+		 * @param begin The start of the data.
+		 * @param end The end of the data.
+		 * @param owner Keeps the memory alive (may be @c nullptr if the
+		 *              memory is owned elsewhere).
+		 */
+		SpanReader(const Util::OS::path_t &name,
+			const MR_UInt8 *begin, const MR_UInt8 *end,
+			std::shared_ptr<const void> owner = nullptr) :
+			name(name), cur(begin), end(end), owner(std::move(owner)) { }
+
+	public:
+		/**
+		 * Retrieve the object that keeps the memory alive.
+		 * Holding on to this is enough to keep pointers returned by Take()
+		 * valid after the stream is gone.
+		 * @return The owner (may be @c nullptr).
+		 */
+		const std::shared_ptr<const void> &GetOwner() const { return owner; }
+
+		size_t GetRemaining() const { return static_cast<size_t>(end - cur); }
+
+		/**
+		 * Read a single value.
+		 * @param [out] val The value.
+		 * @throw ObjStreamExn Not enough data left.
+		 */
+		template<class T>
+		void Read(T &val)
+		{
+			Check(sizeof(T));
+			memcpy(&val, cur, sizeof(T));
+			cur += sizeof(T);
+			//TODO: Big-endian conversion.
+		}
+
+		/**
+		 * Read an array of values.
+		 * @param [out] vals The values.
+		 * @param count The number of values to read.
+		 * @throw ObjStreamExn Not enough data left.
+		 */
+		template<class T>
+		void ReadArray(T *vals, size_t count)
+		{
+			Read(static_cast<void*>(vals), count * sizeof(T));
+		}
+
+		/**
+		 * Read a block of raw data.
+		 * @param [out] buf The destination buffer.
+		 * @param ct The number of bytes.
+		 * @throw ObjStreamExn Not enough data left.
+		 */
+		void Read(void *buf, size_t ct)
+		{
+			Check(ct);
+			if (ct > 0) {
+				memcpy(buf, cur, ct);
+				cur += ct;
+			}
+		}
+
+		/**
+		 * Consume a block of raw data without copying it.
+		 * @param ct The number of bytes.
+		 * @return A pointer to the data.  It stays valid as long as the owner
+		 *         (see GetOwner()) is alive.
+		 * @throw ObjStreamExn Not enough data left.
+		 */
+		const MR_UInt8 *Take(size_t ct)
+		{
+			Check(ct);
+			const MR_UInt8 *retv = cur;
+			cur += ct;
+			return retv;
+		}
+
+		/**
+		 * Skip over a block of data.
+		 * @param ct The number of bytes.
+		 * @throw ObjStreamExn Not enough data left.
+		 */
+		void Skip(size_t ct)
+		{
+			Check(ct);
+			cur += ct;
+		}
+
+	private:
+		void Check(size_t ct) const
+		{
+			if (ct > GetRemaining()) {
+				throw ObjStreamExn(name, "Read past end of record");
+			}
+		}
+
+	private:
+		const Util::OS::path_t &name;
+		const MR_UInt8 *cur;
+		const MR_UInt8 *end;
+		std::shared_ptr<const void> owner;
+};
+
+}  // namespace Parcel
+}  // namespace HoverRace
@@ -21,119 +21,208 @@
 
 #pragma once
 
+#include <string.h>
+
+#include <type_traits>
+
 #include "MR_Types.h"
 
 namespace HoverRace {
 namespace Util {
 
-template<int BYTES>
-struct BitPack {
-	static const int SIZE = BYTES;
-
-	// Need three bytes of padding to be safe in case we write
-	// to the array starting at the last byte.
-	static const int REALSIZE = BYTES + 3;
-	char bdata[REALSIZE];
-
-	void InitFrom(const MR_UInt8 *data);
-
-	void Clear();
-	void Set(MR_UInt32 pOffset, MR_UInt32 pLen, MR_UInt32 pPrecision, MR_Int32 pValue);
-	void Set(MR_UInt32 pOffset, MR_UInt32 pLen, MR_UInt32 pPrecision, MR_UInt32 pValue);
-
-	MR_Int32 Get(MR_UInt32 pOffset, MR_UInt32 pLen, MR_UInt32 pPrecision) const;
-	MR_UInt32 Getu(MR_UInt32 pOffset, MR_UInt32 pLen, MR_UInt32 pPrecision) const;
+/**
+ * Describes a field in a packed buffer, using the same offset, length and
+ * precision (all in bits) as BitField.
+ */
+struct BitPackField
+{
+	MR_UInt32 offset;
+	MR_UInt32 len;
+	MR_UInt32 precision;
 };
 
-static_assert(std::is_pod<BitPack<32>>::value, "BitPack must be a POD type");
-
-template<int BYTES>
-void BitPack<BYTES>::InitFrom(const MR_UInt8 *data) {
-	memcpy(bdata, data, SIZE);
-}
-
-template<int BYTES>
-MR_Int32 BitPack<BYTES>::Get(MR_UInt32 pOffset, MR_UInt32 pLen, MR_UInt32 pPrecision) const
+/**
+ * A bit field at a fixed position in a packed buffer.
+ *
+ * Values are shifted right by @p Precision bits, then truncated to @p Len
+ * bits.  The buffer is accessed a byte at a time (least significant bits
+ * first), so it needs no particular alignment or padding and the layout is
+ * the same on every platform.  The position is known at compile time, so
+ * reading or writing a field compiles down to a few shifts and masks.
+ *
+ * @tparam Offset The offset of the field, in bits.
+ * @tparam Len The length of the field, in bits (1 to 32).
+ * @tparam Precision The number of low-order bits to drop.
+ * @author Michael Imamura
+ */
+template<MR_UInt32 Offset, MR_UInt32 Len, MR_UInt32 Precision=0>
+struct BitField
 {
-	union {
-		MR_Int32 s;
-		MR_UInt32 u;
-	} lReturnValue;
-
-	const char *cdata = static_cast<const char*>(bdata);
-
-	lReturnValue.u = (*(MR_UInt32 *) (cdata + pOffset / 8)) >> (pOffset % 8);
-
-	if((pLen + (pOffset % 8)) > 32) {
-		lReturnValue.u |= (*(MR_UInt32 *) (cdata + (pOffset / 8) + 4)) << (32 - (pOffset % 8));
+	static_assert(Len >= 1 && Len <= 32, "BitField length must be from 1 to 32 bits");
+	static_assert(Precision < 32, "BitField precision must be less than 32 bits");
+
+	static const MR_UInt32 OFFSET = Offset;
+	static const MR_UInt32 LEN = Len;
+	static const MR_UInt32 PRECISION = Precision;
+	static const MR_UInt32 MASK =
+		static_cast<MR_UInt32>((static_cast<MR_UInt64>(1) << Len) - 1);
+
+	/**
+	 * Store the bits of the field as-is.
+	 * The field in the buffer must be cleared first.
+	 * @param buf The buffer.
+	 * @param raw The bits (any bits beyond the length are ignored).
+	 */
+	static void SetRaw(MR_UInt8 *buf, MR_UInt32 raw)
+	{
+		MR_UInt64 bits = static_cast<MR_UInt64>(raw & MASK) << SHIFT;
+		for (MR_UInt32 i = 0; i < NUM_BYTES; i++) {
+			buf[FIRST_BYTE + i] |= static_cast<MR_UInt8>(bits >> (i * 8));
+		}
 	}
-	// Clear overhead bits and preserve sign
-	lReturnValue.s = lReturnValue.s << (32 - pLen) >> (32 - pLen);
 
-	return lReturnValue.s << pPrecision;
-}
+	/**
+	 * Retrieve the bits of the field as-is.
+	 * @param buf The buffer.
+	 * @return The bits.
+	 */
+	static MR_UInt32 GetRaw(const MR_UInt8 *buf)
+	{
+		MR_UInt64 bits = 0;
+		for (MR_UInt32 i = 0; i < NUM_BYTES; i++) {
+			bits |= static_cast<MR_UInt64>(buf[FIRST_BYTE + i]) << (i * 8);
+		}
+		return static_cast<MR_UInt32>(bits >> SHIFT) & MASK;
+	}
 
-template<int BYTES>
-MR_UInt32 BitPack<BYTES>::Getu(MR_UInt32 pOffset, MR_UInt32 pLen, MR_UInt32 pPrecision) const
-{
-	MR_UInt32 lReturnValue;
+	static void Set(MR_UInt8 *buf, MR_Int32 value)
+	{
+		SetRaw(buf, static_cast<MR_UInt32>(value >> Precision));
+	}
 
-	const char *cdata = static_cast<const char*>(bdata);
+	static void Set(MR_UInt8 *buf, MR_UInt32 value)
+	{
+		SetRaw(buf, value >> Precision);
+	}
 
-	lReturnValue = (*(MR_UInt32 *) (cdata + pOffset / 8)) >> (pOffset % 8);
+	/// Retrieve the value, treating the field as signed.
+	static MR_Int32 Get(const MR_UInt8 *buf)
+	{
+		MR_UInt32 extended = static_cast<MR_UInt32>(
+			static_cast<MR_Int32>(GetRaw(buf) << (32 - Len)) >> (32 - Len));
+		return static_cast<MR_Int32>(extended << Precision);
+	}
 
-	if(pLen + (pOffset % 8) > 32) {
-		lReturnValue |= (*(MR_UInt32 *) (cdata + (pOffset / 8) + 4)) << (32 - (pOffset % 8));
+	/// Retrieve the value, treating the field as unsigned.
+	static MR_UInt32 Getu(const MR_UInt8 *buf)
+	{
+		return GetRaw(buf) << Precision;
 	}
-	// Clear overhead bits
-	lReturnValue = lReturnValue << (32 - pLen) >> (32 - pLen);
 
-	return lReturnValue << pPrecision;
-}
+	private:
+		static const MR_UInt32 FIRST_BYTE = Offset / 8;
+		static const MR_UInt32 SHIFT = Offset % 8;
+		static const MR_UInt32 NUM_BYTES = (SHIFT + Len + 7) / 8;
+};
 
-template<int BYTES>
-void BitPack<BYTES>::Clear()
+/**
+ * Binds a member of a struct to a BitField, for BitPackSchema.
+ * Signed members are sign-extended when they are read back.
+ * @tparam T The struct.
+ * @tparam V The type of the member (MR_Int32 or MR_UInt32).
+ * @tparam Member The member.
+ * @tparam Offset The offset of the field, in bits.
+ * @tparam Len The length of the field, in bits.
+ * @tparam Precision The number of low-order bits to drop.
+ * @author Michael Imamura
+ */
+template<class T, class V, V T::*Member,
+	MR_UInt32 Offset, MR_UInt32 Len, MR_UInt32 Precision=0>
+struct BitPackMember
 {
-	memset(bdata, 0, REALSIZE);
-}
+	static_assert(std::is_same<V, MR_Int32>::value || std::is_same<V, MR_UInt32>::value,
+		"BitPackMember must be a MR_Int32 or MR_UInt32");
 
-template<int BYTES>
-inline void BitPack<BYTES>::Set(MR_UInt32 pOffset, MR_UInt32 pLen, MR_UInt32 pPrecision, MR_Int32 pValue)
-{
-	char *cdata = static_cast<char*>(bdata);
+	typedef BitField<Offset, Len, Precision> field_t;
 
-	union {
-		MR_Int32 s;
-		MR_UInt32 u;
-	} conv;
+	static void Encode(const T &src, MR_UInt8 *buf)
+	{
+		field_t::Set(buf, src.*Member);
+	}
 
-	conv.s = pValue >> pPrecision;
-	MR_UInt32 lValue = conv.u;
+	static void Decode(const MR_UInt8 *buf, T &dest)
+	{
+		dest.*Member = Get(buf, std::is_signed<V>());
+	}
 
-	lValue = lValue << (32 - pLen) >> (32 - pLen);
+	private:
+		static V Get(const MR_UInt8 *buf, std::true_type) { return field_t::Get(buf); }
+		static V Get(const MR_UInt8 *buf, std::false_type) { return field_t::Getu(buf); }
+};
 
-	(*(MR_UInt32 *) (cdata + pOffset / 8)) |= lValue << (pOffset % 8);
+namespace detail {
+	template<MR_UInt32 Bits, class... Members>
+	struct BitPackFits : std::true_type { };
 
-	if((pLen + (pOffset % 8)) > 32) {
-		(*(MR_UInt32 *) (cdata + (pOffset / 8) + 4)) |= lValue >> (32 - (pOffset % 8));
-	}
+	template<MR_UInt32 Bits, class Member, class... Rest>
+	struct BitPackFits<Bits, Member, Rest...> : std::integral_constant<bool,
+		(Member::field_t::OFFSET + Member::field_t::LEN <= Bits) &&
+		BitPackFits<Bits, Rest...>::value> { };
 }
 
-template<int BYTES>
-inline void BitPack<BYTES>::Set(MR_UInt32 pOffset, MR_UInt32 pLen, MR_UInt32 pPrecision, MR_UInt32 pValue)
+/**
+ * The layout of a struct packed into a fixed-size buffer.
+ *
+ * The layout is checked at compile time, and packing is done entirely on
+ * the caller's buffer, so a schema can be used from any number of threads
+ * at once.  Bits not covered by any member are always zero.
+ *
+ * @tparam T The struct.
+ * @tparam Bytes The size of the packed buffer.
+ * @tparam Members The members (see BitPackMember).
+ * @author Michael Imamura
+ */
+template<class T, int Bytes, class... Members>
+struct BitPackSchema
 {
-	char *cdata = static_cast<char*>(bdata);
-
-	MR_UInt32 lValue = pValue >> pPrecision;
-
-	lValue = lValue << (32 - pLen) >> (32 - pLen);
-
-	(*(MR_UInt32 *) (cdata + pOffset / 8)) |= lValue << (pOffset % 8);
+	static_assert(detail::BitPackFits<Bytes * 8, Members...>::value,
+		"BitPackSchema field extends past the end of the buffer");
+
+	static const int SIZE = Bytes;
+	static const int NUM_FIELDS = sizeof...(Members);
+
+	/// The layout of each field, for code that needs to inspect the fields
+	/// at runtime.
+	static const BitPackField FIELDS[sizeof...(Members)];
+
+	/**
+	 * Pack a struct.
+	 * @param src The struct.
+	 * @param[out] buf The buffer (@c SIZE bytes).
+	 */
+	static void Encode(const T &src, MR_UInt8 *buf)
+	{
+		memset(buf, 0, Bytes);
+		int expand[] = { 0, (Members::Encode(src, buf), 0)... };
+		(void)expand;
+	}
 
-	if((pLen + (pOffset % 8)) > 32) {
-		(*(MR_UInt32 *) (cdata + (pOffset / 8) + 4)) |= lValue >> (32 - (pOffset % 8));
+	/**
+	 * Unpack a struct.
+	 * @param buf The buffer (@c SIZE bytes).
+	 * @param[out] dest The struct.
+	 */
+	static void Decode(const MR_UInt8 *buf, T &dest)
+	{
+		int expand[] = { 0, (Members::Decode(buf, dest), 0)... };
+		(void)expand;
 	}
-}
+};
+
+template<class T, int Bytes, class... Members>
+const BitPackField BitPackSchema<T, Bytes, Members...>::FIELDS[sizeof...(Members)] = {
+	{ Members::field_t::OFFSET, Members::field_t::LEN, Members::field_t::PRECISION }...
+};
 
 }  // namespace Util
 }  // namespace HoverRace
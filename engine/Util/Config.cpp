@@ -540,6 +540,16 @@ Parcel::TrackBundlePtr Config::GetTrackBundle() const
 	return trackBundle;
 }
 
+/**
+ * Retrieve the path to the cache of track headers.
+ * @return The file path (may be relative).
+ * @see Model::TrackList::Reload
+ */
+OS::path_t Config::GetTrackIndexPath() const
+{
+	return dataPath / Str::UP("tracks.idx");
+}
+
 /**
  * Retrieve the path to the help file for a class in the scripting API.
  * @param className The name of the class.
@@ -978,6 +988,9 @@ void Config::video_t::ResetToDefaults()
 	fullscreenRefreshRate = 0;
 
 	stackedSplitscreen = true;
+	bandedRendering = false;
+
+	textureCacheMb = 64;
 }
 
 void Config::video_t::Load(yaml::MapNode *root)
@@ -1001,6 +1014,9 @@ void Config::video_t::Load(yaml::MapNode *root)
 	READ_INT(root, fullscreenRefreshRate, 0, 32768);
 
 	READ_BOOL(root, stackedSplitscreen);
+	READ_BOOL(root, bandedRendering);
+
+	READ_INT(root, textureCacheMb, 0, 4096);
 }
 
 void Config::video_t::Save(yaml::Emitter *emitter) const
@@ -1025,6 +1041,9 @@ void Config::video_t::Save(yaml::Emitter *emitter) const
 	EMIT_VAR(emitter, fullscreenRefreshRate);
 
 	EMIT_VAR(emitter, stackedSplitscreen);
+	EMIT_VAR(emitter, bandedRendering);
+
+	EMIT_VAR(emitter, textureCacheMb);
 
 	emitter->EndMap();
 }
@@ -117,6 +117,7 @@ public:
 	const OS::path_t &GetUserTrackPath() const;
 	OS::path_t GetUserTrackPath(const std::string &name) const;
 	Parcel::TrackBundlePtr GetTrackBundle() const;
+	OS::path_t GetTrackIndexPath() const;
 
 	OS::path_t GetScriptHelpPath(const std::string &className) const;
 
@@ -195,6 +196,9 @@ public:
 		int fullscreenRefreshRate;
 
 		bool stackedSplitscreen;
+		bool bandedRendering;  ///< Render a single 3D view on all cores.
+
+		int textureCacheMb;  ///< Budget for unused cached UI textures.
 
 		void ResetToDefaults();
 		void Load(yaml::MapNode*);
@@ -19,6 +19,7 @@
 // and limitations under the License.
 //
 
+#include <atomic>
 #include <map>
 
 #include "../ObjFac1/ObjFac1.h"
@@ -40,7 +41,7 @@ class FactoryDll
 {
 	public:
 		BOOL mDynamic;
-		int mRefCount;
+		std::atomic<int> mRefCount;  ///< Objects may be created on any thread.
 
 		virtual ObjectFromFactory* GetObject(int classId) const = 0;
 		virtual ObjFacTools::ResourceLib &GetResourceLib() const = 0;
@@ -21,6 +21,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <list>
+#include <mutex>
 #include <queue>
 
 #include "Log.h"
@@ -40,16 +45,55 @@ namespace Util {
 
 /**
  * Queue of resource loaders.
+ *
+ * Loaders normally run one at a time on the thread that calls LoadNext()
+ * (usually the render thread), so that the loading scene can keep animating
+ * between them.  Loaders that are added with AddBackgroundLoader() do not
+ * touch the display or the scripting environment, and so are run on their
+ * own threads instead; consecutive background loaders run concurrently.
+ * Any work that must be done on the render thread (e.g. uploading textures)
+ * can be handed back with PostToRenderThread().
+ *
+ * A regular loader always waits for every background loader that was
+ * added before it to finish, so the relative order of the queue is
+ * preserved.
+ *
  * @author Michael Imamura
  */
 class Loader
 {
 	public:
-		Loader() { }
-		~Loader() { }
+		Loader() : total(0), completed(0), finishedFired(false) { }
+		~Loader()
+		{
+			// Don't let the background loaders outlive the objects they
+			// were loading into.
+			for (auto &task : running) {
+				if (task.second.valid()) {
+					task.second.wait();
+				}
+			}
+		}
 
 	public:
-		bool IsEmpty() const { return loaders.empty(); }
+		bool IsEmpty() const
+		{
+			std::lock_guard<std::mutex> lock(postedMutex);
+			return loaders.empty() && running.empty() && posted.empty();
+		}
+
+		/**
+		 * Retrieve how much of the queue has been processed.
+		 * Work posted back to the render thread is counted along with the
+		 * loaders themselves.
+		 * @return The progress, from 0.0 to 1.0.
+		 */
+		double GetProgress() const
+		{
+			size_t totalCount = total;
+			return (totalCount == 0) ? 1.0 :
+				static_cast<double>(completed) / totalCount;
+		}
 
 	public:
 		typedef boost::signals2::signal<void()> finishedLoadingSignal_t;
@@ -63,13 +107,29 @@ class Loader
 			return finishedLoadingSignal;
 		}
 
+		/**
+		 * Fire the finished loading signal.
+		 * The signal is only ever fired once; subsequent calls are ignored.
+		 */
 		void FireFinishedLoadingSignal()
 		{
-			finishedLoadingSignal();
+			if (!finishedFired) {
+				finishedFired = true;
+				finishedLoadingSignal();
+			}
 		}
 
 	private:
-		typedef std::pair<std::string, std::function<void()>> loader_t;
+		struct loader_t
+		{
+			loader_t(const std::string &name, std::function<void()> fn,
+				bool background) :
+				name(name), fn(std::move(fn)), background(background) { }
+
+			std::string name;
+			std::function<void()> fn;
+			bool background;
+		};
 	public:
 		/**
 		 * Add a new named loader.
@@ -80,7 +140,8 @@ class Loader
 		template<class Fn>
 		void AddLoader(const std::string &s, Fn fn)
 		{
-			loaders.emplace(s, fn);
+			loaders.emplace(s, fn, false);
+			total++;
 		}
 
 		/**
@@ -91,38 +152,141 @@ class Loader
 		void AddLoader(Fn fn)
 		{
 			std::ostringstream oss;
-			oss << "Loader " << loaders.size();
-			loaders.emplace(oss.str(), fn);
+			oss << "Loader " << total;
+			AddLoader(oss.str(), fn);
+		}
+
+		/**
+		 * Add a new named loader that may be run on a background thread.
+		 * The loader must not use the display, sound, or scripting
+		 * environment directly; use PostToRenderThread() for any work that
+		 * must be done on the render thread.
+		 * @param s The name of the loader.
+		 * @param fn The loader function.
+		 */
+		template<class Fn>
+		void AddBackgroundLoader(const std::string &s, Fn fn)
+		{
+			loaders.emplace(s, fn, true);
+			total++;
+		}
+
+		/**
+		 * Schedule a function to be called on the render thread.
+		 * This may be called from any thread, including background loaders.
+		 * The function will be called during a subsequent LoadNext(), and
+		 * loading will not be considered finished until it has run.
+		 * @param fn The function.
+		 */
+		template<class Fn>
+		void PostToRenderThread(Fn fn)
+		{
+			std::lock_guard<std::mutex> lock(postedMutex);
+			posted.emplace_back(fn);
+			total++;
 		}
 
 	public:
 		/**
 		 * Load the next item.
 		 *
+		 * This never blocks waiting for background loaders; if the next
+		 * regular loader is waiting on them, then this returns immediately
+		 * so the caller can continue rendering.
+		 *
 		 * If all of the loaders have been executed, then the
 		 * finishedLoadingSignal will *not* be fired automatically, since the
 		 * owner of the loader may want to perform some actions before
 		 * notifying the listeners.
 		 *
+		 * If a loader threw an exception, then it is rethrown here.
+		 *
 		 * @return @c true if there are any loaders remaining,
 		 *         @c false if all loaders have executed.
 		 */
 		bool LoadNext()
 		{
-			if (loaders.empty()) {
-				return false;
+			// Anything posted by a loader that has finished is guaranteed to
+			// be run before the next regular loader starts.
+			ReapBackground();
+			RunPosted();
+
+			if (!loaders.empty()) {
+				if (loaders.front().background) {
+					// Start every background loader up to the next regular
+					// one; they're independent of each other.
+					while (!loaders.empty() && loaders.front().background) {
+						auto &loader = loaders.front();
+						Log::Info("Loading (background): %s",
+							loader.name.c_str());
+						running.emplace_back(loader.name,
+							std::async(std::launch::async, std::move(loader.fn)));
+						loaders.pop();
+					}
+				}
+				else if (running.empty()) {
+					auto &loader = loaders.front();
+					Log::Info("Loading: %s", loader.name.c_str());
+					loader.fn();
+					loaders.pop();
+					completed++;
+
+					// Anything the loader posted can be run right away.
+					RunPosted();
+				}
 			}
 
-			auto &loader = loaders.front();
-			Log::Info("Loading: %s", loader.first.c_str());
-			loader.second();
-			loaders.pop();
+			return !IsEmpty();
+		}
 
-			return !loaders.empty();
+	private:
+		/**
+		 * Run the work that was posted to the render thread.
+		 */
+		void RunPosted()
+		{
+			std::vector<std::function<void()>> fns;
+			{
+				std::lock_guard<std::mutex> lock(postedMutex);
+				fns.swap(posted);
+			}
+
+			for (auto &fn : fns) {
+				fn();
+				completed++;
+			}
+		}
+
+		/**
+		 * Collect the background loaders that have finished.
+		 */
+		void ReapBackground()
+		{
+			for (auto iter = running.begin(); iter != running.end(); ) {
+				auto &task = iter->second;
+				if (task.wait_for(std::chrono::seconds(0)) ==
+					std::future_status::ready)
+				{
+					Log::Info("Finished loading: %s", iter->first.c_str());
+					std::future<void> done = std::move(task);
+					iter = running.erase(iter);
+					completed++;
+					done.get();  // Rethrows if the loader failed.
+				}
+				else {
+					++iter;
+				}
+			}
 		}
 
 	private:
 		std::queue<loader_t> loaders;
+		std::list<std::pair<std::string, std::future<void>>> running;
+		mutable std::mutex postedMutex;
+		std::vector<std::function<void()>> posted;
+		std::atomic<size_t> total;
+		std::atomic<size_t> completed;
+		bool finishedFired;
 		finishedLoadingSignal_t finishedLoadingSignal;
 };
 
@@ -0,0 +1,150 @@
+
+// WorkerPool.cpp
+//
+// Copyright (c) 2014 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "WorkerPool.h"
+
+namespace HoverRace {
+namespace Util {
+
+/**
+ * Constructor.
+ * @param threads The total number of threads to use for each job, including
+ *                the calling thread.  If zero, one thread per hardware
+ *                thread is used.
+ */
+WorkerPool::WorkerPool(unsigned int threads) :
+	quit(false), generation(0), busy(0),
+	jobFn(nullptr), jobCount(0), nextItem(0)
+{
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+
+	// The calling thread is the first worker.
+	for (unsigned int i = 1; i < threads; i++) {
+		this->threads.emplace_back(&WorkerPool::ThreadProc, this);
+	}
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		quit = true;
+	}
+	jobReady.notify_all();
+
+	for (auto &thread : threads) {
+		thread.join();
+	}
+}
+
+/**
+ * Run a function for each index in [0, count), spread across the pool.
+ * Blocks until every call has returned.
+ * If any of the calls throw, the first exception is rethrown here once the
+ * job has finished.
+ * @param count The number of items.
+ * @param fn The function to call for each item.
+ */
+void WorkerPool::ParallelFor(int count, const std::function<void(int)> &fn)
+{
+	if (count <= 0) return;
+
+	// Not worth waking up the workers for a single item.
+	if (count == 1 || threads.empty()) {
+		for (int i = 0; i < count; i++) {
+			fn(i);
+		}
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobFn = &fn;
+		jobCount = count;
+		nextItem = 0;
+		jobExn = nullptr;
+		busy = static_cast<unsigned int>(threads.size());
+		generation++;
+	}
+	jobReady.notify_all();
+
+	RunItems();
+
+	std::exception_ptr exn;
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		jobDone.wait(lock, [&]{ return busy == 0; });
+		jobFn = nullptr;
+		exn = jobExn;
+	}
+
+	if (exn) {
+		std::rethrow_exception(exn);
+	}
+}
+
+void WorkerPool::ThreadProc()
+{
+	unsigned long lastGeneration = 0;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobReady.wait(lock, [&]{ return quit || generation != lastGeneration; });
+			if (quit) return;
+			lastGeneration = generation;
+		}
+
+		RunItems();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			busy--;
+		}
+		jobDone.notify_one();
+	}
+}
+
+/**
+ * Process items from the current job until there are none left.
+ */
+void WorkerPool::RunItems()
+{
+	for (;;) {
+		int i = nextItem++;
+		if (i >= jobCount) break;
+
+		try {
+			(*jobFn)(i);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(mutex);
+			if (!jobExn) {
+				jobExn = std::current_exception();
+			}
+		}
+	}
+}
+
+}  // namespace Util
+}  // namespace HoverRace
@@ -0,0 +1,91 @@
+
+// WorkerPool.h
+//
+// Copyright (c) 2014 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32) && defined(HR_ENGINE_SHARED)
+#	ifdef MR_ENGINE
+#		define MR_DllDeclare   __declspec( dllexport )
+#	else
+#		define MR_DllDeclare   __declspec( dllimport )
+#	endif
+#else
+#	define MR_DllDeclare
+#endif
+
+namespace HoverRace {
+namespace Util {
+
+/**
+ * A fixed set of threads for running data-parallel jobs.
+ *
+ * Only one job runs at a time; the thread that submits the job takes part
+ * in it and blocks until every item has been processed.
+ * @author Michael Imamura
+ */
+class MR_DllDeclare WorkerPool
+{
+	public:
+		WorkerPool(unsigned int threads=0);
+		~WorkerPool();
+
+	public:
+		/**
+		 * Retrieve the number of threads that will work on a job,
+		 * including the calling thread.
+		 * @return The thread count (always at least 1).
+		 */
+		unsigned int GetThreadCount() const { return static_cast<unsigned int>(threads.size()) + 1; }
+
+		void ParallelFor(int count, const std::function<void(int)> &fn);
+
+	private:
+		void ThreadProc();
+		void RunItems();
+
+	private:
+		std::vector<std::thread> threads;
+
+		std::mutex mutex;
+		std::condition_variable jobReady;
+		std::condition_variable jobDone;
+		bool quit;
+		unsigned long generation;  ///< Incremented for each new job.
+		unsigned int busy;  ///< Number of workers still in the current job.
+
+		const std::function<void(int)> *jobFn;
+		int jobCount;
+		std::atomic<int> nextItem;
+		std::exception_ptr jobExn;
+};
+
+}  // namespace Util
+}  // namespace HoverRace
+
+#undef MR_DllDeclare
@@ -228,29 +228,41 @@ void Sprite::StrBlt(int pX, int pY, const char *pStr, Viewport2D *pDest, eAlignm
 const char *Ascii2Simple(const char *pSrc)
 {
 	// Warning: non reentrant function (not for multi thread)
+	static char lBuffer[256];
+
+	return Ascii2Simple(pSrc, lBuffer, sizeof(lBuffer));
+}
 
+/**
+ * Reentrant version of Ascii2Simple(const char*).
+ * @param pSrc The string to convert (may be @c NULL).
+ * @param pDest The destination buffer.
+ * @param pDestSize The size of the destination buffer (must be at least 1).
+ * @return @p pDest.
+ */
+const char *Ascii2Simple(const char *pSrc, char *pDest, size_t pDestSize)
+{
 	// Conversion string
 	// " !"#$%&'()*+,-./0123456789:;<=>?@ABCDEFGHIJKLMNOPQRSTUVWXYZ[\]^_`abcdefghijklmnopqrstuvwxyz{|}~"
-	static char lBuffer[256];
 
 	if(pSrc == NULL) {
-		lBuffer[0] = 0;
+		pDest[0] = 0;
 	}
 	else {
-		unsigned lCounter = 0;
-		while((lCounter < (sizeof(lBuffer) - 1)) && (*pSrc != 0)) {
+		size_t lCounter = 0;
+		while((lCounter < (pDestSize - 1)) && (*pSrc != 0)) {
 			if((*pSrc >= 32) && (*pSrc < 127)) {
-				lBuffer[lCounter++] = (char) (*pSrc - 32 + 1);
+				pDest[lCounter++] = (char) (*pSrc - 32 + 1);
 			}
 			else {
-				lBuffer[lCounter++] = '_' - 32 + 1;
+				pDest[lCounter++] = '_' - 32 + 1;
 			}
 			pSrc++;
 		}
-		lBuffer[lCounter] = 0;
+		pDest[lCounter] = 0;
 	}
 
-	return lBuffer;
+	return pDest;
 
 }
 
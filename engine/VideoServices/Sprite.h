@@ -81,6 +81,7 @@ class MR_DllDeclare Sprite
 
 // Helper class and functions
 MR_DllDeclare const char *Ascii2Simple(const char *pSrc);
+MR_DllDeclare const char *Ascii2Simple(const char *pSrc, char *pDest, size_t pDestSize);
 MR_DllDeclare char Ascii2Simple(char pSrc);
 
 }  // namespace VideoServices
@@ -34,8 +34,25 @@ Viewport3D::Viewport3D() :
 	mPosition(0, 0, 0), mOrientation(0),
 	mScroll(0), mVAngle(1),
 	mZBuffer(NULL), mBufferLine(NULL), mZBufferLine(NULL),
+	mBackgroundConst(NULL),
+	mClipX0(0), mClipX1(-1),
+	mSetupSerial(0)
+{
+}
+
+/**
+ * Copy constructor.
+ * The copy renders to the same buffer with the same camera, but has its own
+ * rasterizer state, so the original and the copy may render concurrently
+ * (e.g. into different parts of the buffer, or to draw an off-screen pass).
+ * @param pSource The viewport to copy.
+ */
+Viewport3D::Viewport3D(const Viewport3D & pSource) :
+	Viewport2D(pSource),
+	mBufferLine(NULL), mZBufferLine(NULL),
 	mBackgroundConst(NULL)
 {
+	CopySetup(pSource);
 }
 
 Viewport3D::~Viewport3D()
@@ -45,8 +62,73 @@ Viewport3D::~Viewport3D()
 	delete[]mBackgroundConst;
 }
 
+Viewport3D & Viewport3D::operator=(const Viewport3D & pSource)
+{
+	if(this != &pSource) {
+		Viewport2D::operator=(pSource);
+		CopySetup(pSource);
+	}
+	return *this;
+}
+
+/**
+ * Copy the camera, the buffer setup and the precomputed tables
+ * (but not the rasterizer state) from another viewport.
+ * @param pSource The viewport to copy.
+ */
+void Viewport3D::CopySetup(const Viewport3D & pSource)
+{
+	mPosition = pSource.mPosition;
+	mOrientation = pSource.mOrientation;
+	mScroll = pSource.mScroll;
+	mVAngle = pSource.mVAngle;
+	mPlanDist = pSource.mPlanDist;
+	mPlanHW = pSource.mPlanHW;
+	mPlanVW = pSource.mPlanVW;
+
+	mZBuffer = pSource.mZBuffer;
+	mZLineLen = pSource.mZLineLen;
+
+	mHVarPerDInc_16384 = pSource.mHVarPerDInc_16384;
+	mVVarPerDInc_16384 = pSource.mVVarPerDInc_16384;
+	mXRes_PlanDist = pSource.mXRes_PlanDist;
+	mYRes_PlanDist = pSource.mYRes_PlanDist;
+	mPlanHW_PlanDist_2_XRes_16384 = pSource.mPlanHW_PlanDist_2_XRes_16384;
+	mXRes_PlanDist_2PlanHW_4096 = pSource.mXRes_PlanDist_2PlanHW_4096;
+
+	memcpy(mRotationMatrix, pSource.mRotationMatrix, sizeof(mRotationMatrix));
+
+	mClipX0 = pSource.mClipX0;
+	mClipX1 = pSource.mClipX1;
+
+	mSetupSerial = pSource.mSetupSerial;
+
+	delete[]mBufferLine;
+	delete[]mZBufferLine;
+	delete[]mBackgroundConst;
+	mBufferLine = NULL;
+	mZBufferLine = NULL;
+	mBackgroundConst = NULL;
+
+	if(pSource.mBufferLine != NULL) {
+		mBufferLine = new MR_UInt8 *[mYRes];
+		mZBufferLine = new MR_UInt16 *[mYRes];
+		memcpy(mBufferLine, pSource.mBufferLine, mYRes * sizeof(MR_UInt8 *));
+		memcpy(mZBufferLine, pSource.mZBufferLine, mYRes * sizeof(MR_UInt16 *));
+	}
+
+	if(pSource.mBackgroundConst != NULL) {
+		mBackgroundConst = new BackColumn[mXRes];
+		memcpy(mBackgroundConst, pSource.mBackgroundConst, mXRes * sizeof(BackColumn));
+	}
+}
+
 void Viewport3D::OnMetricsChange(int pMetrics)
 {
+	if(pMetrics != eNone) {
+		mSetupSerial++;
+	}
+
 	if((pMetrics & ~eBuffer) != eNone) {
 		// Recompute camera parameters
 
@@ -119,6 +201,21 @@ void Viewport3D::SetupCameraPosition(const MR_3DCoordinate & pPosition, MR_Angle
 	ComputeRotationMatrix();
 }
 
+/**
+ * Copy only the camera position from another viewport.
+ * This is enough to keep a copy up to date as long as the setup of the
+ * source hasn't changed since the copy was made (see GetSetupSerial()).
+ * @param pSource The viewport to copy.
+ */
+void Viewport3D::CopyCamera(const Viewport3D & pSource)
+{
+	mPosition = pSource.mPosition;
+	mOrientation = pSource.mOrientation;
+	mScroll = pSource.mScroll;
+
+	memcpy(mRotationMatrix, pSource.mRotationMatrix, sizeof(mRotationMatrix));
+}
+
 void Viewport3D::ComputeBackgroundConst()
 {
 	delete[]mBackgroundConst;
@@ -285,13 +382,42 @@ void Viewport3D::ApplyPositionMatrix(const PositionMatrix & pMatrix, const MR_3D
 
 }
 
+/**
+ * Restrict the 3D rendering functions to a band of columns.
+ * Every pixel drawn with a clip set is identical to the pixel that would
+ * have been drawn without it, so a frame may be split into bands that are
+ * rendered independently (and concurrently, by copies of this viewport).
+ * The clip does not apply to the 2D drawing functions (Clear, sprites...).
+ * @param pX0 The first column.
+ * @param pX1 The column after the last one.
+ */
+void Viewport3D::SetColumnClip(int pX0, int pX1)
+{
+	mClipX0 = (pX0 < 0) ? 0 : pX0;
+	mClipX1 = (pX1 < mClipX0) ? mClipX0 : pX1;
+}
+
+/**
+ * Remove the column clip, so the whole viewport is rendered.
+ */
+void Viewport3D::ClearColumnClip()
+{
+	mClipX0 = 0;
+	mClipX1 = -1;
+}
+
 void Viewport3D::ClearZ()
 {
+	int lClipX1 = GetClipX1();
+
+	if(lClipX1 <= mClipX0) {
+		return;
+	}
 
-	MR_UInt16 *lZBuffer = mZBuffer;
+	MR_UInt16 *lZBuffer = mZBuffer + mClipX0;
 
 	for(int lCounter = 0; lCounter < mYRes; lCounter++) {
-		memset(lZBuffer, -1, 2 * mXRes);
+		memset(lZBuffer, -1, 2 * (lClipX1 - mClipX0));
 		lZBuffer += mZLineLen;
 	}
 }
@@ -51,6 +51,85 @@ class PositionMatrix
 		MR_3DCoordinate mDisplacement;
 };
 
+// Rasterizer parameters (used by Viewport3DRendering.cpp)
+#define MR_MAX_PATCH_RES 16
+
+struct MR_ColumnBltParam
+{
+	int mColumn;
+	MR_UInt8 **mBuffer;
+	int mYScreenStart_4096;
+	int mYScreenEnd_4096;
+	int mBufferLen;
+	int mBufferStep;
+	MR_UInt16 **mZBuffer;
+	int mZBufferStep;
+	MR_UInt16 mZ;
+	MR_UInt8 *mBitmap;
+	int mPixelStep;
+	int mBitmapColMask;
+	MR_UInt8 mLightIntensity;
+	MR_UInt8 mColor;
+};
+
+struct MR_LineBltParam
+{
+	MR_UInt8 *mBuffer;
+	int mBltLen;
+	MR_UInt16 *mZBuffer;
+	MR_UInt16 mZ;
+	MR_UInt8 **mBitmap;
+	MR_UInt32 mBitmapColMask;
+	MR_UInt32 mBitmapRowMask;
+	MR_UInt32 mBitmapCol_4096;
+	MR_UInt32 mBitmapRow_4096;
+	MR_UInt32 mBitmapColInc_4096;
+	MR_UInt32 mBitmapRowInc_4096;
+
+	MR_UInt8 mLightIntensity;
+	MR_UInt8 mColor;
+};
+
+struct MR_TriangleDrawInfo
+{
+	MR_UInt8 **mBuffer;
+	int mLineLen;
+	int mXMin;									  // Column band
+	int mXRes;
+	int mYRes;
+
+	MR_UInt16 **mZBuffer;
+	int mZLineLen;
+
+	int mVertexList[3];
+	MR_Int32 mBitmapRow_4096[3];
+	MR_Int32 mBitmapCol_4096[3];
+
+	MR_UInt8 **mBitmap;
+	MR_UInt32 mBitmapColMask;
+	MR_UInt32 mBitmapRowMask;
+
+	MR_UInt8 mLightIntensity;
+	MR_UInt8 mColor;
+};
+
+/**
+ * Scratch state used while rasterizing.
+ * Each Viewport3D owns one so that separate viewports can be rendered
+ * concurrently.  This is never shared between copies of a viewport.
+ */
+struct MR_RasterState
+{
+	MR_ColumnBltParam mColumnBlt;
+	MR_LineBltParam mLineBlt;
+	MR_TriangleDrawInfo mTriangleBlt;
+
+	MR_3DCoordinate mRotatedPatch[MR_MAX_PATCH_RES * MR_MAX_PATCH_RES];
+	int mScreenXPatch[MR_MAX_PATCH_RES * MR_MAX_PATCH_RES];
+	int mScreenYPatch[MR_MAX_PATCH_RES * MR_MAX_PATCH_RES];
+	int mScreenVisibility[MR_MAX_PATCH_RES * MR_MAX_PATCH_RES];
+};
+
 class Viewport3D : public Viewport2D
 {
 	protected:
@@ -90,8 +169,18 @@ class Viewport3D : public Viewport2D
 
 		MR_Int32 mRotationMatrix[3][3];
 
+		MR_RasterState mRaster;
+
+		int mClipX0;							  // First column that may be drawn
+		int mClipX1;							  // Last column (exclusive), -1 for mXRes
+
+		int mSetupSerial;						  // Incremented when the metrics change
+
 		void ComputeRotationMatrix();
 		void ComputeBackgroundConst();
+		void CopySetup(const Viewport3D &pSource);
+
+		int GetClipX1() const { return ((mClipX1 < 0) || (mClipX1 > mXRes)) ? mXRes : mClipX1; }
 
 		void ApplyRotationMatrix(const MR_3DCoordinate & pSrc, MR_3DCoordinate & pDest) const;
 		void ApplyRotationMatrix(const MR_2DCoordinate & pSrc, MR_2DCoordinate & pDest) const;
@@ -102,11 +191,25 @@ class Viewport3D : public Viewport2D
 	public:
 
 		MR_DllDeclare Viewport3D();
+		MR_DllDeclare Viewport3D(const Viewport3D &pSource);
 		MR_DllDeclare ~Viewport3D();
 
+		MR_DllDeclare Viewport3D &operator=(const Viewport3D &pSource);
+
 		MR_DllDeclare void Setup(VideoBuffer *pBuffer, int pX0, int pY0, int pSizeX, int pSizeY, MR_Angle pApperture, int pMetrics = eNone);
 
 		MR_DllDeclare void SetupCameraPosition(const MR_3DCoordinate & pPosition, MR_Angle pOrientation, int pScroll);
+		MR_DllDeclare void CopyCamera(const Viewport3D &pSource);
+
+		/**
+		 * Retrieve a number that changes whenever the size, aperture or
+		 * buffer of the viewport changes, so copies know when they are
+		 * out of date.
+		 */
+		int GetSetupSerial() const { return mSetupSerial; }
+
+		MR_DllDeclare void SetColumnClip(int pX0, int pX1);
+		MR_DllDeclare void ClearColumnClip();
 
 		MR_DllDeclare void ClearZ();
 
@@ -29,78 +29,14 @@ namespace VideoServices {
 // Local constants
 #define MR_PIXEL_FRACT 2048
 
-// Local structures
-struct MR_ColumnBltParam
-{
-	int mColumn;
-	MR_UInt8 **mBuffer;
-	int mYScreenStart_4096;
-	int mYScreenEnd_4096;
-	int mBufferLen;
-	int mBufferStep;
-	MR_UInt16 **mZBuffer;
-	int mZBufferStep;
-	MR_UInt16 mZ;
-	MR_UInt8 *mBitmap;
-	int mPixelStep;
-	int mBitmapColMask;
-	MR_UInt8 mLightIntensity;
-	MR_UInt8 mColor;
-};
-
-struct MR_LineBltParam
-{
-	MR_UInt8 *mBuffer;
-	int mBltLen;
-	MR_UInt16 *mZBuffer;
-	MR_UInt16 mZ;
-	MR_UInt8 **mBitmap;
-	MR_UInt32 mBitmapColMask;
-	MR_UInt32 mBitmapRowMask;
-	MR_UInt32 mBitmapCol_4096;
-	MR_UInt32 mBitmapRow_4096;
-	MR_UInt32 mBitmapColInc_4096;
-	MR_UInt32 mBitmapRowInc_4096;
-
-	MR_UInt8 mLightIntensity;
-	MR_UInt8 mColor;
-};
-
-struct MR_TriangleDrawInfo
-{
-	MR_UInt8 **mBuffer;
-	int mLineLen;
-	int mXRes;
-	int mYRes;
-
-	MR_UInt16 **mZBuffer;
-	int mZLineLen;
-
-	int mVertexList[3];
-	MR_Int32 mBitmapRow_4096[3];
-	MR_Int32 mBitmapCol_4096[3];
-
-	MR_UInt8 **mBitmap;
-	MR_UInt32 mBitmapColMask;
-	MR_UInt32 mBitmapRowMask;
-
-	MR_UInt8 mLightIntensity;
-	MR_UInt8 mColor;
-};
-
-// Local variables .. for fast rendering speed
-static struct MR_ColumnBltParam gsColumnBltParam;
-static struct MR_LineBltParam gsLineBltParam;
-static struct MR_TriangleDrawInfo gsTriangleBltParam;
-
 // Local functions
-static void BltPlainColumn();
-static void BltColumn();
+static void BltPlainColumn(const MR_ColumnBltParam &pParam);
+static void BltColumn(const MR_ColumnBltParam &pParam);
 
-static void BltPlainLineNoZCheck();
-static void BltLineNoZCheck();
+static void BltPlainLineNoZCheck(const MR_LineBltParam &pParam);
+static void BltLineNoZCheck(const MR_LineBltParam &pParam);
 
-static void BltTriangle();
+static void BltTriangle(const MR_RasterState &pState);
 
 // Local Macros
 
@@ -244,6 +180,17 @@ void Viewport3D::RenderAlternateWallSurface(const MR_3DCoordinate & pUpperLeft,
 		lScreenX1 = mXRes;
 	}
 
+	// Column band cut
+	int lClipX1 = GetClipX1();
+
+	if(lScreenX1 > lClipX1) {
+		lScreenX1 = lClipX1;
+	}
+
+	if(lScreenX1 <= mClipX0) {
+		return;
+	}
+
 	// Precompute rendering constants
 
 	// lLen = (lColumn*mXVariationPerYInc*lY0Wall - lX0Wall)
@@ -275,13 +222,13 @@ void Viewport3D::RenderAlternateWallSurface(const MR_3DCoordinate & pUpperLeft,
 	int lBitmapYRes = pBitmap->GetMaxYRes();
 
 	// Prefill the rendering structure
-	gsColumnBltParam.mBuffer = mBufferLine;
-	gsColumnBltParam.mColumn = lScreenX0;
-	gsColumnBltParam.mBufferLen = mYRes;
-	gsColumnBltParam.mBufferStep = mLineLen;
-	gsColumnBltParam.mZBuffer = mZBufferLine;
-	gsColumnBltParam.mZBufferStep = mZLineLen;
-	gsColumnBltParam.mColor = pBitmap->GetPlainColor();
+	mRaster.mColumnBlt.mBuffer = mBufferLine;
+	mRaster.mColumnBlt.mColumn = lScreenX0;
+	mRaster.mColumnBlt.mBufferLen = mYRes;
+	mRaster.mColumnBlt.mBufferStep = mLineLen;
+	mRaster.mColumnBlt.mZBuffer = mZBufferLine;
+	mRaster.mColumnBlt.mZBufferStep = mZLineLen;
+	mRaster.mColumnBlt.mColor = pBitmap->GetPlainColor();
 
 	MR_Int32 lBitmapXRes_BitmapWidth = (lBitmapXRes * MR_PIXEL_FRACT) / pBitmap->GetWidth();
 	MR_Int32 lNbBitmapInHeight_4096 = ((pUpperLeft.mZ - pLowerRight.mZ) * 4096) / pBitmap->GetHeight();
@@ -291,6 +238,28 @@ void Viewport3D::RenderAlternateWallSurface(const MR_3DCoordinate & pUpperLeft,
 
 	int lPrevColumn = -1;
 
+	// Columns left of the band are skipped.  The column accumulators are
+	// linear, so they can be stepped ahead directly unless we're alternating
+	// bitmaps; the alternation depends on every column drawn so far, so
+	// in that case we go through the columns but do not draw them.
+	int lFirstColumn = lScreenX0;
+
+	if(lScreenX0 < mClipX0) {
+		lFirstColumn = mClipX0;
+
+		if(pSerialLen <= 1) {
+			int lSkip = mClipX0 - lScreenX0;
+
+			lYTop_4096 += lSkip * lDYTop_4096;
+			lYBottom_4096 += lSkip * lDYBottom_4096;
+			lColumn_HVarPerDInc_X0Wall_Y0Wall_16384 += lSkip * lHVarPerDInc_X0Wall_16384;
+			lColumn_HVarPerDInc_XWallVarPerMM_YWallVarPerMM_16384 += lSkip * lHVarPerDInc_XWallVarPerMM_16384;
+			lBitmapHeight_256 += lSkip * lBitmapHeightVar_256;
+
+			lScreenX0 = mClipX0;
+		}
+	}
+
 	for(int lColumn = lScreenX0; lColumn < lScreenX1; lColumn++) {
 
 		// Screen coordinate
@@ -328,15 +297,17 @@ void Viewport3D::RenderAlternateWallSurface(const MR_3DCoordinate & pUpperLeft,
 			// Bitmap selection
 			int lSelectedBitmap = pBitmap->GetBestBitmapForYRes(lBitmapHeight_256 / 256);
 
-			gsColumnBltParam.mColumn = lColumn;
-			gsColumnBltParam.mYScreenStart_4096 = lYTop_4096;
-			gsColumnBltParam.mYScreenEnd_4096 = lYBottom_4096 + 2 * 4096;
+			mRaster.mColumnBlt.mColumn = lColumn;
+			mRaster.mColumnBlt.mYScreenStart_4096 = lYTop_4096;
+			mRaster.mColumnBlt.mYScreenEnd_4096 = lYBottom_4096 + 2 * 4096;
 													//-(lDepth/256);
-			gsColumnBltParam.mLightIntensity = MR_NORMAL_INTENSITY;
-			gsColumnBltParam.mZ = (MR_UInt16) lDepth;
+			mRaster.mColumnBlt.mLightIntensity = MR_NORMAL_INTENSITY;
+			mRaster.mColumnBlt.mZ = (MR_UInt16) lDepth;
 
 			if(lSelectedBitmap == -1) {
-				BltPlainColumn();
+				if(lColumn >= lFirstColumn) {
+					BltPlainColumn(mRaster.mColumnBlt);
+				}
 			}
 			else {
 				int lBitmapColumn = lBitmapXRes_BitmapWidth * lLen_4 / (4 * MR_PIXEL_FRACT);
@@ -354,15 +325,18 @@ void Viewport3D::RenderAlternateWallSurface(const MR_3DCoordinate & pUpperLeft,
 				lBitmapColumn >>= pBitmap->GetXResShiftFactor(lSelectedBitmap);
 
 				if(pSerialStart == 0) {
-					gsColumnBltParam.mBitmap = pBitmap2->GetColumnBuffer(lSelectedBitmap, lBitmapColumn);
+					mRaster.mColumnBlt.mBitmap = pBitmap2->GetColumnBuffer(lSelectedBitmap, lBitmapColumn);
 				}
 				else {
-					gsColumnBltParam.mBitmap = pBitmap->GetColumnBuffer(lSelectedBitmap, lBitmapColumn);
+					mRaster.mColumnBlt.mBitmap = pBitmap->GetColumnBuffer(lSelectedBitmap, lBitmapColumn);
 				}
 
-				gsColumnBltParam.mPixelStep = (lNbBitmapInHeight_BitmapYRes * 64 / ((lYBottom_4096 - lYTop_4096) / 64)) >> pBitmap->GetYResShiftFactor(lSelectedBitmap);
-				gsColumnBltParam.mBitmapColMask = pBitmap->GetXRes(lSelectedBitmap) - 1;
-				BltColumn();
+				mRaster.mColumnBlt.mPixelStep = (lNbBitmapInHeight_BitmapYRes * 64 / ((lYBottom_4096 - lYTop_4096) / 64)) >> pBitmap->GetYResShiftFactor(lSelectedBitmap);
+				mRaster.mColumnBlt.mBitmapColMask = pBitmap->GetXRes(lSelectedBitmap) - 1;
+
+				if(lColumn >= lFirstColumn) {
+					BltColumn(mRaster.mColumnBlt);
+				}
 			}
 
 		}
@@ -381,44 +355,44 @@ void Viewport3D::RenderAlternateWallSurface(const MR_3DCoordinate & pUpperLeft,
 
 // Local functions implementation
 
-void BltPlainColumn()
+void BltPlainColumn(const MR_ColumnBltParam &pParam)
 {
 	MR_UInt8 *lBuffer;
 	MR_UInt16 *lZBuffer;
 	int lNbPoints;
-	MR_UInt8 lColor = gsColumnBltParam.mColor;
+	MR_UInt8 lColor = pParam.mColor;
 
-	if(gsColumnBltParam.mYScreenStart_4096 < 0) {
-		lBuffer = gsColumnBltParam.mBuffer[0] + gsColumnBltParam.mColumn;
-		lZBuffer = gsColumnBltParam.mZBuffer[0] + gsColumnBltParam.mColumn;
+	if(pParam.mYScreenStart_4096 < 0) {
+		lBuffer = pParam.mBuffer[0] + pParam.mColumn;
+		lZBuffer = pParam.mZBuffer[0] + pParam.mColumn;
 		lNbPoints = 0;
 
 	}
 	else {
-		lBuffer = gsColumnBltParam.mBuffer[gsColumnBltParam.mYScreenStart_4096 / 4096] + gsColumnBltParam.mColumn;
-		lZBuffer = gsColumnBltParam.mZBuffer[gsColumnBltParam.mYScreenStart_4096 / 4096] + gsColumnBltParam.mColumn;
-		lNbPoints = -gsColumnBltParam.mYScreenStart_4096 / 4096;
+		lBuffer = pParam.mBuffer[pParam.mYScreenStart_4096 / 4096] + pParam.mColumn;
+		lZBuffer = pParam.mZBuffer[pParam.mYScreenStart_4096 / 4096] + pParam.mColumn;
+		lNbPoints = -pParam.mYScreenStart_4096 / 4096;
 	}
 
-	if(gsColumnBltParam.mYScreenEnd_4096 / 4096 < gsColumnBltParam.mBufferLen) {
-		lNbPoints += gsColumnBltParam.mYScreenEnd_4096 / 4096;
+	if(pParam.mYScreenEnd_4096 / 4096 < pParam.mBufferLen) {
+		lNbPoints += pParam.mYScreenEnd_4096 / 4096;
 	}
 	else {
-		lNbPoints += gsColumnBltParam.mBufferLen;
+		lNbPoints += pParam.mBufferLen;
 	}
 
 	for(int lCounter = 0; lCounter < lNbPoints; lCounter++) {
-		if(*lZBuffer >= gsColumnBltParam.mZ) {
+		if(*lZBuffer >= pParam.mZ) {
 			*lBuffer = lColor;
-			*lZBuffer = gsColumnBltParam.mZ;
+			*lZBuffer = pParam.mZ;
 		}
 
-		lBuffer += gsColumnBltParam.mBufferStep;
-		lZBuffer += gsColumnBltParam.mZBufferStep;
+		lBuffer += pParam.mBufferStep;
+		lZBuffer += pParam.mZBufferStep;
 	}
 }
 
-void BltColumn()
+void BltColumn(const MR_ColumnBltParam &pParam)
 {
 
 	MR_UInt8 *lBuffer;
@@ -426,38 +400,38 @@ void BltColumn()
 	int lBitmapOffset;
 	int lNbPoints;
 
-	if(gsColumnBltParam.mYScreenStart_4096 < 0) {
-		lBuffer = gsColumnBltParam.mBuffer[0] + gsColumnBltParam.mColumn;
-		lZBuffer = gsColumnBltParam.mZBuffer[0] + gsColumnBltParam.mColumn;
-		lBitmapOffset = (4096 - gsColumnBltParam.mYScreenStart_4096) * gsColumnBltParam.mPixelStep / 4096;
+	if(pParam.mYScreenStart_4096 < 0) {
+		lBuffer = pParam.mBuffer[0] + pParam.mColumn;
+		lZBuffer = pParam.mZBuffer[0] + pParam.mColumn;
+		lBitmapOffset = (4096 - pParam.mYScreenStart_4096) * pParam.mPixelStep / 4096;
 		lNbPoints = 0;
 
 	}
 	else {
-		lBuffer = gsColumnBltParam.mBuffer[gsColumnBltParam.mYScreenStart_4096 / 4096] + gsColumnBltParam.mColumn;
-		lZBuffer = gsColumnBltParam.mZBuffer[gsColumnBltParam.mYScreenStart_4096 / 4096] + gsColumnBltParam.mColumn;
-		lBitmapOffset = (4096 - (gsColumnBltParam.mYScreenStart_4096 & 4095)) * gsColumnBltParam.mPixelStep / 4096;
-		lNbPoints = -gsColumnBltParam.mYScreenStart_4096 / 4096;
+		lBuffer = pParam.mBuffer[pParam.mYScreenStart_4096 / 4096] + pParam.mColumn;
+		lZBuffer = pParam.mZBuffer[pParam.mYScreenStart_4096 / 4096] + pParam.mColumn;
+		lBitmapOffset = (4096 - (pParam.mYScreenStart_4096 & 4095)) * pParam.mPixelStep / 4096;
+		lNbPoints = -pParam.mYScreenStart_4096 / 4096;
 
 	}
 
-	if(gsColumnBltParam.mYScreenEnd_4096 / 4096 < gsColumnBltParam.mBufferLen) {
-		lNbPoints += gsColumnBltParam.mYScreenEnd_4096 / 4096;
+	if(pParam.mYScreenEnd_4096 / 4096 < pParam.mBufferLen) {
+		lNbPoints += pParam.mYScreenEnd_4096 / 4096;
 	}
 	else {
-		lNbPoints += gsColumnBltParam.mBufferLen;
+		lNbPoints += pParam.mBufferLen;
 	}
 
 	for(int lCounter = 0; lCounter < lNbPoints; lCounter++) {
-		if(*lZBuffer >= gsColumnBltParam.mZ) {
-			*lBuffer = gsColumnBltParam.mBitmap[(lBitmapOffset / MR_PIXEL_FRACT) & (gsColumnBltParam.mBitmapColMask)];
-			*lZBuffer = gsColumnBltParam.mZ;
+		if(*lZBuffer >= pParam.mZ) {
+			*lBuffer = pParam.mBitmap[(lBitmapOffset / MR_PIXEL_FRACT) & (pParam.mBitmapColMask)];
+			*lZBuffer = pParam.mZ;
 		}
 
-		lBuffer += gsColumnBltParam.mBufferStep;
-		lZBuffer += gsColumnBltParam.mZBufferStep;
+		lBuffer += pParam.mBufferStep;
+		lZBuffer += pParam.mZBufferStep;
 
-		lBitmapOffset += gsColumnBltParam.mPixelStep;
+		lBitmapOffset += pParam.mPixelStep;
 	}
 }
 
@@ -485,6 +459,7 @@ void Viewport3D::RenderHorizontalSurface(int pNbVertex, const MR_2DCoordinate *
 
 	int lCounter;
 	MR_Int32 lLevel;
+	int lClipX1 = GetClipX1();
 
 	lLevel = pLevel - mPosition.mZ;
 
@@ -938,35 +913,47 @@ void Viewport3D::RenderHorizontalSurface(int pNbVertex, const MR_2DCoordinate *
 								lSelectedBitmap = -1;
 							}
 
-							gsLineBltParam.mBuffer = lLineBuffer + lLeft;
-							gsLineBltParam.mBltLen = lRight - lLeft;
-							gsLineBltParam.mZBuffer = lZLineBuffer + lLeft;
-							gsLineBltParam.mZ = static_cast<MR_UInt16>(lDepth_8 / (8 * MR_ZBUFFER_UNIT));
+							// Column band cut (after the depth tracking above, which must
+							// see the same lines as an unclipped render)
+							if(lLeft < mClipX0) {
+								lLeft = mClipX0;
+							}
 
-							gsLineBltParam.mLightIntensity = MR_NORMAL_INTENSITY;
+							if(lRight > lClipX1) {
+								lRight = lClipX1;
+							}
 
-							if(lSelectedBitmap == -1) {
-								gsLineBltParam.mColor = pBitmap->GetPlainColor();
+							if(lRight > lLeft) {
+								mRaster.mLineBlt.mBuffer = lLineBuffer + lLeft;
+								mRaster.mLineBlt.mBltLen = lRight - lLeft;
+								mRaster.mLineBlt.mZBuffer = lZLineBuffer + lLeft;
+								mRaster.mLineBlt.mZ = static_cast<MR_UInt16>(lDepth_8 / (8 * MR_ZBUFFER_UNIT));
 
-								BltPlainLineNoZCheck();
+								mRaster.mLineBlt.mLightIntensity = MR_NORMAL_INTENSITY;
 
-							}
-							else {
+								if(lSelectedBitmap == -1) {
+									mRaster.mLineBlt.mColor = pBitmap->GetPlainColor();
+
+									BltPlainLineNoZCheck(mRaster.mLineBlt);
+
+								}
+								else {
 
-								int lColShift = pBitmap->GetXResShiftFactor(lSelectedBitmap);
-								int lRowShift = pBitmap->GetYResShiftFactor(lSelectedBitmap);
+									int lColShift = pBitmap->GetXResShiftFactor(lSelectedBitmap);
+									int lRowShift = pBitmap->GetYResShiftFactor(lSelectedBitmap);
 
-								gsLineBltParam.mBitmap = pBitmap->GetColumnBufferTable(lSelectedBitmap);
-								gsLineBltParam.mBitmapColMask = pBitmap->GetXRes(lSelectedBitmap) - 1;
-								gsLineBltParam.mBitmapRowMask = pBitmap->GetYRes(lSelectedBitmap) - 1;
+									mRaster.mLineBlt.mBitmap = pBitmap->GetColumnBufferTable(lSelectedBitmap);
+									mRaster.mLineBlt.mBitmapColMask = pBitmap->GetXRes(lSelectedBitmap) - 1;
+									mRaster.mLineBlt.mBitmapRowMask = pBitmap->GetYRes(lSelectedBitmap) - 1;
 
-								gsLineBltParam.mBitmapColInc_4096 = ((lBitmapHColVariation_16384_64 * lDepth_8) >> lColShift) / (8 * 4 * 64);
-								gsLineBltParam.mBitmapRowInc_4096 = ((lBitmapHRowVariation_16384_64 * lDepth_8) >> lRowShift) / (8 * 4 * 64);
+									mRaster.mLineBlt.mBitmapColInc_4096 = ((lBitmapHColVariation_16384_64 * lDepth_8) >> lColShift) / (8 * 4 * 64);
+									mRaster.mLineBlt.mBitmapRowInc_4096 = ((lBitmapHRowVariation_16384_64 * lDepth_8) >> lRowShift) / (8 * 4 * 64);
 
-								gsLineBltParam.mBitmapCol_4096 = (lLeft - mXRes / 2) * gsLineBltParam.mBitmapColInc_4096 + (((lBitmapVColVariation_16384 * lDepth_8 / (4 * 8)) + lBitmapCol0_4096) >> lColShift);
-								gsLineBltParam.mBitmapRow_4096 = (lLeft - mXRes / 2) * gsLineBltParam.mBitmapRowInc_4096 + (((lBitmapVRowVariation_16384 * lDepth_8 / (4 * 8)) + lBitmapRow0_4096) >> lRowShift);
+									mRaster.mLineBlt.mBitmapCol_4096 = (lLeft - mXRes / 2) * mRaster.mLineBlt.mBitmapColInc_4096 + (((lBitmapVColVariation_16384 * lDepth_8 / (4 * 8)) + lBitmapCol0_4096) >> lColShift);
+									mRaster.mLineBlt.mBitmapRow_4096 = (lLeft - mXRes / 2) * mRaster.mLineBlt.mBitmapRowInc_4096 + (((lBitmapVRowVariation_16384 * lDepth_8 / (4 * 8)) + lBitmapRow0_4096) >> lRowShift);
 
-								BltLineNoZCheck();
+									BltLineNoZCheck(mRaster.mLineBlt);
+								}
 							}
 
 						}
@@ -1006,34 +993,34 @@ void Viewport3D::RenderHorizontalSurface(int pNbVertex, const MR_2DCoordinate *
 	}
 }
 
-void BltPlainLineNoZCheck()
+void BltPlainLineNoZCheck(const MR_LineBltParam &pParam)
 {
-	if(gsLineBltParam.mBltLen > 0) {
-		memset(gsLineBltParam.mBuffer, gsLineBltParam.mColor, gsLineBltParam.mBltLen);
+	if(pParam.mBltLen > 0) {
+		memset(pParam.mBuffer, pParam.mColor, pParam.mBltLen);
 
-		for(int lCounter = 0; lCounter < gsLineBltParam.mBltLen; lCounter++) {
-			gsLineBltParam.mZBuffer[lCounter] = gsLineBltParam.mZ;
+		for(int lCounter = 0; lCounter < pParam.mBltLen; lCounter++) {
+			pParam.mZBuffer[lCounter] = pParam.mZ;
 		}
 	}
 }
 
-void BltLineNoZCheck()
+void BltLineNoZCheck(const MR_LineBltParam &pParam)
 {
 
-	MR_UInt8 *lBuffer = gsLineBltParam.mBuffer;
-	MR_UInt16 *lZBuffer = gsLineBltParam.mZBuffer;
+	MR_UInt8 *lBuffer = pParam.mBuffer;
+	MR_UInt16 *lZBuffer = pParam.mZBuffer;
 
-	MR_UInt32 lColumn_4096 = gsLineBltParam.mBitmapCol_4096;
-	MR_UInt32 lRow_4096 = gsLineBltParam.mBitmapRow_4096;
+	MR_UInt32 lColumn_4096 = pParam.mBitmapCol_4096;
+	MR_UInt32 lRow_4096 = pParam.mBitmapRow_4096;
 
-	for(int lCounter = 0; lCounter < gsLineBltParam.mBltLen; lCounter++) {
+	for(int lCounter = 0; lCounter < pParam.mBltLen; lCounter++) {
 
-		*(lBuffer++) = gsLineBltParam.mBitmap[(lColumn_4096 / 4096) & gsLineBltParam.mBitmapColMask]
-			[(lRow_4096 / 4096) & gsLineBltParam.mBitmapRowMask];
-		*(lZBuffer++) = gsLineBltParam.mZ;
+		*(lBuffer++) = pParam.mBitmap[(lColumn_4096 / 4096) & pParam.mBitmapColMask]
+			[(lRow_4096 / 4096) & pParam.mBitmapRowMask];
+		*(lZBuffer++) = pParam.mZ;
 
-		lColumn_4096 += gsLineBltParam.mBitmapColInc_4096;
-		lRow_4096 += gsLineBltParam.mBitmapRowInc_4096;
+		lColumn_4096 += pParam.mBitmapColInc_4096;
+		lRow_4096 += pParam.mBitmapRowInc_4096;
 	}
 }
 
@@ -1041,8 +1028,6 @@ void BltLineNoZCheck()
 // Patch section
 //
 
-#define MAX_PATCH_RES 16
-
 #define ON_SCREEN   0
 #define ON_RIGHT    1
 #define ON_LEFT     2
@@ -1051,11 +1036,6 @@ void BltLineNoZCheck()
 #define ON_FRONT   16
 #define ON_BACK    32
 
-static MR_3DCoordinate gsRotatedPatch[MAX_PATCH_RES * MAX_PATCH_RES];
-static int gsScreenXPatch[MAX_PATCH_RES * MAX_PATCH_RES];
-static int gsScreenYPatch[MAX_PATCH_RES * MAX_PATCH_RES];
-static int gsScreenVisibility[MAX_PATCH_RES * MAX_PATCH_RES];
-
 void Viewport3D::RenderPatch(const Patch & pPatch, const PositionMatrix & pMatrix, const Bitmap * pBitmap)
 {
 
@@ -1070,20 +1050,20 @@ void Viewport3D::RenderPatch(const Patch & pPatch, const PositionMatrix & pMatri
 	for(lCounter = 0; lCounter < lNbNodes; lCounter++) {
 		// Rotate each vertex of the patch
 
-		ApplyPositionMatrix(pMatrix, lNodeList[lCounter], gsRotatedPatch[lCounter]);
+		ApplyPositionMatrix(pMatrix, lNodeList[lCounter], mRaster.mRotatedPatch[lCounter]);
 
 		// Compute the screen coordinate of the vertex
-		gsScreenVisibility[lCounter] = ON_SCREEN;
+		mRaster.mScreenVisibility[lCounter] = ON_SCREEN;
 
-		if(gsRotatedPatch[lCounter].mX < mPlanDist / 2) {
-			gsScreenVisibility[lCounter] = ON_FRONT;
+		if(mRaster.mRotatedPatch[lCounter].mX < mPlanDist / 2) {
+			mRaster.mScreenVisibility[lCounter] = ON_FRONT;
 		}
-		else if(gsRotatedPatch[lCounter].mX / MR_ZBUFFER_UNIT > MR_ZBUFFER_LIMIT) {
-			gsScreenVisibility[lCounter] = ON_BACK;
+		else if(mRaster.mRotatedPatch[lCounter].mX / MR_ZBUFFER_UNIT > MR_ZBUFFER_LIMIT) {
+			mRaster.mScreenVisibility[lCounter] = ON_BACK;
 		}
 		else {
-			gsScreenXPatch[lCounter] = MulDiv(-gsRotatedPatch[lCounter].mY, mXRes_PlanDist, gsRotatedPatch[lCounter].mX * mPlanHW * 2) + mXRes / 2;
-			gsScreenYPatch[lCounter] = -MulDiv(gsRotatedPatch[lCounter].mZ, mYRes_PlanDist, gsRotatedPatch[lCounter].mX * mPlanVW * 2) + mYRes / 2 + mScroll;
+			mRaster.mScreenXPatch[lCounter] = MulDiv(-mRaster.mRotatedPatch[lCounter].mY, mXRes_PlanDist, mRaster.mRotatedPatch[lCounter].mX * mPlanHW * 2) + mXRes / 2;
+			mRaster.mScreenYPatch[lCounter] = -MulDiv(mRaster.mRotatedPatch[lCounter].mZ, mYRes_PlanDist, mRaster.mRotatedPatch[lCounter].mX * mPlanVW * 2) + mYRes / 2 + mScroll;
 		}
 	}
 
@@ -1096,20 +1076,21 @@ void Viewport3D::RenderPatch(const Patch & pPatch, const PositionMatrix & pMatri
 	lBitmapXRes = pBitmap->GetXRes(lSelectedBitmap);
 	lBitmapYRes = pBitmap->GetYRes(lSelectedBitmap);
 
-	gsTriangleBltParam.mBitmap = pBitmap->GetColumnBufferTable(lSelectedBitmap);
-	gsTriangleBltParam.mBitmapColMask = lBitmapXRes - 1;
-	gsTriangleBltParam.mBitmapRowMask = lBitmapYRes - 1;
+	mRaster.mTriangleBlt.mBitmap = pBitmap->GetColumnBufferTable(lSelectedBitmap);
+	mRaster.mTriangleBlt.mBitmapColMask = lBitmapXRes - 1;
+	mRaster.mTriangleBlt.mBitmapRowMask = lBitmapYRes - 1;
 
-	gsTriangleBltParam.mLightIntensity = MR_NORMAL_INTENSITY;
-	gsTriangleBltParam.mColor = pBitmap->GetPlainColor();
+	mRaster.mTriangleBlt.mLightIntensity = MR_NORMAL_INTENSITY;
+	mRaster.mTriangleBlt.mColor = pBitmap->GetPlainColor();
 
-	gsTriangleBltParam.mBuffer = mBufferLine;
-	gsTriangleBltParam.mLineLen = mLineLen;
-	gsTriangleBltParam.mXRes = mXRes;
-	gsTriangleBltParam.mYRes = mYRes;
+	mRaster.mTriangleBlt.mBuffer = mBufferLine;
+	mRaster.mTriangleBlt.mLineLen = mLineLen;
+	mRaster.mTriangleBlt.mXMin = mClipX0;
+	mRaster.mTriangleBlt.mXRes = GetClipX1();
+	mRaster.mTriangleBlt.mYRes = mYRes;
 
-	gsTriangleBltParam.mZBuffer = mZBufferLine;
-	gsTriangleBltParam.mZLineLen = mZLineLen;
+	mRaster.mTriangleBlt.mZBuffer = mZBufferLine;
+	mRaster.mTriangleBlt.mZLineLen = mZLineLen;
 
 	MR_Int32 lBitmapRowInc_4096 = lBitmapXRes * 4096 / (lVRes - 1);
 	MR_Int32 lBitmapColInc_4096 = lBitmapYRes * 4096 / (lURes - 1);
@@ -1125,38 +1106,38 @@ void Viewport3D::RenderPatch(const Patch & pPatch, const PositionMatrix & pMatri
 		MR_Int32 lBitmapCol_4096_1 = lBitmapColInc_4096;
 
 		for(int lU = 0; lU < (lURes - 1); lU++) {
-			if((gsScreenVisibility[lCounter + 1] == ON_SCREEN) && (gsScreenVisibility[lCounter + lURes] == ON_SCREEN)) {
-				if(gsScreenVisibility[lCounter] == ON_SCREEN) {
-					gsTriangleBltParam.mVertexList[0] = lCounter;
-					gsTriangleBltParam.mVertexList[1] = lCounter + 1;
-					gsTriangleBltParam.mVertexList[2] = lCounter + lURes;
+			if((mRaster.mScreenVisibility[lCounter + 1] == ON_SCREEN) && (mRaster.mScreenVisibility[lCounter + lURes] == ON_SCREEN)) {
+				if(mRaster.mScreenVisibility[lCounter] == ON_SCREEN) {
+					mRaster.mTriangleBlt.mVertexList[0] = lCounter;
+					mRaster.mTriangleBlt.mVertexList[1] = lCounter + 1;
+					mRaster.mTriangleBlt.mVertexList[2] = lCounter + lURes;
 
-					gsTriangleBltParam.mBitmapCol_4096[0] = lBitmapCol_4096_0;
-					gsTriangleBltParam.mBitmapCol_4096[1] = lBitmapCol_4096_1;
-					gsTriangleBltParam.mBitmapCol_4096[2] = lBitmapCol_4096_0;
+					mRaster.mTriangleBlt.mBitmapCol_4096[0] = lBitmapCol_4096_0;
+					mRaster.mTriangleBlt.mBitmapCol_4096[1] = lBitmapCol_4096_1;
+					mRaster.mTriangleBlt.mBitmapCol_4096[2] = lBitmapCol_4096_0;
 
-					gsTriangleBltParam.mBitmapRow_4096[0] = lBitmapRow_4096_0;
-					gsTriangleBltParam.mBitmapRow_4096[1] = lBitmapRow_4096_0;
-					gsTriangleBltParam.mBitmapRow_4096[2] = lBitmapRow_4096_1;
+					mRaster.mTriangleBlt.mBitmapRow_4096[0] = lBitmapRow_4096_0;
+					mRaster.mTriangleBlt.mBitmapRow_4096[1] = lBitmapRow_4096_0;
+					mRaster.mTriangleBlt.mBitmapRow_4096[2] = lBitmapRow_4096_1;
 
-					BltTriangle();
+					BltTriangle(mRaster);
 
 				}
 
-				if(gsScreenVisibility[lCounter + lURes + 1] == ON_SCREEN) {
-					gsTriangleBltParam.mVertexList[0] = lCounter + 1;
-					gsTriangleBltParam.mVertexList[1] = lCounter + lURes + 1;
-					gsTriangleBltParam.mVertexList[2] = lCounter + lURes;
+				if(mRaster.mScreenVisibility[lCounter + lURes + 1] == ON_SCREEN) {
+					mRaster.mTriangleBlt.mVertexList[0] = lCounter + 1;
+					mRaster.mTriangleBlt.mVertexList[1] = lCounter + lURes + 1;
+					mRaster.mTriangleBlt.mVertexList[2] = lCounter + lURes;
 
-					gsTriangleBltParam.mBitmapCol_4096[0] = lBitmapCol_4096_1;
-					gsTriangleBltParam.mBitmapCol_4096[1] = lBitmapCol_4096_1;
-					gsTriangleBltParam.mBitmapCol_4096[2] = lBitmapCol_4096_0;
+					mRaster.mTriangleBlt.mBitmapCol_4096[0] = lBitmapCol_4096_1;
+					mRaster.mTriangleBlt.mBitmapCol_4096[1] = lBitmapCol_4096_1;
+					mRaster.mTriangleBlt.mBitmapCol_4096[2] = lBitmapCol_4096_0;
 
-					gsTriangleBltParam.mBitmapRow_4096[0] = lBitmapRow_4096_0;
-					gsTriangleBltParam.mBitmapRow_4096[1] = lBitmapRow_4096_1;
-					gsTriangleBltParam.mBitmapRow_4096[2] = lBitmapRow_4096_1;
+					mRaster.mTriangleBlt.mBitmapRow_4096[0] = lBitmapRow_4096_0;
+					mRaster.mTriangleBlt.mBitmapRow_4096[1] = lBitmapRow_4096_1;
+					mRaster.mTriangleBlt.mBitmapRow_4096[2] = lBitmapRow_4096_1;
 
-					BltTriangle();
+					BltTriangle(mRaster);
 
 				}
 			}
@@ -1174,7 +1155,7 @@ void Viewport3D::RenderPatch(const Patch & pPatch, const PositionMatrix & pMatri
 
 }
 
-void BltTriangle()
+void BltTriangle(const MR_RasterState &pState)
 {
 	int lCounter;
 
@@ -1186,18 +1167,18 @@ void BltTriangle()
 	int lBottom;
 
 	MR_Int32 lDiffY[3];
-	lDiffY[0] = gsScreenYPatch[gsTriangleBltParam.mVertexList[1]] - gsScreenYPatch[gsTriangleBltParam.mVertexList[0]];
-	lDiffY[1] = gsScreenYPatch[gsTriangleBltParam.mVertexList[2]] - gsScreenYPatch[gsTriangleBltParam.mVertexList[1]];
-	lDiffY[2] = gsScreenYPatch[gsTriangleBltParam.mVertexList[0]] - gsScreenYPatch[gsTriangleBltParam.mVertexList[2]];
+	lDiffY[0] = pState.mScreenYPatch[pState.mTriangleBlt.mVertexList[1]] - pState.mScreenYPatch[pState.mTriangleBlt.mVertexList[0]];
+	lDiffY[1] = pState.mScreenYPatch[pState.mTriangleBlt.mVertexList[2]] - pState.mScreenYPatch[pState.mTriangleBlt.mVertexList[1]];
+	lDiffY[2] = pState.mScreenYPatch[pState.mTriangleBlt.mVertexList[0]] - pState.mScreenYPatch[pState.mTriangleBlt.mVertexList[2]];
 
 	if((lDiffY[0] == 0) && (lDiffY[1] == 0)) {
 		return;
 	}
 
 	MR_Int32 lDiffX[3];
-	lDiffX[0] = gsScreenXPatch[gsTriangleBltParam.mVertexList[1]] - gsScreenXPatch[gsTriangleBltParam.mVertexList[0]];
-	lDiffX[1] = gsScreenXPatch[gsTriangleBltParam.mVertexList[2]] - gsScreenXPatch[gsTriangleBltParam.mVertexList[1]];
-	lDiffX[2] = gsScreenXPatch[gsTriangleBltParam.mVertexList[0]] - gsScreenXPatch[gsTriangleBltParam.mVertexList[2]];
+	lDiffX[0] = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[1]] - pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[0]];
+	lDiffX[1] = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[2]] - pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[1]];
+	lDiffX[2] = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[0]] - pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[2]];
 
 	if((lDiffX[0] == 0) && (lDiffX[1] == 0)) {
 		return;
@@ -1306,13 +1287,13 @@ void BltTriangle()
 		}
 	}
 
-	int lTopLine = gsScreenYPatch[gsTriangleBltParam.mVertexList[lTop]];
-	int lMiddleLine = gsScreenYPatch[gsTriangleBltParam.mVertexList[lMiddle]];
-	int lBottomLine = gsScreenYPatch[gsTriangleBltParam.mVertexList[lBottom]];
+	int lTopLine = pState.mScreenYPatch[pState.mTriangleBlt.mVertexList[lTop]];
+	int lMiddleLine = pState.mScreenYPatch[pState.mTriangleBlt.mVertexList[lMiddle]];
+	int lBottomLine = pState.mScreenYPatch[pState.mTriangleBlt.mVertexList[lBottom]];
 
 	// Verify that we are on screen
 
-	if((lBottomLine <= 0) || lTopLine >= gsTriangleBltParam.mYRes) {
+	if((lBottomLine <= 0) || lTopLine >= pState.mTriangleBlt.mYRes) {
 		return;
 	}
 
@@ -1347,33 +1328,33 @@ void BltTriangle()
 	int lDV_PerPixel_4096;
 	int lDZ_PerPixel_4096;
 
-	int lUOnMiddle = gsTriangleBltParam.mBitmapCol_4096[lTop]
-		+ (gsTriangleBltParam.mBitmapCol_4096[lBottom] - gsTriangleBltParam.mBitmapCol_4096[lTop])
+	int lUOnMiddle = pState.mTriangleBlt.mBitmapCol_4096[lTop]
+		+ (pState.mTriangleBlt.mBitmapCol_4096[lBottom] - pState.mTriangleBlt.mBitmapCol_4096[lTop])
 		* (lMiddleLine - lTopLine) / (lBottomLine - lTopLine);
 
-	int lVOnMiddle = gsTriangleBltParam.mBitmapRow_4096[lTop]
-		+ (gsTriangleBltParam.mBitmapRow_4096[lBottom] - gsTriangleBltParam.mBitmapRow_4096[lTop])
+	int lVOnMiddle = pState.mTriangleBlt.mBitmapRow_4096[lTop]
+		+ (pState.mTriangleBlt.mBitmapRow_4096[lBottom] - pState.mTriangleBlt.mBitmapRow_4096[lTop])
 		* (lMiddleLine - lTopLine) / (lBottomLine - lTopLine);
 
-	int lZOnMiddle = gsRotatedPatch[gsTriangleBltParam.mVertexList[lTop]].mX * 4096 + (gsRotatedPatch[gsTriangleBltParam.mVertexList[lBottom]].mX - gsRotatedPatch[gsTriangleBltParam.mVertexList[lTop]].mX) * 4096 * (lMiddleLine - lTopLine) / (lBottomLine - lTopLine);
+	int lZOnMiddle = pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lTop]].mX * 4096 + (pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lBottom]].mX - pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lTop]].mX) * 4096 * (lMiddleLine - lTopLine) / (lBottomLine - lTopLine);
 
-	int lXOnMiddle = gsScreenXPatch[gsTriangleBltParam.mVertexList[lTop]] * 4096 + (gsScreenXPatch[gsTriangleBltParam.mVertexList[lBottom]] - gsScreenXPatch[gsTriangleBltParam.mVertexList[lTop]]) * 4096 * (lMiddleLine - lTopLine) / (lBottomLine - lTopLine);
+	int lXOnMiddle = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lTop]] * 4096 + (pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lBottom]] - pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lTop]]) * 4096 * (lMiddleLine - lTopLine) / (lBottomLine - lTopLine);
 
-	int lOnMiddleLen = gsScreenXPatch[gsTriangleBltParam.mVertexList[lMiddle]] * 4096 - lXOnMiddle;
+	int lOnMiddleLen = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lMiddle]] * 4096 - lXOnMiddle;
 
 	if(lOnMiddleLen / 1024 == 0) {
 		// ASSERT( FALSE ); // I was thinking that the case was already trap
 		return;									  // all points are on a single line
 	}
 
-	lDU_PerPixel_4096 = (gsTriangleBltParam.mBitmapCol_4096[lMiddle] - lUOnMiddle) * 4 / (lOnMiddleLen / 1024);
-	lDV_PerPixel_4096 = (gsTriangleBltParam.mBitmapRow_4096[lMiddle] - lVOnMiddle) * 4 / (lOnMiddleLen / 1024);
-	lDZ_PerPixel_4096 = (gsRotatedPatch[gsTriangleBltParam.mVertexList[lMiddle]].mX * 4096 - lZOnMiddle) * 64 / (lOnMiddleLen / 64);
+	lDU_PerPixel_4096 = (pState.mTriangleBlt.mBitmapCol_4096[lMiddle] - lUOnMiddle) * 4 / (lOnMiddleLen / 1024);
+	lDV_PerPixel_4096 = (pState.mTriangleBlt.mBitmapRow_4096[lMiddle] - lVOnMiddle) * 4 / (lOnMiddleLen / 1024);
+	lDZ_PerPixel_4096 = (pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lMiddle]].mX * 4096 - lZOnMiddle) * 64 / (lOnMiddleLen / 64);
 
 	if(lMiddleShouldBeOnRight) {
-		lDU_PerLine_4096 = (gsTriangleBltParam.mBitmapCol_4096[lBottom] - gsTriangleBltParam.mBitmapCol_4096[lTop]) / (lBottomLine - lTopLine);
-		lDV_PerLine_4096 = (gsTriangleBltParam.mBitmapRow_4096[lBottom] - gsTriangleBltParam.mBitmapRow_4096[lTop]) / (lBottomLine - lTopLine);
-		lDZ_PerLine_4096 = (gsRotatedPatch[gsTriangleBltParam.mVertexList[lBottom]].mX - gsRotatedPatch[gsTriangleBltParam.mVertexList[lTop]].mX) * 4096 / (lBottomLine - lTopLine);
+		lDU_PerLine_4096 = (pState.mTriangleBlt.mBitmapCol_4096[lBottom] - pState.mTriangleBlt.mBitmapCol_4096[lTop]) / (lBottomLine - lTopLine);
+		lDV_PerLine_4096 = (pState.mTriangleBlt.mBitmapRow_4096[lBottom] - pState.mTriangleBlt.mBitmapRow_4096[lTop]) / (lBottomLine - lTopLine);
+		lDZ_PerLine_4096 = (pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lBottom]].mX - pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lTop]].mX) * 4096 / (lBottomLine - lTopLine);
 	}
 	else {
 		// Can not be calculated now
@@ -1393,11 +1374,11 @@ void BltTriangle()
 
 	if(lSecondStop > 0) {
 		// Cut what is below the screen bottom
-		if(lSecondStop > gsTriangleBltParam.mYRes) {
-			lSecondStop = gsTriangleBltParam.mYRes - 1;
+		if(lSecondStop > pState.mTriangleBlt.mYRes) {
+			lSecondStop = pState.mTriangleBlt.mYRes - 1;
 
-			if(lFirstStop > gsTriangleBltParam.mYRes) {
-				lFirstStop = gsTriangleBltParam.mYRes - 1;
+			if(lFirstStop > pState.mTriangleBlt.mYRes) {
+				lFirstStop = pState.mTriangleBlt.mYRes - 1;
 			}
 		}
 		// If the upper part of the triangle is below the screen top, draw it
@@ -1407,16 +1388,16 @@ void BltTriangle()
 
 				lCurrentLine = lTopLine;
 
-				lXLeft_4096 = lXRight_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lTop]] * 4096;
+				lXLeft_4096 = lXRight_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lTop]] * 4096;
 
-				lU_4096 = gsTriangleBltParam.mBitmapCol_4096[lTop];
-				lV_4096 = gsTriangleBltParam.mBitmapRow_4096[lTop];
-				lZ_4096 = gsRotatedPatch[gsTriangleBltParam.mVertexList[lTop]].mX * 4096;
+				lU_4096 = pState.mTriangleBlt.mBitmapCol_4096[lTop];
+				lV_4096 = pState.mTriangleBlt.mBitmapRow_4096[lTop];
+				lZ_4096 = pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lTop]].mX * 4096;
 
 				if(!lMiddleShouldBeOnRight) {
-					lDU_PerLine_4096 = (gsTriangleBltParam.mBitmapCol_4096[lMiddle] - gsTriangleBltParam.mBitmapCol_4096[lTop]) / (lMiddleLine - lTopLine);
-					lDV_PerLine_4096 = (gsTriangleBltParam.mBitmapRow_4096[lMiddle] - gsTriangleBltParam.mBitmapRow_4096[lTop]) / (lMiddleLine - lTopLine);
-					lDZ_PerLine_4096 = (gsRotatedPatch[gsTriangleBltParam.mVertexList[lMiddle]].mX - gsRotatedPatch[gsTriangleBltParam.mVertexList[lTop]].mX) * 4096 / (lMiddleLine - lTopLine);
+					lDU_PerLine_4096 = (pState.mTriangleBlt.mBitmapCol_4096[lMiddle] - pState.mTriangleBlt.mBitmapCol_4096[lTop]) / (lMiddleLine - lTopLine);
+					lDV_PerLine_4096 = (pState.mTriangleBlt.mBitmapRow_4096[lMiddle] - pState.mTriangleBlt.mBitmapRow_4096[lTop]) / (lMiddleLine - lTopLine);
+					lDZ_PerLine_4096 = (pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lMiddle]].mX - pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lTop]].mX) * 4096 / (lMiddleLine - lTopLine);
 				}
 
 				if(lCurrentLine < 0) {
@@ -1431,35 +1412,35 @@ void BltTriangle()
 
 				}
 
-				lLineBuffer = gsTriangleBltParam.mBuffer[lCurrentLine];
-				lLineZBuffer = gsTriangleBltParam.mZBuffer[lCurrentLine];
+				lLineBuffer = pState.mTriangleBlt.mBuffer[lCurrentLine];
+				lLineZBuffer = pState.mTriangleBlt.mZBuffer[lCurrentLine];
 
 				while(lCurrentLine < lFirstStop) {
 
 					int lXLeft = lXLeft_4096 / 4096;
 					int lXRight = lXRight_4096 / 4096;
 
-					if((lXLeft < gsTriangleBltParam.mXRes) && (lXLeft < lXRight)) {
+					if((lXLeft < pState.mTriangleBlt.mXRes) && (lXLeft < lXRight)) {
 						int lLocalU_4096 = lU_4096;
 						int lLocalV_4096 = lV_4096;
 						int lLocalZ_4096 = lZ_4096;
 
-						if(lXRight > gsTriangleBltParam.mXRes) {
-							lXRight = gsTriangleBltParam.mXRes;
+						if(lXRight > pState.mTriangleBlt.mXRes) {
+							lXRight = pState.mTriangleBlt.mXRes;
 						}
 
-						if(lXLeft < 0) {
-							lLocalU_4096 += -lXLeft * lDU_PerPixel_4096;
-							lLocalV_4096 += -lXLeft * lDV_PerPixel_4096;
-							lLocalZ_4096 += -lXLeft * lDZ_PerPixel_4096;
-							lXLeft = 0;
+						if(lXLeft < pState.mTriangleBlt.mXMin) {
+							lLocalU_4096 += (pState.mTriangleBlt.mXMin - lXLeft) * lDU_PerPixel_4096;
+							lLocalV_4096 += (pState.mTriangleBlt.mXMin - lXLeft) * lDV_PerPixel_4096;
+							lLocalZ_4096 += (pState.mTriangleBlt.mXMin - lXLeft) * lDZ_PerPixel_4096;
+							lXLeft = pState.mTriangleBlt.mXMin;
 						}
 
 						while(lXLeft < lXRight) {
 							if(lLineZBuffer[lXLeft] >= lLocalZ_4096 / (4096 * MR_ZBUFFER_UNIT)) {
 								lLineZBuffer[lXLeft] = static_cast<MR_UInt16>(lLocalZ_4096 / (4096 * MR_ZBUFFER_UNIT));
-								lLineBuffer[lXLeft] = gsTriangleBltParam.mBitmap[(lLocalU_4096 / 4096) & gsTriangleBltParam.mBitmapColMask]
-									[(lLocalV_4096 / 4096) & gsTriangleBltParam.mBitmapRowMask];
+								lLineBuffer[lXLeft] = pState.mTriangleBlt.mBitmap[(lLocalU_4096 / 4096) & pState.mTriangleBlt.mBitmapColMask]
+									[(lLocalV_4096 / 4096) & pState.mTriangleBlt.mBitmapRowMask];
 							}
 
 							lXLeft++;
@@ -1472,8 +1453,8 @@ void BltTriangle()
 					}
 					lCurrentLine++;
 
-					lLineBuffer += gsTriangleBltParam.mLineLen;
-					lLineZBuffer += gsTriangleBltParam.mZLineLen;
+					lLineBuffer += pState.mTriangleBlt.mLineLen;
+					lLineZBuffer += pState.mTriangleBlt.mZLineLen;
 
 					lXLeft_4096 += lLeftSlope;
 					lXRight_4096 += lRightSlope;
@@ -1488,21 +1469,21 @@ void BltTriangle()
 
 				if(lFirstStop != lSecondStop) {
 					if(!lMiddleShouldBeOnRight) {
-						lU_4096 = gsTriangleBltParam.mBitmapCol_4096[lMiddle];
-						lV_4096 = gsTriangleBltParam.mBitmapRow_4096[lMiddle];
-						lZ_4096 = gsRotatedPatch[gsTriangleBltParam.mVertexList[lMiddle]].mX * 4096;
+						lU_4096 = pState.mTriangleBlt.mBitmapCol_4096[lMiddle];
+						lV_4096 = pState.mTriangleBlt.mBitmapRow_4096[lMiddle];
+						lZ_4096 = pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lMiddle]].mX * 4096;
 
-						lDU_PerLine_4096 = (gsTriangleBltParam.mBitmapCol_4096[lBottom] - gsTriangleBltParam.mBitmapCol_4096[lMiddle]) / (lBottomLine - lMiddleLine);
-						lDV_PerLine_4096 = (gsTriangleBltParam.mBitmapRow_4096[lBottom] - gsTriangleBltParam.mBitmapRow_4096[lMiddle]) / (lBottomLine - lMiddleLine);
-						lDZ_PerLine_4096 = (gsRotatedPatch[gsTriangleBltParam.mVertexList[lBottom]].mX - gsRotatedPatch[gsTriangleBltParam.mVertexList[lMiddle]].mX) * 4096 / (lBottomLine - lMiddleLine);
+						lDU_PerLine_4096 = (pState.mTriangleBlt.mBitmapCol_4096[lBottom] - pState.mTriangleBlt.mBitmapCol_4096[lMiddle]) / (lBottomLine - lMiddleLine);
+						lDV_PerLine_4096 = (pState.mTriangleBlt.mBitmapRow_4096[lBottom] - pState.mTriangleBlt.mBitmapRow_4096[lMiddle]) / (lBottomLine - lMiddleLine);
+						lDZ_PerLine_4096 = (pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lBottom]].mX - pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lMiddle]].mX) * 4096 / (lBottomLine - lMiddleLine);
 					}
 
 					if(lMiddleShouldBeOnRight) {
-						lXRight_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lMiddle]] * 4096;
+						lXRight_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lMiddle]] * 4096;
 						lRightSlope = lBottomSlope;
 					}
 					else {
-						lXLeft_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lMiddle]] * 4096;
+						lXLeft_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lMiddle]] * 4096;
 						lLeftSlope = lBottomSlope;
 					}
 				}
@@ -1515,30 +1496,30 @@ void BltTriangle()
 				if(lFirstStop != lSecondStop) {
 
 					if(lMiddleShouldBeOnRight) {
-						lU_4096 = gsTriangleBltParam.mBitmapCol_4096[lTop];
-						lV_4096 = gsTriangleBltParam.mBitmapRow_4096[lTop];
-						lZ_4096 = gsRotatedPatch[gsTriangleBltParam.mVertexList[lTop]].mX * 4096;
+						lU_4096 = pState.mTriangleBlt.mBitmapCol_4096[lTop];
+						lV_4096 = pState.mTriangleBlt.mBitmapRow_4096[lTop];
+						lZ_4096 = pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lTop]].mX * 4096;
 
 					}
 					else {
-						lU_4096 = gsTriangleBltParam.mBitmapCol_4096[lMiddle];
-						lV_4096 = gsTriangleBltParam.mBitmapRow_4096[lMiddle];
-						lZ_4096 = gsRotatedPatch[gsTriangleBltParam.mVertexList[lMiddle]].mX * 4096;
+						lU_4096 = pState.mTriangleBlt.mBitmapCol_4096[lMiddle];
+						lV_4096 = pState.mTriangleBlt.mBitmapRow_4096[lMiddle];
+						lZ_4096 = pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lMiddle]].mX * 4096;
 
-						lDU_PerLine_4096 = (gsTriangleBltParam.mBitmapCol_4096[lBottom] - gsTriangleBltParam.mBitmapCol_4096[lMiddle]) / (lBottomLine - lMiddleLine);
-						lDV_PerLine_4096 = (gsTriangleBltParam.mBitmapRow_4096[lBottom] - gsTriangleBltParam.mBitmapRow_4096[lMiddle]) / (lBottomLine - lMiddleLine);
-						lDZ_PerLine_4096 = (gsRotatedPatch[gsTriangleBltParam.mVertexList[lBottom]].mX - gsRotatedPatch[gsTriangleBltParam.mVertexList[lMiddle]].mX) * 4096 / (lBottomLine - lMiddleLine);
+						lDU_PerLine_4096 = (pState.mTriangleBlt.mBitmapCol_4096[lBottom] - pState.mTriangleBlt.mBitmapCol_4096[lMiddle]) / (lBottomLine - lMiddleLine);
+						lDV_PerLine_4096 = (pState.mTriangleBlt.mBitmapRow_4096[lBottom] - pState.mTriangleBlt.mBitmapRow_4096[lMiddle]) / (lBottomLine - lMiddleLine);
+						lDZ_PerLine_4096 = (pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lBottom]].mX - pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lMiddle]].mX) * 4096 / (lBottomLine - lMiddleLine);
 					}
 
 					if(lMiddleShouldBeOnRight) {
-						lXLeft_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lTop]] * 4096;
-						lXRight_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lMiddle]] * 4096;
+						lXLeft_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lTop]] * 4096;
+						lXRight_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lMiddle]] * 4096;
 
 						lRightSlope = lBottomSlope;
 					}
 					else {
-						lXLeft_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lMiddle]] * 4096;
-						lXRight_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lTop]] * 4096;
+						lXLeft_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lMiddle]] * 4096;
+						lXRight_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lTop]] * 4096;
 
 						lLeftSlope = lBottomSlope;
 					}
@@ -1550,9 +1531,9 @@ void BltTriangle()
 			lCurrentLine = 0;
 
 			if(lMiddleShouldBeOnRight) {
-				lU_4096 = gsTriangleBltParam.mBitmapCol_4096[lTop];
-				lV_4096 = gsTriangleBltParam.mBitmapRow_4096[lTop];
-				lZ_4096 = gsRotatedPatch[gsTriangleBltParam.mVertexList[lTop]].mX * 4096;
+				lU_4096 = pState.mTriangleBlt.mBitmapCol_4096[lTop];
+				lV_4096 = pState.mTriangleBlt.mBitmapRow_4096[lTop];
+				lZ_4096 = pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lTop]].mX * 4096;
 
 				lU_4096 += -lTopLine * lDU_PerLine_4096;
 				lV_4096 += -lTopLine * lDV_PerLine_4096;
@@ -1560,13 +1541,13 @@ void BltTriangle()
 
 			}
 			else {
-				lU_4096 = gsTriangleBltParam.mBitmapCol_4096[lMiddle];
-				lV_4096 = gsTriangleBltParam.mBitmapRow_4096[lMiddle];
-				lZ_4096 = gsRotatedPatch[gsTriangleBltParam.mVertexList[lMiddle]].mX * 4096;
+				lU_4096 = pState.mTriangleBlt.mBitmapCol_4096[lMiddle];
+				lV_4096 = pState.mTriangleBlt.mBitmapRow_4096[lMiddle];
+				lZ_4096 = pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lMiddle]].mX * 4096;
 
-				lDU_PerLine_4096 = (gsTriangleBltParam.mBitmapCol_4096[lBottom] - gsTriangleBltParam.mBitmapCol_4096[lMiddle]) / (lBottomLine - lMiddleLine);
-				lDV_PerLine_4096 = (gsTriangleBltParam.mBitmapRow_4096[lBottom] - gsTriangleBltParam.mBitmapRow_4096[lMiddle]) / (lBottomLine - lMiddleLine);
-				lDZ_PerLine_4096 = (gsRotatedPatch[gsTriangleBltParam.mVertexList[lBottom]].mX - gsRotatedPatch[gsTriangleBltParam.mVertexList[lMiddle]].mX) * 4096 / (lBottomLine - lMiddleLine);
+				lDU_PerLine_4096 = (pState.mTriangleBlt.mBitmapCol_4096[lBottom] - pState.mTriangleBlt.mBitmapCol_4096[lMiddle]) / (lBottomLine - lMiddleLine);
+				lDV_PerLine_4096 = (pState.mTriangleBlt.mBitmapRow_4096[lBottom] - pState.mTriangleBlt.mBitmapRow_4096[lMiddle]) / (lBottomLine - lMiddleLine);
+				lDZ_PerLine_4096 = (pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lBottom]].mX - pState.mRotatedPatch[pState.mTriangleBlt.mVertexList[lMiddle]].mX) * 4096 / (lBottomLine - lMiddleLine);
 
 				lU_4096 += -lMiddleLine * lDU_PerLine_4096;
 				lV_4096 += -lMiddleLine * lDV_PerLine_4096;
@@ -1575,8 +1556,8 @@ void BltTriangle()
 			}
 
 			if(lMiddleShouldBeOnRight) {
-				lXLeft_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lTop]] * 4096;
-				lXRight_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lMiddle]] * 4096;
+				lXLeft_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lTop]] * 4096;
+				lXRight_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lMiddle]] * 4096;
 
 				lRightSlope = lBottomSlope;
 
@@ -1585,8 +1566,8 @@ void BltTriangle()
 
 			}
 			else {
-				lXLeft_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lMiddle]] * 4096;
-				lXRight_4096 = gsScreenXPatch[gsTriangleBltParam.mVertexList[lTop]] * 4096;
+				lXLeft_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lMiddle]] * 4096;
+				lXRight_4096 = pState.mScreenXPatch[pState.mTriangleBlt.mVertexList[lTop]] * 4096;
 
 				lLeftSlope = lBottomSlope;
 
@@ -1596,34 +1577,34 @@ void BltTriangle()
 		}
 
 		// Draw the bottom part of the triangle
-		lLineBuffer = gsTriangleBltParam.mBuffer[lCurrentLine];
-		lLineZBuffer = gsTriangleBltParam.mZBuffer[lCurrentLine];
+		lLineBuffer = pState.mTriangleBlt.mBuffer[lCurrentLine];
+		lLineZBuffer = pState.mTriangleBlt.mZBuffer[lCurrentLine];
 
 		while(lCurrentLine < lSecondStop) {
 			int lXLeft = lXLeft_4096 / 4096;
 			int lXRight = lXRight_4096 / 4096;
 
-			if((lXLeft < gsTriangleBltParam.mXRes) && (lXLeft < lXRight)) {
+			if((lXLeft < pState.mTriangleBlt.mXRes) && (lXLeft < lXRight)) {
 				int lLocalU_4096 = lU_4096;
 				int lLocalV_4096 = lV_4096;
 				int lLocalZ_4096 = lZ_4096;
 
-				if(lXRight > gsTriangleBltParam.mXRes) {
-					lXRight = gsTriangleBltParam.mXRes;
+				if(lXRight > pState.mTriangleBlt.mXRes) {
+					lXRight = pState.mTriangleBlt.mXRes;
 				}
 
-				if(lXLeft < 0) {
-					lLocalU_4096 += -lXLeft * lDU_PerPixel_4096;
-					lLocalV_4096 += -lXLeft * lDV_PerPixel_4096;
-					lLocalZ_4096 += -lXLeft * lDZ_PerPixel_4096;
-					lXLeft = 0;
+				if(lXLeft < pState.mTriangleBlt.mXMin) {
+					lLocalU_4096 += (pState.mTriangleBlt.mXMin - lXLeft) * lDU_PerPixel_4096;
+					lLocalV_4096 += (pState.mTriangleBlt.mXMin - lXLeft) * lDV_PerPixel_4096;
+					lLocalZ_4096 += (pState.mTriangleBlt.mXMin - lXLeft) * lDZ_PerPixel_4096;
+					lXLeft = pState.mTriangleBlt.mXMin;
 				}
 
 				while(lXLeft < lXRight) {
 					if(lLineZBuffer[lXLeft] >= lLocalZ_4096 / (4096 * MR_ZBUFFER_UNIT)) {
 						lLineZBuffer[lXLeft] = static_cast<MR_UInt16>(lLocalZ_4096 / (4096 * MR_ZBUFFER_UNIT));
-						lLineBuffer[lXLeft] = gsTriangleBltParam.mBitmap[(lLocalU_4096 / 4096) & gsTriangleBltParam.mBitmapColMask]
-							[(lLocalV_4096 / 4096) & gsTriangleBltParam.mBitmapRowMask];
+						lLineBuffer[lXLeft] = pState.mTriangleBlt.mBitmap[(lLocalU_4096 / 4096) & pState.mTriangleBlt.mBitmapColMask]
+							[(lLocalV_4096 / 4096) & pState.mTriangleBlt.mBitmapRowMask];
 					}
 
 					lXLeft++;
@@ -1635,8 +1616,8 @@ void BltTriangle()
 			}
 			lCurrentLine++;
 
-			lLineBuffer += gsTriangleBltParam.mLineLen;
-			lLineZBuffer += gsTriangleBltParam.mZLineLen;
+			lLineBuffer += pState.mTriangleBlt.mLineLen;
+			lLineZBuffer += pState.mTriangleBlt.mZLineLen;
 
 			lXLeft_4096 += lLeftSlope;
 			lXRight_4096 += lRightSlope;
@@ -1670,7 +1651,9 @@ void Viewport3D::RenderBackground(const MR_UInt8 * pBitmap)
 		return;
 	}
 
-	for(int lColumn = 0; lColumn < mXRes; lColumn++) {
+	int lClipX1 = GetClipX1();
+
+	for(int lColumn = mClipX0; lColumn < lClipX1; lColumn++) {
 		int lRow;
 		int lBitmapColumn = (MR_BACK_X_RES + ((MR_PI / 2 - mOrientation) * MR_BACK_X_RES / MR_2PI) + mBackgroundConst[lColumn].mBitmapColumn) & (MR_BACK_X_RES - 1);
 		MR_UInt8 *lDest = mBufferLine[lStartingLine] + lColumn;
@@ -0,0 +1,272 @@
+
+// Race.cpp
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StdAfx.h"
+
+#include "../engine/MainCharacter/MainCharacter.h"
+#include "../engine/Net/Prediction.h"
+#include "../engine/Exception.h"
+
+#include "Race.h"
+
+using namespace HoverRace::Net;
+
+namespace HoverRace {
+namespace Server {
+
+namespace {
+	/// Inputs for slices further ahead of the simulation than this (in ms)
+	/// are dropped, so a client with a runaway clock can't pile them up.
+	const MR_SimulationTime MAX_INPUT_LEAD = 1000;
+}
+
+/**
+ * Constructor.
+ * @param trackName The name of the track.
+ * @param track The track (will be loaded for this race).
+ * @param laps The number of laps.
+ * @param gameOpts The game options (see OPT_ALLOW_* in Level.h).
+ * @param maxPlayers The maximum number of players.
+ * @throws Exception The track failed to load.
+ */
+Race::Race(const std::string &trackName, Model::TrackPtr track,
+	int laps, char gameOpts, int maxPlayers) :
+	trackName(trackName), laps(laps), gameOpts(gameOpts),
+	stateDelta(MainCharacter::MainCharacter::NET_STATE_FIELDS,
+		MainCharacter::MainCharacter::NUM_NET_STATE_FIELDS,
+		MainCharacter::MainCharacter::NET_STATE_SIZE),
+	session(false), players(static_cast<size_t>(maxPlayers)), numPlayers(0),
+	pendingTime(0)
+{
+	if (!session.LoadNew(trackName.c_str(), std::move(track), gameOpts)) {
+		throw Exception("Unable to load track: " + trackName);
+	}
+	if (session.GetCurrentLevel()->GetPlayerCount() < 1) {
+		throw Exception("Track has no starting positions: " + trackName);
+	}
+	session.SetSimulationTime(0);
+}
+
+Race::~Race()
+{
+	// The hovercraft are owned by the level, which goes with the session.
+}
+
+/**
+ * Add a new hovercraft to the race.
+ * @param name The player name.
+ * @param hoverModel The requested craft (may be changed if the game options
+ *                   don't allow it).
+ * @return The player index, or @c -1 if the race is full.
+ */
+int Race::AddPlayer(const std::string &name, int hoverModel)
+{
+	auto iter = std::find_if(players.begin(), players.end(),
+		[](const Player &player) { return player.ch == nullptr; });
+	if (iter == players.end()) return -1;
+
+	int idx = static_cast<int>(iter - players.begin());
+
+	MainCharacter::MainCharacter *ch =
+		MainCharacter::MainCharacter::New(idx, gameOpts);
+	if (!ch) {
+		throw Exception("Unable to create hovercraft");
+	}
+
+	Model::Level *level = session.GetCurrentLevel();
+	int start = idx % level->GetPlayerCount();
+
+	ch->mRoom = level->GetStartingRoom(start);
+	ch->mPosition = level->GetStartingPos(start);
+	ch->SetOrientation(level->GetStartingOrientation(start));
+	ch->SetHoverId(idx);
+	ch->SetHoverModel(hoverModel);
+	ch->SetNbLapForRace(laps);
+	ch->SetAsMaster();
+	ch->SetSimulationTime(session.GetSimulationTime());
+
+	Player &player = *iter;
+	player.name = name;
+	player.ch = ch;
+	player.handle = level->InsertElement(ch, ch->mRoom);
+	player.pending.clear();
+	player.lastSeq = 0;
+	player.receivedSeq = 0;
+	player.controls = 0;
+
+	numPlayers++;
+
+	return idx;
+}
+
+/**
+ * Remove a hovercraft from the race.
+ * @param idx The player index.
+ */
+void Race::RemovePlayer(int idx)
+{
+	Player &player = players.at(static_cast<size_t>(idx));
+	if (!player.ch) return;
+
+	session.GetCurrentLevel()->DeleteElement(player.handle);
+
+	player = Player();
+	numPlayers--;
+}
+
+/**
+ * Queue the controls that a client sent.
+ * @param idx The player index.
+ * @param seq The input sequence number; inputs that are not newer than the
+ *            last one received are ignored.
+ * @param sliceTime The simulation time at the start of the slice that the
+ *                  controls are for.
+ * @param controls The control bits (see RaceProtocol::Control).
+ */
+void Race::SetInput(int idx, MR_UInt32 seq, MR_SimulationTime sliceTime,
+	MR_UInt32 controls)
+{
+	Player &player = players.at(static_cast<size_t>(idx));
+	if (!player.ch) return;
+
+	// Sequence numbers may wrap.
+	if (static_cast<MR_Int32>(seq - player.receivedSeq) <= 0 && player.receivedSeq != 0) {
+		return;
+	}
+
+	if (sliceTime - session.GetSimulationTime() > MAX_INPUT_LEAD) return;
+
+	player.receivedSeq = seq;
+
+	Input &input = player.pending[sliceTime];
+	input.seq = seq;
+	input.controls = controls;
+}
+
+/**
+ * Apply a player's controls for the slice that is about to be simulated.
+ * Inputs that arrived too late for their own slice are applied to this one
+ * instead; if there is no input for this slice, the controls are held.
+ * @param player The player.
+ * @param sliceTime The simulation time at the start of the slice.
+ */
+void Race::ApplyInput(Player &player, MR_SimulationTime sliceTime)
+{
+	MR_UInt32 prevControls = player.controls;
+
+	auto end = player.pending.upper_bound(sliceTime);
+	if (end != player.pending.begin()) {
+		const Input &input = std::prev(end)->second;
+		player.lastSeq = input.seq;
+		player.controls = input.controls;
+		player.pending.erase(player.pending.begin(), end);
+	}
+
+	// Applied every slice, the same way the client's prediction does.
+	Prediction::ApplyControls(player.ch, player.controls, prevControls);
+}
+
+/**
+ * Run the simulation.
+ * The simulation is only advanced in whole slices, applying each player's
+ * input for each slice; the remainder is carried over to the next call.
+ * @param duration The time to advance, in milliseconds.
+ */
+void Race::Advance(MR_SimulationTime duration)
+{
+	if (duration > 0) {
+		pendingTime += duration;
+	}
+
+	while (pendingTime >= Model::GameSession::SIMULATION_SLICE) {
+		MR_SimulationTime now = session.GetSimulationTime();
+		for (auto &player : players) {
+			if (!player.ch) continue;
+			ApplyInput(player, now);
+			player.ch->SetSimulationTime(now);
+		}
+
+		session.Step();
+		pendingTime -= Model::GameSession::SIMULATION_SLICE;
+	}
+}
+
+/**
+ * Capture the state of every hovercraft.
+ * @param seq The STATE sequence number.
+ * @param[out] snap The snapshot (any previous contents are replaced; the
+ *                  storage is reused).
+ */
+void Race::TakeSnapshot(MR_UInt32 seq, Snapshot &snap) const
+{
+	const size_t stateLen = static_cast<size_t>(stateDelta.GetStateLength());
+
+	snap.seq = seq;
+	snap.simTime = session.GetSimulationTime();
+	snap.count = numPlayers;
+	snap.present.assign(players.size(), false);
+	snap.states.resize(players.size() * stateLen);
+
+	for (size_t i = 0; i < players.size(); i++) {
+		const Player &player = players[i];
+		if (!player.ch) continue;
+
+		snap.present[i] = true;
+		player.ch->PackNetState(&snap.states[i * stateLen]);
+	}
+}
+
+/**
+ * Write a STATE message for one client.
+ * @param msg The message (the message type has already been written).
+ * @param snap The current state.
+ * @param base The last state that the client acknowledged, or @c nullptr
+ *             to send every hovercraft in full.
+ * @param recipient The client's player index.
+ */
+void Race::WriteState(RaceProtocol::Writer &msg, const Snapshot &snap,
+	const Snapshot *base, int recipient) const
+{
+	const size_t stateLen = static_cast<size_t>(stateDelta.GetStateLength());
+
+	msg.Write(snap.seq);
+	msg.Write(base ? base->seq : static_cast<MR_UInt32>(0));
+	msg.Write(static_cast<MR_UInt32>(snap.simTime));
+	msg.Write(players.at(static_cast<size_t>(recipient)).lastSeq);
+	msg.Write(static_cast<MR_UInt8>(snap.count));
+
+	for (size_t i = 0; i < snap.present.size(); i++) {
+		if (!snap.present[i]) continue;
+
+		const MR_UInt8 *cur = &snap.states[i * stateLen];
+		if (base && base->present[i]) {
+			msg.Write(static_cast<MR_UInt8>(i | RaceProtocol::STATE_FROM_BASELINE));
+			stateDelta.Write(msg, &base->states[i * stateLen], cur);
+		}
+		else {
+			msg.Write(static_cast<MR_UInt8>(i));
+			stateDelta.Write(msg, nullptr, cur);
+		}
+	}
+}
+
+}  // namespace Server
+}  // namespace HoverRace
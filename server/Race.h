@@ -0,0 +1,129 @@
+
+// Race.h
+// A race hosted by the dedicated server.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include "../engine/Model/GameSession.h"
+#include "../engine/Net/RaceProtocol.h"
+#include "../engine/Net/StateDelta.h"
+
+namespace HoverRace {
+	namespace MainCharacter {
+		class MainCharacter;
+	}
+}
+
+namespace HoverRace {
+namespace Server {
+
+/**
+ * A single race, simulated authoritatively by the server.
+ *
+ * The race owns its own GameSession; the hovercraft are all simulated in
+ * master mode from the inputs that the clients send.  Each input is tagged
+ * with the slice it was sampled for, and is held until the simulation
+ * reaches that slice, so the server applies the same input to the same
+ * slice as the client's prediction did.
+ *
+ * @author Michael Imamura
+ */
+class Race
+{
+	public:
+		Race(const std::string &trackName, Model::TrackPtr track,
+			int laps, char gameOpts, int maxPlayers);
+		Race(const Race&) = delete;
+		~Race();
+
+		Race &operator=(const Race&) = delete;
+
+	public:
+		/// The state of every hovercraft at one point in time.
+		struct Snapshot
+		{
+			Snapshot() : seq(0), simTime(0), count(0) { }
+
+			MR_UInt32 seq;  ///< STATE sequence number (0 if unused).
+			MR_SimulationTime simTime;
+			int count;  ///< Number of hovercraft present.
+			std::vector<bool> present;  ///< Indexed by player.
+			std::vector<MR_UInt8> states;  ///< Net state of each player, back-to-back.
+		};
+
+	public:
+		const std::string &GetTrackName() const { return trackName; }
+		int GetLaps() const { return laps; }
+		int GetMaxPlayers() const { return static_cast<int>(players.size()); }
+		int GetPlayerCount() const { return numPlayers; }
+		MR_SimulationTime GetSimulationTime() const { return session.GetSimulationTime(); }
+
+		int AddPlayer(const std::string &name, int hoverModel);
+		void RemovePlayer(int idx);
+
+		void SetInput(int idx, MR_UInt32 seq, MR_SimulationTime sliceTime,
+			MR_UInt32 controls);
+
+		void Advance(MR_SimulationTime duration);
+
+		void TakeSnapshot(MR_UInt32 seq, Snapshot &snap) const;
+		void WriteState(Net::RaceProtocol::Writer &msg, const Snapshot &snap,
+			const Snapshot *base, int recipient) const;
+
+	private:
+		struct Input
+		{
+			MR_UInt32 seq;
+			MR_UInt32 controls;
+		};
+		typedef std::map<MR_SimulationTime, Input> inputs_t;
+
+		struct Player
+		{
+			Player() : ch(nullptr), handle(nullptr),
+				lastSeq(0), receivedSeq(0), controls(0) { }
+
+			std::string name;
+			MainCharacter::MainCharacter *ch;  ///< Owned by the level; @c nullptr if slot is free.
+			MR_FreeElementHandle handle;
+			inputs_t pending;  ///< Received inputs, by the slice they're for.
+			MR_UInt32 lastSeq;  ///< Sequence number of the last applied input.
+			MR_UInt32 receivedSeq;  ///< Sequence number of the last received input.
+			MR_UInt32 controls;
+		};
+
+		void ApplyInput(Player &player, MR_SimulationTime sliceTime);
+
+	private:
+		std::string trackName;
+		int laps;
+		char gameOpts;
+
+		Net::StateDelta stateDelta;
+
+		Model::GameSession session;
+		std::vector<Player> players;
+		int numPlayers;
+		MR_SimulationTime pendingTime;  ///< Leftover time from Advance() (less than a slice).
+};
+
+}  // namespace Server
+}  // namespace HoverRace
@@ -0,0 +1,287 @@
+
+// RaceHost.cpp
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StdAfx.h"
+
+#include "../engine/Util/Log.h"
+
+#include "Race.h"
+#include "Shard.h"
+
+#include "RaceHost.h"
+
+using namespace HoverRace::Net;
+using namespace HoverRace::Util;
+using boost::asio::ip::udp;
+
+namespace HoverRace {
+namespace Server {
+
+namespace {
+	/// The simulation runs in 15 ms slices, so tick at the same rate.
+	const auto TICK_DURATION = std::chrono::milliseconds(15);
+
+	/// If the race falls further behind than this, skip ahead instead of
+	/// trying to catch up.
+	const auto MAX_CATCH_UP = std::chrono::milliseconds(250);
+
+	/// Clients that haven't sent anything for this long are dropped.
+	const auto CLIENT_TIMEOUT = std::chrono::seconds(10);
+
+	/// Number of sent states to keep as baselines; clients whose last
+	/// acknowledgement is older than this get the full state.
+	const size_t HISTORY_SIZE = 32;
+}
+
+/**
+ * Constructor.
+ * @param shard The shard that the race is pinned to.
+ * @param id The race ID that clients use to join.
+ * @param race The race to host.
+ * @param stateInterval The number of ticks between state broadcasts.
+ */
+RaceHost::RaceHost(Shard &shard, int id, std::shared_ptr<Race> race,
+	int stateInterval) :
+	shard(shard), id(id), race(std::move(race)),
+	stateInterval(stateInterval < 1 ? 1 : stateInterval),
+	tickTimer(shard.GetIoService()), numClients(0),
+	history(HISTORY_SIZE), stateSeq(0),
+	ticksUntilState(0), stopping(false)
+{
+}
+
+/**
+ * Start running the race.
+ * Must be called on the shard's thread.
+ */
+void RaceHost::Start()
+{
+	Log::Info("Race %d: %s (%d laps) on shard %d",
+		id, race->GetTrackName().c_str(), race->GetLaps(), shard.GetId());
+
+	lastTick = clock_t::now();
+	nextTick = lastTick + TICK_DURATION;
+
+	ScheduleTick();
+}
+
+/**
+ * Stop running the race.
+ * Must be called on the shard's thread.
+ */
+void RaceHost::Stop()
+{
+	stopping = true;
+
+	boost::system::error_code err;
+	tickTimer.cancel(err);
+}
+
+/**
+ * Handle a message from a client.
+ * Must be called on the shard's thread.
+ * @param sender The client address.
+ * @param data The message.
+ * @param len The length of the message.
+ */
+void RaceHost::OnDatagram(const udp::endpoint &sender,
+	const MR_UInt8 *data, size_t len)
+{
+	if (stopping) return;
+
+	RaceProtocol::Reader msg(data, len);
+
+	switch (msg.ReadMsg()) {
+		case RaceProtocol::Msg::JOIN: OnJoin(sender, msg); break;
+		case RaceProtocol::Msg::INPUT: OnInput(sender, msg); break;
+		case RaceProtocol::Msg::LEAVE: OnLeave(sender); break;
+		default:
+			// Ignore anything we don't understand.
+			break;
+	}
+}
+
+void RaceHost::OnJoin(const udp::endpoint &sender, RaceProtocol::Reader &msg)
+{
+	// The shard has already checked the version and race ID.
+	msg.ReadUInt16();
+	msg.ReadUInt16();
+	int hoverModel = msg.ReadUInt8();
+	std::string name = msg.ReadString();
+	if (!msg.IsOk()) return;
+
+	auto iter = clients.find(sender);
+	if (iter == clients.end()) {
+		int idx = race->AddPlayer(name, hoverModel);
+		if (idx < 0) {
+			shard.Reject(sender, "Race is full");
+			return;
+		}
+
+		Client client;
+		client.playerIdx = idx;
+		client.ackedState = 0;
+		iter = clients.insert(clients_t::value_type(sender, client)).first;
+		numClients = static_cast<int>(clients.size());
+
+		std::ostringstream oss;
+		oss << sender;
+		Log::Info("Race %d: Player %d (%s) joined from %s",
+			id, idx, name.c_str(), oss.str().c_str());
+	}
+	iter->second.lastHeard = clock_t::now();
+
+	// Always answer, since the client will retry if the welcome is lost.
+	RaceProtocol::Writer welcome(RaceProtocol::Msg::WELCOME);
+	welcome.
+		Write(static_cast<MR_UInt8>(iter->second.playerIdx)).
+		Write(static_cast<MR_UInt32>(race->GetSimulationTime())).
+		Write(race->GetTrackName()).
+		Write(static_cast<MR_UInt8>(race->GetLaps())).
+		Write(static_cast<MR_UInt16>(shard.GetRacePort()));
+	shard.Send(sender, welcome);
+}
+
+void RaceHost::OnInput(const udp::endpoint &sender, RaceProtocol::Reader &msg)
+{
+	MR_UInt32 seq = msg.ReadUInt32();
+	MR_UInt32 sliceTime = msg.ReadUInt32();
+	MR_UInt32 controls = msg.ReadUInt32();
+	MR_UInt32 ack = msg.ReadUInt32();
+	if (!msg.IsOk()) return;
+
+	auto iter = clients.find(sender);
+	if (iter == clients.end()) return;
+
+	Client &client = iter->second;
+	client.lastHeard = clock_t::now();
+
+	// Inputs may arrive out of order; only move the baseline forward.
+	// Sequence numbers may wrap.
+	if (ack != 0 && static_cast<MR_Int32>(ack - stateSeq) <= 0 &&
+		(client.ackedState == 0 ||
+			static_cast<MR_Int32>(ack - client.ackedState) > 0))
+	{
+		client.ackedState = ack;
+	}
+
+	race->SetInput(client.playerIdx, seq,
+		static_cast<MR_SimulationTime>(sliceTime), controls);
+}
+
+void RaceHost::OnLeave(const udp::endpoint &sender)
+{
+	auto iter = clients.find(sender);
+	if (iter == clients.end()) return;
+
+	Log::Info("Race %d: Player %d left", id, iter->second.playerIdx);
+
+	race->RemovePlayer(iter->second.playerIdx);
+	clients.erase(iter);
+	numClients = static_cast<int>(clients.size());
+}
+
+void RaceHost::ScheduleTick()
+{
+	tickTimer.expires_at(nextTick);
+	tickTimer.async_wait([&](const boost::system::error_code &err) {
+		OnTick(err);
+	});
+}
+
+void RaceHost::OnTick(const boost::system::error_code &err)
+{
+	if (stopping || err == boost::asio::error::operation_aborted) return;
+
+	clock_t::time_point now = clock_t::now();
+
+	// Waking up a whole tick late means the shard's thread can't keep up.
+	shard.CountTick(now - nextTick > TICK_DURATION);
+
+	auto elapsed = now - lastTick;
+	if (elapsed > MAX_CATCH_UP) {
+		HR_LOG(warning) << "Race " << id << " fell behind by " <<
+			std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count() <<
+			" ms; skipping ahead";
+		elapsed = TICK_DURATION;
+		nextTick = now;
+	}
+	lastTick = now;
+
+	race->Advance(static_cast<MR_SimulationTime>(
+		std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count()));
+
+	if (--ticksUntilState <= 0) {
+		ticksUntilState = stateInterval;
+		DropIdleClients();
+		BroadcastState();
+	}
+
+	nextTick += TICK_DURATION;
+	ScheduleTick();
+}
+
+void RaceHost::DropIdleClients()
+{
+	clock_t::time_point cutoff = clock_t::now() - CLIENT_TIMEOUT;
+
+	for (auto iter = clients.begin(); iter != clients.end(); ) {
+		if (iter->second.lastHeard < cutoff) {
+			Log::Info("Race %d: Player %d timed out", id, iter->second.playerIdx);
+			race->RemovePlayer(iter->second.playerIdx);
+			iter = clients.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+	numClients = static_cast<int>(clients.size());
+}
+
+void RaceHost::BroadcastState()
+{
+	if (clients.empty()) return;
+
+	if (++stateSeq == 0) stateSeq = 1;
+
+	Race::Snapshot &snap = history[stateSeq % HISTORY_SIZE];
+	race->TakeSnapshot(stateSeq, snap);
+
+	// Each client gets the changes since the last state it acknowledged.
+	for (const auto &ent : clients) {
+		const Client &client = ent.second;
+
+		const Race::Snapshot *base = nullptr;
+		if (client.ackedState != 0) {
+			const Race::Snapshot &prev = history[client.ackedState % HISTORY_SIZE];
+			if (prev.seq == client.ackedState) {
+				base = &prev;
+			}
+		}
+
+		RaceProtocol::Writer msg(RaceProtocol::Msg::STATE);
+		race->WriteState(msg, snap, base, client.playerIdx);
+		shard.Send(ent.first, msg);
+	}
+}
+
+}  // namespace Server
+}  // namespace HoverRace
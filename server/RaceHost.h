@@ -0,0 +1,117 @@
+
+// RaceHost.h
+// Connects a race to its clients.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include "../engine/Net/RaceProtocol.h"
+
+#include "Race.h"
+
+namespace HoverRace {
+	namespace Server {
+		class Shard;
+	}
+}
+
+namespace HoverRace {
+namespace Server {
+
+/**
+ * Runs a single race for its clients.
+ *
+ * Each race is pinned to a shard: the host's timer and message handlers
+ * only ever run on that shard's thread, so the race itself needs no locking.
+ *
+ * @author Michael Imamura
+ */
+class RaceHost
+{
+	typedef std::chrono::steady_clock clock_t;
+	public:
+		RaceHost(Shard &shard, int id, std::shared_ptr<Race> race,
+			int stateInterval);
+		RaceHost(const RaceHost&) = delete;
+
+		RaceHost &operator=(const RaceHost&) = delete;
+
+	public:
+		Shard &GetShard() const { return shard; }
+		int GetId() const { return id; }
+		const Race &GetRace() const { return *race; }
+
+		/**
+		 * Retrieve the number of connected clients.
+		 * May be called from any thread.
+		 * @return The client count.
+		 */
+		int GetClientCount() const { return numClients; }
+
+		void Start();
+		void Stop();
+
+		void OnDatagram(const boost::asio::ip::udp::endpoint &sender,
+			const MR_UInt8 *data, size_t len);
+
+	private:
+		void OnJoin(const boost::asio::ip::udp::endpoint &sender,
+			Net::RaceProtocol::Reader &msg);
+		void OnInput(const boost::asio::ip::udp::endpoint &sender,
+			Net::RaceProtocol::Reader &msg);
+		void OnLeave(const boost::asio::ip::udp::endpoint &sender);
+
+		void ScheduleTick();
+		void OnTick(const boost::system::error_code &err);
+		void DropIdleClients();
+		void BroadcastState();
+
+	private:
+		struct Client
+		{
+			int playerIdx;
+			clock_t::time_point lastHeard;
+			MR_UInt32 ackedState;  ///< Last STATE the client received (0 if none).
+		};
+		typedef std::map<boost::asio::ip::udp::endpoint, Client> clients_t;
+
+	private:
+		Shard &shard;
+		int id;
+		std::shared_ptr<Race> race;
+		int stateInterval;  ///< Number of ticks between state broadcasts.
+
+		boost::asio::steady_timer tickTimer;
+
+		clients_t clients;
+		std::atomic<int> numClients;
+
+		/// Recently-sent states, indexed by sequence number, for deltas.
+		std::vector<Race::Snapshot> history;
+		MR_UInt32 stateSeq;
+
+		clock_t::time_point lastTick;
+		clock_t::time_point nextTick;
+		int ticksUntilState;
+		bool stopping;
+};
+
+}  // namespace Server
+}  // namespace HoverRace
@@ -1,80 +1,178 @@
-// GrokkSoft HoverRace SourceCode License v1.0, November 29, 2008
-// 
-// Redistribution and use in source and binary forms, with or without modification,
-// are permitted provided that the following conditions are met:
-// 
-// - Redistributions in source code must retain the accompanying copyright notice,
-//   this list of conditions, and the following disclaimer. 
-// - Redistributions in binary form must reproduce the accompanying copyright
-//   notice, this list of conditions, and the following disclaimer in the
-//   documentation and/or other materials provided with the distribution. 
-// - Names of the copyright holders (Richard Langlois and Grokksoft inc.) must not
-//   be used to endorse or promote products derived from this software without
-//   prior written permission from the copyright holders. 
-// - This software, or its derivates must not be used for commercial activities
-//   without prior written permission from the copyright holders. 
-// - If any files are modified, you must cause the modified files to carry
-//   prominent notices stating that you changed the files and the date of any
-//   change. 
-// 
-// Disclaimer: 
-//   The author makes no representations about the suitability of this software for
-//   any purpose.  It is provided "AS IS", WITHOUT WARRANTIES OR CONDITIONS OF ANY
-//   KIND, either express or implied.
-// 
-
-/***
- * Server.cpp
- *
- * Implementation of the dedicated server.
- */
+
+// Server.cpp
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StdAfx.h"
+
+#include "../engine/Util/Log.h"
+#include "../engine/Exception.h"
+
+#include "Race.h"
+#include "RaceHost.h"
+
 #include "Server.h"
 
-#include <boost/bind.hpp>
+using namespace HoverRace::Util;
+
+namespace HoverRace {
+namespace Server {
+
+/**
+ * Constructor.
+ * @param port The UDP port to listen on.  Each shard also uses one of the
+ *             ports that follow it for its races.
+ * @param threads The number of shards (@c 0 for one per core).
+ * @param firstCpu The CPU to pin the first shard to; the others follow
+ *                 in turn (@c -1 to let the OS schedule them).
+ * @param stateInterval The number of ticks between state broadcasts.
+ * @throws boost::system::system_error A port could not be bound.
+ * @throws Exception There are not enough ports after the server port.
+ */
+Server::Server(unsigned short port, unsigned int threads, int firstCpu,
+	int stateInterval) :
+	firstCpu(firstCpu), stateInterval(stateInterval)
+{
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+		if (threads == 0) threads = 1;
+	}
+
+	if (static_cast<unsigned int>(port) + threads > 65535) {
+		throw Exception("Not enough UDP ports after the server port");
+	}
 
-using namespace std;
-using namespace boost::asio;
-using namespace boost::asio::ip;
+	bool shareSocket = Shard::CanShareSocket();
+	for (unsigned int i = 0; i < threads; i++) {
+		shards.emplace_back(new Shard(*this, static_cast<int>(i), port,
+			static_cast<unsigned short>(port + 1 + i),
+			shareSocket || i == 0));
+	}
+	lastStats.resize(shards.size(), Shard::Stats());
+}
 
-Server::Server(io_service &io_service, short tcpListenPort, short udpListenPort)
+Server::~Server()
 {
-	// TODO: make listen ports specifiable
-	this->io_service = io_service;
-	acceptor(io_service, tcp::endpoint(tcp::v4(), tcpListenPort));
-
-	// this is our connectionless UDP socket, which will get passed to all UDPConnection
-	// objects
-	udpSocket = udp::socket(io_service, udp::endpoint(udp::v4(), udpListenPort));
-
-	// "blank" connection that gets written to when someone tries to connect, and
-	// then we deal with it
-	tcpConnection = new TCPConnection(io_service);
-	udpSender = udp::endpoint;
-
-	// set up handler for a new received TCP connection
-	tcpAcceptor.async_accept(tcpConnection->getSocket(),
-		boost::bind(&Server::HandleTCPAccept, this, tcpConnection, placeholders::error));
-
-	// and a handler for a new received UDP connection
-	udpSocket->getSocket().async_receive_from(buffer(udpSocket->getBuffer(),
-		udpSocket->getMaxBufferLength()), udpSender, boost::bind(&Server::HandleUDPConnect, this,
-			placeholders::error, placeholders::bytes_transferred));
+	Stop();
+	Join();
 }
 
-Server::HandleTCPAccept(TCPConnection *connection, const boost::system::error_code &error)
+/**
+ * Add a race.
+ * Races are pinned to the shards in turn.
+ * Must be called before the server is started.
+ * @param race The race.
+ * @return The race ID.
+ */
+int Server::AddRace(std::shared_ptr<Race> race)
+{
+	int id = static_cast<int>(races.size());
+	Shard &shard = *shards[races.size() % shards.size()];
+
+	races.emplace_back(new RaceHost(shard, id, std::move(race), stateInterval));
+	shard.AddRace(races.back().get());
+
+	return id;
+}
+
+/**
+ * Look up a race.
+ * May be called from any thread.
+ * @param id The race ID.
+ * @return The race, or @c nullptr if there is no race with that ID.
+ */
+RaceHost *Server::FindRace(int id) const
 {
-	if(!error) {
-		
-	} else {
-		// HOLY SHIT WHAT DO WE DO CAPTAIN?
+	// The list of races doesn't change once the shards are running.
+	if (id < 0 || static_cast<size_t>(id) >= races.size()) return nullptr;
+	return races[id].get();
+}
+
+/**
+ * Start every shard.
+ */
+void Server::Start()
+{
+	Log::Info("Hosting %d races on %u threads%s",
+		static_cast<int>(races.size()), GetShardCount(),
+		Shard::CanShareSocket() ? " (shared port)" : "");
+
+	unsigned int cpus = std::thread::hardware_concurrency();
+	if (cpus == 0) cpus = 1;
+
+	for (auto &shard : shards) {
+		shard->Start(firstCpu < 0 ? -1 :
+			static_cast<int>((firstCpu + shard->GetId()) % cpus));
 	}
 }
 
-Server::HandleUDPConnect(UDPConnection *connection, const boost::system::error_code &error)
+/**
+ * Stop every shard.
+ * May be called from any thread.
+ */
+void Server::Stop()
 {
-	if(!error) {
+	for (auto &shard : shards) {
+		shard->Stop();
+	}
+}
 
-	} else {
-		// ???
+/**
+ * Wait for every shard to stop.
+ */
+void Server::Join()
+{
+	for (auto &shard : shards) {
+		shard->Join();
 	}
 }
+
+/**
+ * Log the counters for each shard since the last call.
+ */
+void Server::LogStats()
+{
+	HR_LOG(info) << races.size() << " races on " << shards.size() <<
+		" threads (" <<
+		(static_cast<double>(races.size()) / shards.size()) <<
+		" races per core)";
+
+	for (size_t i = 0; i < shards.size(); i++) {
+		Shard::Stats stats = shards[i]->GetStats();
+		const Shard::Stats &last = lastStats[i];
+
+		MR_UInt64 ticks = stats.ticks - last.ticks;
+		MR_UInt64 overruns = stats.overruns - last.overruns;
+
+		HR_LOG(info) << "Shard " << i << ": " <<
+			stats.races << " races, " <<
+			stats.clients << " players, " <<
+			ticks << " ticks, " <<
+			overruns << " overruns (" <<
+			(ticks > 0 ? (100.0 * overruns / ticks) : 0.0) << "%), " <<
+			(stats.datagrams - last.datagrams) << " datagrams in, " <<
+			(stats.forwarded - last.forwarded) << " joins forwarded, " <<
+			(stats.bytesSent - last.bytesSent) << " bytes out";
+
+		lastStats[i] = stats;
+	}
+}
+
+}  // namespace Server
+}  // namespace HoverRace
@@ -1,61 +1,81 @@
-// GrokkSoft HoverRace SourceCode License v1.0, November 29, 2008
-// 
-// Redistribution and use in source and binary forms, with or without modification,
-// are permitted provided that the following conditions are met:
-// 
-// - Redistributions in source code must retain the accompanying copyright notice,
-//   this list of conditions, and the following disclaimer. 
-// - Redistributions in binary form must reproduce the accompanying copyright
-//   notice, this list of conditions, and the following disclaimer in the
-//   documentation and/or other materials provided with the distribution. 
-// - Names of the copyright holders (Richard Langlois and Grokksoft inc.) must not
-//   be used to endorse or promote products derived from this software without
-//   prior written permission from the copyright holders. 
-// - This software, or its derivates must not be used for commercial activities
-//   without prior written permission from the copyright holders. 
-// - If any files are modified, you must cause the modified files to carry
-//   prominent notices stating that you changed the files and the date of any
-//   change. 
-// 
-// Disclaimer: 
-//   The author makes no representations about the suitability of this software for
-//   any purpose.  It is provided "AS IS", WITHOUT WARRANTIES OR CONDITIONS OF ANY
-//   KIND, either express or implied.
-// 
-
-/***
- * Server.h
- * Declaration of Server class, the "overseer" class in the dedicated server
- *
- * @author Ryan Curtin
- */
 
-#include <vector>
+// Server.h
+// The dedicated race server.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include "Shard.h"
 
-#include <boost/asio.hpp>
+namespace HoverRace {
+	namespace Server {
+		class Race;
+		class RaceHost;
+	}
+}
 
-#include "Connection.h"
-#include "TCPConnection.h"
-#include "UDPConnection.h"
+namespace HoverRace {
+namespace Server {
 
-class Server {
+/**
+ * Hosts any number of races for remote clients over UDP.
+ *
+ * The races are spread across a set of shards (normally one per core); each
+ * race is pinned to a shard, whose thread advances the simulation at a
+ * fixed rate and sends the state of every hovercraft to every client.
+ * Clients join through a single UDP port, picking a race by its ID; each
+ * shard then serves its races on its own port.
+ *
+ * @author Michael Imamura
+ */
+class Server
+{
 	public:
-		Server(boost::asio::io_service &io_service);
+		Server(unsigned short port, unsigned int threads, int firstCpu,
+			int stateInterval);
+		Server(const Server&) = delete;
+		~Server();
 
-		void run();
+		Server &operator=(const Server&) = delete;
 
-	private:
-		void HandleTCPAccept(TCPConnection *newConn, const boost::system::error_code &error);
-		void HandleUDPConnect(UDPConnection *udpConn, const boost::system::error_code &error);
+	public:
+		unsigned int GetShardCount() const { return static_cast<unsigned int>(shards.size()); }
+		Shard &GetShard(unsigned int idx) { return *shards[idx]; }
+
+		int AddRace(std::shared_ptr<Race> race);
+		RaceHost *FindRace(int id) const;
 
-		std::vector<Connection> connections;
-		//std::vector<Game> games; // games we are managing
+		void Start();
+		void Stop();
+		void Join();
 
-		TCPConnection *tcpConnection;
-		boost::asio::ip::udp::socket udpSocket;
-		boost::asio::ip::udp::endpoint udpSender;
+		void LogStats();
 
-		boost::asio::io_service io_service;
-		boost::asio::ip::tcp::acceptor tcpAccept;
-//		udp::acceptor udpAccept;
+	private:
+		std::vector<std::unique_ptr<Shard>> shards;
+		std::vector<std::unique_ptr<RaceHost>> races;  ///< Indexed by race ID.
+		int firstCpu;
+		int stateInterval;
+
+		std::vector<Shard::Stats> lastStats;  ///< As of the last LogStats().
 };
+
+}  // namespace Server
+}  // namespace HoverRace
@@ -0,0 +1,453 @@
+
+// Shard.cpp
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StdAfx.h"
+
+#ifdef __linux__
+#	include <pthread.h>
+#	include <sched.h>
+#endif
+
+#include "../engine/Util/Log.h"
+
+#include "RaceHost.h"
+#include "Server.h"
+
+#include "Shard.h"
+
+using namespace HoverRace::Net;
+using namespace HoverRace::Util;
+using boost::asio::ip::udp;
+
+namespace HoverRace {
+namespace Server {
+
+namespace {
+	/// Clients that haven't sent anything for this long are forgotten.
+	const auto ROUTE_TIMEOUT = std::chrono::seconds(10);
+}
+
+/**
+ * Constructor.
+ * @param server The server that owns the shard.
+ * @param id The shard ID.
+ * @param port The server's UDP port, where clients send JOIN.
+ * @param racePort The UDP port for this shard's races.
+ * @param listen @c true to receive JOINs on the server's port; if more than
+ *               one shard listens, CanShareSocket() must be @c true.
+ * @throws boost::system::system_error A port could not be bound.
+ */
+Shard::Shard(Server &server, int id, unsigned short port,
+	unsigned short racePort, bool listen) :
+	server(server), id(id), joinSocket(io), socket(io), racePort(racePort),
+	pruneTimer(io), stopping(false),
+	numTicks(0), numOverruns(0), numDatagrams(0), numForwarded(0),
+	numBytesSent(0)
+{
+	if (listen) {
+		joinSocket.open(udp::v4());
+#		ifdef __linux__
+			int on = 1;
+			if (setsockopt(joinSocket.native_handle(), SOL_SOCKET, SO_REUSEPORT,
+				&on, sizeof(on)) < 0)
+			{
+				throw boost::system::system_error(errno,
+					boost::system::system_category(), "SO_REUSEPORT");
+			}
+#		endif
+		joinSocket.bind(udp::endpoint(udp::v4(), port));
+	}
+
+	socket.open(udp::v4());
+	socket.bind(udp::endpoint(udp::v4(), racePort));
+}
+
+Shard::~Shard()
+{
+	Join();
+}
+
+/**
+ * Check if every shard can listen on the same port.
+ * @return @c true if the OS balances datagrams between sockets sharing a
+ *         port; otherwise, only one shard may listen.
+ */
+bool Shard::CanShareSocket()
+{
+#	ifdef __linux__
+		// Other platforms accept SO_REUSEPORT, but deliver each datagram to
+		// only one of the sockets.
+		return true;
+#	else
+		return false;
+#	endif
+}
+
+/**
+ * Pin a race to this shard.
+ * Must be called before the shard is started.
+ * @param host The race.
+ */
+void Shard::AddRace(RaceHost *host)
+{
+	races.push_back(host);
+}
+
+/**
+ * Start the shard's thread.
+ * @param cpu The CPU to run the thread on (@c -1 to let the OS decide).
+ */
+void Shard::Start(int cpu)
+{
+	io.post([&]() {
+		for (RaceHost *host : races) {
+			host->Start();
+		}
+		if (IsListening()) {
+			ReceiveJoin();
+		}
+		Receive();
+		SchedulePrune();
+	});
+
+	thread = std::thread([&]() { Run(); });
+
+	if (cpu >= 0) {
+		SetAffinity(cpu);
+	}
+}
+
+/**
+ * Stop the shard.
+ * Pending operations are canceled, so the thread will run out of work.
+ * May be called from any thread.
+ */
+void Shard::Stop()
+{
+	io.post([&]() {
+		stopping = true;
+
+		for (RaceHost *host : races) {
+			host->Stop();
+		}
+
+		boost::system::error_code err;
+		pruneTimer.cancel(err);
+		joinSocket.close(err);
+		socket.close(err);
+	});
+}
+
+/**
+ * Wait for the shard's thread to finish.
+ */
+void Shard::Join()
+{
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+void Shard::Run()
+{
+	for (;;) {
+		try {
+			io.run();
+			break;
+		}
+		catch (std::exception &ex) {
+			// Keep the other races on this shard going.
+			Log::Error("Shard %d: %s", id, ex.what());
+		}
+	}
+}
+
+/**
+ * Keep the shard's thread on a single CPU, so the races' state stays in
+ * that CPU's cache.
+ * @param cpu The CPU.
+ */
+void Shard::SetAffinity(int cpu)
+{
+#	ifdef _WIN32
+		DWORD_PTR mask = static_cast<DWORD_PTR>(1) << cpu;
+		if (SetThreadAffinityMask(thread.native_handle(), mask) == 0) {
+			Log::Warn("Shard %d: Unable to pin to CPU %d", id, cpu);
+		}
+#	elif defined(__linux__)
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		int err = pthread_setaffinity_np(thread.native_handle(),
+			sizeof(cpus), &cpus);
+		if (err != 0) {
+			Log::Warn("Shard %d: Unable to pin to CPU %d: %s",
+				id, cpu, strerror(err));
+		}
+#	else
+		Log::Warn("Shard %d: Pinning to a CPU is not supported", id);
+#	endif
+}
+
+/**
+ * Retrieve the counters.
+ * May be called from any thread.
+ * @return The counters.
+ */
+Shard::Stats Shard::GetStats() const
+{
+	Stats retv;
+	retv.races = static_cast<int>(races.size());
+	retv.clients = 0;
+	for (const RaceHost *host : races) {
+		retv.clients += host->GetClientCount();
+	}
+	retv.ticks = numTicks.load(std::memory_order_relaxed);
+	retv.overruns = numOverruns.load(std::memory_order_relaxed);
+	retv.datagrams = numDatagrams.load(std::memory_order_relaxed);
+	retv.forwarded = numForwarded.load(std::memory_order_relaxed);
+	retv.bytesSent = numBytesSent.load(std::memory_order_relaxed);
+	return retv;
+}
+
+void Shard::ReceiveJoin()
+{
+	joinSocket.async_receive_from(
+		boost::asio::buffer(joinBuf, sizeof(joinBuf)), joinSender,
+		[&](const boost::system::error_code &err, size_t len) {
+			OnReceiveJoin(err, len);
+		});
+}
+
+/**
+ * Handle a datagram sent to the server's port.
+ * Only JOINs are accepted here; the race's shard takes it from there.
+ */
+void Shard::OnReceiveJoin(const boost::system::error_code &err, size_t len)
+{
+	if (stopping) return;
+
+	if (!err) {
+		numDatagrams.fetch_add(1, std::memory_order_relaxed);
+
+		RaceHost *host = CheckJoin(joinSocket, joinSender, joinBuf, len);
+		if (host) {
+			Shard &owner = host->GetShard();
+			if (&owner == this) {
+				Admit(host, joinSender, joinBuf, len);
+			}
+			else {
+				// Joining is rare enough that it doesn't matter that this
+				// takes a lock and a copy.
+				numForwarded.fetch_add(1, std::memory_order_relaxed);
+				udp::endpoint from = joinSender;
+				std::vector<MR_UInt8> data(joinBuf, joinBuf + len);
+				owner.io.post([&owner, host, from, data]() {
+					owner.Admit(host, from, data.data(), data.size());
+				});
+			}
+		}
+	}
+	else if (err != boost::asio::error::operation_aborted) {
+		HR_LOG(debug) << "Receive error: " << err.message();
+	}
+
+	ReceiveJoin();
+}
+
+void Shard::Receive()
+{
+	socket.async_receive_from(
+		boost::asio::buffer(recvBuf, sizeof(recvBuf)), sender,
+		[&](const boost::system::error_code &err, size_t len) {
+			OnReceive(err, len);
+		});
+}
+
+/**
+ * Handle a datagram sent to this shard's race port.
+ * These are always for one of this shard's own races.
+ */
+void Shard::OnReceive(const boost::system::error_code &err, size_t len)
+{
+	if (stopping) return;
+
+	if (!err) {
+		numDatagrams.fetch_add(1, std::memory_order_relaxed);
+
+		RaceProtocol::Reader msg(recvBuf, len);
+		RaceProtocol::Msg type = msg.ReadMsg();
+
+		if (type == RaceProtocol::Msg::JOIN) {
+			// A client that has already been welcomed may repeat its JOIN
+			// if the first WELCOME was slow to arrive.
+			RaceHost *host = CheckJoin(socket, sender, recvBuf, len);
+			if (host && &host->GetShard() == this) {
+				Admit(host, sender, recvBuf, len);
+			}
+		}
+		else {
+			auto iter = routes.find(sender);
+			if (iter != routes.end()) {
+				RaceHost *host = iter->second.host;
+				if (type == RaceProtocol::Msg::LEAVE) {
+					routes.erase(iter);
+				}
+				else {
+					iter->second.lastHeard = clock_t::now();
+				}
+
+				host->OnDatagram(sender, recvBuf, len);
+			}
+		}
+	}
+	else if (err != boost::asio::error::operation_aborted) {
+		// On some platforms, an ICMP "port unreachable" from a client that
+		// went away shows up as an error here; just keep going.
+		HR_LOG(debug) << "Receive error: " << err.message();
+	}
+
+	Receive();
+}
+
+/**
+ * Check the version and race of a JOIN.
+ * @param replySocket The socket to send a rejection through.
+ * @param from The client.
+ * @param data The message.
+ * @param len The length of the message.
+ * @return The race to join, or @c nullptr if the JOIN was rejected.
+ */
+RaceHost *Shard::CheckJoin(udp::socket &replySocket, const udp::endpoint &from,
+	const MR_UInt8 *data, size_t len)
+{
+	RaceProtocol::Reader msg(data, len);
+	if (msg.ReadMsg() != RaceProtocol::Msg::JOIN) return nullptr;
+
+	MR_UInt16 version = msg.ReadUInt16();
+	int raceId = msg.ReadUInt16();
+	if (!msg.IsOk()) return nullptr;
+
+	const char *reason = nullptr;
+	RaceHost *host = nullptr;
+	if (version != RaceProtocol::VERSION) {
+		reason = "Incompatible version";
+	}
+	else if (!(host = server.FindRace(raceId))) {
+		reason = "No such race";
+	}
+
+	if (reason) {
+		RaceProtocol::Writer reject(RaceProtocol::Msg::REJECT);
+		reject.Write(std::string(reason));
+		SendRaw(replySocket, from, reject.GetData(), reject.GetLength());
+	}
+	return host;
+}
+
+/**
+ * Route a client to one of this shard's races.
+ * Must be called on this shard's thread.
+ * @param host The race.
+ * @param from The client.
+ * @param data The JOIN message.
+ * @param len The length of the message.
+ */
+void Shard::Admit(RaceHost *host, const udp::endpoint &from,
+	const MR_UInt8 *data, size_t len)
+{
+	if (stopping) return;
+
+	ClientRoute &route = routes[from];
+	route.host = host;
+	route.lastHeard = clock_t::now();
+
+	host->OnDatagram(from, data, len);
+}
+
+/**
+ * Send a message from this shard's race port.
+ * Must be called on this shard's thread.
+ * @param dest The recipient.
+ * @param msg The message.
+ */
+void Shard::Send(const udp::endpoint &dest, const RaceProtocol::Writer &msg)
+{
+	if (!msg.IsOk()) {
+		HR_LOG(error) << "Message too large; not sent";
+		return;
+	}
+
+	SendRaw(socket, dest, msg.GetData(), msg.GetLength());
+}
+
+void Shard::SendRaw(udp::socket &sock, const udp::endpoint &dest,
+	const MR_UInt8 *data, size_t len)
+{
+	// UDP sends don't block for long, so there's no need to queue them.
+	boost::system::error_code err;
+	sock.send_to(boost::asio::buffer(data, len), dest, 0, err);
+	if (err) {
+		HR_LOG(debug) << "Send error: " << err.message();
+	}
+	else {
+		numBytesSent.fetch_add(len, std::memory_order_relaxed);
+	}
+}
+
+void Shard::Reject(const udp::endpoint &dest, const std::string &reason)
+{
+	RaceProtocol::Writer msg(RaceProtocol::Msg::REJECT);
+	msg.Write(reason);
+	Send(dest, msg);
+}
+
+void Shard::SchedulePrune()
+{
+	pruneTimer.expires_from_now(ROUTE_TIMEOUT);
+	pruneTimer.async_wait([&](const boost::system::error_code &err) {
+		OnPrune(err);
+	});
+}
+
+/**
+ * Forget clients that went away without leaving.
+ */
+void Shard::OnPrune(const boost::system::error_code &err)
+{
+	if (stopping || err == boost::asio::error::operation_aborted) return;
+
+	clock_t::time_point cutoff = clock_t::now() - ROUTE_TIMEOUT;
+
+	for (auto iter = routes.begin(); iter != routes.end(); ) {
+		if (iter->second.lastHeard < cutoff) {
+			iter = routes.erase(iter);
+		}
+		else {
+			++iter;
+		}
+	}
+
+	SchedulePrune();
+}
+
+}  // namespace Server
+}  // namespace HoverRace
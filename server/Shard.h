@@ -0,0 +1,166 @@
+
+// Shard.h
+// A thread of the dedicated server and the races pinned to it.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#pragma once
+
+#include "../engine/Net/RaceProtocol.h"
+
+namespace HoverRace {
+	namespace Server {
+		class RaceHost;
+		class Server;
+	}
+}
+
+namespace HoverRace {
+namespace Server {
+
+/**
+ * A thread with its own I/O service, which runs a fixed set of races.
+ *
+ * Each shard has its own UDP port (the race port) which serves only its
+ * own races.  Clients send JOIN to the server's port and are told the race
+ * port in WELCOME; from then on, all of their traffic goes straight to the
+ * shard that runs their race, so datagrams are never handed between
+ * threads.  Only JOINs that arrive at the wrong shard are passed on.
+ *
+ * Where the OS can balance UDP traffic between sockets bound to the same
+ * port (@c SO_REUSEPORT on Linux), every shard listens on the server's port
+ * for JOINs.  Elsewhere, only the first shard does.
+ *
+ * @author Michael Imamura
+ */
+class Shard
+{
+	typedef std::chrono::steady_clock clock_t;
+	public:
+		Shard(Server &server, int id, unsigned short port,
+			unsigned short racePort, bool listen);
+		Shard(const Shard&) = delete;
+		~Shard();
+
+		Shard &operator=(const Shard&) = delete;
+
+	public:
+		static bool CanShareSocket();
+
+		int GetId() const { return id; }
+		boost::asio::io_service &GetIoService() { return io; }
+		bool IsListening() const { return joinSocket.is_open(); }
+
+		/**
+		 * Retrieve the port that clients of this shard's races send to.
+		 * @return The port.
+		 */
+		unsigned short GetRacePort() const { return racePort; }
+
+		void AddRace(RaceHost *host);
+
+		void Start(int cpu);
+		void Stop();
+		void Join();
+
+		void Send(const boost::asio::ip::udp::endpoint &dest,
+			const Net::RaceProtocol::Writer &msg);
+		void Reject(const boost::asio::ip::udp::endpoint &dest,
+			const std::string &reason);
+
+		/**
+		 * Record a simulation tick.
+		 * @param overrun @c true if the tick started late.
+		 */
+		void CountTick(bool overrun)
+		{
+			numTicks.fetch_add(1, std::memory_order_relaxed);
+			if (overrun) numOverruns.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		/// Counters for sizing hosts; totals since the shard was created.
+		struct Stats
+		{
+			int races;
+			int clients;
+			MR_UInt64 ticks;
+			MR_UInt64 overruns;  ///< Ticks that started a whole tick late.
+			MR_UInt64 datagrams;  ///< Datagrams received by this shard.
+			MR_UInt64 forwarded;  ///< JOINs handed to another shard.
+			MR_UInt64 bytesSent;  ///< Bytes sent through this shard's socket.
+		};
+		Stats GetStats() const;
+
+	private:
+		void Run();
+		void SetAffinity(int cpu);
+
+		void ReceiveJoin();
+		void OnReceiveJoin(const boost::system::error_code &err, size_t len);
+		void Receive();
+		void OnReceive(const boost::system::error_code &err, size_t len);
+		RaceHost *CheckJoin(boost::asio::ip::udp::socket &replySocket,
+			const boost::asio::ip::udp::endpoint &from,
+			const MR_UInt8 *data, size_t len);
+		void Admit(RaceHost *host, const boost::asio::ip::udp::endpoint &from,
+			const MR_UInt8 *data, size_t len);
+		void SendRaw(boost::asio::ip::udp::socket &sock,
+			const boost::asio::ip::udp::endpoint &dest,
+			const MR_UInt8 *data, size_t len);
+
+		void SchedulePrune();
+		void OnPrune(const boost::system::error_code &err);
+
+	private:
+		struct ClientRoute
+		{
+			RaceHost *host;
+			clock_t::time_point lastHeard;
+		};
+		typedef std::map<boost::asio::ip::udp::endpoint, ClientRoute> routes_t;
+
+	private:
+		Server &server;
+		int id;
+
+		boost::asio::io_service io;
+		boost::asio::ip::udp::socket joinSocket;  ///< Shared server port.
+		boost::asio::ip::udp::socket socket;  ///< This shard's race port.
+		unsigned short racePort;
+		boost::asio::steady_timer pruneTimer;
+		std::thread thread;
+
+		std::vector<RaceHost*> races;
+
+		MR_UInt8 joinBuf[Net::RaceProtocol::MAX_DATAGRAM];
+		boost::asio::ip::udp::endpoint joinSender;
+		MR_UInt8 recvBuf[Net::RaceProtocol::MAX_DATAGRAM];
+		boost::asio::ip::udp::endpoint sender;
+		routes_t routes;  ///< Only used on this shard's thread.
+		bool stopping;
+
+		std::atomic<MR_UInt64> numTicks;
+		std::atomic<MR_UInt64> numOverruns;
+		std::atomic<MR_UInt64> numDatagrams;
+		std::atomic<MR_UInt64> numForwarded;
+		std::atomic<MR_UInt64> numBytesSent;
+};
+
+}  // namespace Server
+}  // namespace HoverRace
@@ -0,0 +1,39 @@
+/* StdAfx.h
+	Precompiled header for the dedicated server. */
+
+#pragma once
+
+#include "../include/util/os.h"
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#	pragma warning(push, 0)
+#endif
+
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/signals2.hpp>
+
+#ifdef _WIN32
+#	pragma warning(pop)
+#endif
+
+#include "../include/util/i18n.h"
+#include "../include/util/util.h"
@@ -1,50 +1,217 @@
-// GrokkSoft HoverRace SourceCode License v1.0, November 29, 2008
-// 
-// Redistribution and use in source and binary forms, with or without modification,
-// are permitted provided that the following conditions are met:
-// 
-// - Redistributions in source code must retain the accompanying copyright notice,
-//   this list of conditions, and the following disclaimer. 
-// - Redistributions in binary form must reproduce the accompanying copyright
-//   notice, this list of conditions, and the following disclaimer in the
-//   documentation and/or other materials provided with the distribution. 
-// - Names of the copyright holders (Richard Langlois and Grokksoft inc.) must not
-//   be used to endorse or promote products derived from this software without
-//   prior written permission from the copyright holders. 
-// - This software, or its derivates must not be used for commercial activities
-//   without prior written permission from the copyright holders. 
-// - If any files are modified, you must cause the modified files to carry
-//   prominent notices stating that you changed the files and the date of any
-//   change. 
-// 
-// Disclaimer: 
-//   The author makes no representations about the suitability of this software for
-//   any purpose.  It is provided "AS IS", WITHOUT WARRANTIES OR CONDITIONS OF ANY
-//   KIND, either express or implied.
-// 
-
-/***
- * main.cpp
- * Entrance point for dedicated server
- * Use getopt() if not on Windows, or do it by hand if we are
- *
- * @author Ryan Curtin
- */
-
-#ifdef _WIN32
-	// perhaps find some getopt() equivalent
-#else
-	#include <getopt.h>
-#endif
 
+// main.cpp
+// Entry point for the dedicated race server.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StdAfx.h"
+
+#include "../engine/MainCharacter/MainCharacter.h"
+#include "../engine/Model/Track.h"
+#include "../engine/Parcel/TrackBundle.h"
+#include "../engine/Util/Config.h"
+#include "../engine/Util/DllObjectFactory.h"
+#include "../engine/Util/FuzzyLogic.h"
+#include "../engine/Util/Log.h"
+#include "../engine/Util/OS.h"
+#include "../engine/Util/WorldCoordinates.h"
+#include "../engine/VideoServices/SoundServer.h"
+#include "../engine/Exception.h"
+
+#include "Race.h"
 #include "Server.h"
-#include <boost/asio.hpp>
 
-using namespace boost::asio;
+using namespace HoverRace;
+using namespace HoverRace::Util;
+
+namespace {
+
+struct Options
+{
+	Options() :
+		port(Config::net_t::DEFAULT_TCP_SERV_PORT), laps(5), players(9),
+		stateInterval(2), threads(0), firstCpu(0), statsInterval(60) { }
+
+	std::vector<std::string> trackNames;
+	OS::path_t mediaPath;
+	int port;
+	int laps;
+	int players;
+	int stateInterval;
+	int threads;
+	int firstCpu;
+	int statsInterval;
+};
+
+void PrintUsage()
+{
+	std::cerr <<
+		"Usage: hoverrace-server [options] <track name> [<track name>...]\n"
+		"\n"
+		"Each track name starts a race; the first race is race 0.\n"
+		"\n"
+		"Options:\n"
+		"  -m PATH    Media path (default: from config)\n"
+		"  -p PORT    UDP port to listen on (default: " <<
+			static_cast<int>(Config::net_t::DEFAULT_TCP_SERV_PORT) << ");\n"
+		"             each thread also uses one of the ports after it\n"
+		"  -l COUNT   Number of laps (default: 5)\n"
+		"  -n COUNT   Maximum number of players (default: 9)\n"
+		"  -s COUNT   Simulation slices between state updates (default: 2)\n"
+		"  -j COUNT   Number of threads (default: one per core)\n"
+		"  -a CPU     Pin the threads to CPUs starting from this one\n"
+		"             (default: 0; -1 = don't pin)\n"
+		"  -t SECS    Seconds between statistics reports (default: 60; 0 = off)\n";
+}
+
+bool ParseArgs(int argc, char **argv, Options &opts)
+{
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg.size() == 2 && arg[0] == '-') {
+			if (++i >= argc) return false;
+			try {
+				switch (arg[1]) {
+					case 'm': opts.mediaPath = argv[i]; break;
+					case 'p': opts.port = boost::lexical_cast<int>(argv[i]); break;
+					case 'l': opts.laps = boost::lexical_cast<int>(argv[i]); break;
+					case 'n': opts.players = boost::lexical_cast<int>(argv[i]); break;
+					case 's': opts.stateInterval = boost::lexical_cast<int>(argv[i]); break;
+					case 'j': opts.threads = boost::lexical_cast<int>(argv[i]); break;
+					case 'a': opts.firstCpu = boost::lexical_cast<int>(argv[i]); break;
+					case 't': opts.statsInterval = boost::lexical_cast<int>(argv[i]); break;
+					default:
+						return false;
+				}
+			}
+			catch (boost::bad_lexical_cast&) {
+				return false;
+			}
+		}
+		else {
+			opts.trackNames.push_back(arg);
+		}
+	}
+
+	return !opts.trackNames.empty() && opts.trackNames.size() < 65536 &&
+		opts.port > 0 && opts.port < 65536 &&
+		opts.laps > 0 && opts.laps < 256 &&
+		opts.players > 0 && opts.players <= MR_NB_MAX_PLAYER &&
+		opts.stateInterval > 0 &&
+		opts.threads >= 0 &&
+		opts.firstCpu >= -1 &&
+		opts.statsInterval >= 0;
+}
+
+void ScheduleStats(boost::asio::steady_timer &timer, Server::Server &server,
+	int statsInterval)
+{
+	timer.expires_from_now(std::chrono::seconds(statsInterval));
+	timer.async_wait([&timer, &server, statsInterval](const boost::system::error_code &err) {
+		if (err == boost::asio::error::operation_aborted) return;
+		server.LogStats();
+		ScheduleStats(timer, server, statsInterval);
+	});
+}
+
+int RunServer(const Options &opts)
+{
+	Server::Server server(static_cast<unsigned short>(opts.port),
+		static_cast<unsigned int>(opts.threads), opts.firstCpu,
+		opts.stateInterval);
+
+	// Each race gets its own copy of the track, since the level holds the
+	// state of the race.  They are all loaded before any shard starts.
+	for (const auto &trackName : opts.trackNames) {
+		Model::TrackPtr track =
+			Config::GetInstance()->GetTrackBundle()->OpenTrack(trackName);
+		if (!track) {
+			std::cerr << "Track not found: " << trackName << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		server.AddRace(std::make_shared<Server::Race>(trackName, track,
+			opts.laps, 0x7f, opts.players));
+	}
+
+	// The main thread only waits for signals and reports statistics;
+	// the races run on the server's own threads.
+	boost::asio::io_service io;
+
+	boost::asio::steady_timer statsTimer(io);
+	if (opts.statsInterval > 0) {
+		ScheduleStats(statsTimer, server, opts.statsInterval);
+	}
+
+	boost::asio::signal_set signals(io, SIGINT, SIGTERM);
+	signals.async_wait([&](const boost::system::error_code&, int) {
+		Log::Info("Shutting down");
+		boost::system::error_code err;
+		statsTimer.cancel(err);
+		server.Stop();
+	});
+
+	server.Start();
+	io.run();
+	server.Join();
+
+	return EXIT_SUCCESS;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+	Options opts;
+	if (!ParseArgs(argc, argv, opts)) {
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	Config *cfg = Config::Init(0, 0, 0, 0, true, opts.mediaPath, OS::path_t());
+	cfg->runtime.silent = true;
+
+	Log::Init();
+
+	MR_InitTrigoTables();
+	MR_InitFuzzyModule();
+	VideoServices::SoundServer::Init();
+	DllObjectFactory::Init();
+	MainCharacter::MainCharacter::RegisterFactory();
+
+	int retv;
+	try {
+		retv = RunServer(opts);
+	}
+	catch (Exception &ex) {
+		std::cerr << ex.what() << std::endl;
+		retv = EXIT_FAILURE;
+	}
+	catch (boost::system::system_error &ex) {
+		std::cerr << ex.what() << std::endl;
+		retv = EXIT_FAILURE;
+	}
+
+	DllObjectFactory::Clean(FALSE);
+	VideoServices::SoundServer::Close();
 
-int main(int argv, char **argc) {
-	// parse program options which have not yet been invented
-	// TODO
+	Config::Shutdown();
 
-	Server s(io_service());
+	return retv;
 }
@@ -0,0 +1,34 @@
+/* StdAfx.h
+	Precompiled header for the BitPacking test. */
+
+#pragma once
+
+#include "../../include/util/os.h"
+
+#define BOOST_FILESYSTEM_NO_DEPRECATED
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <exception>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#	pragma warning(push, 0)
+#endif
+
+#include <boost/lexical_cast.hpp>
+#include <boost/signals2.hpp>
+
+#ifdef _WIN32
+#	pragma warning(pop)
+#endif
+
+#include "../../include/util/i18n.h"
+#include "../../include/util/util.h"
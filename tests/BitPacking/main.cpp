@@ -0,0 +1,367 @@
+
+// main.cpp
+// Checks the net state packing against the original BitPack layout.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StdAfx.h"
+
+#include <random>
+
+#include "../../engine/MainCharacter/MainCharacter.h"
+#include "../../engine/Util/BitPacking.h"
+
+using namespace HoverRace;
+using namespace HoverRace::Util;
+
+namespace {
+
+const int RANDOM_SAMPLES = 1000000;
+
+/// A copy of the fields that MainCharacter sends over the network.
+struct NetState
+{
+	MR_Int32 posX;
+	MR_Int32 posY;
+	MR_Int32 posZ;
+	MR_Int32 room;
+	MR_UInt32 orientation;
+	MR_Int32 speedX256;
+	MR_Int32 speedY256;
+	MR_Int32 speedZ256;
+	MR_UInt32 controlState;
+	MR_Int32 onFloor;
+	MR_UInt32 hoverModel;
+};
+
+// Must stay in sync with the schema in MainCharacter.cpp; CheckFields()
+// compares the two.
+typedef BitPackSchema<NetState, MainCharacter::MainCharacter::NET_STATE_SIZE,
+	BitPackMember<NetState, MR_Int32, &NetState::posX,            0, 32, 5>,
+	BitPackMember<NetState, MR_Int32, &NetState::posY,           32, 32, 5>,
+	BitPackMember<NetState, MR_Int32, &NetState::posZ,           64, 27, 0>,
+	BitPackMember<NetState, MR_Int32, &NetState::room,           91, 11, 0>,
+	BitPackMember<NetState, MR_UInt32, &NetState::orientation,  102,  9, 3>,
+	BitPackMember<NetState, MR_Int32, &NetState::speedX256,     111, 17, 2>,
+	BitPackMember<NetState, MR_Int32, &NetState::speedY256,     128, 17, 2>,
+	BitPackMember<NetState, MR_Int32, &NetState::speedZ256,     145,  9, 2>,
+	BitPackMember<NetState, MR_UInt32, &NetState::controlState, 154, 15, 0>,
+	BitPackMember<NetState, MR_Int32, &NetState::onFloor,       169,  1, 0>,
+	BitPackMember<NetState, MR_UInt32, &NetState::hoverModel,   170,  3, 0>
+	> NetStateSchema;
+
+const int SIZE = NetStateSchema::SIZE;
+
+/**
+ * The original packing (the old @c BitPack class), one bit at a time.
+ * Values are shifted right by the precision and truncated to the length,
+ * and stored least significant bit first; signed values are sign-extended
+ * when they are read back.
+ */
+class RefPack
+{
+	public:
+		RefPack() { memset(data, 0, sizeof(data)); }
+
+	public:
+		void Set(int offset, int len, int precision, MR_Int32 value)
+		{
+			MR_UInt32 bits = static_cast<MR_UInt32>(value >> precision);
+			for (int i = 0; i < len; i++) {
+				if (bits & (1u << i)) {
+					data[(offset + i) / 8] |= static_cast<MR_UInt8>(1 << ((offset + i) % 8));
+				}
+			}
+		}
+
+		void Setu(int offset, int len, int precision, MR_UInt32 value)
+		{
+			Set(offset, len, 0, static_cast<MR_Int32>(value >> precision));
+		}
+
+		MR_UInt32 Getu(int offset, int len, int precision) const
+		{
+			MR_UInt32 bits = 0;
+			for (int i = 0; i < len; i++) {
+				if (data[(offset + i) / 8] & (1 << ((offset + i) % 8))) {
+					bits |= 1u << i;
+				}
+			}
+			return bits << precision;
+		}
+
+		MR_Int32 Get(int offset, int len, int precision) const
+		{
+			MR_UInt32 bits = Getu(offset, len, 0);
+			if (len < 32 && (bits & (1u << (len - 1)))) {
+				bits |= ~((1u << len) - 1);
+			}
+			return static_cast<MR_Int32>(bits << precision);
+		}
+
+	public:
+		MR_UInt8 data[SIZE];
+};
+
+void RefEncode(const NetState &state, RefPack &pack)
+{
+	pack.Set(0, 32, 5, state.posX);
+	pack.Set(32, 32, 5, state.posY);
+	pack.Set(64, 27, 0, state.posZ);
+	pack.Set(91, 11, 0, state.room);
+	pack.Setu(102, 9, 3, state.orientation);
+	pack.Set(111, 17, 2, state.speedX256);
+	pack.Set(128, 17, 2, state.speedY256);
+	pack.Set(145, 9, 2, state.speedZ256);
+	pack.Setu(154, 15, 0, state.controlState);
+	pack.Set(169, 1, 0, state.onFloor);
+	pack.Setu(170, 3, 0, state.hoverModel);
+}
+
+void RefDecode(const RefPack &pack, NetState &state)
+{
+	state.posX = pack.Get(0, 32, 5);
+	state.posY = pack.Get(32, 32, 5);
+	state.posZ = pack.Get(64, 27, 0);
+	state.room = pack.Get(91, 11, 0);
+	state.orientation = pack.Getu(102, 9, 3);
+	state.speedX256 = pack.Get(111, 17, 2);
+	state.speedY256 = pack.Get(128, 17, 2);
+	state.speedZ256 = pack.Get(145, 9, 2);
+	state.controlState = pack.Getu(154, 15, 0);
+	state.onFloor = pack.Get(169, 1, 0);
+	state.hoverModel = pack.Getu(170, 3, 0);
+}
+
+/**
+ * States packed by the original BitPack code, with the values it read back.
+ * Note that onFloor is a signed 1-bit field, so it always reads back as 0
+ * or -1.
+ */
+struct Golden
+{
+	NetState state;
+	MR_UInt8 packed[SIZE];
+	NetState decoded;
+};
+
+const Golden GOLDEN[] = {
+	{
+		{ 0, 0, 0, 0, 0u, 0, 0, 0, 0u, 0, 0u },
+		{
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 },
+		{ 0, 0, 0, 0, 0u, 0, 0, 0, 0u, 0, 0u },
+	},
+	{
+		{ 123456, -654321, 2000, 17, 1234u, -5000, 5000, -300, 4660u, 1, 5u },
+		{
+			0x12, 0x0f, 0x00, 0x00, 0x20, 0xb0, 0xff, 0xff, 0xd0, 0x07, 0x00, 0x88,
+			0x80, 0x26, 0x8f, 0xfd, 0xe2, 0x04, 0x6a, 0xd3, 0x48, 0x16, 0x00 },
+		{ 123456, -654336, 2000, 17, 1232u, -5000, 5000, -300, 4660u, -1, 5u },
+	},
+	{
+		{ 2147483647, -2147483647 - 1, 67108863, 1023, 4095u, 262143, -262144, 1020, 32767u, 1, 7u },
+		{
+			0xff, 0xff, 0xff, 0x03, 0x00, 0x00, 0x00, 0xfc, 0xff, 0xff, 0xff, 0xfb,
+			0xdf, 0xff, 0xff, 0x7f, 0x00, 0x00, 0xff, 0xfd, 0xff, 0x1f, 0x00 },
+		{ 2147483616, -2147483647 - 1, 67108863, 1023, 4088u, 262140, -262144, 1020, 32767u, -1, 7u },
+	},
+	{
+		{ -1, -32, -67108864, -1, 8u, -4, 3, -1024, 0u, 0, 0u },
+		{
+			0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0xfc,
+			0x7f, 0x80, 0xff, 0xff, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00 },
+		{ -32, -32, -67108864, -1, 8u, -4, 0, -1024, 0u, 0, 0u },
+	},
+	{
+		{ 305419896, -1698898192, 28036591, -1024, 4294967295u, 61680, -61680, 341, 4294967295u, -1, 4294967295u },
+		{
+			0xb3, 0xa2, 0x91, 0x00, 0xf7, 0xe6, 0xd5, 0xfc, 0xef, 0xcd, 0xab, 0x01,
+			0xe0, 0x7f, 0x1e, 0x1e, 0xc4, 0xc3, 0xab, 0xfc, 0xff, 0x1f, 0x00 },
+		{ 305419872, -1698898208, 28036591, -1024, 4088u, 61680, -61680, 340, 32767u, -1, 7u },
+	},
+};
+
+bool SameState(const NetState &a, const NetState &b)
+{
+	return
+		a.posX == b.posX && a.posY == b.posY && a.posZ == b.posZ &&
+		a.room == b.room && a.orientation == b.orientation &&
+		a.speedX256 == b.speedX256 && a.speedY256 == b.speedY256 &&
+		a.speedZ256 == b.speedZ256 && a.controlState == b.controlState &&
+		a.onFloor == b.onFloor && a.hoverModel == b.hoverModel;
+}
+
+void PrintState(const char *label, const NetState &state)
+{
+	std::cerr << "  " << label << ": pos=(" <<
+		state.posX << ", " << state.posY << ", " << state.posZ << ")"
+		" room=" << state.room <<
+		" orientation=" << state.orientation <<
+		" speed=(" << state.speedX256 << ", " << state.speedY256 << ", " <<
+		state.speedZ256 << ")"
+		" controls=" << state.controlState <<
+		" onFloor=" << state.onFloor <<
+		" model=" << state.hoverModel << "\n";
+}
+
+void PrintBytes(const char *label, const MR_UInt8 *buf)
+{
+	std::ios::fmtflags flags = std::cerr.flags();
+	std::cerr << "  " << label << ":" << std::hex;
+	for (int i = 0; i < SIZE; i++) {
+		std::cerr << ' ' << static_cast<int>(buf[i]);
+	}
+	std::cerr << "\n";
+	std::cerr.flags(flags);
+}
+
+/**
+ * Pack and unpack one state, checking the bytes and the values read back
+ * against the expected ones, and that packing the values read back gives
+ * the same bytes.
+ * @return @c true if everything matched.
+ */
+bool CheckState(const NetState &state, const MR_UInt8 *expectedBuf,
+	const NetState &expectedState)
+{
+	MR_UInt8 buf[SIZE];
+	NetStateSchema::Encode(state, buf);
+
+	NetState decoded;
+	NetStateSchema::Decode(buf, decoded);
+
+	MR_UInt8 reencoded[SIZE];
+	NetStateSchema::Encode(decoded, reencoded);
+
+	if (memcmp(buf, expectedBuf, SIZE) == 0 &&
+		SameState(decoded, expectedState) &&
+		memcmp(buf, reencoded, SIZE) == 0)
+	{
+		return true;
+	}
+
+	std::cerr << "Mismatch:\n";
+	PrintState("input   ", state);
+	PrintBytes("expected", expectedBuf);
+	PrintBytes("packed  ", buf);
+	PrintBytes("repacked", reencoded);
+	PrintState("expected", expectedState);
+	PrintState("decoded ", decoded);
+	return false;
+}
+
+/**
+ * Check that the layout here is the one MainCharacter actually uses.
+ * @return The number of mismatches.
+ */
+int CheckFields()
+{
+	typedef MainCharacter::MainCharacter MC;
+
+	int failures = 0;
+	if (MC::NET_STATE_SIZE != 23) {
+		std::cerr << "Net state size changed: " << MC::NET_STATE_SIZE << std::endl;
+		failures++;
+	}
+	if (MC::NUM_NET_STATE_FIELDS != NetStateSchema::NUM_FIELDS) {
+		std::cerr << "Net state field count changed: " <<
+			MC::NUM_NET_STATE_FIELDS << std::endl;
+		return failures + 1;
+	}
+	for (int i = 0; i < NetStateSchema::NUM_FIELDS; i++) {
+		const BitPackField &expected = NetStateSchema::FIELDS[i];
+		const BitPackField &actual = MC::NET_STATE_FIELDS[i];
+		if (expected.offset != actual.offset || expected.len != actual.len ||
+			expected.precision != actual.precision)
+		{
+			std::cerr << "Net state field " << i << " changed: " <<
+				actual.offset << '/' << actual.len << '/' << actual.precision <<
+				" (expected " <<
+				expected.offset << '/' << expected.len << '/' << expected.precision <<
+				")" << std::endl;
+			failures++;
+		}
+	}
+	return failures;
+}
+
+int CheckGolden()
+{
+	int failures = 0;
+	for (const Golden &golden : GOLDEN) {
+		if (!CheckState(golden.state, golden.packed, golden.decoded)) failures++;
+	}
+	std::cout << (sizeof(GOLDEN) / sizeof(GOLDEN[0])) << " known states, " <<
+		failures << " mismatches" << std::endl;
+	return failures;
+}
+
+/**
+ * Round-trip random states, covering the full range of each field (and
+ * then some, since values are truncated to the field length).
+ * @return The number of mismatches.
+ */
+int CheckRandom()
+{
+	std::mt19937 rng(42);
+	int failures = 0;
+
+	for (int i = 0; i < RANDOM_SAMPLES; i++) {
+		NetState state;
+		state.posX = static_cast<MR_Int32>(rng());
+		state.posY = static_cast<MR_Int32>(rng());
+		state.posZ = static_cast<MR_Int32>(rng()) >> 6;
+		state.room = static_cast<MR_Int32>(rng() % 2100) - 1;
+		state.orientation = rng() % 4096;
+		state.speedX256 = static_cast<MR_Int32>(rng()) >> 15;
+		state.speedY256 = static_cast<MR_Int32>(rng()) >> 15;
+		state.speedZ256 = static_cast<MR_Int32>(rng()) >> 23;
+		state.controlState = rng() & 0x7fff;
+		state.onFloor = rng() & 1;
+		state.hoverModel = rng() & 7;
+
+		RefPack ref;
+		RefEncode(state, ref);
+		NetState refDecoded;
+		RefDecode(ref, refDecoded);
+
+		if (!CheckState(state, ref.data, refDecoded)) {
+			// One report is enough to see what went wrong.
+			if (++failures >= 10) break;
+		}
+	}
+
+	std::cout << RANDOM_SAMPLES << " random states, " <<
+		failures << " mismatches" << std::endl;
+	return failures;
+}
+
+}  // namespace
+
+int main(int, char **)
+{
+	int failures = 0;
+	failures += CheckFields();
+	failures += CheckGolden();
+	failures += CheckRandom();
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,344 @@
+
+// main.cpp
+// Forces a misprediction and checks the rollback.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StdAfx.h"
+
+#include "../../engine/MainCharacter/MainCharacter.h"
+#include "../../engine/Model/GameSession.h"
+#include "../../engine/Model/Track.h"
+#include "../../engine/Net/Prediction.h"
+#include "../../engine/Net/RaceProtocol.h"
+#include "../../engine/Net/StateDelta.h"
+#include "../../engine/Parcel/TrackBundle.h"
+#include "../../engine/Util/Config.h"
+#include "../../engine/Util/DllObjectFactory.h"
+#include "../../engine/Util/FuzzyLogic.h"
+#include "../../engine/Util/OS.h"
+#include "../../engine/VideoServices/SoundServer.h"
+#include "../../engine/Exception.h"
+
+using namespace HoverRace;
+using namespace HoverRace::Util;
+
+typedef MainCharacter::MainCharacter MC;
+
+namespace {
+
+const char GAME_OPTS = 0x7f;
+const MR_SimulationTime SLICE = Model::GameSession::SIMULATION_SLICE;
+
+const int LEAD = 4;  ///< Slices the client runs ahead of the server.
+const int STATE_INTERVAL = 3;  ///< Server slices between states.
+const int SLICES = 60;  ///< Slices simulated by the client.
+const int LOST_SLICE = 20;  ///< The slice whose input the server never gets.
+const int FIRE_SLICE = 22;  ///< Launches a missile while rolling back.
+const int CHANGE_ITEM_SLICE = 23;  ///< Switches to mines while rolling back.
+
+void PrintUsage()
+{
+	std::cerr <<
+		"Usage: hoverrace-test-prediction [options] track\n"
+		"\n"
+		"Races a client against a simulated server on the track, losing one\n"
+		"input on the way, and checks that the client rolls back correctly.\n"
+		"\n"
+		"Options:\n"
+		"  -m PATH    Media path (default: from config)\n";
+}
+
+/**
+ * The controls for each slice.
+ * The engine is held the whole time, so fuel is burned on every slice.
+ * The controls change at the lost slice, so losing it makes a difference,
+ * and the fire and change item presses come after it, so they are replayed
+ * by the rollback.
+ */
+MR_UInt32 Controls(int slice)
+{
+	using namespace Net::RaceProtocol;
+
+	MR_UInt32 retv = CTL_ENGINE;
+	if (slice == LOST_SLICE) retv |= CTL_RIGHT;
+	else if (slice >= 10 && slice < 40) retv |= CTL_LEFT;
+	if (slice == FIRE_SLICE) retv |= CTL_FIRE;
+	if (slice == CHANGE_ITEM_SLICE) retv |= CTL_CHANGE_ITEM;
+	return retv;
+}
+
+/// A session with a single hovercraft, set up the same way as the server.
+struct Racer
+{
+	Racer(Parcel::TrackBundlePtr trackBundle, const std::string &name) :
+		session(false), ch(nullptr), handle(nullptr)
+	{
+		Model::TrackPtr track = trackBundle->OpenTrack(name);
+		if (!track) {
+			throw Exception("Track not found: " + name);
+		}
+		if (!session.LoadNew(name.c_str(), track, GAME_OPTS)) {
+			throw Exception("Unable to load track: " + name);
+		}
+		session.SetSimulationTime(0);
+
+		ch = MC::New(0, GAME_OPTS);
+		if (!ch) {
+			throw Exception("Unable to create hovercraft");
+		}
+
+		Model::Level *level = session.GetCurrentLevel();
+		ch->mRoom = level->GetStartingRoom(0);
+		ch->mPosition = level->GetStartingPos(0);
+		ch->SetOrientation(level->GetStartingOrientation(0));
+		ch->SetHoverId(0);
+		ch->SetHoverModel(0);
+		ch->SetNbLapForRace(1);
+		ch->SetAsMaster();
+		ch->SetSimulationTime(0);
+		handle = level->InsertElement(ch, ch->mRoom);
+	}
+
+	/// Simulate one slice, the same way the server does.
+	void Step(MR_UInt32 controls, MR_UInt32 prevControls)
+	{
+		Net::Prediction::ApplyControls(ch, controls, prevControls);
+		ch->SetSimulationTime(session.GetSimulationTime());
+		session.Step();
+	}
+
+	std::vector<MR_UInt8> Pack() const
+	{
+		std::vector<MR_UInt8> retv(MC::NET_STATE_SIZE);
+		ch->PackNetState(retv.data());
+		return retv;
+	}
+
+	Model::GameSession session;
+	MC *ch;  ///< Owned by the level.
+	MR_FreeElementHandle handle;
+};
+
+void PrintState(const char *label, const std::vector<MR_UInt8> &state)
+{
+	std::ios::fmtflags flags = std::cerr.flags();
+	std::cerr << "  " << label << ":" << std::hex;
+	for (MR_UInt8 b : state) {
+		std::cerr << ' ' << static_cast<int>(b);
+	}
+	std::cerr << "\n";
+	std::cerr.flags(flags);
+}
+
+int Expect(const char *counter, MR_Int64 actual, MR_Int64 expected)
+{
+	if (actual == expected) return 0;
+
+	std::cerr << "Expected " << counter << " = " << expected <<
+		", got " << actual << std::endl;
+	return 1;
+}
+
+int CheckTrack(Parcel::TrackBundlePtr trackBundle, const std::string &name)
+{
+	Racer client(trackBundle, name);
+	Racer server(trackBundle, name);
+
+	Net::Prediction prediction(client.session, client.ch, client.handle);
+
+	int failures = 0;
+	MR_UInt32 serverControls = 0;
+	MR_Int64 expectedStates = 0;
+	bool rolledBack = false;
+
+	for (int i = 0; i < SLICES; i++) {
+		MR_UInt32 seq = prediction.Step(Controls(i));
+		if (seq != static_cast<MR_UInt32>(i + 1)) {
+			std::cerr << "Unexpected input sequence: " << seq << std::endl;
+			failures++;
+		}
+
+		// The server is LEAD slices behind, and holds the previous controls
+		// for the slice whose input was lost.
+		int slice = i - LEAD;
+		if (slice < 0) continue;
+
+		MR_UInt32 controls = slice == LOST_SLICE ? serverControls : Controls(slice);
+		server.Step(controls, serverControls);
+		serverControls = controls;
+
+		MR_SimulationTime simTime = server.session.GetSimulationTime();
+		if ((slice + 1) % STATE_INTERVAL != 0) continue;
+
+		std::vector<MR_UInt8> state = server.Pack();
+		std::vector<MR_UInt8> predicted = client.Pack();
+
+		prediction.OnState(simTime, state.data());
+		expectedStates++;
+
+		// Every state but the first one after the lost input (before or
+		// after the rollback) must match the prediction.
+		const Net::Prediction::Stats &stats = prediction.GetStats();
+		if (slice < LOST_SLICE || rolledBack) {
+			if (stats.confirmed != expectedStates - (rolledBack ? 1 : 0)) {
+				std::cerr << "Misprediction at " << simTime << " ms\n";
+				PrintState("server", state);
+				return failures + 1;
+			}
+			continue;
+		}
+		rolledBack = true;
+
+		// The first state after the lost input must be rolled back, and
+		// the client's slices since then replayed, including the presses.
+		failures += Expect("states", stats.states, expectedStates);
+		failures += Expect("confirmed", stats.confirmed, expectedStates - 1);
+		failures += Expect("rollbacks", stats.rollbacks, 1);
+		failures += Expect("replayed", stats.replayed, LEAD);
+		failures += Expect("max depth", stats.maxDepth, LEAD);
+		failures += Expect("too deep", stats.tooDeep, 0);
+		failures += Expect("ahead", stats.ahead, 0);
+		if (client.session.GetSimulationTime() != simTime + LEAD * SLICE) {
+			std::cerr << "Rollback changed the simulation time" << std::endl;
+			failures++;
+		}
+		if (client.Pack() == predicted) {
+			std::cerr << "Rollback didn't change the state" << std::endl;
+			failures++;
+		}
+	}
+
+	if (!rolledBack) {
+		std::cerr << "The lost input was never corrected" << std::endl;
+		return failures + 1;
+	}
+
+	// Catch the server up; the client's inventory, fuel and timers must
+	// match, so the replayed presses took effect exactly once.
+	for (int slice = SLICES - LEAD; slice < SLICES; slice++) {
+		server.Step(Controls(slice), serverControls);
+		serverControls = Controls(slice);
+	}
+
+	if (server.ch->GetMissileRefillLevel(1000) == 999) {
+		std::cerr << "Expected a missile to be launched" << std::endl;
+		failures++;
+	}
+	if (client.ch->GetCurrentWeapon() != MC::eMine) {
+		std::cerr << "Expected the weapon to be changed once" << std::endl;
+		failures++;
+	}
+	failures += Expect("weapon", client.ch->GetCurrentWeapon(),
+		server.ch->GetCurrentWeapon());
+	failures += Expect("missile refill", client.ch->GetMissileRefillLevel(1000),
+		server.ch->GetMissileRefillLevel(1000));
+	failures += Expect("mines", client.ch->GetMineCount(),
+		server.ch->GetMineCount());
+	failures += Expect("power-ups", client.ch->GetPowerUpCount(),
+		server.ch->GetPowerUpCount());
+	if (client.ch->GetFuelLevel() != server.ch->GetFuelLevel()) {
+		std::cerr << "Expected fuel level " << server.ch->GetFuelLevel() <<
+			", got " << client.ch->GetFuelLevel() << std::endl;
+		failures++;
+	}
+
+	Net::StateDelta layout(MC::NET_STATE_FIELDS, MC::NUM_NET_STATE_FIELDS,
+		MC::NET_STATE_SIZE);
+	std::vector<MR_UInt8> expected = server.Pack();
+	std::vector<MR_UInt8> actual = client.Pack();
+	if (!layout.IsClose(actual.data(), expected.data(), MC::NET_STATE_TOLERANCE)) {
+		std::cerr << "Client drifted from the server\n";
+		PrintState("server", expected);
+		PrintState("client", actual);
+		failures++;
+	}
+
+	// A state from past the prediction, and one that's too old to replay,
+	// are both taken as-is.
+	std::vector<MR_UInt8> state = client.Pack();
+	MR_SimulationTime now = client.session.GetSimulationTime();
+	prediction.OnState(now + SLICE, state.data());
+	failures += Expect("ahead", prediction.GetStats().ahead, 1);
+
+	for (int i = 0; i <= Net::Prediction::DEFAULT_MAX_DEPTH; i++) {
+		prediction.Step(0);
+	}
+	prediction.OnState(now, state.data());
+	failures += Expect("too deep", prediction.GetStats().tooDeep, 1);
+	failures += Expect("rollbacks", prediction.GetStats().rollbacks, 1);
+
+	std::cout << name << ": " << prediction.GetStats().states << " states, " <<
+		prediction.GetStats().rollbacks << " rollbacks, " <<
+		prediction.GetStats().replayed << " slices replayed, " <<
+		failures << " failures" << std::endl;
+
+	return failures;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+	OS::path_t mediaPath;
+	std::string trackName;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg == "-m" && i + 1 < argc) {
+			mediaPath = argv[++i];
+		}
+		else if (arg.empty() || arg[0] == '-' || !trackName.empty()) {
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+		else {
+			trackName = arg;
+		}
+	}
+	if (trackName.empty()) {
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	Config *cfg = Config::Init(0, 0, 0, 0, true, mediaPath, OS::path_t());
+	cfg->runtime.silent = true;
+
+	MR_InitTrigoTables();
+	MR_InitFuzzyModule();
+	VideoServices::SoundServer::Init();
+	DllObjectFactory::Init();
+	MainCharacter::MainCharacter::RegisterFactory();
+
+	int failures = 0;
+	try {
+		failures += CheckTrack(cfg->GetTrackBundle(), trackName);
+	}
+	catch (Exception &ex) {
+		std::cerr << ex.what() << std::endl;
+		failures++;
+	}
+
+	DllObjectFactory::Clean(FALSE);
+	VideoServices::SoundServer::Close();
+
+	Config::Shutdown();
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,268 @@
+
+// main.cpp
+// Checks the flattened (SSE2) room contact test against the generic one.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+#include "StdAfx.h"
+
+#include <random>
+
+#include "../../engine/MainCharacter/MainCharacter.h"
+#include "../../engine/Model/ConcreteShape.h"
+#include "../../engine/Model/GameSession.h"
+#include "../../engine/Model/ShapeCollisions.h"
+#include "../../engine/Model/Track.h"
+#include "../../engine/Model/TrackEntry.h"
+#include "../../engine/Model/TrackList.h"
+#include "../../engine/Parcel/TrackBundle.h"
+#include "../../engine/Util/Config.h"
+#include "../../engine/Util/DllObjectFactory.h"
+#include "../../engine/Util/FuzzyLogic.h"
+#include "../../engine/Util/OS.h"
+#include "../../engine/Util/WorldCoordinates.h"
+#include "../../engine/VideoServices/SoundServer.h"
+#include "../../engine/Exception.h"
+
+using namespace HoverRace;
+using namespace HoverRace::Util;
+
+namespace {
+
+const MR_Int32 RAY_LENS[] = { 1, 500, 1600, 4000 };
+const int RANDOM_SAMPLES = 200;  ///< Random axes per room.
+
+void PrintUsage()
+{
+	std::cerr <<
+		"Usage: hoverrace-test-roomcontact [options] [track name...]\n"
+		"\n"
+		"Checks every room of each track (default: every installed track).\n"
+		"\n"
+		"Options:\n"
+		"  -m PATH    Media path (default: from config)\n";
+}
+
+bool SameContact(const Model::RoomContactSpec &a,
+	const Model::RoomContactSpec &b)
+{
+	if (a.mTouchingRoom != b.mTouchingRoom ||
+		a.mDistanceFromFloor != b.mDistanceFromFloor ||
+		a.mDistanceFromCeiling != b.mDistanceFromCeiling ||
+		a.mNbWallContact != b.mNbWallContact)
+	{
+		return false;
+	}
+	for (int i = 0; i < a.mNbWallContact; i++) {
+		if (a.mWallContact[i] != b.mWallContact[i]) return false;
+	}
+	return true;
+}
+
+void PrintContact(const char *label, const Model::RoomContactSpec &spec)
+{
+	std::cerr << "  " << label << ": touching=" << spec.mTouchingRoom <<
+		" floor=" << spec.mDistanceFromFloor <<
+		" ceiling=" << spec.mDistanceFromCeiling <<
+		" walls=[";
+	for (int i = 0; i < spec.mNbWallContact; i++) {
+		if (i > 0) std::cerr << ' ';
+		std::cerr << spec.mWallContact[i];
+	}
+	std::cerr << "]\n";
+}
+
+/**
+ * Compare the two room contact tests for one cylinder.
+ * The generic test goes through the PolygonShape interface and is the
+ * scalar reference; Level::GetRoomContact() uses the flattened room, which
+ * takes the SSE2 path where it's available.
+ * @return @c true if the results are identical.
+ */
+bool CheckCylinder(Model::Level *level, int room,
+	const Model::PolygonShape *shape, const Model::Cylinder &cyl)
+{
+	Model::RoomContactSpec expected;
+	Model::RoomContactSpec actual;
+	memset(&expected, 0, sizeof(expected));
+	memset(&actual, 0, sizeof(actual));
+
+	Model::DetectRoomContact(&cyl, shape, expected);
+	level->GetRoomContact(room, &cyl, actual);
+
+	if (SameContact(expected, actual)) return true;
+
+	std::cerr << "Mismatch in room " << room <<
+		" at (" << cyl.mAxis.mX << ", " << cyl.mAxis.mY << ")"
+		" ray " << cyl.mRayLen <<
+		" z [" << cyl.mZMin << ", " << cyl.mZMax << "]\n";
+	PrintContact("scalar", expected);
+	PrintContact("SSE2  ", actual);
+	return false;
+}
+
+/**
+ * Check every room of a track with a set of sampled cylinders: one at each
+ * vertex and wall midpoint (where the wall tests are closest to their
+ * limits) and a number of random ones around the room.
+ * @return The number of mismatches.
+ */
+int CheckTrack(Parcel::TrackBundlePtr trackBundle, const std::string &name,
+	MR_Int64 &checked)
+{
+	Model::TrackPtr track = trackBundle->OpenTrack(name);
+	if (!track) {
+		std::cerr << "Track not found: " << name << std::endl;
+		return 1;
+	}
+
+	Model::GameSession session(false);
+	if (!session.LoadNew(name.c_str(), track, 0x7f)) {
+		std::cerr << "Unable to load track: " << name << std::endl;
+		return 1;
+	}
+	Model::Level *level = session.GetCurrentLevel();
+
+	std::mt19937 rng(12345);
+	int failures = 0;
+
+	for (int room = 0; room < level->GetRoomCount(); room++) {
+		std::unique_ptr<Model::PolygonShape> shape(level->GetRoomShape(room));
+
+		int vertexCount = level->GetRoomVertexCount(room);
+		MR_Int32 floor = level->GetRoomBottomLevel(room);
+		MR_Int32 ceiling = level->GetRoomTopLevel(room);
+
+		std::vector<MR_2DCoordinate> axes;
+		for (int i = 0; i < vertexCount; i++) {
+			const MR_2DCoordinate &v0 = level->GetRoomVertex(room, i);
+			const MR_2DCoordinate &v1 =
+				level->GetRoomVertex(room, (i + 1) % vertexCount);
+			MR_2DCoordinate mid;
+			mid.mX = (v0.mX + v1.mX) / 2;
+			mid.mY = (v0.mY + v1.mY) / 2;
+			axes.push_back(v0);
+			axes.push_back(mid);
+		}
+
+		std::uniform_int_distribution<MR_Int32> distX(
+			shape->XMin() - 4000, shape->XMax() + 4000);
+		std::uniform_int_distribution<MR_Int32> distY(
+			shape->YMin() - 4000, shape->YMax() + 4000);
+		for (int i = 0; i < RANDOM_SAMPLES; i++) {
+			MR_2DCoordinate axis;
+			axis.mX = distX(rng);
+			axis.mY = distY(rng);
+			axes.push_back(axis);
+		}
+
+		for (const MR_2DCoordinate &axis : axes) {
+			for (MR_Int32 rayLen : RAY_LENS) {
+				Model::Cylinder cyl;
+				cyl.mAxis = axis;
+				cyl.mRayLen = rayLen;
+
+				// Below, straddling and above the floor, then through both
+				// the floor and the ceiling.
+				const MR_Int32 ranges[][2] = {
+					{ floor - 2500, floor - 500 },
+					{ floor - 1000, floor + 1000 },
+					{ floor + 500, floor + 2500 },
+					{ floor - 1000, ceiling + 1000 },
+				};
+				for (const auto &range : ranges) {
+					cyl.mZMin = range[0];
+					cyl.mZMax = range[1];
+					if (!CheckCylinder(level, room, shape.get(), cyl)) failures++;
+					checked++;
+				}
+			}
+		}
+	}
+
+	std::cout << name << ": " << level->GetRoomCount() << " rooms, " <<
+		failures << " mismatches" << std::endl;
+
+	return failures;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+	OS::path_t mediaPath;
+	std::vector<std::string> trackNames;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg == "-m" && i + 1 < argc) {
+			mediaPath = argv[++i];
+		}
+		else if (!arg.empty() && arg[0] == '-') {
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+		else {
+			trackNames.push_back(arg);
+		}
+	}
+
+	Config *cfg = Config::Init(0, 0, 0, 0, true, mediaPath, OS::path_t());
+	cfg->runtime.silent = true;
+
+	MR_InitTrigoTables();
+	MR_InitFuzzyModule();
+	VideoServices::SoundServer::Init();
+	DllObjectFactory::Init();
+	MainCharacter::MainCharacter::RegisterFactory();
+
+	int failures = 0;
+	try {
+		Parcel::TrackBundlePtr trackBundle = cfg->GetTrackBundle();
+
+		if (trackNames.empty()) {
+			Model::TrackList trackList;
+			trackList.Reload(trackBundle);
+			for (const Model::TrackEntryPtr &entry : trackList) {
+				trackNames.push_back(entry->name);
+			}
+		}
+		if (trackNames.empty()) {
+			std::cerr << "No tracks found." << std::endl;
+			failures++;
+		}
+
+		MR_Int64 checked = 0;
+		for (const std::string &name : trackNames) {
+			failures += CheckTrack(trackBundle, name, checked);
+		}
+		std::cout << checked << " cylinders checked" << std::endl;
+	}
+	catch (Exception &ex) {
+		std::cerr << ex.what() << std::endl;
+		failures++;
+	}
+
+	DllObjectFactory::Clean(FALSE);
+	VideoServices::SoundServer::Close();
+
+	Config::Shutdown();
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
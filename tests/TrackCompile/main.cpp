@@ -0,0 +1,783 @@
+
+// main.cpp
+// Checks that tracks compile to the same bytes serially and in parallel.
+//
+// Copyright (c) 2015 Michael Imamura.
+//
+// Licensed under GrokkSoft HoverRace SourceCode License v1.0(the "License");
+// you may not use this file except in compliance with the License.
+//
+// A copy of the license should have been attached to the package from which
+// you have taken this file. If you can not find the license you can not use
+// this file.
+//
+//
+// The author makes no representations about the suitability of
+// this software for any purpose.  It is provided "as is" "AS IS",
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or
+// implied.
+//
+// See the License for the specific language governing permissions
+// and limitations under the License.
+
+
+#include "StdAfx.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "../../engine/MazeCompiler/TrackCompilationLog.h"
+#include "../../engine/MazeCompiler/TrackCompileExn.h"
+#include "../../engine/MazeCompiler/TrackCompiler.h"
+#include "../../engine/Util/Config.h"
+#include "../../engine/Util/DllObjectFactory.h"
+#include "../../engine/Util/OS.h"
+#include "../../engine/Util/Str.h"
+#include "../../engine/VideoServices/SoundServer.h"
+#include "../../engine/Exception.h"
+
+using namespace HoverRace;
+using namespace HoverRace::Util;
+
+namespace {
+
+void PrintUsage()
+{
+	std::cerr <<
+		"Usage: hoverrace-test-trackcompile [options] source.TR...\n"
+		"\n"
+		"Compiles each HoverCAD track once on a single thread and once on\n"
+		"several threads and checks that the compiled tracks are identical.\n"
+		"\n"
+		"Options:\n"
+		"  -b FILE    Background image to use instead of the one named\n"
+		"             in each track\n";
+}
+
+struct CompilationLog : public MazeCompiler::TrackCompilationLog
+{
+	virtual void Info(const std::string&) { }
+	virtual void Warn(const std::string &msg) { std::cerr << msg << std::endl; }
+};
+
+// HoverCAD document ///////////////////////////////////////////////////////
+
+// The track sources are HoverCAD documents (MFC archives).  HoverCAD itself
+// is Windows-only, so this is a minimal reader for the document and a copy
+// of CHoverCadDoc::GenerateOutputFile() to produce the compiler input.
+
+/// Texture or object type (see hovercad/HoverTypes.cpp).
+struct HoverType
+{
+	int mSerialId;
+	int mDllId;
+	int mTypeId;
+};
+
+const HoverType WALL_TEXTURES[] = {
+	{ 0, 1, 50 }, { 19, 1, 72 }, { 20, 1, 73 }, { 1, 1, 52 }, { 2, 1, 53 },
+	{ 3, 1, 54 }, { 4, 1, 55 }, { 5, 1, 56 }, { 6, 1, 57 }, { 21, 1, 70 },
+	{ 22, 1, 71 }, { 7, 1, 58 }, { 8, 1, 59 }, { 9, 1, 60 }, { 10, 1, 61 },
+	{ 11, 1, 62 }, { 12, 1, 63 }, { 13, 1, 64 }, { 14, 1, 65 },
+	{ 15, 1, 66 }, { 16, 1, 67 }, { 17, 1, 68 }, { 18, 1, 69 },
+};
+
+const HoverType FLOOR_TEXTURES[] = {
+	{ 0, 1, 51 }, { 1, 1, 58 }, { 2, 1, 63 }, { 3, 1, 64 }, { 4, 1, 65 },
+	{ 5, 1, 66 }, { 6, 1, 67 },
+};
+
+const HoverType CEILING_TEXTURES[] = {
+	{ 0, 1, 50 }, { 1, 1, 51 }, { 2, 1, 58 }, { 3, 1, 63 }, { 4, 1, 64 },
+	{ 5, 1, 65 }, { 6, 1, 66 }, { 7, 1, 67 },
+};
+
+const HoverType OBJECTS[] = {
+	{ 0, 0, 1 }, { 1, 0, 2 }, { 2, 0, 3 }, { 3, 0, 4 }, { 4, 0, 5 },
+	{ 5, 0, 6 }, { 6, 0, 7 }, { 7, 0, 8 }, { 8, 0, 9 }, { 9, 0, 10 },
+	{ 12, 1, 202 }, { 16, 1, 203 }, { 17, 1, 204 }, { 10, 1, 200 },
+	{ 11, 1, 201 }, { 13, 1, 170 }, { 14, 1, 151 }, { 15, 1, 152 },
+};
+
+template<size_t N>
+int GetTypeIndex(int pId, const HoverType (&pList)[N])
+{
+	int lReturnValue = 0;  // avoid errors
+
+	for (int lCounter = 0; lCounter < static_cast<int>(N); lCounter++) {
+		if (pList[lCounter].mSerialId == pId) {
+			lReturnValue = lCounter;
+		}
+	}
+	return lReturnValue;
+}
+
+class DocReader;
+
+struct DocObject
+{
+	virtual ~DocObject() { }
+	virtual void Serialize(DocReader &in) = 0;
+};
+
+struct AnchorWall;
+struct Item;
+struct Polygon;
+
+struct Node : public DocObject
+{
+	Node() : mX(0), mY(0), mItem(nullptr) { }
+	virtual void Serialize(DocReader &in);
+
+	int mX;
+	int mY;
+	Item *mItem;
+	std::vector<AnchorWall*> mAnchorList;
+};
+
+struct AnchorWall : public DocObject
+{
+	AnchorWall() : mWallTexture(0), mNode(nullptr), mPolygon(nullptr), mExportId(0) { }
+	virtual void Serialize(DocReader &in);
+
+	AnchorWall *GetNext() const;
+	AnchorWall *GetPrev() const;
+
+	int mWallTexture;
+	Node *mNode;
+	Polygon *mPolygon;
+	int mExportId;
+};
+
+struct Polygon : public DocObject
+{
+	Polygon() : mFeature(false), mFloorTexture(0), mCeilingTexture(0),
+		mFloorLevel(0), mCeilingLevel(0), mExportId(0) { }
+	virtual void Serialize(DocReader &in);
+
+	bool IsIncluding(int pX, int pY) const;
+
+	bool mFeature;
+	int mFloorTexture;
+	int mCeilingTexture;
+	int mFloorLevel;
+	int mCeilingLevel;
+	int mExportId;
+	std::vector<AnchorWall*> mAnchorWallList;
+};
+
+struct Item : public DocObject
+{
+	Item() : mNode(nullptr), mElementType(0), mDistanceFromFloor(0), mOrientation(0) { }
+	virtual void Serialize(DocReader &in);
+
+	Node *mNode;
+	int mElementType;
+	int mDistanceFromFloor;
+	int mOrientation;
+};
+
+/**
+ * Reads the subset of the MFC archive format used by HoverCAD documents.
+ */
+class DocReader
+{
+	public:
+		DocReader(std::istream &in, std::vector<std::unique_ptr<DocObject>> &objects) :
+			in(in), objects(objects), classMap(1), objectMap(1, nullptr) { }
+
+	public:
+		void Read(void *buf, size_t len)
+		{
+			in.read(static_cast<char*>(buf), len);
+			if (in.fail()) {
+				throw Exception("Unexpected end of document");
+			}
+		}
+
+		MR_UInt8 ReadByte()
+		{
+			MR_UInt8 buf;
+			Read(&buf, 1);
+			return buf;
+		}
+
+		MR_UInt16 ReadWord()
+		{
+			MR_UInt8 buf[2];
+			Read(buf, 2);
+			return static_cast<MR_UInt16>(buf[0] | (buf[1] << 8));
+		}
+
+		MR_UInt32 ReadDword()
+		{
+			MR_UInt8 buf[4];
+			Read(buf, 4);
+			return static_cast<MR_UInt32>(buf[0]) |
+				(static_cast<MR_UInt32>(buf[1]) << 8) |
+				(static_cast<MR_UInt32>(buf[2]) << 16) |
+				(static_cast<MR_UInt32>(buf[3]) << 24);
+		}
+
+		int ReadInt() { return static_cast<MR_Int32>(ReadDword()); }
+
+		std::string ReadString()
+		{
+			size_t len = ReadByte();
+			if (len == 0xff) {
+				len = ReadWord();
+				if (len == 0xfffe) {
+					throw Exception("Unicode strings are not supported");
+				}
+				else if (len == 0xffff) {
+					len = ReadDword();
+				}
+			}
+			std::string retv(len, '\0');
+			if (len > 0) {
+				Read(&retv[0], len);
+			}
+			return retv;
+		}
+
+		template<class T>
+		T *ReadObject()
+		{
+			DocObject *obj = ReadAnyObject();
+			if (!obj) return nullptr;
+
+			T *retv = dynamic_cast<T*>(obj);
+			if (!retv) {
+				throw Exception("Unexpected object type in document");
+			}
+			return retv;
+		}
+
+		template<class T>
+		void ReadList(std::vector<T*> &list)
+		{
+			int count = ReadInt();
+			for (int i = 0; i < count; i++) {
+				list.push_back(ReadObject<T>());
+			}
+		}
+
+	private:
+		DocObject *ReadAnyObject();
+		std::unique_ptr<DocObject> NewObject(const std::string &className);
+
+	private:
+		std::istream &in;
+		std::vector<std::unique_ptr<DocObject>> &objects;
+		// Classes and objects share the same index space.
+		std::vector<std::string> classMap;
+		std::vector<DocObject*> objectMap;
+};
+
+DocObject *DocReader::ReadAnyObject()
+{
+	static const MR_UInt16 NEW_CLASS_TAG = 0xffff;
+	static const MR_UInt16 CLASS_TAG = 0x8000;
+	static const MR_UInt16 BIG_OBJECT_TAG = 0x7fff;
+	static const MR_UInt32 BIG_CLASS_TAG = 0x80000000;
+
+	MR_UInt32 tag = ReadWord();
+	bool classTag;
+	size_t index;
+
+	if (tag == BIG_OBJECT_TAG) {
+		tag = ReadDword();
+		classTag = (tag & BIG_CLASS_TAG) != 0;
+		index = tag & ~BIG_CLASS_TAG;
+	}
+	else if (tag == NEW_CLASS_TAG) {
+		ReadWord();  // Schema.
+		std::string className(ReadWord(), '\0');
+		if (!className.empty()) {
+			Read(&className[0], className.size());
+		}
+		classMap.push_back(className);
+		objectMap.push_back(nullptr);
+
+		classTag = true;
+		index = classMap.size() - 1;
+	}
+	else {
+		classTag = (tag & CLASS_TAG) != 0;
+		index = tag & ~CLASS_TAG;
+	}
+
+	if (!classTag) {
+		// Reference to an object we've already read (or null).
+		if (index >= objectMap.size() || (index != 0 && !objectMap[index])) {
+			throw Exception("Invalid object reference in document");
+		}
+		return objectMap[index];
+	}
+
+	if (index >= classMap.size() || classMap[index].empty()) {
+		throw Exception("Invalid class reference in document");
+	}
+
+	objects.emplace_back(NewObject(classMap[index]));
+	DocObject *obj = objects.back().get();
+
+	// The object is mapped before it is read, so it can be referred to
+	// by the objects it contains.
+	classMap.push_back(std::string());
+	objectMap.push_back(obj);
+
+	obj->Serialize(*this);
+	return obj;
+}
+
+std::unique_ptr<DocObject> DocReader::NewObject(const std::string &className)
+{
+	if (className == "HCNode") return std::unique_ptr<DocObject>(new Node());
+	if (className == "HCAnchorWall") return std::unique_ptr<DocObject>(new AnchorWall());
+	if (className == "HCPolygon") return std::unique_ptr<DocObject>(new Polygon());
+	if (className == "HCItem") return std::unique_ptr<DocObject>(new Item());
+	throw Exception("Unknown class in document: " + className);
+}
+
+void Node::Serialize(DocReader &in)
+{
+	mX = in.ReadInt();
+	mY = in.ReadInt();
+	mItem = in.ReadObject<Item>();
+	in.ReadList(mAnchorList);
+}
+
+void AnchorWall::Serialize(DocReader &in)
+{
+	mWallTexture = GetTypeIndex(in.ReadInt(), WALL_TEXTURES);
+	mNode = in.ReadObject<Node>();
+	mPolygon = in.ReadObject<Polygon>();
+}
+
+AnchorWall *AnchorWall::GetNext() const
+{
+	const auto &list = mPolygon->mAnchorWallList;
+	auto iter = std::find(list.begin(), list.end(), this);
+	++iter;
+	return iter == list.end() ? list.front() : *iter;
+}
+
+AnchorWall *AnchorWall::GetPrev() const
+{
+	const auto &list = mPolygon->mAnchorWallList;
+	auto iter = std::find(list.begin(), list.end(), this);
+	return iter == list.begin() ? list.back() : *(--iter);
+}
+
+void Polygon::Serialize(DocReader &in)
+{
+	mFeature = in.ReadInt() != 0;
+	mFloorTexture = GetTypeIndex(in.ReadInt(), FLOOR_TEXTURES);
+	mCeilingTexture = GetTypeIndex(in.ReadInt(), CEILING_TEXTURES);
+	mFloorLevel = in.ReadInt();
+	mCeilingLevel = in.ReadInt();
+	in.ReadList(mAnchorWallList);
+}
+
+bool Polygon::IsIncluding(int pX, int pY) const
+{
+	// First do a bounding box test
+	bool lXMin = false;
+	bool lXMax = false;
+	bool lYMin = false;
+	bool lYMax = false;
+
+	for (const AnchorWall *lAnchor : mAnchorWallList) {
+		const Node *lNode = lAnchor->mNode;
+
+		if (pX >= lNode->mX) lXMin = true;
+		if (pX <= lNode->mX) lXMax = true;
+		if (pY >= lNode->mY) lYMin = true;
+		if (pY <= lNode->mY) lYMax = true;
+	}
+
+	if (!(lXMin && lXMax && lYMin && lYMax)) {
+		return false;
+	}
+
+	for (size_t i = 0; i < mAnchorWallList.size(); i++) {
+		const Node *lNode = mAnchorWallList[i]->mNode;
+		const Node *lNextNode =
+			mAnchorWallList[(i + 1) % mAnchorWallList.size()]->mNode;
+
+		MR_Int64 lVectorProd =
+			Int32x32To64((lNextNode->mY - lNode->mY), (pX - lNode->mX)) -
+			Int32x32To64((lNextNode->mX - lNode->mX), (pY - lNode->mY));
+
+		if (lVectorProd < 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void Item::Serialize(DocReader &in)
+{
+	mNode = in.ReadObject<Node>();
+	mElementType = GetTypeIndex(in.ReadInt(), OBJECTS);
+	mDistanceFromFloor = in.ReadInt();
+	mOrientation = in.ReadInt();
+}
+
+/**
+ * A HoverCAD track document.
+ */
+class Document
+{
+	public:
+		Document(const OS::path_t &filename);
+
+	public:
+		void GenerateOutputFile(std::ostream &os, const std::string &background);
+
+	private:
+		Polygon *GetRoomForNode(const Node *pNode) const;
+
+	private:
+		std::vector<std::unique_ptr<DocObject>> objects;
+		std::vector<Node*> mNodeList;
+		std::vector<Polygon*> mPolygonList;
+		std::string mBackImageName;
+		std::string mDescription;
+};
+
+Document::Document(const OS::path_t &filename)
+{
+	boost::filesystem::ifstream in(filename, std::ios::in | std::ios::binary);
+	if (in.fail()) {
+		throw Exception(std::string("Unable to open: ") + (const char*)Str::PU(filename));
+	}
+
+	DocReader reader(in, objects);
+	reader.ReadList(mNodeList);
+	reader.ReadList(mPolygonList);
+	mBackImageName = reader.ReadString();
+	mDescription = reader.ReadString();
+}
+
+/**
+ * Generate the compiler input.
+ * Same as CHoverCadDoc::GenerateOutputFile().
+ * @param os The output stream.
+ * @param background The background image (empty to use the one
+ *                   named in the document).
+ */
+void Document::GenerateOutputFile(std::ostream &os, const std::string &background)
+{
+	// Create header section
+	std::string lDescription;
+
+	for (size_t lCounter = 0; lCounter < mDescription.length(); lCounter++) {
+		if (mDescription[lCounter] == '\r') {
+			lDescription += "\\n";
+			lCounter++;
+		}
+		else {
+			lDescription += mDescription[lCounter];
+		}
+	}
+
+	os << boost::format(
+		"[Header]\n"
+		"Description=%s\n"
+		"Background=%s\n\n") %
+		lDescription %
+		(background.empty() ? mBackImageName : background);
+
+	// Assign an id to each polygon and anchor (for a faster output)
+	int lPolygonId = 1;
+	for (Polygon *lPolygon : mPolygonList) {
+		lPolygon->mExportId = lPolygonId++;
+
+		int lAnchorId = 0;
+		for (AnchorWall *lAnchor : lPolygon->mAnchorWallList) {
+			lAnchor->mExportId = lAnchorId++;
+		}
+	}
+
+	// Export rooms(track sections) and 3D features
+	for (Polygon *lPolygon : mPolygonList) {
+		int lParent = 0;
+
+		if (lPolygon->mFeature) {
+			Polygon *lParentRoom = GetRoomForNode(lPolygon->mAnchorWallList.front()->mNode);
+
+			lParent = (lParentRoom == nullptr) ? -1 : lParentRoom->mExportId;
+
+			if (lParent != -1) {
+				os << boost::format(
+					"[Feature]\n"
+					"Id=%d\n"
+					"Parent=%d\n") %
+					lPolygon->mExportId %
+					lParent;
+			}
+		}
+		else {
+			os << boost::format(
+				"[Room]\n"
+				"Id=%d\n") %
+				lPolygon->mExportId;
+		}
+
+		if (lParent != -1) {
+			os << boost::format(
+				"floor= %f, %d, %d\n"
+				"ceiling= %f, %d, %d\n") %
+				(lPolygon->mFloorLevel / 1000.0) %
+				FLOOR_TEXTURES[lPolygon->mFloorTexture].mDllId %
+				FLOOR_TEXTURES[lPolygon->mFloorTexture].mTypeId %
+				(lPolygon->mCeilingLevel / 1000.0) %
+				CEILING_TEXTURES[lPolygon->mCeilingTexture].mDllId %
+				CEILING_TEXTURES[lPolygon->mCeilingTexture].mTypeId;
+
+			for (const AnchorWall *lAnchor : lPolygon->mAnchorWallList) {
+				os << boost::format(
+					"wall=%f, %f, %d, %d\n") %
+					(lAnchor->mNode->mX / 1000.0) %
+					(lAnchor->mNode->mY / 1000.0) %
+					WALL_TEXTURES[lAnchor->mWallTexture].mDllId %
+					WALL_TEXTURES[lAnchor->mWallTexture].mTypeId;
+			}
+			os << '\n';
+		}
+	}
+
+	// Export Initial positions
+	for (int lCounter = 0; OBJECTS[lCounter].mDllId == 0; lCounter++) {
+		// Find this object in the object list
+		const Item *lItem = nullptr;
+
+		for (const Node *lNode : mNodeList) {
+			if (lNode->mItem != nullptr && lNode->mItem->mElementType == lCounter) {
+				lItem = lNode->mItem;
+				break;
+			}
+		}
+		if (lItem == nullptr) continue;
+
+		const Polygon *lParent = GetRoomForNode(lItem->mNode);
+		if (lParent == nullptr) continue;
+
+		os << boost::format(
+			"[Initial_Position]\n"
+			"Section=%d\n"
+			"Position= %f, %f, %f\n"
+			"Orientation= %f\n"
+			"Team= %d\n\n") %
+			lParent->mExportId %
+			(lItem->mNode->mX / 1000.0) %
+			(lItem->mNode->mY / 1000.0) %
+			((lItem->mDistanceFromFloor + lParent->mFloorLevel) / 1000.0) %
+			(lItem->mOrientation / 1000.0) %
+			(lCounter + 1);
+	}
+
+	// Export other objects
+	for (const Node *lNode : mNodeList) {
+		const Item *lItem = lNode->mItem;
+
+		if (lItem != nullptr && OBJECTS[lItem->mElementType].mDllId > 0) {
+			const Polygon *lParent = GetRoomForNode(lItem->mNode);
+
+			if (lParent != nullptr) {
+				os << boost::format(
+					"[Free_Element]\n"
+					"Section=%d\n"
+					"Position= %f, %f, %f\n"
+					"Orientation= %f\n"
+					"Element_Type= %d, %d\n\n") %
+					lParent->mExportId %
+					(lItem->mNode->mX / 1000.0) %
+					(lItem->mNode->mY / 1000.0) %
+					((lItem->mDistanceFromFloor + lParent->mFloorLevel) / 1000.0) %
+					(lItem->mOrientation / 1000.0) %
+					OBJECTS[lItem->mElementType].mDllId %
+					OBJECTS[lItem->mElementType].mTypeId;
+			}
+		}
+	}
+
+	// export connections
+	os << "[Connection_List]\n";
+
+	for (const Polygon *lPolygon : mPolygonList) {
+		if (lPolygon->mFeature) continue;
+
+		for (AnchorWall *lAnchor : lPolygon->mAnchorWallList) {
+			if (lAnchor->mExportId == -1) continue;
+
+			for (const AnchorWall *lAnchor2 : lAnchor->mNode->mAnchorList) {
+				if ((lAnchor2 != lAnchor) && !lAnchor2->mPolygon->mFeature && (lAnchor2->GetPrev()->mExportId != -1)) {
+					// Verify if they are the same wall
+					if (lAnchor->GetNext()->mNode == lAnchor2->GetPrev()->mNode) {
+						// They are the same, export the connection
+						os << boost::format(
+							"%d, %d, %d, %d\n") %
+							lAnchor->mPolygon->mExportId %
+							lAnchor->mExportId %
+							lAnchor2->mPolygon->mExportId %
+							lAnchor2->GetPrev()->mExportId;
+
+						// mark this wall as being exported
+						lAnchor->mExportId = -1;
+						lAnchor2->GetPrev()->mExportId = -1;
+					}
+				}
+			}
+		}
+	}
+
+	os << "\n\n";
+}
+
+Polygon *Document::GetRoomForNode(const Node *pNode) const
+{
+	for (Polygon *lPolygon : mPolygonList) {
+		if (!lPolygon->mFeature && lPolygon->IsIncluding(pNode->mX, pNode->mY)) {
+			return lPolygon;
+		}
+	}
+	return nullptr;
+}
+
+// Compilation /////////////////////////////////////////////////////////////
+
+std::string ReadFile(const OS::path_t &filename)
+{
+	boost::filesystem::ifstream in(filename, std::ios::in | std::ios::binary);
+	std::ostringstream oss;
+	oss << in.rdbuf();
+	return oss.str();
+}
+
+/**
+ * Compile a track with a given number of threads.
+ * The visible zones cache is disabled so that every room is computed.
+ * @param src The compiler input.
+ * @param outputFilename The compiled track.
+ * @param threads The number of threads.
+ * @return The bytes of the compiled track.
+ * @throw MazeCompiler::TrackCompileExn
+ */
+std::string Compile(const std::string &src, const OS::path_t &outputFilename,
+	unsigned int threads)
+{
+	std::istringstream in(src);
+
+	MazeCompiler::TrackCompilationLogPtr compileLog(new CompilationLog());
+	MazeCompiler::TrackCompiler compiler(compileLog, outputFilename);
+	compiler.SetVisibleZonesCache(OS::path_t());
+	compiler.SetThreads(threads);
+	compiler.Compile(in);
+
+	return ReadFile(outputFilename);
+}
+
+/**
+ * Compile a track serially and in parallel and compare the results.
+ * @return @c true if the compiled tracks are identical.
+ */
+bool CheckTrack(const OS::path_t &source, const std::string &background,
+	const OS::path_t &tempDir, unsigned int threads)
+{
+	const std::string name = Str::PU(source.filename());
+
+	std::ostringstream oss;
+	Document(source).GenerateOutputFile(oss, background);
+	const std::string src = oss.str();
+
+	std::string serial, parallel;
+	try {
+		serial = Compile(src, tempDir / "serial.trk", 1);
+		parallel = Compile(src, tempDir / "parallel.trk", threads);
+	}
+	catch (MazeCompiler::TrackCompileExn &ex) {
+		std::cerr << name << ": " << ex.what() << std::endl;
+		return false;
+	}
+
+	if (serial == parallel) {
+		std::cout << name << ": " << serial.size() << " bytes, identical" <<
+			std::endl;
+		return true;
+	}
+
+	auto diff = std::mismatch(serial.begin(),
+		serial.begin() + std::min(serial.size(), parallel.size()),
+		parallel.begin());
+	std::cerr << name << ": serial (" << serial.size() << " bytes) and "
+		"parallel (" << parallel.size() << " bytes) differ at offset " <<
+		(diff.first - serial.begin()) << std::endl;
+	return false;
+}
+
+}  // namespace
+
+int main(int argc, char **argv)
+{
+	std::string background;
+	std::vector<OS::path_t> sources;
+
+	for (int i = 1; i < argc; i++) {
+		std::string arg(argv[i]);
+		if (arg == "-b" && i + 1 < argc) {
+			background = argv[++i];
+		}
+		else if (!arg.empty() && arg[0] == '-') {
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+		else {
+			sources.push_back(Str::UP(arg));
+		}
+	}
+
+	if (sources.empty()) {
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	Config *cfg = Config::Init(0, 0, 0, 0, true, OS::path_t(), OS::path_t());
+	cfg->runtime.silent = true;
+
+	VideoServices::SoundServer::Init();
+	DllObjectFactory::Init();
+
+	// Use several threads even on a single-core machine so that the rooms
+	// really are interleaved.
+	unsigned int threads = std::max(4u, std::thread::hardware_concurrency());
+
+	OS::path_t tempDir = boost::filesystem::temp_directory_path() /
+		boost::filesystem::unique_path("hoverrace-test-%%%%-%%%%-%%%%");
+	boost::filesystem::create_directories(tempDir);
+
+	int failures = 0;
+	for (const OS::path_t &source : sources) {
+		try {
+			if (!CheckTrack(source, background, tempDir, threads)) {
+				failures++;
+			}
+		}
+		catch (Exception &ex) {
+			std::cerr << Str::PU(source) << ": " << ex.what() << std::endl;
+			failures++;
+		}
+	}
+
+	boost::system::error_code ec;
+	boost::filesystem::remove_all(tempDir, ec);
+
+	DllObjectFactory::Clean(FALSE);
+	VideoServices::SoundServer::Close();
+
+	Config::Shutdown();
+
+	return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}